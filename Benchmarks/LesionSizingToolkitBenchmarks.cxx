@@ -0,0 +1,866 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    LesionSizingToolkitBenchmarks.cxx
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+// Times every feature generator, feature aggregator and segmentation module
+// of the toolkit, the hole filling and region competition filters, and the
+// full LesionSegmentationImageFilter8, on a synthetic lesion resampled to the
+// requested size and anisotropy. The results are printed as a table and
+// optionally written as JSON, to be compared across releases.
+//
+// Every repetition times the Update() of a freshly configured process
+// object, so that no stage is skipped because it is up to date. The
+// configuration is done outside of the timed section.
+
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkMetaImageIOFactory.h"
+#include "itkResampleImageFilter.h"
+#include "itkIdentityTransform.h"
+#include "itkLinearInterpolateImageFunction.h"
+#include "itkMinimumMaximumImageCalculator.h"
+#include "itkImageRegionIterator.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkMultiThreaderBase.h"
+#include "itkImageSpatialObject.h"
+#include "itkLandmarkSpatialObject.h"
+#include "itkVersion.h"
+
+#include "itkBinaryThresholdFeatureGenerator.h"
+#include "itkCannyEdgesDistanceAdvectionFieldFeatureGenerator.h"
+#include "itkCannyEdgesDistanceFeatureGenerator.h"
+#include "itkCannyEdgesFeatureGenerator.h"
+#include "itkDescoteauxSheetnessFeatureGenerator.h"
+#include "itkFrangiTubularnessFeatureGenerator.h"
+#include "itkGradientMagnitudeSigmoidFeatureGenerator.h"
+#include "itkLungWallFeatureGenerator.h"
+#include "itkMorphologicalOpenningFeatureGenerator.h"
+#include "itkSatoLocalStructureFeatureGenerator.h"
+#include "itkSatoVesselnessFeatureGenerator.h"
+#include "itkSatoVesselnessSigmoidFeatureGenerator.h"
+#include "itkSigmoidFeatureGenerator.h"
+
+#include "itkMaximumFeatureAggregator.h"
+#include "itkMinimumFeatureAggregator.h"
+#include "itkWeightedSumFeatureAggregator.h"
+
+#include "itkConfidenceConnectedSegmentationModule.h"
+#include "itkConnectedThresholdSegmentationModule.h"
+#include "itkFastMarchingAndGeodesicActiveContourLevelSetSegmentationModule.h"
+#include "itkFastMarchingAndShapeDetectionLevelSetSegmentationModule.h"
+#include "itkFastMarchingSegmentationModule.h"
+#include "itkGeodesicActiveContourLevelSetSegmentationModule.h"
+#include "itkShapeDetectionLevelSetSegmentationModule.h"
+
+#include "itkVotingBinaryHoleFillFloodingImageFilter.h"
+#include "itkRegionCompetitionImageFilter.h"
+#include "itkLesionSegmentationImageFilter8.h"
+#include "itkSegmentationStageReport.h"
+
+#include "metaCommand.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#ifndef LSTK_BENCHMARK_DEFAULT_INPUT
+#define LSTK_BENCHMARK_DEFAULT_INPUT "SphereLesion.mha"
+#endif
+
+namespace
+{
+
+constexpr unsigned int Dimension = 3;
+
+using InputPixelType = signed short;
+using BinaryPixelType = unsigned char;
+using LabelPixelType = unsigned short;
+using FeaturePixelType = float;
+
+using InputImageType = itk::Image< InputPixelType, Dimension >;
+using BinaryImageType = itk::Image< BinaryPixelType, Dimension >;
+using LabelImageType = itk::Image< LabelPixelType, Dimension >;
+using FeatureImageType = itk::Image< FeaturePixelType, Dimension >;
+
+using InputSpatialObjectType = itk::ImageSpatialObject< Dimension, InputPixelType >;
+using FeatureSpatialObjectType = itk::ImageSpatialObject< Dimension, FeaturePixelType >;
+using SeedSpatialObjectType = itk::LandmarkSpatialObject< Dimension >;
+
+using StageReportType = itk::SegmentationStageReport< Dimension >;
+
+/** Intensities of the synthetic scan, in Hounsfield units. */
+constexpr double BackgroundIntensity = -850.0;
+constexpr double LesionIntensity = 50.0;
+constexpr double NoiseStandardDeviation = 20.0;
+
+
+/** Wall times of the repetitions of one benchmark. */
+struct BenchmarkResult
+{
+  std::string             Name;
+  std::string             Category;
+  itk::SizeValueType      NumberOfVoxels;
+  std::vector< double >   WallTimes;
+  double                  CPUTime;
+  itk::SizeValueType      PeakResidentSetSize;
+
+  double GetMinimumWallTime() const
+    {
+    return *std::min_element( WallTimes.begin(), WallTimes.end() );
+    }
+
+  double GetMaximumWallTime() const
+    {
+    return *std::max_element( WallTimes.begin(), WallTimes.end() );
+    }
+
+  double GetMeanWallTime() const
+    {
+    return std::accumulate( WallTimes.begin(), WallTimes.end(), 0.0 ) / WallTimes.size();
+    }
+
+  double GetMedianWallTime() const
+    {
+    std::vector< double > sorted = WallTimes;
+    std::sort( sorted.begin(), sorted.end() );
+    const size_t middle = sorted.size() / 2;
+    return ( sorted.size() % 2 ) ? sorted[middle] : 0.5 * ( sorted[middle - 1] + sorted[middle] );
+    }
+};
+
+
+/** Runs the benchmarks and collects their results. */
+class BenchmarkRunner
+{
+public:
+  using FactoryType = std::function< itk::ProcessObject::Pointer() >;
+
+  BenchmarkRunner( unsigned int repetitions, unsigned int warmup, const std::string & selection,
+                   itk::SizeValueType numberOfVoxels ) :
+    m_Repetitions( std::max( repetitions, 1u ) ),
+    m_Warmup( warmup ),
+    m_Selection( selection ),
+    m_NumberOfVoxels( numberOfVoxels )
+    {
+    }
+
+  /** Time the update of the process objects returned by the factory, one
+   * new object per repetition. Benchmarks whose name does not contain the
+   * selection are skipped. */
+  void Run( const std::string & category, const std::string & name, const FactoryType & factory )
+    {
+    if( !m_Selection.empty() && name.find( m_Selection ) == std::string::npos )
+      {
+      return;
+      }
+
+    std::cout << "Running " << name << "..." << std::flush;
+
+    for( unsigned int i = 0; i < m_Warmup; i++ )
+      {
+      factory()->Update();
+      }
+
+    BenchmarkResult result;
+    result.Name = name;
+    result.Category = category;
+    result.NumberOfVoxels = m_NumberOfVoxels;
+    result.CPUTime = 0.0;
+
+    for( unsigned int i = 0; i < m_Repetitions; i++ )
+      {
+      itk::ProcessObject::Pointer stage = factory();
+
+      const double startCPUTime = StageReportType::GetProcessCPUTime();
+      const auto startTime = std::chrono::steady_clock::now();
+
+      stage->Update();
+
+      const auto endTime = std::chrono::steady_clock::now();
+      result.CPUTime += StageReportType::GetProcessCPUTime() - startCPUTime;
+      result.WallTimes.push_back( std::chrono::duration< double >( endTime - startTime ).count() );
+      }
+
+    result.CPUTime /= m_Repetitions;
+    result.PeakResidentSetSize = StageReportType::GetProcessPeakResidentSetSize();
+
+    std::cout << " " << result.GetMedianWallTime() << " s" << std::endl;
+
+    m_Results.push_back( result );
+    }
+
+  const std::vector< BenchmarkResult > & GetResults() const
+    {
+    return m_Results;
+    }
+
+  void WriteTable( std::ostream & os ) const
+    {
+    os << std::left << std::setw( 56 ) << "Benchmark"
+       << std::right << std::setw( 12 ) << "Min (s)"
+       << std::setw( 12 ) << "Median (s)"
+       << std::setw( 12 ) << "CPU (s)"
+       << std::setw( 14 ) << "Mvoxels/s" << std::endl;
+
+    for( const BenchmarkResult & result : m_Results )
+      {
+      const double median = result.GetMedianWallTime();
+      os << std::left << std::setw( 56 ) << ( result.Category + "/" + result.Name )
+         << std::right << std::fixed << std::setprecision( 4 )
+         << std::setw( 12 ) << result.GetMinimumWallTime()
+         << std::setw( 12 ) << median
+         << std::setw( 12 ) << result.CPUTime
+         << std::setw( 14 ) << std::setprecision( 2 )
+         << ( median > 0.0 ? result.NumberOfVoxels / median / 1e6 : 0.0 )
+         << std::endl;
+      }
+    os.unsetf( std::ios::floatfield );
+    }
+
+private:
+  unsigned int                    m_Repetitions;
+  unsigned int                    m_Warmup;
+  std::string                     m_Selection;
+  itk::SizeValueType              m_NumberOfVoxels;
+  std::vector< BenchmarkResult >  m_Results;
+};
+
+
+/** Quote a string for JSON. */
+std::string Quote( const std::string & text )
+{
+  std::string quoted = "\"";
+  for( const char c : text )
+    {
+    if( c == '"' || c == '\\' )
+      {
+      quoted += '\\';
+      }
+    quoted += c;
+    }
+  return quoted + "\"";
+}
+
+
+void WriteJSON( std::ostream & os, const std::string & inputFileName, const InputImageType * image,
+                double anisotropy, unsigned int repetitions, unsigned int warmup,
+                const std::vector< BenchmarkResult > & results )
+{
+  os << std::setprecision( 9 );
+  os << "{\n";
+  os << "  \"Configuration\": {\n";
+  os << "    \"ITKVersion\": " << Quote( itk::Version::GetITKVersion() ) << ",\n";
+  os << "    \"InputImage\": " << Quote( inputFileName ) << ",\n";
+
+  const InputImageType::SizeType & size = image->GetBufferedRegion().GetSize();
+  const InputImageType::SpacingType & spacing = image->GetSpacing();
+  os << "    \"Size\": [" << size[0] << ", " << size[1] << ", " << size[2] << "],\n";
+  os << "    \"Spacing\": [" << spacing[0] << ", " << spacing[1] << ", " << spacing[2] << "],\n";
+  os << "    \"Anisotropy\": " << anisotropy << ",\n";
+  os << "    \"NumberOfThreads\": " << itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads() << ",\n";
+  os << "    \"Repetitions\": " << repetitions << ",\n";
+  os << "    \"Warmup\": " << warmup << "\n";
+  os << "  },\n";
+
+  os << "  \"Benchmarks\": [";
+  for( size_t i = 0; i < results.size(); i++ )
+    {
+    const BenchmarkResult & result = results[i];
+    os << ( i ? ",\n" : "\n" );
+    os << "    {\n";
+    os << "      \"Name\": " << Quote( result.Name ) << ",\n";
+    os << "      \"Category\": " << Quote( result.Category ) << ",\n";
+    os << "      \"NumberOfVoxels\": " << result.NumberOfVoxels << ",\n";
+    os << "      \"MinimumWallTime\": " << result.GetMinimumWallTime() << ",\n";
+    os << "      \"MedianWallTime\": " << result.GetMedianWallTime() << ",\n";
+    os << "      \"MeanWallTime\": " << result.GetMeanWallTime() << ",\n";
+    os << "      \"MaximumWallTime\": " << result.GetMaximumWallTime() << ",\n";
+    os << "      \"CPUTime\": " << result.CPUTime << ",\n";
+    os << "      \"PeakResidentSetSize\": " << result.PeakResidentSetSize << "\n";
+    os << "    }";
+    }
+  os << "\n  ]\n";
+  os << "}\n";
+}
+
+
+/** Resample the synthetic lesion to the given number of voxels along x and
+ * y, with slices anisotropy times thicker than the in-plane spacing, and map
+ * it to CT intensities with a reproducible Gaussian noise. */
+InputImageType::Pointer CreateSyntheticScan( const std::string & fileName, unsigned int size, double anisotropy )
+{
+  using SourceImageType = itk::Image< float, Dimension >;
+  using ReaderType = itk::ImageFileReader< SourceImageType >;
+
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( fileName );
+  reader->Update();
+
+  const SourceImageType * source = reader->GetOutput();
+  const SourceImageType::SizeType & sourceSize = source->GetLargestPossibleRegion().GetSize();
+  const SourceImageType::SpacingType & sourceSpacing = source->GetSpacing();
+
+  const double inPlaneExtent = std::max( sourceSize[0] * sourceSpacing[0], sourceSize[1] * sourceSpacing[1] );
+  const double inPlaneSpacing = inPlaneExtent / size;
+
+  SourceImageType::SpacingType spacing;
+  SourceImageType::SizeType    outputSize;
+  for( unsigned int d = 0; d < Dimension; d++ )
+    {
+    spacing[d] = ( d == 2 ) ? inPlaneSpacing * anisotropy : inPlaneSpacing;
+    const double extent = sourceSize[d] * sourceSpacing[d];
+    outputSize[d] = std::max( 1l, std::lround( extent / spacing[d] ) );
+    }
+
+  using ResamplerType = itk::ResampleImageFilter< SourceImageType, SourceImageType >;
+  using TransformType = itk::IdentityTransform< double, Dimension >;
+  using InterpolatorType = itk::LinearInterpolateImageFunction< SourceImageType, double >;
+
+  ResamplerType::Pointer resampler = ResamplerType::New();
+  resampler->SetInput( source );
+  resampler->SetTransform( TransformType::New() );
+  resampler->SetInterpolator( InterpolatorType::New() );
+  resampler->SetOutputOrigin( source->GetOrigin() );
+  resampler->SetOutputDirection( source->GetDirection() );
+  resampler->SetOutputSpacing( spacing );
+  resampler->SetSize( outputSize );
+  resampler->SetDefaultPixelValue( 0.0 );
+  resampler->Update();
+
+  using CalculatorType = itk::MinimumMaximumImageCalculator< SourceImageType >;
+  CalculatorType::Pointer calculator = CalculatorType::New();
+  calculator->SetImage( source );
+  calculator->ComputeMaximum();
+  const double maximum = std::max( static_cast< double >( calculator->GetMaximum() ), 1.0 );
+
+  const SourceImageType * resampled = resampler->GetOutput();
+
+  InputImageType::Pointer scan = InputImageType::New();
+  scan->CopyInformation( resampled );
+  scan->SetRegions( resampled->GetBufferedRegion() );
+  scan->Allocate();
+
+  using RandomGeneratorType = itk::Statistics::MersenneTwisterRandomVariateGenerator;
+  RandomGeneratorType::Pointer random = RandomGeneratorType::New();
+  random->SetSeed( 1234 );
+
+  itk::ImageRegionConstIterator< SourceImageType > sitr( resampled, resampled->GetBufferedRegion() );
+  itk::ImageRegionIterator< InputImageType > oitr( scan, scan->GetBufferedRegion() );
+
+  for( sitr.GoToBegin(), oitr.GoToBegin(); !oitr.IsAtEnd(); ++sitr, ++oitr )
+    {
+    const double value = BackgroundIntensity +
+      ( LesionIntensity - BackgroundIntensity ) * sitr.Get() / maximum +
+      random->GetNormalVariate( 0.0, NoiseStandardDeviation * NoiseStandardDeviation );
+    oitr.Set( static_cast< InputPixelType >( std::round( value ) ) );
+    }
+
+  return scan;
+}
+
+
+/** Binary image of the voxels brighter than the threshold. */
+BinaryImageType::Pointer CreateBinaryImage( const InputImageType * scan, InputPixelType threshold )
+{
+  BinaryImageType::Pointer binary = BinaryImageType::New();
+  binary->CopyInformation( scan );
+  binary->SetRegions( scan->GetBufferedRegion() );
+  binary->Allocate();
+
+  itk::ImageRegionConstIterator< InputImageType > sitr( scan, scan->GetBufferedRegion() );
+  itk::ImageRegionIterator< BinaryImageType > bitr( binary, binary->GetBufferedRegion() );
+
+  for( sitr.GoToBegin(), bitr.GoToBegin(); !bitr.IsAtEnd(); ++sitr, ++bitr )
+    {
+    bitr.Set( sitr.Get() > threshold ? 255 : 0 );
+    }
+
+  return binary;
+}
+
+
+/** Two competing labels: the core of the lesion and the darkest background
+ * voxels, the rest being unlabeled. */
+LabelImageType::Pointer CreateCompetitionLabels( const InputImageType * scan )
+{
+  LabelImageType::Pointer labels = LabelImageType::New();
+  labels->CopyInformation( scan );
+  labels->SetRegions( scan->GetBufferedRegion() );
+  labels->Allocate();
+
+  const double backgroundThreshold = BackgroundIntensity - NoiseStandardDeviation;
+
+  itk::ImageRegionConstIterator< InputImageType > sitr( scan, scan->GetBufferedRegion() );
+  itk::ImageRegionIterator< LabelImageType > litr( labels, labels->GetBufferedRegion() );
+
+  for( sitr.GoToBegin(), litr.GoToBegin(); !litr.IsAtEnd(); ++sitr, ++litr )
+    {
+    const double value = sitr.Get();
+    litr.Set( value > 0.0 ? 1 : ( value < backgroundThreshold ? 2 : 0 ) );
+    }
+
+  return labels;
+}
+
+
+/** The generators LesionSegmentationImageFilter8 aggregates. */
+template <typename TAggregator>
+void AddLesionFeatureGenerators( TAggregator * aggregator, const InputSpatialObjectType * input )
+{
+  auto lungWallGenerator = itk::LungWallFeatureGenerator< Dimension >::New();
+  lungWallGenerator->SetInput( input );
+  lungWallGenerator->SetLungThreshold( -400 );
+
+  auto vesselnessGenerator = itk::SatoVesselnessSigmoidFeatureGenerator< Dimension >::New();
+  vesselnessGenerator->SetInput( input );
+  vesselnessGenerator->SetSigma( 1.0 );
+  vesselnessGenerator->SetAlpha1( 0.1 );
+  vesselnessGenerator->SetAlpha2( 2.0 );
+  vesselnessGenerator->SetSigmoidAlpha( -10.0 );
+  vesselnessGenerator->SetSigmoidBeta( 40.0 );
+
+  auto sigmoidGenerator = itk::SigmoidFeatureGenerator< Dimension >::New();
+  sigmoidGenerator->SetInput( input );
+  sigmoidGenerator->SetAlpha( 100.0 );
+  sigmoidGenerator->SetBeta( -200.0 );
+
+  auto cannyEdgesGenerator = itk::CannyEdgesFeatureGenerator< Dimension >::New();
+  cannyEdgesGenerator->SetInput( input );
+  cannyEdgesGenerator->SetSigma( 1.0 );
+  cannyEdgesGenerator->SetUpperThreshold( 150.0 );
+  cannyEdgesGenerator->SetLowerThreshold( 75.0 );
+
+  aggregator->AddFeatureGenerator( lungWallGenerator );
+  aggregator->AddFeatureGenerator( vesselnessGenerator );
+  aggregator->AddFeatureGenerator( sigmoidGenerator );
+  aggregator->AddFeatureGenerator( cannyEdgesGenerator );
+}
+
+} // end anonymous namespace
+
+
+int main( int argc, char * argv[] )
+{
+  MetaCommand command;
+  command.DisableDeprecatedWarnings();
+  command.SetDescription( "Time the feature generators, feature aggregators, segmentation modules "
+                          "and filters of the Lesion Sizing Toolkit on a synthetic lesion." );
+
+  command.AddArgument( "InputImage", false,
+    "Synthetic lesion that is resampled to build the benchmark volume.",
+    MetaCommand::STRING, LSTK_BENCHMARK_DEFAULT_INPUT );
+  command.AddArgument( "Size", false,
+    "Number of voxels of the benchmark volume along x and y.", MetaCommand::INT, "100" );
+  command.AddArgument( "Anisotropy", false,
+    "Ratio of the slice thickness to the in-plane spacing.", MetaCommand::FLOAT, "1" );
+  command.AddArgument( "Threads", false,
+    "Number of threads used by the filters. Defaults to the ITK default.", MetaCommand::INT, "0" );
+  command.AddArgument( "Repetitions", false,
+    "Number of timed runs of every benchmark.", MetaCommand::INT, "5" );
+  command.AddArgument( "Warmup", false,
+    "Number of untimed runs of every benchmark before the timed ones.", MetaCommand::INT, "1" );
+  command.AddArgument( "Benchmark", false,
+    "Only run the benchmarks whose name contains this string." );
+  command.AddArgument( "Output", false,
+    "JSON file where the configuration and the timings of the benchmarks are written." );
+
+  if( !command.Parse( argc, argv ) )
+    {
+    return EXIT_FAILURE;
+    }
+
+  const std::string inputFileName = command.GetValueAsString( "InputImage" );
+  const int size = command.GetValueAsInt( "Size" );
+  const double anisotropy = command.GetValueAsFloat( "Anisotropy" );
+  const int threads = command.GetValueAsInt( "Threads" );
+  const int repetitions = command.GetValueAsInt( "Repetitions" );
+  const int warmup = command.GetValueAsInt( "Warmup" );
+  const std::string selection = command.GetOptionWasSet( "Benchmark" ) ? command.GetValueAsString( "Benchmark" ) : "";
+
+  if( size < 8 || anisotropy < 1.0 || threads < 0 || repetitions < 1 || warmup < 0 )
+    {
+    std::cerr << "Expected a size of at least 8, an anisotropy of at least 1, "
+              << "and positive numbers of threads and repetitions." << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if( threads > 0 )
+    {
+    itk::MultiThreaderBase::SetGlobalMaximumNumberOfThreads( threads );
+    itk::MultiThreaderBase::SetGlobalDefaultNumberOfThreads( threads );
+    }
+
+  itk::MetaImageIOFactory::RegisterOneFactory();
+
+  try
+    {
+    //
+    // Inputs shared by the benchmarks, computed outside of the timings.
+    //
+    InputImageType::Pointer scan = CreateSyntheticScan( inputFileName, size, anisotropy );
+
+    InputSpatialObjectType::Pointer scanObject = InputSpatialObjectType::New();
+    scanObject->SetImage( scan );
+
+    const InputImageType::RegionType region = scan->GetBufferedRegion();
+
+    InputImageType::IndexType centerIndex;
+    for( unsigned int d = 0; d < Dimension; d++ )
+      {
+      centerIndex[d] = region.GetIndex()[d] + region.GetSize()[d] / 2;
+      }
+    InputImageType::PointType center;
+    scan->TransformIndexToPhysicalPoint( centerIndex, center );
+
+    SeedSpatialObjectType::PointListType seeds( 1 );
+    seeds[0].SetPosition( center );
+
+    SeedSpatialObjectType::Pointer seedObject = SeedSpatialObjectType::New();
+    seedObject->SetPoints( seeds );
+
+    // Speed image of the segmentation modules, bright in the lesion.
+    auto speedGenerator = itk::SigmoidFeatureGenerator< Dimension >::New();
+    speedGenerator->SetInput( scanObject );
+    speedGenerator->SetAlpha( 100.0 );
+    speedGenerator->SetBeta( -200.0 );
+    speedGenerator->Update();
+
+    const auto * speedObject = dynamic_cast< const FeatureSpatialObjectType * >( speedGenerator->GetFeature() );
+    FeatureSpatialObjectType::Pointer featureObject = FeatureSpatialObjectType::New();
+    featureObject->SetImage( speedObject->GetImage() );
+
+    // Initial level set of the level set modules.
+    auto fastMarchingModule = itk::FastMarchingSegmentationModule< Dimension >::New();
+    fastMarchingModule->SetInput( seedObject );
+    fastMarchingModule->SetFeature( featureObject );
+    fastMarchingModule->SetStoppingValue( 5.0 );
+    fastMarchingModule->SetDistanceFromSeeds( 2.0 );
+    fastMarchingModule->Update();
+
+    const auto * levelSetObject =
+      dynamic_cast< const FeatureSpatialObjectType * >( fastMarchingModule->GetOutput() );
+    FeatureSpatialObjectType::Pointer initialLevelSetObject = FeatureSpatialObjectType::New();
+    initialLevelSetObject->SetImage( levelSetObject->GetImage() );
+
+    BinaryImageType::Pointer holeyLesion = CreateBinaryImage( scan, 0 );
+    LabelImageType::Pointer competitionLabels = CreateCompetitionLabels( scan );
+
+    std::cout << "Benchmark volume of " << region.GetSize() << " voxels, spacing "
+              << scan->GetSpacing() << ", "
+              << itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads() << " threads" << std::endl;
+
+    BenchmarkRunner runner( repetitions, warmup, selection, region.GetNumberOfPixels() );
+
+    //
+    // Feature generators
+    //
+    runner.Run( "FeatureGenerator", "BinaryThresholdFeatureGenerator", [&]() {
+      auto generator = itk::BinaryThresholdFeatureGenerator< Dimension >::New();
+      generator->SetInput( scanObject );
+      generator->SetThreshold( -400.0 );
+      return itk::ProcessObject::Pointer( generator.GetPointer() );
+      } );
+
+    runner.Run( "FeatureGenerator", "CannyEdgesFeatureGenerator", [&]() {
+      auto generator = itk::CannyEdgesFeatureGenerator< Dimension >::New();
+      generator->SetInput( scanObject );
+      generator->SetSigma( 1.0 );
+      generator->SetUpperThreshold( 150.0 );
+      generator->SetLowerThreshold( 75.0 );
+      return itk::ProcessObject::Pointer( generator.GetPointer() );
+      } );
+
+    runner.Run( "FeatureGenerator", "CannyEdgesDistanceFeatureGenerator", [&]() {
+      auto generator = itk::CannyEdgesDistanceFeatureGenerator< Dimension >::New();
+      generator->SetInput( scanObject );
+      generator->SetSigma( 1.0 );
+      generator->SetUpperThreshold( 150.0 );
+      generator->SetLowerThreshold( 75.0 );
+      return itk::ProcessObject::Pointer( generator.GetPointer() );
+      } );
+
+    runner.Run( "FeatureGenerator", "CannyEdgesDistanceAdvectionFieldFeatureGenerator", [&]() {
+      auto generator = itk::CannyEdgesDistanceAdvectionFieldFeatureGenerator< Dimension >::New();
+      generator->SetInput( scanObject );
+      generator->SetSigma( 1.0 );
+      generator->SetUpperThreshold( 150.0 );
+      generator->SetLowerThreshold( 75.0 );
+      return itk::ProcessObject::Pointer( generator.GetPointer() );
+      } );
+
+    runner.Run( "FeatureGenerator", "DescoteauxSheetnessFeatureGenerator", [&]() {
+      auto generator = itk::DescoteauxSheetnessFeatureGenerator< Dimension >::New();
+      generator->SetInput( scanObject );
+      generator->SetSigma( 1.0 );
+      return itk::ProcessObject::Pointer( generator.GetPointer() );
+      } );
+
+    runner.Run( "FeatureGenerator", "FrangiTubularnessFeatureGenerator", [&]() {
+      auto generator = itk::FrangiTubularnessFeatureGenerator< Dimension >::New();
+      generator->SetInput( scanObject );
+      generator->SetSigma( 1.0 );
+      return itk::ProcessObject::Pointer( generator.GetPointer() );
+      } );
+
+    runner.Run( "FeatureGenerator", "GradientMagnitudeSigmoidFeatureGenerator", [&]() {
+      auto generator = itk::GradientMagnitudeSigmoidFeatureGenerator< Dimension >::New();
+      generator->SetInput( scanObject );
+      generator->SetSigma( 1.0 );
+      generator->SetAlpha( -1.0 );
+      generator->SetBeta( 128.0 );
+      return itk::ProcessObject::Pointer( generator.GetPointer() );
+      } );
+
+    runner.Run( "FeatureGenerator", "LungWallFeatureGenerator", [&]() {
+      auto generator = itk::LungWallFeatureGenerator< Dimension >::New();
+      generator->SetInput( scanObject );
+      generator->SetLungThreshold( -400 );
+      return itk::ProcessObject::Pointer( generator.GetPointer() );
+      } );
+
+    runner.Run( "FeatureGenerator", "MorphologicalOpenningFeatureGenerator", [&]() {
+      auto generator = itk::MorphologicalOpenningFeatureGenerator< Dimension >::New();
+      generator->SetInput( scanObject );
+      generator->SetLungThreshold( -400 );
+      return itk::ProcessObject::Pointer( generator.GetPointer() );
+      } );
+
+    runner.Run( "FeatureGenerator", "SatoLocalStructureFeatureGenerator", [&]() {
+      auto generator = itk::SatoLocalStructureFeatureGenerator< Dimension >::New();
+      generator->SetInput( scanObject );
+      generator->SetSigma( 1.0 );
+      return itk::ProcessObject::Pointer( generator.GetPointer() );
+      } );
+
+    runner.Run( "FeatureGenerator", "SatoVesselnessFeatureGenerator", [&]() {
+      auto generator = itk::SatoVesselnessFeatureGenerator< Dimension >::New();
+      generator->SetInput( scanObject );
+      generator->SetSigma( 1.0 );
+      generator->SetAlpha1( 0.1 );
+      generator->SetAlpha2( 2.0 );
+      return itk::ProcessObject::Pointer( generator.GetPointer() );
+      } );
+
+    runner.Run( "FeatureGenerator", "SatoVesselnessFeatureGenerator (VED)", [&]() {
+      auto generator = itk::SatoVesselnessFeatureGenerator< Dimension >::New();
+      generator->SetInput( scanObject );
+      generator->SetSigma( 1.0 );
+      generator->SetAlpha1( 0.1 );
+      generator->SetAlpha2( 2.0 );
+      generator->SetUseVesselEnhancingDiffusion( true );
+      return itk::ProcessObject::Pointer( generator.GetPointer() );
+      } );
+
+    runner.Run( "FeatureGenerator", "SatoVesselnessSigmoidFeatureGenerator", [&]() {
+      auto generator = itk::SatoVesselnessSigmoidFeatureGenerator< Dimension >::New();
+      generator->SetInput( scanObject );
+      generator->SetSigma( 1.0 );
+      generator->SetAlpha1( 0.1 );
+      generator->SetAlpha2( 2.0 );
+      generator->SetSigmoidAlpha( -10.0 );
+      generator->SetSigmoidBeta( 40.0 );
+      return itk::ProcessObject::Pointer( generator.GetPointer() );
+      } );
+
+    runner.Run( "FeatureGenerator", "SigmoidFeatureGenerator", [&]() {
+      auto generator = itk::SigmoidFeatureGenerator< Dimension >::New();
+      generator->SetInput( scanObject );
+      generator->SetAlpha( 100.0 );
+      generator->SetBeta( -200.0 );
+      return itk::ProcessObject::Pointer( generator.GetPointer() );
+      } );
+
+    //
+    // Feature aggregators, including the generation of their features.
+    //
+    runner.Run( "FeatureAggregator", "MinimumFeatureAggregator", [&]() {
+      auto aggregator = itk::MinimumFeatureAggregator< Dimension >::New();
+      AddLesionFeatureGenerators( aggregator.GetPointer(), scanObject );
+      return itk::ProcessObject::Pointer( aggregator.GetPointer() );
+      } );
+
+    runner.Run( "FeatureAggregator", "MinimumFeatureAggregator (parallel)", [&]() {
+      auto aggregator = itk::MinimumFeatureAggregator< Dimension >::New();
+      AddLesionFeatureGenerators( aggregator.GetPointer(), scanObject );
+      aggregator->SetUseParallelFeatureGeneration( true );
+      return itk::ProcessObject::Pointer( aggregator.GetPointer() );
+      } );
+
+    runner.Run( "FeatureAggregator", "MinimumFeatureAggregator (tiled)", [&]() {
+      auto aggregator = itk::MinimumFeatureAggregator< Dimension >::New();
+      AddLesionFeatureGenerators( aggregator.GetPointer(), scanObject );
+      aggregator->SetUseTiledFeatureGeneration( true );
+      return itk::ProcessObject::Pointer( aggregator.GetPointer() );
+      } );
+
+    runner.Run( "FeatureAggregator", "MaximumFeatureAggregator", [&]() {
+      auto aggregator = itk::MaximumFeatureAggregator< Dimension >::New();
+      AddLesionFeatureGenerators( aggregator.GetPointer(), scanObject );
+      return itk::ProcessObject::Pointer( aggregator.GetPointer() );
+      } );
+
+    runner.Run( "FeatureAggregator", "WeightedSumFeatureAggregator", [&]() {
+      auto aggregator = itk::WeightedSumFeatureAggregator< Dimension >::New();
+      AddLesionFeatureGenerators( aggregator.GetPointer(), scanObject );
+      for( unsigned int i = 0; i < 4; i++ )
+        {
+        aggregator->AddWeight( 0.25 );
+        }
+      return itk::ProcessObject::Pointer( aggregator.GetPointer() );
+      } );
+
+    //
+    // Segmentation modules, on the speed image and the initial level set.
+    //
+    runner.Run( "SegmentationModule", "ConfidenceConnectedSegmentationModule", [&]() {
+      auto module = itk::ConfidenceConnectedSegmentationModule< Dimension >::New();
+      module->SetInput( seedObject );
+      module->SetFeature( featureObject );
+      module->SetSigmaMultiplier( 2.5 );
+      return itk::ProcessObject::Pointer( module.GetPointer() );
+      } );
+
+    runner.Run( "SegmentationModule", "ConnectedThresholdSegmentationModule", [&]() {
+      auto module = itk::ConnectedThresholdSegmentationModule< Dimension >::New();
+      module->SetInput( seedObject );
+      module->SetFeature( featureObject );
+      module->SetLowerThreshold( 0.5 );
+      module->SetUpperThreshold( 1.0 );
+      return itk::ProcessObject::Pointer( module.GetPointer() );
+      } );
+
+    runner.Run( "SegmentationModule", "FastMarchingSegmentationModule", [&]() {
+      auto module = itk::FastMarchingSegmentationModule< Dimension >::New();
+      module->SetInput( seedObject );
+      module->SetFeature( featureObject );
+      module->SetStoppingValue( 5.0 );
+      module->SetDistanceFromSeeds( 2.0 );
+      return itk::ProcessObject::Pointer( module.GetPointer() );
+      } );
+
+    runner.Run( "SegmentationModule", "GeodesicActiveContourLevelSetSegmentationModule", [&]() {
+      auto module = itk::GeodesicActiveContourLevelSetSegmentationModule< Dimension >::New();
+      module->SetInput( initialLevelSetObject );
+      module->SetFeature( featureObject );
+      module->SetMaximumNumberOfIterations( 100 );
+      return itk::ProcessObject::Pointer( module.GetPointer() );
+      } );
+
+    runner.Run( "SegmentationModule", "ShapeDetectionLevelSetSegmentationModule", [&]() {
+      auto module = itk::ShapeDetectionLevelSetSegmentationModule< Dimension >::New();
+      module->SetInput( initialLevelSetObject );
+      module->SetFeature( featureObject );
+      module->SetMaximumNumberOfIterations( 100 );
+      return itk::ProcessObject::Pointer( module.GetPointer() );
+      } );
+
+    runner.Run( "SegmentationModule", "FastMarchingAndGeodesicActiveContourLevelSetSegmentationModule", [&]() {
+      auto module = itk::FastMarchingAndGeodesicActiveContourLevelSetSegmentationModule< Dimension >::New();
+      module->SetInput( seedObject );
+      module->SetFeature( featureObject );
+      module->SetStoppingValue( 5.0 );
+      module->SetDistanceFromSeeds( 2.0 );
+      module->SetMaximumNumberOfIterations( 100 );
+      return itk::ProcessObject::Pointer( module.GetPointer() );
+      } );
+
+    runner.Run( "SegmentationModule", "FastMarchingAndShapeDetectionLevelSetSegmentationModule", [&]() {
+      auto module = itk::FastMarchingAndShapeDetectionLevelSetSegmentationModule< Dimension >::New();
+      module->SetInput( seedObject );
+      module->SetFeature( featureObject );
+      module->SetStoppingValue( 5.0 );
+      module->SetDistanceFromSeeds( 2.0 );
+      module->SetMaximumNumberOfIterations( 100 );
+      return itk::ProcessObject::Pointer( module.GetPointer() );
+      } );
+
+    //
+    // Filters
+    //
+    runner.Run( "Filter", "VotingBinaryHoleFillFloodingImageFilter", [&]() {
+      using FilterType = itk::VotingBinaryHoleFillFloodingImageFilter< BinaryImageType, BinaryImageType >;
+      FilterType::Pointer filter = FilterType::New();
+      FilterType::InputSizeType radius;
+      radius.Fill( 1 );
+      filter->SetInput( holeyLesion );
+      filter->SetRadius( radius );
+      filter->SetBackgroundValue( 0 );
+      filter->SetForegroundValue( 255 );
+      filter->SetMajorityThreshold( 1 );
+      filter->SetMaximumNumberOfIterations( 10 );
+      return itk::ProcessObject::Pointer( filter.GetPointer() );
+      } );
+
+    runner.Run( "Filter", "RegionCompetitionImageFilter", [&]() {
+      using FilterType = itk::RegionCompetitionImageFilter< InputImageType, LabelImageType >;
+      FilterType::Pointer filter = FilterType::New();
+      filter->SetInput( scan );
+      filter->SetInputLabels( competitionLabels );
+      filter->SetMaximumNumberOfIterations( 10 );
+      return itk::ProcessObject::Pointer( filter.GetPointer() );
+      } );
+
+    using SegmentationFilterType = itk::LesionSegmentationImageFilter8< InputImageType, FeatureImageType >;
+
+    runner.Run( "Filter", "LesionSegmentationImageFilter8", [&]() {
+      SegmentationFilterType::Pointer filter = SegmentationFilterType::New();
+      filter->SetInput( scan );
+      filter->SetSeeds( seeds );
+      filter->SetRegionOfInterest( region );
+      filter->SetSigmoidBeta( -200.0 );
+      return itk::ProcessObject::Pointer( filter.GetPointer() );
+      } );
+
+    runner.Run( "Filter", "LesionSegmentationImageFilter8 (parallel features)", [&]() {
+      SegmentationFilterType::Pointer filter = SegmentationFilterType::New();
+      filter->SetInput( scan );
+      filter->SetSeeds( seeds );
+      filter->SetRegionOfInterest( region );
+      filter->SetSigmoidBeta( -200.0 );
+      filter->SetUseParallelFeatureGeneration( true );
+      return itk::ProcessObject::Pointer( filter.GetPointer() );
+      } );
+
+    std::cout << std::endl;
+    runner.WriteTable( std::cout );
+
+    if( command.GetOptionWasSet( "Output" ) )
+      {
+      std::ofstream output( command.GetValueAsString( "Output" ).c_str() );
+      if( !output )
+        {
+        std::cerr << "Could not write " << command.GetValueAsString( "Output" ) << std::endl;
+        return EXIT_FAILURE;
+        }
+      WriteJSON( output, inputFileName, scan, anisotropy, repetitions, warmup, runner.GetResults() );
+      }
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -31,8 +31,15 @@
 #include "vtkWindowToImageFilter.h"
 #include "vtkPNGWriter.h"
 #include "itkOrientImageFilter.h"
+#include "itkChangeInformationImageFilter.h"
+#include "itkRegionOfInterestImageFilter.h"
+#include "itkContinuousIndex.h"
 #include "vtkVersion.h"
 
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
 // This needs to come after the other includes to prevent the global definitions
 // of PixelType to be shadowed by other declarations.
 #include "itkLesionSegmentationImageFilter8.h"
@@ -71,13 +78,11 @@ protected:
 
 
 // --------------------------------------------------------------------------
-LesionSegmentationCLI::InputImageType::Pointer GetImage( std::string dir, bool ignoreDirection )
-{
-  const unsigned int Dimension = LesionSegmentationCLI::ImageDimension;
-  using ImageType = itk::Image< LesionSegmentationCLI::PixelType, Dimension >;
+using DICOMSeriesReaderType = itk::ImageSeriesReader< LesionSegmentationCLI::InputImageType >;
 
-  using ReaderType = itk::ImageSeriesReader< ImageType >;
-  ReaderType::Pointer reader = ReaderType::New();
+DICOMSeriesReaderType::Pointer GetDICOMSeriesReader( std::string dir )
+{
+  DICOMSeriesReaderType::Pointer reader = DICOMSeriesReaderType::New();
 
   using ImageIOType = itk::GDCMImageIO;
   ImageIOType::Pointer dicomIO = ImageIOType::New();
@@ -137,30 +142,145 @@ LesionSegmentationCLI::InputImageType::Pointer GetImage( std::string dir, bool i
 
 
     reader->SetFileNames( fileNames );
+    return reader;
+    }
+  catch (itk::ExceptionObject &ex)
+    {
+    std::cout << ex << std::endl;
+    return NULL;
+    }
 
-    try
+  return NULL;
+}
+
+// --------------------------------------------------------------------------
+LesionSegmentationCLI::InputImageType::Pointer GetImage( std::string dir, bool ignoreDirection )
+{
+  using ImageType = LesionSegmentationCLI::InputImageType;
+
+  DICOMSeriesReaderType::Pointer reader = GetDICOMSeriesReader( dir );
+  if (!reader)
+    {
+    return NULL;
+    }
+
+  try
+    {
+    reader->Update();
+    }
+  catch (itk::ExceptionObject &ex)
+    {
+    std::cout << ex << std::endl;
+    return NULL;
+    }
+
+
+  ImageType::Pointer image = reader->GetOutput();
+  ImageType::DirectionType direction;
+  direction.SetIdentity();
+  image->DisconnectPipeline();
+  std::cout << "Image Direction:" << image->GetDirection() << std::endl;
+
+
+  if (ignoreDirection)
+    {
+    std::cout << "Ignoring the direction of the DICOM image and using identity." << std::endl;
+    image->SetDirection(direction);
+    }
+  return image;
+}
+
+// --------------------------------------------------------------------------
+// Read only the voxels of the ROI, and reorient only those. The ROI is first
+// computed from the header of the image and the seeds, then the matching
+// region is requested from the reader. Readers that can stream (uncompressed
+// MetaImage for instance) only load that region, and a DICOM series reader
+// only loads the slices it spans. Orienting preserves the physical
+// coordinates, so the ROI computed on the result is the same as the one
+// computed on the whole volume.
+LesionSegmentationCLI::InputImageType::Pointer GetImageRegionOfInterest(
+  itk::ImageSource< LesionSegmentationCLI::InputImageType > * source,
+  bool ignoreDirection, LesionSegmentationCLI &args )
+{
+  using ImageType = LesionSegmentationCLI::InputImageType;
+  const unsigned int Dimension = LesionSegmentationCLI::ImageDimension;
+
+  using ChangeInformationFilterType = itk::ChangeInformationImageFilter< ImageType >;
+  using ROIFilterType = itk::RegionOfInterestImageFilter< ImageType, ImageType >;
+  using OrientFilterType = itk::OrientImageFilter< ImageType, ImageType >;
+
+  ImageType::DirectionType direction;
+  direction.SetIdentity();
+
+  try
+    {
+    ChangeInformationFilterType::Pointer changeInformation = ChangeInformationFilterType::New();
+    changeInformation->SetInput( source->GetOutput() );
+    if (ignoreDirection)
       {
-      reader->Update();
+      std::cout << "Ignoring the direction of the image and using identity." << std::endl;
+      changeInformation->SetOutputDirection( direction );
+      changeInformation->ChangeDirectionOn();
+      }
+    changeInformation->UpdateOutputInformation();
+    const ImageType * header = changeInformation->GetOutput();
+    std::cout << "Image Direction:" << header->GetDirection() << std::endl;
+
+    // Seeds in pixel units refer to the reoriented image, hand the seeds
+    // and the ROI the geometry it will have.
+    OrientFilterType::Pointer orienter = OrientFilterType::New();
+    orienter->UseImageDirectionOn();
+    orienter->SetDesiredCoordinateDirection( direction );
+    orienter->SetInput( header );
+    orienter->UpdateOutputInformation();
+    args.SetImage( orienter->GetOutput() );
+
+    // Region of the file covered by the physical bounds of the ROI, with a
+    // voxel of margin for the rounding done later on.
+    const double *roi = args.GetROI();
+    ImageType::IndexType lower, upper;
+    lower.Fill( itk::NumericTraits< itk::IndexValueType >::max() );
+    upper.Fill( itk::NumericTraits< itk::IndexValueType >::NonpositiveMin() );
+    for (unsigned int corner = 0; corner < (1u << Dimension); corner++)
+      {
+      ImageType::PointType p;
+      for (unsigned int i = 0; i < Dimension; i++)
+        {
+        p[i] = roi[2*i + ((corner >> i) & 1)];
+        }
+      itk::ContinuousIndex< double, Dimension > index;
+      header->TransformPhysicalPointToContinuousIndex( p, index );
+      for (unsigned int i = 0; i < Dimension; i++)
+        {
+        lower[i] = std::min( lower[i], static_cast< itk::IndexValueType >( std::floor( index[i] ) ) - 1 );
+        upper[i] = std::max( upper[i], static_cast< itk::IndexValueType >( std::ceil( index[i] ) ) + 1 );
+        }
+      }
+
+    ImageType::SizeType size;
+    for (unsigned int i = 0; i < Dimension; i++)
+      {
+      size[i] = static_cast< itk::SizeValueType >( upper[i] - lower[i] + 1 );
       }
-    catch (itk::ExceptionObject &ex)
+    ImageType::RegionType region( lower, size );
+    if (!region.Crop( header->GetLargestPossibleRegion() ))
       {
-      std::cout << ex << std::endl;
+      std::cerr << "ROI has no overlap with the image region of "
+                << header->GetLargestPossibleRegion() << std::endl;
       return NULL;
       }
 
+    std::cout << "Reading region " << region << " of the image" << std::endl;
 
-    ImageType::Pointer image = reader->GetOutput();
-    ImageType::DirectionType direction;
-    direction.SetIdentity();
-    image->DisconnectPipeline();
-    std::cout << "Image Direction:" << image->GetDirection() << std::endl;
+    ROIFilterType::Pointer roiFilter = ROIFilterType::New();
+    roiFilter->SetInput( header );
+    roiFilter->SetRegionOfInterest( region );
 
+    orienter->SetInput( roiFilter->GetOutput() );
+    orienter->Update();
 
-    if (ignoreDirection)
-      {
-      std::cout << "Ignoring the direction of the DICOM image and using identity." << std::endl;
-      image->SetDirection(direction);
-      }
+    ImageType::Pointer image = orienter->GetOutput();
+    image->DisconnectPipeline();
     return image;
     }
   catch (itk::ExceptionObject &ex)
@@ -396,12 +516,28 @@ int main( int argc, char * argv[] )
   InputImageType::Pointer image;
 
   std::cout << "Reading " << args.GetValueAsString("InputImage") << ".." << std::endl;
-  if (!args.GetValueAsString("InputDICOMDir").empty())
+  if (args.GetValueAsBool("StreamROI"))
     {
-    std::cout << "Reading from DICOM dir " << args.GetValueAsString("InputDICOMDir") << ".." << std::endl;
-    image = GetImage(
-      args.GetValueAsString("InputDICOMDir"),
-      args.GetValueAsBool("IgnoreDirection"));
+    using ImageSourceType = itk::ImageSource< InputImageType >;
+    ImageSourceType::Pointer source;
+    bool ignoreDirection = false;
+
+    if (!args.GetValueAsString("InputImage").empty())
+      {
+      reader->SetFileName(args.GetValueAsString("InputImage"));
+      source = reader.GetPointer();
+      }
+    else if (!args.GetValueAsString("InputDICOMDir").empty())
+      {
+      std::cout << "Reading from DICOM dir " << args.GetValueAsString("InputDICOMDir") << ".." << std::endl;
+      source = GetDICOMSeriesReader(args.GetValueAsString("InputDICOMDir")).GetPointer();
+      ignoreDirection = args.GetValueAsBool("IgnoreDirection");
+      }
+
+    if (source)
+      {
+      image = GetImageRegionOfInterest(source, ignoreDirection, args);
+      }
 
     if (!image)
       {
@@ -409,28 +545,43 @@ int main( int argc, char * argv[] )
       return EXIT_FAILURE;
       }
     }
-
-  if (!args.GetValueAsString("InputImage").empty())
+  else
     {
-    reader->SetFileName(args.GetValueAsString("InputImage"));
-    reader->Update();
-    image = reader->GetOutput();
-    }
+    if (!args.GetValueAsString("InputDICOMDir").empty())
+      {
+      std::cout << "Reading from DICOM dir " << args.GetValueAsString("InputDICOMDir") << ".." << std::endl;
+      image = GetImage(
+        args.GetValueAsString("InputDICOMDir"),
+        args.GetValueAsBool("IgnoreDirection"));
 
+      if (!image)
+        {
+        std::cerr << "Failed to read the input image" << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
 
-  //To make sure the tumor polydata aligns with the image volume during
-  //vtk rendering in ViewImageAndSegmentationSurface(),
-  //reorient image so that the direction matrix is an identity matrix.
-  using InputReaderType = itk::ImageFileReader< InputImageType >;
-  itk::OrientImageFilter<InputImageType,InputImageType>::Pointer orienter =
-  itk::OrientImageFilter<InputImageType,InputImageType>::New();
-  orienter->UseImageDirectionOn();
-  InputImageType::DirectionType direction;
-  direction.SetIdentity();
-  orienter->SetDesiredCoordinateDirection (direction);
-  orienter->SetInput(image);
-  orienter->Update();
-  image = orienter->GetOutput();
+    if (!args.GetValueAsString("InputImage").empty())
+      {
+      reader->SetFileName(args.GetValueAsString("InputImage"));
+      reader->Update();
+      image = reader->GetOutput();
+      }
+
+
+    //To make sure the tumor polydata aligns with the image volume during
+    //vtk rendering in ViewImageAndSegmentationSurface(),
+    //reorient image so that the direction matrix is an identity matrix.
+    itk::OrientImageFilter<InputImageType,InputImageType>::Pointer orienter =
+    itk::OrientImageFilter<InputImageType,InputImageType>::New();
+    orienter->UseImageDirectionOn();
+    InputImageType::DirectionType direction;
+    direction.SetIdentity();
+    orienter->SetDesiredCoordinateDirection (direction);
+    orienter->SetInput(image);
+    orienter->Update();
+    image = orienter->GetOutput();
+    }
 
   // Set the image object on the args
   args.SetImage( image );
@@ -522,8 +673,39 @@ int main( int argc, char * argv[] )
     seg->SetSigma(args.GetSigmas());
     }
   seg->SetSigmoidBeta(args.GetValueAsBool("PartSolid") ? -500 : -200 );
+
+  using FeatureCacheType = SegmentationFilterType::FeatureCacheType;
+  FeatureCacheType::Pointer featureCache = FeatureCacheType::New();
+  if (args.GetOptionWasSet("FeatureCacheDirectory"))
+    {
+    featureCache->SetDirectory(args.GetValueAsString("FeatureCacheDirectory"));
+    featureCache->SetMaximumSize(
+      static_cast< itk::SizeValueType >(args.GetValueAsInt("FeatureCacheSize")) * 1024 * 1024);
+    seg->SetFeatureCache(featureCache);
+    }
+
+  using StageReportType = SegmentationFilterType::StageReportType;
+  StageReportType::Pointer stageReport = StageReportType::New();
+  if (args.GetOptionWasSet("StageReport"))
+    {
+    seg->SetStageReport(stageReport);
+    }
+
   seg->Update();
 
+  if (args.GetOptionWasSet("StageReport"))
+    {
+    std::cout << "Writing the stage report as: "
+      << args.GetValueAsString("StageReport") << std::endl;
+    std::ofstream reportFile(args.GetValueAsString("StageReport").c_str());
+    if (!reportFile)
+      {
+      std::cerr << "Cannot write " << args.GetValueAsString("StageReport") << std::endl;
+      return EXIT_FAILURE;
+      }
+    stageReport->WriteJSON(reportFile);
+    }
+
 
   if (!args.GetValueAsString("OutputImage").empty())
     {
@@ -62,6 +62,14 @@ public:
     this->AddArgument("Screenshot",false,"Screenshot PNG file of the final segmented surface (requires \"Visualize\" to be ON.");
     this->AddArgument("ShowBoundingBox", false,
       "Show the ROI used for the segmentation as a bounding box on the visualization.", MetaCommand::BOOL, "0");
+    this->AddArgument("FeatureCacheDirectory", false,
+      "Directory where the features are cached between runs. Re-running the segmentation of the same data with different seeds then skips the feature computation.");
+    this->AddArgument("FeatureCacheSize", false,
+      "Maximum size of the feature cache in MB. The least recently used features are evicted beyond that size.", MetaCommand::INT, "1024");
+    this->AddArgument("StreamROI", false,
+      "Read and reorient only the ROI instead of the whole volume. This reduces the time and memory needed to load large scans, particularly uncompressed MetaImage files and DICOM series. The image shown by the Visualize flag is then the ROI only.", MetaCommand::BOOL, "0");
+    this->AddArgument("StageReport", false,
+      "JSON file where the wall time, CPU time, peak memory increase and number of voxels of every stage of the segmentation are written.");
     this->AddArgument("GetZSpacingFromSliceNameRegex",false,
       "This option was added for the NIST Biochange challenge where the Z seed index was specified by providing the filename of the DICOM slice where the seed resides. Hence if this option is specified, the Z value of the seed is ignored.");
 
@@ -215,11 +223,11 @@ public:
       pointSeed[2] = sz;
       IndexType indexSeed;
       m_Image->TransformPhysicalPointToIndex(pointSeed, indexSeed);
-      if (!this->m_Image->GetBufferedRegion().IsInside(indexSeed))
+      if (!this->m_Image->GetLargestPossibleRegion().IsInside(indexSeed))
         {
         std::cerr << "Seed with pixel units of index: " <<
             indexSeed << " does not lie within the image. The images extents are"
-          << this->m_Image->GetBufferedRegion() << std::endl;
+          << this->m_Image->GetLargestPossibleRegion() << std::endl;
         exit(-1);
         }      
 
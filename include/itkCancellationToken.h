@@ -0,0 +1,159 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkCancellationToken.h
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkCancellationToken_h
+#define itkCancellationToken_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkProcessObject.h"
+
+#include <atomic>
+
+namespace itk
+{
+
+/** \class CancellationToken
+ * \brief Flag shared by the iterative filters of a pipeline to stop early.
+ *
+ * Cancel() may be called from any thread. The iterative loops of the
+ * toolkit poll the token at least every PollingInterval pixels, seeds or
+ * edge nodes, and once per iteration. When they find it cancelled they stop
+ * as if their filter had been aborted.
+ *
+ * A filter polls the token it was given with SetCancellationToken(), or
+ * else the current token of the thread executing it. A Scope makes a token
+ * current on its thread for its lifetime, so that a composite filter can
+ * reach all the filters of its internal pipeline without wiring the token
+ * through them. Code that executes filters on other threads installs the
+ * current token of the launching thread on its workers.
+ *
+ * A filter that finds the token cancelled throws ProcessAborted once its
+ * working memory is released, so that its partial output is never taken
+ * as up to date. Filters that do not poll the token, those of ITK itself,
+ * are stopped through an AbortObserver, which aborts them from their next
+ * progress or iteration event.
+ *
+ * The latency of a cancellation is thus the time to process
+ * PollingInterval pixels, or one iteration, in the polling filters, and
+ * the time between two progress or iteration events in the others, a few
+ * milliseconds for the images of a lesion.
+ *
+ * \ingroup LesionSizingToolkit
+ */
+class CancellationToken : public Object
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(CancellationToken);
+
+  /** Standard class type alias. */
+  using Self = CancellationToken;
+  using Superclass = Object;
+  using Pointer = SmartPointer<Self>;
+  using ConstPointer = SmartPointer<const Self>;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(CancellationToken, Object);
+
+  /** Number of pixels, seeds or nodes that a loop may process between two
+   * polls of the token. */
+  static constexpr SizeValueType PollingInterval = 4096;
+
+  /** Request the filters polling the token to stop. */
+  void Cancel();
+
+  /** Clear the request, so that the token can serve the next execution. */
+  void Reset();
+
+  bool IsCancellationRequested() const
+    {
+    return this->m_CancellationRequested.load( std::memory_order_relaxed );
+    }
+
+  /** Token made current on the calling thread by the innermost Scope, or
+   * null if there is none. */
+  static CancellationToken * GetCurrent();
+
+  /** The given token, or the current one when it is null. */
+  static CancellationToken * Resolve( CancellationToken * token )
+    {
+    return token ? token : GetCurrent();
+    }
+
+  /** Makes a token current on the calling thread for its lifetime. Scopes
+   * nest, a null token hides the enclosing one. */
+  class Scope
+    {
+  public:
+    explicit Scope( CancellationToken * token );
+    ~Scope();
+
+    Scope( const Scope & ) = delete;
+    Scope & operator=( const Scope & ) = delete;
+
+  private:
+    CancellationToken * m_PreviousToken;
+    };
+
+  /** Aborts a filter that does not poll the token once the token is
+   * cancelled, for its lifetime. The filter is turned AbortGenerateDataOn()
+   * from its next progress or iteration event, and throws ProcessAborted
+   * as ITK filters do when aborted. The flag is turned back off when the
+   * observer is destroyed. A null token aborts nothing. */
+  class AbortObserver
+    {
+  public:
+    AbortObserver( CancellationToken * token, ProcessObject * filter );
+    ~AbortObserver();
+
+    AbortObserver( const AbortObserver & ) = delete;
+    AbortObserver & operator=( const AbortObserver & ) = delete;
+
+  private:
+    static void AbortIfCancelled( Object * caller, const EventObject & event, void * clientData );
+
+    CancellationToken *             m_Token;
+    ProcessObject::Pointer          m_Filter;
+    unsigned long                   m_ProgressTag;
+    unsigned long                   m_IterationTag;
+    std::atomic< bool >             m_Aborted;
+    };
+
+  /** Throws the ProcessAborted exception by which the filters polling a
+   * token stop when it is cancelled. */
+  static void ThrowProcessAborted( const Object * filter );
+
+protected:
+  CancellationToken();
+  ~CancellationToken() override;
+  void PrintSelf(std::ostream& os, Indent indent) const override;
+
+private:
+  static CancellationToken * & GetCurrentReference();
+
+  std::atomic< bool >             m_CancellationRequested;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+# include "itkCancellationToken.hxx"
+#endif
+
+#endif
@@ -0,0 +1,184 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkCancellationToken.hxx
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkCancellationToken_hxx
+#define itkCancellationToken_hxx
+
+#include "itkCancellationToken.h"
+#include "itkCommand.h"
+
+#include <string>
+
+namespace itk
+{
+
+/**
+ * Constructor
+ */
+inline
+CancellationToken
+::CancellationToken()
+{
+  this->m_CancellationRequested.store( false );
+}
+
+
+/**
+ * Destructor
+ */
+inline
+CancellationToken
+::~CancellationToken()
+{
+}
+
+
+inline
+void
+CancellationToken
+::Cancel()
+{
+  this->m_CancellationRequested.store( true, std::memory_order_relaxed );
+}
+
+
+inline
+void
+CancellationToken
+::Reset()
+{
+  this->m_CancellationRequested.store( false, std::memory_order_relaxed );
+}
+
+
+inline
+CancellationToken * &
+CancellationToken
+::GetCurrentReference()
+{
+  static thread_local CancellationToken * currentToken = nullptr;
+  return currentToken;
+}
+
+
+inline
+CancellationToken *
+CancellationToken
+::GetCurrent()
+{
+  return Self::GetCurrentReference();
+}
+
+
+inline
+CancellationToken::Scope
+::Scope( CancellationToken * token )
+{
+  this->m_PreviousToken = CancellationToken::GetCurrentReference();
+  CancellationToken::GetCurrentReference() = token;
+}
+
+
+inline
+CancellationToken::Scope
+::~Scope()
+{
+  CancellationToken::GetCurrentReference() = this->m_PreviousToken;
+}
+
+
+inline
+CancellationToken::AbortObserver
+::AbortObserver( CancellationToken * token, ProcessObject * filter ) :
+  m_Token( token ),
+  m_Filter( filter ),
+  m_ProgressTag( 0 ),
+  m_IterationTag( 0 ),
+  m_Aborted( false )
+{
+  if( this->m_Token == nullptr || this->m_Filter.IsNull() )
+    {
+    return;
+    }
+
+  CStyleCommand::Pointer command = CStyleCommand::New();
+  command->SetCallback( &AbortObserver::AbortIfCancelled );
+  command->SetClientData( this );
+
+  // The level sets and the fast marching check the flag after each
+  // iteration or visit, the others from their progress reports.
+  this->m_ProgressTag = this->m_Filter->AddObserver( ProgressEvent(), command );
+  this->m_IterationTag = this->m_Filter->AddObserver( IterationEvent(), command );
+}
+
+
+inline
+CancellationToken::AbortObserver
+::~AbortObserver()
+{
+  if( this->m_Token == nullptr || this->m_Filter.IsNull() )
+    {
+    return;
+    }
+
+  this->m_Filter->RemoveObserver( this->m_ProgressTag );
+  this->m_Filter->RemoveObserver( this->m_IterationTag );
+
+  if( this->m_Aborted )
+    {
+    this->m_Filter->AbortGenerateDataOff();
+    }
+}
+
+
+inline
+void
+CancellationToken::AbortObserver
+::AbortIfCancelled( Object * itkNotUsed( caller ), const EventObject & itkNotUsed( event ), void * clientData )
+{
+  auto * self = static_cast< AbortObserver * >( clientData );
+
+  if( self->m_Token->IsCancellationRequested() && !self->m_Aborted.exchange( true ) )
+    {
+    self->m_Filter->AbortGenerateDataOn();
+    }
+}
+
+
+inline
+void
+CancellationToken
+::ThrowProcessAborted( const Object * filter )
+{
+  ProcessAborted e( __FILE__, __LINE__ );
+  e.SetDescription( std::string( "Object " ) + filter->GetNameOfClass() + ": cancelled" );
+  e.SetLocation( ITK_LOCATION );
+  throw e;
+}
+
+
+inline
+void
+CancellationToken
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf( os, indent );
+  os << indent << "CancellationRequested: " << this->IsCancellationRequested() << std::endl;
+}
+
+} // end namespace itk
+
+#endif
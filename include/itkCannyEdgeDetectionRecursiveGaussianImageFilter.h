@@ -28,6 +28,8 @@
 #include "itkDerivativeOperator.h"
 #include "itkSparseFieldLayer.h"
 #include "itkObjectStore.h"
+#include "itkImageBufferPool.h"
+#include "itkCancellationToken.h"
 
 
 namespace itk
@@ -183,6 +185,20 @@ public:
     return this->m_MultiplyImageFilter->GetOutput();
     }
 
+  /** Pool from which the update buffer is allocated, and to which it is
+   * returned at the end of every run. Defaults to the global pool, a null
+   * pool allocates from the heap. */
+  itkSetObjectMacro( BufferPool, ImageBufferPool );
+  itkGetModifiableObjectMacro( BufferPool, ImageBufferPool );
+
+  /** Token polled by the computation of the derivatives and by the edge
+   * linking, which also aborts the smoothing. Once the token is cancelled
+   * the filter releases its working memory and throws ProcessAborted, its
+   * output being left out of date. Defaults to null, in which case the
+   * current token of the executing thread, if any, is polled. */
+  itkSetObjectMacro( CancellationToken, CancellationToken );
+  itkGetModifiableObjectMacro( CancellationToken, CancellationToken );
+
   /** CannyEdgeDetectionRecursiveGaussianImageFilter needs a larger input requested
    * region than the output requested region ( derivative operators, etc).  
    * As such, CannyEdgeDetectionRecursiveGaussianImageFilter needs to provide an implementation
@@ -237,6 +253,18 @@ private:
 
   /** Check if the index is in bounds or not */
   bool InBounds(IndexType index);
+
+  /** Give the nodes of the edge list and the update buffer back. */
+  void ReleaseWorkingMemory();
+
+  /** Update one of the filters of the internal pipeline, aborting it when
+   * the token is cancelled. */
+  void UpdateInternalFilter( ProcessObject * filter );
+
+  bool IsCancelled() const
+    {
+    return m_ActiveCancellationToken && m_ActiveCancellationToken->IsCancellationRequested();
+    }
   
 
   /** Calculate the second derivative of the smoothed image, it writes the 
@@ -339,6 +367,11 @@ private:
   typename ListNodeStorageType::Pointer m_NodeStore;
   ListPointerType                       m_NodeList;
 
+  ImageBufferPool::Pointer              m_BufferPool;
+
+  CancellationToken::Pointer            m_CancellationToken;
+  CancellationToken::Pointer            m_ActiveCancellationToken;
+
 };
 
 } //end of namespace itk
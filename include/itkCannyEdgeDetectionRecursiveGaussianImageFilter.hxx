@@ -78,6 +78,10 @@ CannyEdgeDetectionRecursiveGaussianImageFilter()
   //Initialize the list
   m_NodeStore = ListNodeStorageType::New();
   m_NodeList = ListType::New();
+
+  m_BufferPool = ImageBufferPool::GetGlobalPool();
+  m_CancellationToken = nullptr;
+  m_ActiveCancellationToken = nullptr;
 }
  
 template <class TInputImage, class TOutputImage>
@@ -92,7 +96,7 @@ CannyEdgeDetectionRecursiveGaussianImageFilter<TInputImage, TOutputImage>
   m_UpdateBuffer1->CopyInformation( input );
   m_UpdateBuffer1->SetRequestedRegion(input->GetRequestedRegion());
   m_UpdateBuffer1->SetBufferedRegion(input->GetBufferedRegion());
-  m_UpdateBuffer1->Allocate();  
+  ImageBufferPool::Allocate( m_UpdateBuffer1.GetPointer(), m_BufferPool );
 }
 
 template <class TInputImage, class TOutputImage>
@@ -181,6 +185,8 @@ CannyEdgeDetectionRecursiveGaussianImageFilter< TInputImage, TOutputImage >
 
   // support progress methods/callbacks
   ProgressReporter progress(this, threadId, outputRegionForThread.GetNumberOfPixels(), 100, 0.0f, 0.5f );
+
+  SizeValueType visited = 0;
   
   // Process the non-boundady region and then each of the boundary faces.
   // These are N-d regions which border the edge of the buffer.
@@ -194,6 +200,10 @@ CannyEdgeDetectionRecursiveGaussianImageFilter< TInputImage, TOutputImage >
     
     while ( ! bit.IsAtEnd() )
       {
+      if ( ++visited % CancellationToken::PollingInterval == 0 && IsCancelled() )
+        {
+        return;
+        }
       it.Value() = ComputeCannyEdge(bit, globalData);
       ++bit;
       ++it;
@@ -310,6 +320,8 @@ void
 CannyEdgeDetectionRecursiveGaussianImageFilter< TInputImage, TOutputImage >
 ::GenerateData()
 {
+  m_ActiveCancellationToken = CancellationToken::Resolve( m_CancellationToken );
+
   // Allocate the output
   this->GetOutput()->SetBufferedRegion( this->GetOutput()->GetRequestedRegion() );
   this->GetOutput()->Allocate();
@@ -331,7 +343,7 @@ CannyEdgeDetectionRecursiveGaussianImageFilter< TInputImage, TOutputImage >
   m_GaussianFilter->SetSigmaArray( this->m_Sigma );
   m_GaussianFilter->SetNormalizeAcrossScale( true );
   m_GaussianFilter->SetInput(input);
-  m_GaussianFilter->Update();
+  this->UpdateInternalFilter( m_GaussianFilter );
 
   //2. Calculate 2nd order directional derivative-------
   // Calculate the 2nd order directional derivative of the smoothed image.
@@ -339,14 +351,26 @@ CannyEdgeDetectionRecursiveGaussianImageFilter< TInputImage, TOutputImage >
   // derivative.
   this->Compute2ndDerivative();
 
+  if ( IsCancelled() )
+    {
+    this->ReleaseWorkingMemory();
+    CancellationToken::ThrowProcessAborted( this );
+    }
+
   this->Compute2ndDerivativePos();
+
+  if ( IsCancelled() )
+    {
+    this->ReleaseWorkingMemory();
+    CancellationToken::ThrowProcessAborted( this );
+    }
   
   // 3. Non-maximum suppression----------
   
   // Calculate the zero crossings of the 2nd directional derivative and write 
   // the result to output buffer. 
   zeroCrossFilter->SetInput(this->GetOutput());
-  zeroCrossFilter->Update();
+  this->UpdateInternalFilter( zeroCrossFilter );
   
   // 4. Hysteresis Thresholding---------
   
@@ -357,10 +381,61 @@ CannyEdgeDetectionRecursiveGaussianImageFilter< TInputImage, TOutputImage >
   // To save memory, we will graft the output of the m_GaussianFilter, 
   // which is no longer needed, into the m_MultiplyImageFilter.
   m_MultiplyImageFilter->GraftOutput( m_GaussianFilter->GetOutput() );
-  m_MultiplyImageFilter->Update();
+  this->UpdateInternalFilter( m_MultiplyImageFilter );
 
   //Then do the double threshoulding upon the edge reponses
   this->HysteresisThresholding();
+
+  const bool cancelled = IsCancelled();
+
+  // The update buffer is not needed anymore, give it back to the pool.
+  this->ReleaseWorkingMemory();
+
+  if ( cancelled )
+    {
+    CancellationToken::ThrowProcessAborted( this );
+    }
+}
+
+template< class TInputImage, class TOutputImage >
+void
+CannyEdgeDetectionRecursiveGaussianImageFilter< TInputImage, TOutputImage >
+::UpdateInternalFilter( ProcessObject * filter )
+{
+  // The filters of ITK do not poll the token, they are aborted from
+  // their progress reports, and the working memory released.
+  try
+    {
+    CancellationToken::AbortObserver abortObserver( m_ActiveCancellationToken, filter );
+    filter->Update();
+    }
+  catch ( ProcessAborted & )
+    {
+    this->ReleaseWorkingMemory();
+    throw;
+    }
+}
+
+template< class TInputImage, class TOutputImage >
+void
+CannyEdgeDetectionRecursiveGaussianImageFilter< TInputImage, TOutputImage >
+::ReleaseWorkingMemory()
+{
+  // A cancelled edge linking leaves nodes in the list.
+  while( !m_NodeList->Empty() )
+    {
+    ListNodeType * node = m_NodeList->Front();
+    m_NodeList->PopFront();
+    m_NodeStore->Return( node );
+    }
+
+  if ( IsCancelled() )
+    {
+    m_NodeStore->Squeeze();
+    }
+
+  m_UpdateBuffer1->Initialize();
+  m_ActiveCancellationToken = nullptr;
 }
 
 template< class TInputImage, class TOutputImage >
@@ -389,8 +464,15 @@ CannyEdgeDetectionRecursiveGaussianImageFilter< TInputImage, TOutputImage >
     ++uit;
     }
 
+  SizeValueType visited = 0;
+
   while(!oit.IsAtEnd())
     {
+    if ( ++visited % CancellationToken::PollingInterval == 0 && IsCancelled() )
+      {
+      return;
+      }
+
     value = oit.Value();
 
     if(value > m_UpperThreshold)
@@ -434,8 +516,15 @@ CannyEdgeDetectionRecursiveGaussianImageFilter< TInputImage, TOutputImage >
     }
   
   int nSize = m_Center * 2 +1;  
+  SizeValueType visited = 0;
   while(!m_NodeList->Empty())
     {
+    // The nodes left in the list are given back on release.
+    if ( visited++ % CancellationToken::PollingInterval == 0 && IsCancelled() )
+      {
+      return;
+      }
+
     // Pop the front node from the list and read its index value.
     node = m_NodeList->Front(); // get a pointer to the first node
     cIndex = node->m_Value;    // read the value of the first node
@@ -525,6 +614,8 @@ CannyEdgeDetectionRecursiveGaussianImageFilter< TInputImage, TOutputImage >
 
   // support progress methods/callbacks
   ProgressReporter progress(this, threadId, outputRegionForThread.GetNumberOfPixels(), 100, 0.5f, 0.5f);
+
+  SizeValueType visited = 0;
   
   InputImagePixelType zero = NumericTraits<InputImagePixelType>::Zero;
 
@@ -555,6 +646,10 @@ CannyEdgeDetectionRecursiveGaussianImageFilter< TInputImage, TOutputImage >
 
     while ( ! bit.IsAtEnd()  )
       {
+      if ( ++visited % CancellationToken::PollingInterval == 0 && IsCancelled() )
+        {
+        return;
+        }
       
       gradMag = 0.0001;
       
@@ -716,6 +811,8 @@ CannyEdgeDetectionRecursiveGaussianImageFilter<TInputImage,TOutputImage>
      m_MultiplyImageFilter->Print(os,indent.GetNextIndent());
   os << "UpdateBuffer1: " << std::endl;
      m_UpdateBuffer1->Print(os,indent.GetNextIndent());
+  os << indent << "BufferPool: " << m_BufferPool.GetPointer() << std::endl;
+  os << indent << "CancellationToken: " << m_CancellationToken.GetPointer() << std::endl;
 }
 
 }//end of itk namespace
@@ -120,6 +120,9 @@ protected:
    * the segmentation. */
   void  GenerateData () override;
 
+  /** Parameters that identify the feature in a FeatureCache. */
+  bool GetFeatureCacheParameters( std::ostream & os ) const override;
+
 private:
   using InternalPixelType = float;
   using InternalImageType = Image< InternalPixelType, Dimension >;
@@ -183,6 +183,17 @@ CannyEdgesFeatureGenerator<NDimension>
   return m_Sigma[0];
 }
 
+
+template <unsigned int NDimension>
+bool
+CannyEdgesFeatureGenerator<NDimension>
+::GetFeatureCacheParameters( std::ostream & os ) const
+{
+  os << " Sigma " << this->m_Sigma;
+  os << " UpperThreshold " << this->m_UpperThreshold << " LowerThreshold " << this->m_LowerThreshold;
+  return true;
+}
+
 } // end namespace itk
 
 #endif
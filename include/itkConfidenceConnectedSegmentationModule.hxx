@@ -19,6 +19,7 @@
 
 #include "itkConfidenceConnectedSegmentationModule.h"
 #include "itkProgressAccumulator.h"
+#include "itkCancellationToken.h"
 
 
 namespace itk
@@ -102,7 +103,12 @@ ConfidenceConnectedSegmentationModule<NDimension>
   progress->SetMiniPipelineFilter(this);
   progress->RegisterInternalFilter( filter, 1.0 );
 
-  filter->Update();
+  // the filter does not poll the cancellation token of
+  // the segmentation, it is aborted from its events
+    {
+    CancellationToken::AbortObserver abortObserver( CancellationToken::GetCurrent(), filter );
+    filter->Update();
+    }
 
   this->PackOutputImageInOutputSpatialObject( filter->GetOutput() );
 }
@@ -19,6 +19,7 @@
 
 #include "itkConnectedThresholdSegmentationModule.h"
 #include "itkProgressAccumulator.h"
+#include "itkCancellationToken.h"
 
 
 namespace itk
@@ -100,7 +101,12 @@ ConnectedThresholdSegmentationModule<NDimension>
   progress->SetMiniPipelineFilter(this);
   progress->RegisterInternalFilter( filter, 1.0 );
 
-  filter->Update();
+  // the filter does not poll the cancellation token of
+  // the segmentation, it is aborted from its events
+    {
+    CancellationToken::AbortObserver abortObserver( CancellationToken::GetCurrent(), filter );
+    filter->Update();
+    }
 
   this->PackOutputImageInOutputSpatialObject( filter->GetOutput() );
 }
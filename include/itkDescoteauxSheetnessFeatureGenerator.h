@@ -21,6 +21,7 @@
 #include "itkImage.h"
 #include "itkImageSpatialObject.h"
 #include "itkHessianRecursiveGaussianImageFilter.h"
+#include "itkHessianImageProvider.h"
 #include "itkSymmetricSecondRankTensor.h"
 #include "itkSymmetricEigenAnalysisImageFilter.h"
 #include "itkDescoteauxSheetnessImageFilter.h"
@@ -101,6 +102,15 @@ public:
   itkGetMacro( DetectBrightSheets, bool );
   itkBooleanMacro( DetectBrightSheets );
 
+  /** Type of the object that shares Hessian computations among generators. */
+  using HessianProviderType = HessianImageProvider< NDimension >;
+
+  /** Optional provider from which the Hessian is taken instead of being
+   * computed internally. Generators attached to the same provider, and
+   * configured with the same sigma on the same input, share one Hessian. */
+  itkSetObjectMacro( HessianProvider, HessianProviderType );
+  itkGetModifiableObjectMacro( HessianProvider, HessianProviderType );
+
 protected:
   DescoteauxSheetnessFeatureGenerator();
   ~DescoteauxSheetnessFeatureGenerator() override;
@@ -137,6 +147,8 @@ private:
   typename SheetnessFilterType::Pointer           m_SheetnessFilter;
   typename RescaleFilterType::Pointer             m_RescaleFilter;
 
+  typename HessianProviderType::Pointer           m_HessianProvider;
+
   double      m_Sigma;
   double      m_SheetnessNormalization;
   double      m_BloobinessNormalization;
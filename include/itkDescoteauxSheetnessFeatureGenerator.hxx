@@ -117,9 +117,17 @@ DescoteauxSheetnessFeatureGenerator<NDimension>
     itkExceptionMacro("Missing input image");
     }
 
-  this->m_HessianFilter->SetInput( inputImage );
-  this->m_EigenAnalysisFilter->SetInput( this->m_HessianFilter->GetOutput() );
-  this->m_SheetnessFilter->SetInput( this->m_EigenAnalysisFilter->GetOutput() );
+  if( this->m_HessianProvider )
+    {
+    this->m_SheetnessFilter->SetInput(
+      this->m_HessianProvider->GetEigenValues( inputImage, this->m_Sigma ) );
+    }
+  else
+    {
+    this->m_HessianFilter->SetInput( inputImage );
+    this->m_EigenAnalysisFilter->SetInput( this->m_HessianFilter->GetOutput() );
+    this->m_SheetnessFilter->SetInput( this->m_EigenAnalysisFilter->GetOutput() );
+    }
   this->m_RescaleFilter->SetInput( this->m_SheetnessFilter->GetOutput() );
 
   this->m_HessianFilter->SetSigma( this->m_Sigma );
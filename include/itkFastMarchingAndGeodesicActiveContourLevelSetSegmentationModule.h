@@ -86,6 +86,16 @@ public:
   virtual double GetDistanceFromSeeds() const
     { return m_FastMarchingModule->GetDistanceFromSeeds(); }
 
+  /** The fast marching parameters are held by the internal module, account
+   * for its MTime as well. */
+  unsigned long GetMTime() const override;
+
+  /** Internal modules, exposed so that their executions can be observed. */
+  using FastMarchingModuleType = FastMarchingSegmentationModule< Dimension >;
+  using GeodesicActiveContourLevelSetModuleType = GeodesicActiveContourLevelSetSegmentationModule< Dimension >;
+  itkGetModifiableObjectMacro( FastMarchingModule, FastMarchingModuleType );
+  itkGetModifiableObjectMacro( GeodesicActiveContourLevelSetModule, GeodesicActiveContourLevelSetModuleType );
+
 protected:
   FastMarchingAndGeodesicActiveContourLevelSetSegmentationModule();
   ~FastMarchingAndGeodesicActiveContourLevelSetSegmentationModule() override;
@@ -95,9 +105,7 @@ protected:
    * the segmentation. */
   void  GenerateData () override;
 
-  using FastMarchingModuleType = FastMarchingSegmentationModule< Dimension >;
   typename FastMarchingModuleType::Pointer m_FastMarchingModule;
-  using GeodesicActiveContourLevelSetModuleType = GeodesicActiveContourLevelSetSegmentationModule< Dimension >;
   typename GeodesicActiveContourLevelSetModuleType::Pointer m_GeodesicActiveContourLevelSetModule;
 };
 
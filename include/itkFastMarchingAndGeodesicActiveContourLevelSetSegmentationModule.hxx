@@ -64,6 +64,21 @@ FastMarchingAndGeodesicActiveContourLevelSetSegmentationModule<NDimension>
 }
 
 
+template <unsigned int NDimension>
+unsigned long
+FastMarchingAndGeodesicActiveContourLevelSetSegmentationModule<NDimension>
+::GetMTime() const
+{
+  unsigned long mtime = this->Superclass::GetMTime();
+  const unsigned long t = this->m_FastMarchingModule->GetMTime();
+  if (t > mtime)
+    {
+    mtime = t;
+    }
+  return mtime;
+}
+
+
 /**
  * Generate Data
  */
@@ -22,6 +22,7 @@
 #include "itkFastMarchingImageFilter.h"
 #include "itkIntensityWindowingImageFilter.h"
 #include "itkProgressAccumulator.h"
+#include "itkCancellationToken.h"
 
 namespace itk
 {
@@ -126,7 +127,12 @@ FastMarchingSegmentationModule<NDimension>
     }
 
   filter->SetTrialPoints( trialPoints );
-  filter->Update();
+  // the filter does not poll the cancellation token of
+  // the segmentation, it is aborted from its events
+    {
+    CancellationToken::AbortObserver abortObserver( CancellationToken::GetCurrent(), filter );
+    filter->Update();
+    }
 
   // Rescale the values to make the output intensity fit in the expected
   // range of [-4:4]
@@ -21,6 +21,11 @@
 #include "itkImage.h"
 #include "itkImageSpatialObject.h"
 #include "itkProgressAccumulator.h"
+#include "itkCommand.h"
+#include "itkImageBufferPool.h"
+#include "itkCancellationToken.h"
+
+#include <mutex>
 
 namespace itk
 {
@@ -33,6 +38,22 @@ namespace itk
  *
  * SpatialObjects are used as inputs and outputs of this class.
  *
+ * By default the feature generators are updated one after another. When
+ * UseParallelFeatureGeneration is ON, independent generators are updated
+ * concurrently, each one on its own worker, while the filters internal to
+ * every generator keep drawing their threads from the global ITK pool. The
+ * generators are expected to share only read-only inputs.
+ *
+ * When UseTiledFeatureGeneration is ON, the generators that support it are
+ * run on one tile of their input at a time, padded by the halo they need,
+ * and every tile of the aggregated feature is produced as soon as the
+ * features of that tile are available. Only the aggregated feature and the
+ * features of the generators that cannot be tiled are then kept over the
+ * whole input, which bounds the working set of the feature stage. The
+ * tiles are computed by clones of the generators, so that the generators
+ * themselves, their inputs and their features are left untouched, and
+ * the aggregator is only executed again when one of them changes.
+ *
  * \ingroup SpatialObjectFilters
  * \ingroup LesionSizingToolkit
  */
@@ -80,6 +101,43 @@ public:
   /** Check all feature generators and return consolidate MTime */
   unsigned long GetMTime() const override;
 
+  /** Update the feature generators concurrently rather than serially.
+   * Defaults to false. */
+  itkSetMacro( UseParallelFeatureGeneration, bool );
+  itkGetConstMacro( UseParallelFeatureGeneration, bool );
+  itkBooleanMacro( UseParallelFeatureGeneration );
+
+  /** Maximum number of feature generators that may run at the same time when
+   * UseParallelFeatureGeneration is ON. Zero, the default, means as many as
+   * the global default number of threads. */
+  itkSetMacro( MaximumNumberOfConcurrentGenerators, unsigned int );
+  itkGetConstMacro( MaximumNumberOfConcurrentGenerators, unsigned int );
+
+  /** Compute the features tile by tile, for the generators that support it,
+   * see GetSupportsTiling(). The aggregated feature matches the one
+   * computed on the whole input, up to the truncation of the Gaussian
+   * kernels at the halo of the tiles. Defaults to false.
+   * UseParallelFeatureGeneration is ignored in this mode. */
+  itkSetMacro( UseTiledFeatureGeneration, bool );
+  itkGetConstMacro( UseTiledFeatureGeneration, bool );
+  itkBooleanMacro( UseTiledFeatureGeneration );
+
+  /** Size, in voxels, of the tiles. Defaults to 64 along every axis. */
+  using TileSizeType = Size< NDimension >;
+  itkSetMacro( TileSize, TileSizeType );
+  itkGetConstMacro( TileSize, TileSizeType );
+
+  /** Pool from which the aggregated feature is allocated. Its buffer goes
+   * back to the pool when the feature is replaced or released. Defaults to
+   * the global pool, a null pool allocates from the heap. */
+  itkSetObjectMacro( BufferPool, ImageBufferPool );
+  itkGetModifiableObjectMacro( BufferPool, ImageBufferPool );
+
+  /** The aggregated feature can be cached only if every one of the features
+   * it combines can be. Its key is derived from their keys, so a hit skips
+   * the feature generators altogether. */
+  std::string ComputeFeatureCacheKey( typename Superclass::FeatureCacheType * cache ) const override;
+
 protected:
   FeatureAggregator();
   ~FeatureAggregator() override;
@@ -89,12 +147,23 @@ protected:
    * the segmentation. */
   void  GenerateData() override;
 
+  /** Aggregators have no parameters by default. */
+  bool GetFeatureCacheParameters( std::ostream & os ) const override;
+
   unsigned int GetNumberOfInputFeatures() const;
 
   using InputFeatureType = typename FeatureGeneratorType::SpatialObjectType;
 
   const InputFeatureType * GetInputFeature( unsigned int featureId ) const;
 
+  /** Combine the input features over the given region of the consolidated
+   * image. The input features are buffered over that region, and possibly
+   * more. Aggregators implement this method, or override
+   * ConsolidateFeatures() altogether, in which case they do not support
+   * UseTiledFeatureGeneration. */
+  virtual void ConsolidateFeaturesInRegion( OutputImageType * consolidatedImage,
+    const typename OutputImageType::RegionType & region );
+
   ProgressAccumulator::Pointer              m_ProgressAccumulator;
 
 private:
@@ -105,9 +174,35 @@ private:
 
   FeatureGeneratorArrayType                 m_FeatureGenerators;
 
+  /** Clones computing the current tile, in place of the generators of the
+   * same index, empty outside of GenerateTiledFeatures(). */
+  FeatureGeneratorArrayType                 m_TileFeatureGenerators;
+
+  bool                                      m_UseParallelFeatureGeneration;
+  unsigned int                              m_MaximumNumberOfConcurrentGenerators;
+  bool                                      m_UseTiledFeatureGeneration;
+  TileSizeType                              m_TileSize;
+
+  ImageBufferPool::Pointer                  m_BufferPool;
+
+  std::mutex                                m_ProgressMutex;
+
   void UpdateAllFeatureGenerators();
 
-  void virtual ConsolidateFeatures() = 0;
+  /** Update the generators on a bounded set of workers. Each worker picks the
+   * next pending generator until none is left, so that one slow generator
+   * does not hold back the others. */
+  void UpdateAllFeatureGeneratorsConcurrently();
+
+  /** Observer of the progress of the concurrently running generators. */
+  void ReportConcurrentProgress( Object * caller, const EventObject & event );
+
+  /** Compute the features of the tileable generators one tile at a time,
+   * and consolidate every tile as soon as its features are available. */
+  void GenerateTiledFeatures();
+
+  /** Consolidate the features over the whole input. */
+  void virtual ConsolidateFeatures();
 
 };
 
@@ -20,6 +20,15 @@
 #include "itkFeatureAggregator.h"
 #include "itkImageSpatialObject.h"
 #include "itkImageRegionIterator.h"
+#include "itkPlatformMultiThreader.h"
+#include "itkExtractImageFilter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <map>
+#include <sstream>
 
 
 namespace itk
@@ -40,6 +49,12 @@ FeatureAggregator<NDimension>
 
   this->m_ProgressAccumulator = ProgressAccumulator::New();
   this->m_ProgressAccumulator->SetMiniPipelineFilter(this);
+
+  this->m_UseParallelFeatureGeneration = false;
+  this->m_MaximumNumberOfConcurrentGenerators = 0;
+  this->m_UseTiledFeatureGeneration = false;
+  this->m_TileSize.Fill( 64 );
+  this->m_BufferPool = ImageBufferPool::GetGlobalPool();
 }
 
 
@@ -84,6 +99,10 @@ FeatureAggregator<NDimension>
     {
     itkExceptionMacro("Feature Id" << featureId << " doesn't exist");
     }
+  if( featureId < this->m_TileFeatureGenerators.size() && this->m_TileFeatureGenerators[featureId] )
+    {
+    return this->m_TileFeatureGenerators[featureId]->GetFeature();
+    }
   return this->m_FeatureGenerators[featureId]->GetFeature();
 }
 
@@ -109,6 +128,11 @@ FeatureAggregator<NDimension>
     ++gitr;
     }
 
+  os << indent << "Use parallel feature generation = " << this->m_UseParallelFeatureGeneration << std::endl;
+  os << indent << "Maximum number of concurrent generators = " << this->m_MaximumNumberOfConcurrentGenerators << std::endl;
+  os << indent << "Use tiled feature generation = " << this->m_UseTiledFeatureGeneration << std::endl;
+  os << indent << "Tile size = " << this->m_TileSize << std::endl;
+  os << indent << "Buffer pool = " << this->m_BufferPool.GetPointer() << std::endl;
 }
 
 
@@ -120,16 +144,236 @@ void
 FeatureAggregator<NDimension>
 ::GenerateData()
 {
-  this->UpdateAllFeatureGenerators();
+  if( this->m_UseTiledFeatureGeneration )
+    {
+    this->GenerateTiledFeatures();
+    return;
+    }
+
+  if( this->m_UseParallelFeatureGeneration && this->m_FeatureGenerators.size() > 1 )
+    {
+    this->UpdateAllFeatureGeneratorsConcurrently();
+    }
+  else
+    {
+    this->UpdateAllFeatureGenerators();
+    }
   this->ConsolidateFeatures();
 }
 
+
+/**
+ * Consolidate the features over the whole input
+ */
+template <unsigned int NDimension>
+void
+FeatureAggregator<NDimension>
+::ConsolidateFeatures()
+{
+  const auto * firstFeatureObject = dynamic_cast< const OutputImageSpatialObjectType * >( this->GetInputFeature(0) );
+
+  const OutputImageType * firstFeatureImage = firstFeatureObject->GetImage();
+
+  typename OutputImageType::Pointer consolidatedFeatureImage = OutputImageType::New();
+
+  consolidatedFeatureImage->CopyInformation( firstFeatureImage );
+  consolidatedFeatureImage->SetRegions( firstFeatureImage->GetBufferedRegion() );
+  ImageBufferPool::Allocate( consolidatedFeatureImage.GetPointer(), this->m_BufferPool );
+
+  this->ConsolidateFeaturesInRegion( consolidatedFeatureImage, consolidatedFeatureImage->GetBufferedRegion() );
+
+  auto * outputObject = dynamic_cast< OutputImageSpatialObjectType * >(this->ProcessObject::GetOutput(0));
+
+  outputObject->SetImage( consolidatedFeatureImage );
+}
+
+
+template <unsigned int NDimension>
+void
+FeatureAggregator<NDimension>
+::ConsolidateFeaturesInRegion( OutputImageType *, const typename OutputImageType::RegionType & )
+{
+  itkExceptionMacro("This aggregator does not support consolidating features by region");
+}
+
+
+/**
+ * Generate the features and consolidate them tile by tile
+ */
+template <unsigned int NDimension>
+void
+FeatureAggregator<NDimension>
+::GenerateTiledFeatures()
+{
+  using TileInputImageType = Image< signed short, NDimension >;
+  using TileInputSpatialObjectType = ImageSpatialObject< NDimension, signed short >;
+  using ExtractFilterType = ExtractImageFilter< TileInputImageType, TileInputImageType >;
+  using RegionType = typename OutputImageType::RegionType;
+
+  // Bring the shared inputs up to date before they are cut into tiles.
+  for( auto & generator : this->m_FeatureGenerators )
+    {
+    for( auto & input : generator->GetInputs() )
+      {
+      if( input )
+        {
+        input->Update();
+        }
+      }
+    }
+
+  // The generators that cannot be tiled run over the whole input first.
+  std::vector< unsigned int > tiledGenerators;
+  const TileInputImageType * referenceImage = nullptr;
+
+  this->m_ProgressAccumulator->ResetProgress();
+  this->m_ProgressAccumulator->UnregisterAllFilters();
+
+  const unsigned int numberOfGenerators = this->m_FeatureGenerators.size();
+
+  for( unsigned int i = 0; i < numberOfGenerators; i++ )
+    {
+    FeatureGeneratorType * generator = this->m_FeatureGenerators[i];
+    const auto * inputObject = dynamic_cast< const TileInputSpatialObjectType * >( generator->GetInput() );
+
+    if( generator->GetSupportsTiling() && inputObject && inputObject->GetImage() )
+      {
+      if( !referenceImage )
+        {
+        referenceImage = inputObject->GetImage();
+        }
+      else if( inputObject->GetImage()->GetBufferedRegion() != referenceImage->GetBufferedRegion() )
+        {
+        itkExceptionMacro("Tiled feature generators must have inputs buffered over the same region");
+        }
+      tiledGenerators.push_back( i );
+      }
+    else
+      {
+      this->m_ProgressAccumulator->RegisterInternalFilter( generator, 1.0 / numberOfGenerators );
+      generator->Update();
+      }
+    }
+
+  this->m_ProgressAccumulator->UnregisterAllFilters();
+
+  if( tiledGenerators.empty() )
+    {
+    this->ConsolidateFeatures();
+    return;
+    }
+
+  const RegionType fullRegion = referenceImage->GetBufferedRegion();
+
+  typename OutputImageType::Pointer consolidatedFeatureImage = OutputImageType::New();
+  consolidatedFeatureImage->CopyInformation( referenceImage );
+  consolidatedFeatureImage->SetRegions( fullRegion );
+  ImageBufferPool::Allocate( consolidatedFeatureImage.GetPointer(), this->m_BufferPool );
+
+  // Halo, in voxels, wide enough for every tiled generator.
+  double haloRadius = 0.0;
+  for( const auto & i : tiledGenerators )
+    {
+    haloRadius = std::max( haloRadius, this->m_FeatureGenerators[i]->GetTileHaloRadius() );
+    }
+
+  typename RegionType::SizeType halo;
+  TileSizeType tileSize;
+  TileSizeType numberOfTiles;
+  SizeValueType totalNumberOfTiles = 1;
+  for( unsigned int d = 0; d < Dimension; d++ )
+    {
+    halo[d] = static_cast< SizeValueType >( std::ceil( haloRadius / referenceImage->GetSpacing()[d] ) );
+    tileSize[d] = std::max( this->m_TileSize[d], SizeValueType( 1 ) );
+    numberOfTiles[d] = ( fullRegion.GetSize(d) + tileSize[d] - 1 ) / tileSize[d];
+    totalNumberOfTiles *= numberOfTiles[d];
+    }
+
+  // The tiles are computed by clones of the generators, so that the
+  // generators keep their input, cache, modification time and feature.
+  // The clones have no cache, tiles are not worth caching.
+  this->m_TileFeatureGenerators.assign( numberOfGenerators, nullptr );
+  for( const auto & i : tiledGenerators )
+    {
+    this->m_TileFeatureGenerators[i] = this->m_FeatureGenerators[i]->Clone();
+    }
+
+  const float untiledProgress = static_cast< float >( numberOfGenerators - tiledGenerators.size() ) / numberOfGenerators;
+
+  try
+    {
+    for( SizeValueType t = 0; t < totalNumberOfTiles; t++ )
+      {
+      typename RegionType::IndexType tileIndex;
+      typename RegionType::SizeType tileExtent;
+      SizeValueType remainder = t;
+      for( unsigned int d = 0; d < Dimension; d++ )
+        {
+        const SizeValueType k = remainder % numberOfTiles[d];
+        remainder /= numberOfTiles[d];
+        tileIndex[d] = fullRegion.GetIndex(d) + static_cast< IndexValueType >( k * tileSize[d] );
+        tileExtent[d] = std::min( tileSize[d], fullRegion.GetSize(d) - k * tileSize[d] );
+        }
+      const RegionType tile( tileIndex, tileExtent );
+
+      RegionType paddedTile = tile;
+      paddedTile.PadByRadius( halo );
+      paddedTile.Crop( fullRegion );
+
+      // Generators sharing an input share its tile as well.
+      std::map< const TileInputImageType *, typename TileInputSpatialObjectType::Pointer > tileInputs;
+
+      for( unsigned int k = 0; k < tiledGenerators.size(); k++ )
+        {
+        const TileInputImageType * inputImage =
+          static_cast< const TileInputSpatialObjectType * >( this->m_FeatureGenerators[tiledGenerators[k]]->GetInput() )->GetImage();
+
+        typename TileInputSpatialObjectType::Pointer & tileInput = tileInputs[inputImage];
+        if( !tileInput )
+          {
+          typename ExtractFilterType::Pointer extractor = ExtractFilterType::New();
+          extractor->SetInput( inputImage );
+          extractor->SetExtractionRegion( paddedTile );
+          extractor->SetDirectionCollapseToSubmatrix();
+          extractor->Update();
+
+          typename TileInputImageType::Pointer tileImage = extractor->GetOutput();
+          tileImage->DisconnectPipeline();
+
+          tileInput = TileInputSpatialObjectType::New();
+          tileInput->SetImage( tileImage );
+          }
+
+        this->m_TileFeatureGenerators[tiledGenerators[k]]->SetInput( tileInput );
+        this->m_TileFeatureGenerators[tiledGenerators[k]]->Update();
+        }
+
+      this->ConsolidateFeaturesInRegion( consolidatedFeatureImage, tile );
+
+      this->UpdateProgress( untiledProgress + ( 1.0f - untiledProgress ) * ( t + 1 ) / totalNumberOfTiles );
+      }
+    }
+  catch( ... )
+    {
+    this->m_TileFeatureGenerators.clear();
+    throw;
+    }
+
+  this->m_TileFeatureGenerators.clear();
+
+  auto * outputObject = dynamic_cast< OutputImageSpatialObjectType * >(this->ProcessObject::GetOutput(0));
+
+  outputObject->SetImage( consolidatedFeatureImage );
+}
+
 template <unsigned int NDimension>
 unsigned long
 FeatureAggregator<NDimension>
 ::GetMTime() const
 {
-  // MTime is the max of mtime of all feature generators.
+  // MTime is the max of mtime of all feature generators, and of their inputs,
+  // since the generators are not connected to this aggregator through the
+  // pipeline.
   unsigned long mtime = this->Superclass::GetMTime();
   auto gitr = this->m_FeatureGenerators.begin();
   auto gend = this->m_FeatureGenerators.end();
@@ -140,6 +384,13 @@ FeatureAggregator<NDimension>
       {
       mtime = t;
       }
+    for( const auto & input : (*gitr)->GetInputs() )
+      {
+      if( input && input->GetMTime() > mtime )
+        {
+        mtime = input->GetMTime();
+        }
+      }
     ++gitr;
     }
 
@@ -147,6 +398,48 @@ FeatureAggregator<NDimension>
 }
 
 
+template <unsigned int NDimension>
+bool
+FeatureAggregator<NDimension>
+::GetFeatureCacheParameters( std::ostream & ) const
+{
+  return true;
+}
+
+
+template <unsigned int NDimension>
+std::string
+FeatureAggregator<NDimension>
+::ComputeFeatureCacheKey( typename Superclass::FeatureCacheType * cache ) const
+{
+  if( !cache || this->m_FeatureGenerators.empty() )
+    {
+    return std::string();
+    }
+
+  std::ostringstream parameters;
+  parameters.precision( 17 );
+  parameters << this->GetNameOfClass();
+
+  if( !this->GetFeatureCacheParameters( parameters ) )
+    {
+    return std::string();
+    }
+
+  for( const auto & generator : this->m_FeatureGenerators )
+    {
+    const std::string key = generator->ComputeFeatureCacheKey( cache );
+    if( key.empty() )
+      {
+      return std::string();
+      }
+    parameters << " " << key;
+    }
+
+  return cache->ComputeKey( parameters.str() );
+}
+
+
 /**
  * Update feature generators
  */
@@ -155,6 +448,11 @@ void
 FeatureAggregator<NDimension>
 ::UpdateAllFeatureGenerators()
 {
+  // Filters registered in a previous execution would otherwise be counted
+  // twice, and the accumulated progress would exceed one.
+  this->m_ProgressAccumulator->ResetProgress();
+  this->m_ProgressAccumulator->UnregisterAllFilters();
+
   auto gitr = this->m_FeatureGenerators.begin();
   auto gend = this->m_FeatureGenerators.end();
 
@@ -169,6 +467,121 @@ FeatureAggregator<NDimension>
     }
 }
 
+
+/**
+ * Update feature generators concurrently
+ */
+template <unsigned int NDimension>
+void
+FeatureAggregator<NDimension>
+::UpdateAllFeatureGeneratorsConcurrently()
+{
+  const unsigned int numberOfGenerators = this->m_FeatureGenerators.size();
+
+  // The generators typically share their input. Bring that input up to
+  // date, and negotiate the output information and requested regions, here,
+  // serially, since they write to the pipeline state of the shared input.
+  // The concurrent stage below then only generates the data, and only reads
+  // that state.
+  for( auto & generator : this->m_FeatureGenerators )
+    {
+    for( auto & input : generator->GetInputs() )
+      {
+      if( input )
+        {
+        input->Update();
+        }
+      }
+    generator->PropagateFeatureRequest();
+    }
+
+  unsigned int numberOfWorkers = this->m_MaximumNumberOfConcurrentGenerators;
+  if( numberOfWorkers == 0 )
+    {
+    numberOfWorkers = MultiThreaderBase::GetGlobalDefaultNumberOfThreads();
+    }
+  numberOfWorkers = std::max( 1u, std::min( numberOfWorkers, numberOfGenerators ) );
+
+  // The progress accumulator is not meant to be driven from several threads
+  // at once, therefore the progress of the generators is gathered here under
+  // a lock, with the same equal weighting used in the serial case.
+  this->m_ProgressAccumulator->UnregisterAllFilters();
+  this->UpdateProgress( 0.0f );
+
+  using CommandType = MemberCommand< Self >;
+  typename CommandType::Pointer progressCommand = CommandType::New();
+  progressCommand->SetCallbackFunction( this, &Self::ReportConcurrentProgress );
+
+  std::vector< unsigned long > observerTags;
+  for( auto & generator : this->m_FeatureGenerators )
+    {
+    observerTags.push_back( generator->AddObserver( ProgressEvent(), progressCommand ) );
+    }
+
+  // The generators updated by the workers poll the token of this thread.
+  CancellationToken * cancellationToken = CancellationToken::GetCurrent();
+
+  std::atomic< unsigned int > nextGenerator( 0 );
+  std::exception_ptr          firstException;
+  std::mutex                  exceptionMutex;
+
+  // Dedicated workers are used at this level so that the generators, whose
+  // internal filters are themselves multi-threaded, never block a thread of
+  // the shared pool while waiting on work queued to that same pool.
+  PlatformMultiThreader::Pointer threader = PlatformMultiThreader::New();
+  threader->SetNumberOfWorkUnits( numberOfWorkers );
+  threader->ParallelizeArray( 0, numberOfWorkers,
+    [&]( SizeValueType )
+      {
+      CancellationToken::Scope cancellationScope( cancellationToken );
+
+      unsigned int generatorId;
+      while( ( generatorId = nextGenerator++ ) < numberOfGenerators )
+        {
+        try
+          {
+          this->m_FeatureGenerators[generatorId]->UpdateFeatureData();
+          }
+        catch( ... )
+          {
+          std::lock_guard< std::mutex > lock( exceptionMutex );
+          if( !firstException )
+            {
+            firstException = std::current_exception();
+            }
+          }
+        }
+      },
+    nullptr );
+
+  for( unsigned int i = 0; i < numberOfGenerators; i++ )
+    {
+    this->m_FeatureGenerators[i]->RemoveObserver( observerTags[i] );
+    }
+
+  if( firstException )
+    {
+    std::rethrow_exception( firstException );
+    }
+}
+
+
+template <unsigned int NDimension>
+void
+FeatureAggregator<NDimension>
+::ReportConcurrentProgress( Object *, const EventObject & )
+{
+  std::lock_guard< std::mutex > lock( this->m_ProgressMutex );
+
+  float progress = 0.0f;
+  for( auto & generator : this->m_FeatureGenerators )
+    {
+    progress += generator->GetProgress();
+    }
+
+  this->UpdateProgress( progress / this->m_FeatureGenerators.size() );
+}
+
 } // end namespace itk
 
 #endif
@@ -0,0 +1,168 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkFeatureCache.h
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkFeatureCache_h
+#define itkFeatureCache_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkImage.h"
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace itk
+{
+
+/** \class FeatureCache
+ * \brief Persistent, size-bounded, on-disk store of feature images.
+ *
+ * Feature generators that are given a cache look their feature up before
+ * computing it, and store it once computed. Entries are identified by a key
+ * that combines a hash of the input image (pixel buffer, buffered region,
+ * spacing, origin and direction) with the class and parameters of the
+ * generator, so that a repeated run on the same data and settings finds the
+ * features it computed before, even across processes.
+ *
+ * Every entry is a single file in the cache directory holding a small header
+ * followed by the raw float pixels, which keeps reading it close to a plain
+ * memory copy. The header carries a checksum of the pixels; entries that fail
+ * the check are deleted and reported as misses.
+ *
+ * The total size of the directory is kept under MaximumSize by evicting the
+ * least recently used entries, as given by the modification time of their
+ * files, which is refreshed on every hit.
+ *
+ * A cache with an empty Directory is inactive: lookups miss and stores are
+ * ignored. The cache may be shared by generators running concurrently.
+ *
+ * \ingroup LesionSizingToolkit
+ */
+template <unsigned int NDimension>
+class ITK_EXPORT FeatureCache : public Object
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(FeatureCache);
+
+  /** Standard class type alias. */
+  using Self = FeatureCache;
+  using Superclass = Object;
+  using Pointer = SmartPointer<Self>;
+  using ConstPointer = SmartPointer<const Self>;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(FeatureCache, Object);
+
+  /** Dimension of the space */
+  static constexpr unsigned int Dimension = NDimension;
+
+  /** Type of the images from which features are computed. */
+  using InputPixelType = signed short;
+  using InputImageType = Image< InputPixelType, Dimension >;
+
+  /** Type of the cached feature images. */
+  using FeaturePixelType = float;
+  using FeatureImageType = Image< FeaturePixelType, Dimension >;
+  using FeatureImagePointer = typename FeatureImageType::Pointer;
+
+  /** Directory where the entries are stored. It is created if needed. */
+  itkSetMacro( Directory, std::string );
+  itkGetConstReferenceMacro( Directory, std::string );
+
+  /** Maximum total size, in bytes, of the entries kept in the directory.
+   * Defaults to 1 GiB. */
+  itkSetMacro( MaximumSize, SizeValueType );
+  itkGetConstMacro( MaximumSize, SizeValueType );
+
+  /** Key of the feature computed from the given image with the given
+   * parameters. The hash of the image is memoized until its modification
+   * time changes. */
+  std::string ComputeKey( const InputImageType * image, const std::string & parameters );
+
+  /** Key of a feature that is entirely described by the given string,
+   * typically the combination of the keys of other features. */
+  std::string ComputeKey( const std::string & parameters ) const;
+
+  /** Return the feature stored under the key, or a null pointer if there is
+   * none or if it is corrupted. */
+  FeatureImagePointer Retrieve( const std::string & key );
+
+  /** Store the feature under the key, evicting old entries if needed. */
+  void Store( const std::string & key, const FeatureImageType * feature );
+
+  /** Check every entry of the directory and delete the corrupted ones.
+   * Returns the number of entries deleted. */
+  unsigned int RemoveCorruptedEntries();
+
+  /** Delete all the entries of the directory. */
+  void Clear();
+
+  /** Number of lookups that found, or did not find, a valid entry. */
+  SizeValueType GetNumberOfHits() const
+    {
+    return this->m_NumberOfHits;
+    }
+  SizeValueType GetNumberOfMisses() const
+    {
+    return this->m_NumberOfMisses;
+    }
+
+protected:
+  FeatureCache();
+  ~FeatureCache() override;
+  void PrintSelf(std::ostream& os, Indent indent) const override;
+
+private:
+  using HashType = std::uint64_t;
+
+  static HashType Hash( const void * data, size_t numberOfBytes, HashType seed );
+
+  std::string GetEntryFileName( const std::string & key ) const;
+
+  /** Read an entry, returning a null pointer if it is missing or invalid.
+   * Invalid entries are deleted. */
+  FeatureImagePointer ReadEntry( const std::string & fileName ) const;
+
+  /** Remove the least recently used entries until the directory fits in
+   * MaximumSize. */
+  void EvictEntries();
+
+  std::string                     m_Directory;
+  SizeValueType                   m_MaximumSize;
+
+  using ImageHashType = std::pair< ModifiedTimeType, HashType >;
+  std::map< const InputImageType *, ImageHashType >   m_ImageHashes;
+
+  mutable std::mutex              m_Mutex;
+
+  std::atomic< SizeValueType >    m_NumberOfHits;
+  std::atomic< SizeValueType >    m_NumberOfMisses;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+# include "itkFeatureCache.hxx"
+#endif
+
+#endif
@@ -0,0 +1,534 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkFeatureCache.hxx
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkFeatureCache_hxx
+#define itkFeatureCache_hxx
+
+#include "itkFeatureCache.h"
+#include "itksys/SystemTools.hxx"
+#include "itksys/Directory.hxx"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <vector>
+
+namespace itk
+{
+
+namespace FeatureCacheDetail
+{
+// Identifies the files written by FeatureCache, and the version of their layout.
+const char          Magic[8] = { 'L', 'S', 'T', 'F', 'C', '0', '0', '1' };
+const char * const  Extension = ".feature";
+
+inline std::uint64_t RotateLeft( std::uint64_t x, int r )
+{
+  return ( x << r ) | ( x >> ( 64 - r ) );
+}
+
+inline std::uint64_t Mix( std::uint64_t h )
+{
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+} // end namespace FeatureCacheDetail
+
+
+/**
+ * Constructor
+ */
+template <unsigned int NDimension>
+FeatureCache<NDimension>
+::FeatureCache()
+{
+  this->m_MaximumSize = 1024ul * 1024ul * 1024ul;
+  this->m_NumberOfHits = 0;
+  this->m_NumberOfMisses = 0;
+}
+
+
+/**
+ * Destructor
+ */
+template <unsigned int NDimension>
+FeatureCache<NDimension>
+::~FeatureCache()
+{
+}
+
+
+/**
+ * Hash a block of memory, eight bytes at a time.
+ */
+template <unsigned int NDimension>
+typename FeatureCache<NDimension>::HashType
+FeatureCache<NDimension>
+::Hash( const void * data, size_t numberOfBytes, HashType seed )
+{
+  using FeatureCacheDetail::RotateLeft;
+
+  const auto * bytes = static_cast< const unsigned char * >( data );
+
+  HashType h = seed ^ ( numberOfBytes * 0x9e3779b97f4a7c15ULL );
+
+  size_t i = 0;
+  for(; i + sizeof( HashType ) <= numberOfBytes; i += sizeof( HashType ) )
+    {
+    HashType w;
+    std::memcpy( &w, bytes + i, sizeof( HashType ) );
+    w *= 0x87c37b91114253d5ULL;
+    w = RotateLeft( w, 31 );
+    w *= 0x4cf5ad432745937fULL;
+    h ^= w;
+    h = RotateLeft( h, 27 ) * 5 + 0x52dce729;
+    }
+
+  if( i < numberOfBytes )
+    {
+    HashType w = 0;
+    std::memcpy( &w, bytes + i, numberOfBytes - i );
+    w *= 0x87c37b91114253d5ULL;
+    w = RotateLeft( w, 31 );
+    w *= 0x4cf5ad432745937fULL;
+    h ^= w;
+    }
+
+  return FeatureCacheDetail::Mix( h );
+}
+
+
+template <unsigned int NDimension>
+std::string
+FeatureCache<NDimension>
+::ComputeKey( const InputImageType * image, const std::string & parameters )
+{
+  if( !image )
+    {
+    itkExceptionMacro("Missing input image");
+    }
+
+  HashType imageHash;
+
+  {
+  std::lock_guard< std::mutex > lock( this->m_Mutex );
+
+  const ModifiedTimeType imageMTime = image->GetMTime();
+
+  auto hitr = this->m_ImageHashes.find( image );
+
+  if( hitr != this->m_ImageHashes.end() && hitr->second.first == imageMTime )
+    {
+    imageHash = hitr->second.second;
+    }
+  else
+    {
+    const typename InputImageType::RegionType region = image->GetBufferedRegion();
+
+    imageHash = Hash( image->GetBufferPointer(),
+      region.GetNumberOfPixels() * sizeof( InputPixelType ), 0 );
+
+    std::int64_t  index[Dimension];
+    std::uint64_t size[Dimension];
+    double        geometry[Dimension * ( Dimension + 2 )];
+
+    for( unsigned int i = 0; i < Dimension; i++ )
+      {
+      index[i] = region.GetIndex()[i];
+      size[i] = region.GetSize()[i];
+      geometry[i] = image->GetSpacing()[i];
+      geometry[Dimension + i] = image->GetOrigin()[i];
+      for( unsigned int j = 0; j < Dimension; j++ )
+        {
+        geometry[2 * Dimension + i * Dimension + j] = image->GetDirection()[i][j];
+        }
+      }
+
+    imageHash = Hash( index, sizeof( index ), imageHash );
+    imageHash = Hash( size, sizeof( size ), imageHash );
+    imageHash = Hash( geometry, sizeof( geometry ), imageHash );
+
+    // Images are only remembered while they are being processed, do not let
+    // the table grow with every image seen in a long session.
+    if( this->m_ImageHashes.size() > 16 )
+      {
+      this->m_ImageHashes.clear();
+      }
+    this->m_ImageHashes[image] = ImageHashType( imageMTime, imageHash );
+    }
+  }
+
+  const HashType key = Hash( parameters.data(), parameters.size(), imageHash );
+
+  std::ostringstream os;
+  os << std::hex << std::setw( 16 ) << std::setfill( '0' ) << key;
+  return os.str();
+}
+
+
+template <unsigned int NDimension>
+std::string
+FeatureCache<NDimension>
+::ComputeKey( const std::string & parameters ) const
+{
+  const HashType key = Hash( parameters.data(), parameters.size(), 0 );
+
+  std::ostringstream os;
+  os << std::hex << std::setw( 16 ) << std::setfill( '0' ) << key;
+  return os.str();
+}
+
+
+template <unsigned int NDimension>
+std::string
+FeatureCache<NDimension>
+::GetEntryFileName( const std::string & key ) const
+{
+  return this->m_Directory + "/" + key + FeatureCacheDetail::Extension;
+}
+
+
+template <unsigned int NDimension>
+typename FeatureCache<NDimension>::FeatureImagePointer
+FeatureCache<NDimension>
+::Retrieve( const std::string & key )
+{
+  if( this->m_Directory.empty() )
+    {
+    ++this->m_NumberOfMisses;
+    return nullptr;
+    }
+
+  const std::string fileName = this->GetEntryFileName( key );
+
+  FeatureImagePointer feature;
+
+  if( itksys::SystemTools::FileExists( fileName, true ) )
+    {
+    feature = this->ReadEntry( fileName );
+    }
+
+  if( !feature )
+    {
+    ++this->m_NumberOfMisses;
+    return nullptr;
+    }
+
+  // Mark the entry as recently used.
+  itksys::SystemTools::Touch( fileName, false );
+
+  ++this->m_NumberOfHits;
+
+  return feature;
+}
+
+
+template <unsigned int NDimension>
+typename FeatureCache<NDimension>::FeatureImagePointer
+FeatureCache<NDimension>
+::ReadEntry( const std::string & fileName ) const
+{
+  std::ifstream is( fileName.c_str(), std::ios::binary );
+
+  char          magic[sizeof( FeatureCacheDetail::Magic )];
+  std::uint32_t dimension = 0;
+  std::uint32_t pixelSize = 0;
+  std::int64_t  index[Dimension];
+  std::uint64_t size[Dimension];
+  double        geometry[Dimension * ( Dimension + 2 )];
+  HashType      checksum = 0;
+
+  is.read( magic, sizeof( magic ) );
+  is.read( reinterpret_cast< char * >( &dimension ), sizeof( dimension ) );
+  is.read( reinterpret_cast< char * >( &pixelSize ), sizeof( pixelSize ) );
+
+  bool valid = is.good() &&
+    std::equal( magic, magic + sizeof( magic ), FeatureCacheDetail::Magic ) &&
+    dimension == Dimension && pixelSize == sizeof( FeaturePixelType );
+
+  if( valid )
+    {
+    is.read( reinterpret_cast< char * >( index ), sizeof( index ) );
+    is.read( reinterpret_cast< char * >( size ), sizeof( size ) );
+    is.read( reinterpret_cast< char * >( geometry ), sizeof( geometry ) );
+    is.read( reinterpret_cast< char * >( &checksum ), sizeof( checksum ) );
+    valid = is.good();
+    }
+
+  // Check the size of the file before allocating anything, so that a damaged
+  // header cannot request an arbitrarily large buffer.
+  std::uint64_t numberOfPixels = 1;
+  if( valid )
+    {
+    for( unsigned int i = 0; i < Dimension; i++ )
+      {
+      numberOfPixels *= size[i];
+      }
+    const std::uint64_t expectedLength = static_cast< std::uint64_t >( is.tellg() ) +
+      numberOfPixels * sizeof( FeaturePixelType );
+    valid = ( itksys::SystemTools::FileLength( fileName ) == expectedLength );
+    }
+
+  FeatureImagePointer feature;
+
+  if( valid )
+    {
+    typename FeatureImageType::RegionType region;
+    typename FeatureImageType::SpacingType spacing;
+    typename FeatureImageType::PointType origin;
+    typename FeatureImageType::DirectionType direction;
+
+    for( unsigned int i = 0; i < Dimension; i++ )
+      {
+      region.SetIndex( i, index[i] );
+      region.SetSize( i, size[i] );
+      spacing[i] = geometry[i];
+      origin[i] = geometry[Dimension + i];
+      for( unsigned int j = 0; j < Dimension; j++ )
+        {
+        direction[i][j] = geometry[2 * Dimension + i * Dimension + j];
+        }
+      }
+
+    feature = FeatureImageType::New();
+    feature->SetRegions( region );
+    feature->SetSpacing( spacing );
+    feature->SetOrigin( origin );
+    feature->SetDirection( direction );
+    feature->Allocate();
+
+    const size_t numberOfBytes = numberOfPixels * sizeof( FeaturePixelType );
+
+    is.read( reinterpret_cast< char * >( feature->GetBufferPointer() ), numberOfBytes );
+
+    valid = is.good() && Hash( feature->GetBufferPointer(), numberOfBytes, 0 ) == checksum;
+    }
+
+  if( !valid )
+    {
+    is.close();
+    itksys::SystemTools::RemoveFile( fileName );
+    return nullptr;
+    }
+
+  return feature;
+}
+
+
+template <unsigned int NDimension>
+void
+FeatureCache<NDimension>
+::Store( const std::string & key, const FeatureImageType * feature )
+{
+  if( this->m_Directory.empty() || !feature )
+    {
+    return;
+    }
+
+  itksys::SystemTools::MakeDirectory( this->m_Directory );
+
+  const std::string fileName = this->GetEntryFileName( key );
+
+  if( itksys::SystemTools::FileExists( fileName, true ) )
+    {
+    itksys::SystemTools::Touch( fileName, false );
+    return;
+    }
+
+  const typename FeatureImageType::RegionType region = feature->GetBufferedRegion();
+
+  const std::uint32_t dimension = Dimension;
+  const std::uint32_t pixelSize = sizeof( FeaturePixelType );
+  std::int64_t        index[Dimension];
+  std::uint64_t       size[Dimension];
+  double              geometry[Dimension * ( Dimension + 2 )];
+
+  for( unsigned int i = 0; i < Dimension; i++ )
+    {
+    index[i] = region.GetIndex()[i];
+    size[i] = region.GetSize()[i];
+    geometry[i] = feature->GetSpacing()[i];
+    geometry[Dimension + i] = feature->GetOrigin()[i];
+    for( unsigned int j = 0; j < Dimension; j++ )
+      {
+      geometry[2 * Dimension + i * Dimension + j] = feature->GetDirection()[i][j];
+      }
+    }
+
+  const size_t numberOfBytes = region.GetNumberOfPixels() * sizeof( FeaturePixelType );
+  const HashType checksum = Hash( feature->GetBufferPointer(), numberOfBytes, 0 );
+
+  // Write to a private file first and move it in place once complete, so that
+  // other processes sharing the directory never see a partial entry.
+  std::random_device randomDevice;
+  std::ostringstream temporaryFileName;
+  temporaryFileName << fileName << "." << std::hex << randomDevice() << ".tmp";
+
+  std::ofstream os( temporaryFileName.str().c_str(), std::ios::binary );
+
+  os.write( FeatureCacheDetail::Magic, sizeof( FeatureCacheDetail::Magic ) );
+  os.write( reinterpret_cast< const char * >( &dimension ), sizeof( dimension ) );
+  os.write( reinterpret_cast< const char * >( &pixelSize ), sizeof( pixelSize ) );
+  os.write( reinterpret_cast< const char * >( index ), sizeof( index ) );
+  os.write( reinterpret_cast< const char * >( size ), sizeof( size ) );
+  os.write( reinterpret_cast< const char * >( geometry ), sizeof( geometry ) );
+  os.write( reinterpret_cast< const char * >( &checksum ), sizeof( checksum ) );
+  os.write( reinterpret_cast< const char * >( feature->GetBufferPointer() ), numberOfBytes );
+  os.close();
+
+  if( !os || std::rename( temporaryFileName.str().c_str(), fileName.c_str() ) != 0 )
+    {
+    itksys::SystemTools::RemoveFile( temporaryFileName.str() );
+    itkWarningMacro("Could not store feature in " << fileName );
+    return;
+    }
+
+  std::lock_guard< std::mutex > lock( this->m_Mutex );
+  this->EvictEntries();
+}
+
+
+template <unsigned int NDimension>
+void
+FeatureCache<NDimension>
+::EvictEntries()
+{
+  itksys::Directory directory;
+
+  if( !directory.Load( this->m_Directory ) )
+    {
+    return;
+    }
+
+  struct Entry
+    {
+    long int        Time;
+    std::uint64_t   Length;
+    std::string     FileName;
+    };
+
+  std::vector< Entry > entries;
+  std::uint64_t totalLength = 0;
+
+  for( unsigned long i = 0; i < directory.GetNumberOfFiles(); i++ )
+    {
+    const std::string name = directory.GetFile( i );
+    if( itksys::SystemTools::GetFilenameLastExtension( name ) != FeatureCacheDetail::Extension )
+      {
+      continue;
+      }
+    Entry entry;
+    entry.FileName = this->m_Directory + "/" + name;
+    entry.Time = itksys::SystemTools::ModifiedTime( entry.FileName );
+    entry.Length = itksys::SystemTools::FileLength( entry.FileName );
+    totalLength += entry.Length;
+    entries.push_back( entry );
+    }
+
+  std::sort( entries.begin(), entries.end(),
+    []( const Entry & a, const Entry & b ) { return a.Time < b.Time; } );
+
+  auto eitr = entries.begin();
+
+  while( totalLength > static_cast< std::uint64_t >( this->m_MaximumSize ) && eitr != entries.end() )
+    {
+    itksys::SystemTools::RemoveFile( eitr->FileName );
+    totalLength -= eitr->Length;
+    ++eitr;
+    }
+}
+
+
+template <unsigned int NDimension>
+unsigned int
+FeatureCache<NDimension>
+::RemoveCorruptedEntries()
+{
+  itksys::Directory directory;
+
+  if( this->m_Directory.empty() || !directory.Load( this->m_Directory ) )
+    {
+    return 0;
+    }
+
+  unsigned int numberOfRemovedEntries = 0;
+
+  for( unsigned long i = 0; i < directory.GetNumberOfFiles(); i++ )
+    {
+    const std::string name = directory.GetFile( i );
+    if( itksys::SystemTools::GetFilenameLastExtension( name ) != FeatureCacheDetail::Extension )
+      {
+      continue;
+      }
+    if( !this->ReadEntry( this->m_Directory + "/" + name ) )
+      {
+      ++numberOfRemovedEntries;
+      }
+    }
+
+  return numberOfRemovedEntries;
+}
+
+
+template <unsigned int NDimension>
+void
+FeatureCache<NDimension>
+::Clear()
+{
+  itksys::Directory directory;
+
+  if( this->m_Directory.empty() || !directory.Load( this->m_Directory ) )
+    {
+    return;
+    }
+
+  for( unsigned long i = 0; i < directory.GetNumberOfFiles(); i++ )
+    {
+    const std::string name = directory.GetFile( i );
+    if( itksys::SystemTools::GetFilenameLastExtension( name ) == FeatureCacheDetail::Extension )
+      {
+      itksys::SystemTools::RemoveFile( this->m_Directory + "/" + name );
+      }
+    }
+}
+
+
+/**
+ * PrintSelf
+ */
+template <unsigned int NDimension>
+void
+FeatureCache<NDimension>
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf( os, indent );
+  os << indent << "Directory " << this->m_Directory << std::endl;
+  os << indent << "Maximum size " << this->m_MaximumSize << std::endl;
+  os << indent << "Number of hits " << this->m_NumberOfHits.load() << std::endl;
+  os << indent << "Number of misses " << this->m_NumberOfMisses.load() << std::endl;
+}
+
+} // end namespace itk
+
+#endif
@@ -21,6 +21,9 @@
 #include "itkImage.h"
 #include "itkDataObjectDecorator.h"
 #include "itkSpatialObject.h"
+#include "itkFeatureCache.h"
+
+#include <string>
 
 namespace itk
 {
@@ -33,6 +36,11 @@ namespace itk
  *
  * SpatialObjects are used as inputs and outputs of this class.
  *
+ * A FeatureCache may be attached to the generator. Generators that describe
+ * their parameters through GetFeatureCacheParameters() then look their
+ * feature up in the cache when Update() finds it out of date, and only
+ * compute it on a miss.
+ *
  * \ingroup SpatialObjectFilters
  * \ingroup LesionSizingToolkit
  */
@@ -71,6 +79,43 @@ public:
    * SpatialObject. */
   const SpatialObjectType * GetFeature() const;
 
+  /** Type of the persistent store of computed features. */
+  using FeatureCacheType = FeatureCache< NDimension >;
+
+  /** Optional cache from which the feature is taken when it was already
+   * computed, with the same parameters, from the same input. */
+  itkSetObjectMacro( FeatureCache, FeatureCacheType );
+  itkGetModifiableObjectMacro( FeatureCache, FeatureCacheType );
+
+  /** Bring the feature up to date, from the cache when possible. This is
+   * PropagateFeatureRequest() followed by UpdateFeatureData(). */
+  void Update() override;
+
+  /** First half of Update(): bring the output information up to date and
+   * propagate the requested regions to the inputs, without generating any
+   * data. */
+  void PropagateFeatureRequest();
+
+  /** Second half of Update(): generate the feature, or take it from the
+   * cache, once PropagateFeatureRequest() has been called. The pipeline
+   * state of up to date inputs is only read, so that generators sharing an
+   * input may run this concurrently. */
+  void UpdateFeatureData();
+
+  /** Key identifying the feature in the given cache. An empty key means that
+   * the feature cannot be cached. */
+  virtual std::string ComputeFeatureCacheKey( FeatureCacheType * cache ) const;
+
+  /** Whether the feature over a region only depends on the input within
+   * GetTileHaloRadius() of that region, so that an aggregator may compute it
+   * one tile of the input at a time. Such generators override
+   * InternalClone() to copy their parameters, the tiles being computed by
+   * clones. False by default. */
+  virtual bool GetSupportsTiling() const;
+
+  /** Margin, in physical units, of input needed around a tile to compute the
+   * feature over that tile. Zero by default. */
+  virtual double GetTileHaloRadius() const;
 
 protected:
   FeatureGenerator();
@@ -81,6 +126,18 @@ protected:
 
   /** non-const version of the method intended to be used in derived classes. */
   SpatialObjectType * GetInternalFeature();
+
+  /** Write every parameter that affects the feature to the stream. Derived
+   * classes opt into caching by overriding this method and returning true.
+   * Returns false by default. */
+  virtual bool GetFeatureCacheParameters( std::ostream & os ) const;
+
+private:
+  typename FeatureCacheType::Pointer      m_FeatureCache;
+
+  /** Key of the feature, and pipeline time at which it was computed. */
+  std::string                             m_FeatureCacheKey;
+  ModifiedTimeType                        m_FeatureCacheKeyTime;
 };
 
 } // end namespace itk
@@ -18,6 +18,9 @@
 #define itkFeatureGenerator_hxx
 
 #include "itkFeatureGenerator.h"
+#include "itkImageSpatialObject.h"
+
+#include <sstream>
 
 
 namespace itk
@@ -31,6 +34,7 @@ FeatureGenerator<NDimension>
 ::FeatureGenerator()
 {
   this->SetNumberOfRequiredOutputs( 1 );
+  this->m_FeatureCacheKeyTime = 0;
 }
 
 
@@ -80,6 +84,151 @@ FeatureGenerator<NDimension>
 }
 
 
+template <unsigned int NDimension>
+bool
+FeatureGenerator<NDimension>
+::GetFeatureCacheParameters( std::ostream & ) const
+{
+  return false;
+}
+
+
+template <unsigned int NDimension>
+std::string
+FeatureGenerator<NDimension>
+::ComputeFeatureCacheKey( FeatureCacheType * cache ) const
+{
+  using InputImageSpatialObjectType =
+    ImageSpatialObject< NDimension, typename FeatureCacheType::InputPixelType >;
+
+  const auto * inputObject =
+    dynamic_cast< const InputImageSpatialObjectType * >( this->ProcessObject::GetInput(0) );
+
+  if( !cache || !inputObject || !inputObject->GetImage() )
+    {
+    return std::string();
+    }
+
+  std::ostringstream parameters;
+  parameters.precision( 17 );
+  parameters << this->GetNameOfClass();
+
+  if( !this->GetFeatureCacheParameters( parameters ) )
+    {
+    return std::string();
+    }
+
+  return cache->ComputeKey( inputObject->GetImage(), parameters.str() );
+}
+
+
+template <unsigned int NDimension>
+void
+FeatureGenerator<NDimension>
+::Update()
+{
+  this->PropagateFeatureRequest();
+  this->UpdateFeatureData();
+}
+
+
+template <unsigned int NDimension>
+void
+FeatureGenerator<NDimension>
+::PropagateFeatureRequest()
+{
+  DataObject * output = this->GetPrimaryOutput();
+
+  if( output )
+    {
+    output->UpdateOutputInformation();
+    output->PropagateRequestedRegion();
+    }
+}
+
+
+template <unsigned int NDimension>
+void
+FeatureGenerator<NDimension>
+::UpdateFeatureData()
+{
+  using FeatureSpatialObjectType =
+    ImageSpatialObject< NDimension, typename FeatureCacheType::FeaturePixelType >;
+
+  DataObject * output = this->GetPrimaryOutput();
+
+  if( !output )
+    {
+    return;
+    }
+
+  auto * outputObject = dynamic_cast< FeatureSpatialObjectType * >( this->GetInternalFeature() );
+
+  if( !this->m_FeatureCache || !outputObject )
+    {
+    output->UpdateOutputData();
+    return;
+    }
+
+  // Only a feature that is out of date is looked up in the cache, the
+  // pipeline leaves an up to date one as it is.
+  const ModifiedTimeType pipelineMTime = outputObject->GetPipelineMTime();
+
+  if( outputObject->GetUpdateMTime() >= pipelineMTime && !outputObject->GetDataReleased() )
+    {
+    output->UpdateOutputData();
+    return;
+    }
+
+  // The key only changes with the parameters or the input, both of which
+  // are accounted for by the pipeline time.
+  if( this->m_FeatureCacheKeyTime != pipelineMTime )
+    {
+    this->m_FeatureCacheKey = this->ComputeFeatureCacheKey( this->m_FeatureCache );
+    this->m_FeatureCacheKeyTime = pipelineMTime;
+    }
+
+  if( this->m_FeatureCacheKey.empty() )
+    {
+    output->UpdateOutputData();
+    return;
+    }
+
+  typename FeatureCacheType::FeatureImagePointer feature = this->m_FeatureCache->Retrieve( this->m_FeatureCacheKey );
+
+  if( feature )
+    {
+    // The feature is now up to date, the next updates leave it alone.
+    outputObject->SetImage( feature );
+    outputObject->DataHasBeenGenerated();
+    this->UpdateProgress( 1.0f );
+    return;
+    }
+
+  output->UpdateOutputData();
+
+  this->m_FeatureCache->Store( this->m_FeatureCacheKey, outputObject->GetImage() );
+}
+
+
+template <unsigned int NDimension>
+bool
+FeatureGenerator<NDimension>
+::GetSupportsTiling() const
+{
+  return false;
+}
+
+
+template <unsigned int NDimension>
+double
+FeatureGenerator<NDimension>
+::GetTileHaloRadius() const
+{
+  return 0.0;
+}
+
+
 /*
  * PrintSelf
  */
@@ -89,6 +238,7 @@ FeatureGenerator<NDimension>
 ::PrintSelf(std::ostream& os, Indent indent) const
 {
   Superclass::PrintSelf( os, indent );
+  os << indent << "Feature cache " << this->m_FeatureCache.GetPointer() << std::endl;
 }
 
 
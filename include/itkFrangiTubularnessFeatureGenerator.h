@@ -21,6 +21,7 @@
 #include "itkImage.h"
 #include "itkImageSpatialObject.h"
 #include "itkHessianRecursiveGaussianImageFilter.h"
+#include "itkHessianImageProvider.h"
 #include "itkSymmetricSecondRankTensor.h"
 #include "itkSymmetricEigenAnalysisImageFilter.h"
 #include "itkFrangiTubularnessImageFilter.h"
@@ -93,6 +94,15 @@ public:
   itkSetMacro( NoiseNormalization, double );
   itkGetMacro( NoiseNormalization, double );
 
+  /** Type of the object that shares Hessian computations among generators. */
+  using HessianProviderType = HessianImageProvider< NDimension >;
+
+  /** Optional provider from which the Hessian is taken instead of being
+   * computed internally. Generators attached to the same provider, and
+   * configured with the same sigma on the same input, share one Hessian. */
+  itkSetObjectMacro( HessianProvider, HessianProviderType );
+  itkGetModifiableObjectMacro( HessianProvider, HessianProviderType );
+
 protected:
   FrangiTubularnessFeatureGenerator();
   ~FrangiTubularnessFeatureGenerator() override;
@@ -126,6 +136,8 @@ private:
   typename EigenAnalysisFilterType::Pointer       m_EigenAnalysisFilter;
   typename SheetnessFilterType::Pointer           m_SheetnessFilter;
 
+  typename HessianProviderType::Pointer           m_HessianProvider;
+
   double      m_Sigma;
   double      m_SheetnessNormalization;
   double      m_BloobinessNormalization;
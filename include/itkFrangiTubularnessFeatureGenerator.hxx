@@ -107,9 +107,6 @@ FrangiTubularnessFeatureGenerator<NDimension>
   // Report progress.
   ProgressAccumulator::Pointer progress = ProgressAccumulator::New();
   progress->SetMiniPipelineFilter(this);
-  progress->RegisterInternalFilter( this->m_HessianFilter, .5 );
-  progress->RegisterInternalFilter( this->m_EigenAnalysisFilter, .25 );
-  progress->RegisterInternalFilter( this->m_SheetnessFilter, .25 );
 
   typename InputImageSpatialObjectType::ConstPointer inputObject = 
     dynamic_cast<const InputImageSpatialObjectType * >( this->ProcessObject::GetInput(0) );
@@ -126,12 +123,26 @@ FrangiTubularnessFeatureGenerator<NDimension>
     itkExceptionMacro("Missing input image");
     }
 
-  this->m_HessianFilter->SetInput( inputImage );
-  this->m_EigenAnalysisFilter->SetInput( this->m_HessianFilter->GetOutput() );
-  this->m_SheetnessFilter->SetInput( this->m_EigenAnalysisFilter->GetOutput() );
+  if( this->m_HessianProvider )
+    {
+    progress->RegisterInternalFilter( this->m_SheetnessFilter, 1.0 );
+
+    this->m_SheetnessFilter->SetInput(
+      this->m_HessianProvider->GetEigenValues( inputImage, this->m_Sigma ) );
+    }
+  else
+    {
+    progress->RegisterInternalFilter( this->m_HessianFilter, .5 );
+    progress->RegisterInternalFilter( this->m_EigenAnalysisFilter, .25 );
+    progress->RegisterInternalFilter( this->m_SheetnessFilter, .25 );
+
+    this->m_HessianFilter->SetInput( inputImage );
+    this->m_EigenAnalysisFilter->SetInput( this->m_HessianFilter->GetOutput() );
+    this->m_SheetnessFilter->SetInput( this->m_EigenAnalysisFilter->GetOutput() );
 
-  this->m_HessianFilter->SetSigma( this->m_Sigma );
-  this->m_EigenAnalysisFilter->SetDimension( Dimension );
+    this->m_HessianFilter->SetSigma( this->m_Sigma );
+    this->m_EigenAnalysisFilter->SetDimension( Dimension );
+    }
   this->m_SheetnessFilter->SetSheetnessNormalization( this->m_SheetnessNormalization );
   this->m_SheetnessFilter->SetBloobinessNormalization( this->m_BloobinessNormalization );
   this->m_SheetnessFilter->SetNoiseNormalization( this->m_NoiseNormalization );
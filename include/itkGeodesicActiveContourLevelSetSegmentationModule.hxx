@@ -20,6 +20,7 @@
 #include "itkGeodesicActiveContourLevelSetSegmentationModule.h"
 #include "itkGeodesicActiveContourLevelSetImageFilter.h"
 #include "itkProgressAccumulator.h"
+#include "itkCancellationToken.h"
 
 
 namespace itk
@@ -86,7 +87,12 @@ GeodesicActiveContourLevelSetSegmentationModule<NDimension>
   progress->SetMiniPipelineFilter(this);
   progress->RegisterInternalFilter( filter, 1.0 );  
 
-  filter->Update();
+  // the filter does not poll the cancellation token of
+  // the segmentation, it is aborted from its events
+    {
+    CancellationToken::AbortObserver abortObserver( CancellationToken::GetCurrent(), filter );
+    filter->Update();
+    }
 
   std::cout << std::endl;
   std::cout << "Max. no. iterations: " << filter->GetNumberOfIterations() << std::endl;
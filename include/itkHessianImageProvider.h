@@ -0,0 +1,166 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkHessianImageProvider.h
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkHessianImageProvider_h
+#define itkHessianImageProvider_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkImage.h"
+#include "itkHessianRecursiveGaussianImageFilter.h"
+#include "itkSymmetricSecondRankTensor.h"
+#include "itkSymmetricEigenAnalysisImageFilter.h"
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+
+namespace itk
+{
+
+/** \class HessianImageProvider
+ * \brief Computes, caches and shares Hessian and Hessian eigenvalue images.
+ *
+ * Several feature generators (Sato vesselness, Frangi tubularness, Descoteaux
+ * sheetness and Sato local structure) start by computing the Hessian of their
+ * input at a given sigma. When they are attached to the same provider, the
+ * Hessian, and its eigen-analysis, are computed only once for every
+ * combination of input image, sigma and scale normalization.
+ *
+ * An entry is considered stale, and is recomputed, when the modification time
+ * of its input image changes. Cached images are held until
+ * ReleaseCachedImages() is called or the provider is destroyed.
+ *
+ * In three dimensions, the eigenvalues can be computed with the closed form
+ * solver of SymmetricEigenSystem3x3 instead of SymmetricEigenAnalysis, see
+ * SetUseClosedFormEigenAnalysis(). They are sorted by value in both cases.
+ *
+ * The provider can be queried from several threads at once. Two requests for
+ * the same entry wait for a single computation, while requests for different
+ * entries proceed independently.
+ *
+ * \ingroup LesionSizingToolkit
+ */
+template <unsigned int NDimension>
+class ITK_EXPORT HessianImageProvider : public Object
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(HessianImageProvider);
+
+  /** Standard class type alias. */
+  using Self = HessianImageProvider;
+  using Superclass = Object;
+  using Pointer = SmartPointer<Self>;
+  using ConstPointer = SmartPointer<const Self>;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(HessianImageProvider, Object);
+
+  /** Dimension of the space */
+  static constexpr unsigned int Dimension = NDimension;
+
+  /** Type of the images from which the Hessian is computed. This matches the
+   * input image type of the feature generators. */
+  using InputPixelType = signed short;
+  using InputImageType = Image< InputPixelType, Dimension >;
+
+  using HessianFilterType = HessianRecursiveGaussianImageFilter< InputImageType >;
+  using HessianImageType = typename HessianFilterType::OutputImageType;
+  using HessianPixelType = typename HessianImageType::PixelType;
+
+  using EigenValueArrayType = FixedArray< double, HessianPixelType::Dimension >;
+  using EigenValueImageType = Image< EigenValueArrayType, Dimension >;
+
+  using EigenAnalysisFilterType = SymmetricEigenAnalysisImageFilter< HessianImageType, EigenValueImageType >;
+
+  /** Return the Hessian of the image at the given sigma, computing it only if
+   * it is not already cached. */
+  const HessianImageType * GetHessian( const InputImageType * image,
+    double sigma, bool normalizeAcrossScale = false );
+
+  /** Return the Hessian eigenvalues of the image at the given sigma. The
+   * Hessian is taken from, or added to, the cache as well. */
+  const EigenValueImageType * GetEigenValues( const InputImageType * image,
+    double sigma, bool normalizeAcrossScale = false );
+
+  /** Compute the eigenvalues of three dimensional Hessians with the closed
+   * form solver. Off by default. It only affects the eigenvalues computed
+   * after it is changed, the cache may have to be released. */
+  itkSetMacro( UseClosedFormEigenAnalysis, bool );
+  itkGetConstMacro( UseClosedFormEigenAnalysis, bool );
+  itkBooleanMacro( UseClosedFormEigenAnalysis );
+
+  /** Drop all the cached images. */
+  void ReleaseCachedImages();
+
+  /** Number of Hessian images computed, and served from the cache, so far. */
+  SizeValueType GetNumberOfComputedHessians() const
+    {
+    return this->m_NumberOfComputedHessians;
+    }
+  SizeValueType GetNumberOfReusedHessians() const
+    {
+    return this->m_NumberOfReusedHessians;
+    }
+
+protected:
+  HessianImageProvider();
+  ~HessianImageProvider() override;
+  void PrintSelf(std::ostream& os, Indent indent) const override;
+
+private:
+  struct CacheEntry
+    {
+    std::mutex                                Mutex;
+    typename InputImageType::ConstPointer     Image;
+    ModifiedTimeType                          ImageMTime;
+    typename HessianImageType::Pointer        Hessian;
+    typename EigenValueImageType::Pointer     EigenValues;
+    };
+
+  using CacheEntryPointer = std::shared_ptr< CacheEntry >;
+  using CacheKeyType = std::tuple< const InputImageType *, double, bool >;
+  using CacheType = std::map< CacheKeyType, CacheEntryPointer >;
+
+  /** Eigenvalues of a three dimensional Hessian with the closed form
+   * solver. */
+  typename EigenValueImageType::Pointer ComputeClosedFormEigenValues( const HessianImageType * hessian ) const;
+
+  /** Find the entry for the given key, replacing it if it is stale. */
+  CacheEntryPointer GetCacheEntry( const InputImageType * image,
+    double sigma, bool normalizeAcrossScale );
+
+  CacheType                       m_Cache;
+  mutable std::mutex              m_CacheMutex;
+
+  std::atomic< SizeValueType >    m_NumberOfComputedHessians;
+  std::atomic< SizeValueType >    m_NumberOfReusedHessians;
+
+  bool                            m_UseClosedFormEigenAnalysis;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+# include "itkHessianImageProvider.hxx"
+#endif
+
+#endif
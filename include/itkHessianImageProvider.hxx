@@ -0,0 +1,215 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkHessianImageProvider.hxx
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkHessianImageProvider_hxx
+#define itkHessianImageProvider_hxx
+
+#include "itkHessianImageProvider.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+#include "itkMultiThreaderBase.h"
+#include "itkSymmetricEigenSystem3x3.h"
+
+namespace itk
+{
+
+/**
+ * Constructor
+ */
+template <unsigned int NDimension>
+HessianImageProvider<NDimension>
+::HessianImageProvider()
+{
+  this->m_NumberOfComputedHessians = 0;
+  this->m_NumberOfReusedHessians = 0;
+  this->m_UseClosedFormEigenAnalysis = false;
+}
+
+
+/**
+ * Destructor
+ */
+template <unsigned int NDimension>
+HessianImageProvider<NDimension>
+::~HessianImageProvider()
+{
+}
+
+
+template <unsigned int NDimension>
+typename HessianImageProvider<NDimension>::CacheEntryPointer
+HessianImageProvider<NDimension>
+::GetCacheEntry( const InputImageType * image, double sigma, bool normalizeAcrossScale )
+{
+  if( !image )
+    {
+    itkExceptionMacro("Missing input image");
+    }
+
+  const CacheKeyType key( image, sigma, normalizeAcrossScale );
+
+  std::lock_guard< std::mutex > lock( this->m_CacheMutex );
+
+  CacheEntryPointer & entry = this->m_Cache[key];
+
+  if( !entry || entry->ImageMTime != image->GetMTime() )
+    {
+    entry = std::make_shared< CacheEntry >();
+    entry->Image = image;
+    entry->ImageMTime = image->GetMTime();
+    }
+
+  return entry;
+}
+
+
+template <unsigned int NDimension>
+const typename HessianImageProvider<NDimension>::HessianImageType *
+HessianImageProvider<NDimension>
+::GetHessian( const InputImageType * image, double sigma, bool normalizeAcrossScale )
+{
+  CacheEntryPointer entry = this->GetCacheEntry( image, sigma, normalizeAcrossScale );
+
+  std::lock_guard< std::mutex > lock( entry->Mutex );
+
+  if( entry->Hessian )
+    {
+    ++this->m_NumberOfReusedHessians;
+    return entry->Hessian;
+    }
+
+  typename HessianFilterType::Pointer hessianFilter = HessianFilterType::New();
+  hessianFilter->SetInput( image );
+  hessianFilter->SetSigma( sigma );
+  hessianFilter->SetNormalizeAcrossScale( normalizeAcrossScale );
+  hessianFilter->Update();
+
+  entry->Hessian = hessianFilter->GetOutput();
+  entry->Hessian->DisconnectPipeline();
+
+  ++this->m_NumberOfComputedHessians;
+
+  return entry->Hessian;
+}
+
+
+template <unsigned int NDimension>
+const typename HessianImageProvider<NDimension>::EigenValueImageType *
+HessianImageProvider<NDimension>
+::GetEigenValues( const InputImageType * image, double sigma, bool normalizeAcrossScale )
+{
+  // Must be called before locking the entry, since it locks it as well.
+  const HessianImageType * hessian = this->GetHessian( image, sigma, normalizeAcrossScale );
+
+  CacheEntryPointer entry = this->GetCacheEntry( image, sigma, normalizeAcrossScale );
+
+  std::lock_guard< std::mutex > lock( entry->Mutex );
+
+  if( entry->EigenValues )
+    {
+    return entry->EigenValues;
+    }
+
+  if( this->m_UseClosedFormEigenAnalysis && Dimension == 3 )
+    {
+    entry->EigenValues = this->ComputeClosedFormEigenValues( hessian );
+    return entry->EigenValues;
+    }
+
+  typename EigenAnalysisFilterType::Pointer eigenAnalysisFilter = EigenAnalysisFilterType::New();
+  eigenAnalysisFilter->SetInput( hessian );
+  eigenAnalysisFilter->SetDimension( Dimension );
+  eigenAnalysisFilter->Update();
+
+  entry->EigenValues = eigenAnalysisFilter->GetOutput();
+  entry->EigenValues->DisconnectPipeline();
+
+  return entry->EigenValues;
+}
+
+
+template <unsigned int NDimension>
+typename HessianImageProvider<NDimension>::EigenValueImageType::Pointer
+HessianImageProvider<NDimension>
+::ComputeClosedFormEigenValues( const HessianImageType * hessian ) const
+{
+  using EigenSystemType = SymmetricEigenSystem3x3< double >;
+  using RegionType = typename HessianImageType::RegionType;
+
+  typename EigenValueImageType::Pointer eigenValues = EigenValueImageType::New();
+  eigenValues->CopyInformation( hessian );
+  eigenValues->SetRegions( hessian->GetBufferedRegion() );
+  eigenValues->Allocate();
+
+  EigenValueImageType * eigenValuesImage = eigenValues.GetPointer();
+
+  MultiThreaderBase::Pointer threader = MultiThreaderBase::New();
+  threader->template ParallelizeImageRegion< Dimension >(
+    hessian->GetBufferedRegion(),
+    [hessian, eigenValuesImage]( const RegionType & region )
+      {
+      ImageRegionConstIterator< HessianImageType > hitr( hessian, region );
+      ImageRegionIterator< EigenValueImageType > eitr( eigenValuesImage, region );
+
+      for( hitr.GoToBegin(), eitr.GoToBegin(); !hitr.IsAtEnd(); ++hitr, ++eitr )
+        {
+        const HessianPixelType & H = hitr.Get();
+
+        double values[3];
+        EigenSystemType::ComputeEigenValues( H(0,0), H(0,1), H(0,2), H(1,1), H(1,2), H(2,2), values );
+
+        EigenValueArrayType & eigenValue = eitr.Value();
+        eigenValue[0] = values[0];
+        eigenValue[1] = values[1];
+        eigenValue[2] = values[2];
+        }
+      },
+    nullptr );
+
+  return eigenValues;
+}
+
+
+template <unsigned int NDimension>
+void
+HessianImageProvider<NDimension>
+::ReleaseCachedImages()
+{
+  std::lock_guard< std::mutex > lock( this->m_CacheMutex );
+  this->m_Cache.clear();
+}
+
+
+/**
+ * PrintSelf
+ */
+template <unsigned int NDimension>
+void
+HessianImageProvider<NDimension>
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  std::lock_guard< std::mutex > lock( this->m_CacheMutex );
+  os << indent << "Number of cached entries " << this->m_Cache.size() << std::endl;
+  os << indent << "Number of computed Hessians " << this->m_NumberOfComputedHessians.load() << std::endl;
+  os << indent << "Number of reused Hessians " << this->m_NumberOfReusedHessians.load() << std::endl;
+  os << indent << "Use closed form eigen analysis " << this->m_UseClosedFormEigenAnalysis << std::endl;
+}
+
+} // end namespace itk
+
+#endif
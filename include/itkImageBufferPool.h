@@ -0,0 +1,191 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkImageBufferPool.h
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkImageBufferPool_h
+#define itkImageBufferPool_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkImportImageContainer.h"
+
+#include <map>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+namespace itk
+{
+
+/** \class ImageBufferPool
+ * \brief Size-bucketed pool of memory blocks for intermediate images.
+ *
+ * Filters that allocate the same working images on every run take the
+ * buffers of these images from a pool instead of the heap, and give them
+ * back when the images are released. Blocks are grouped in buckets of
+ * geometrically increasing sizes, four per power of two, so that a block can
+ * serve any request of its bucket while wasting at most a fifth of it.
+ * Reusing blocks that were already touched avoids both allocator churn and
+ * the page faults of fresh allocations in long running processes.
+ *
+ * Images are given a pooled buffer with Allocate(), which installs a
+ * PooledImportImageContainer as their pixel container. The block goes back
+ * to the pool when the container is destroyed, that is when the image is
+ * destroyed, re-initialized or given another container.
+ *
+ * Idle blocks are kept up to MaximumIdleSize bytes, larger blocks being
+ * freed when they are released. The pool may be shared by filters running
+ * concurrently. Most filters use the process wide pool returned by
+ * GetGlobalPool() unless given another one.
+ *
+ * \ingroup LesionSizingToolkit
+ */
+class ImageBufferPool : public Object
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(ImageBufferPool);
+
+  /** Standard class type alias. */
+  using Self = ImageBufferPool;
+  using Superclass = Object;
+  using Pointer = SmartPointer<Self>;
+  using ConstPointer = SmartPointer<const Self>;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(ImageBufferPool, Object);
+
+  /** Pool shared by all the filters of the process. */
+  static ImageBufferPool * GetGlobalPool();
+
+  /** Take a block of at least numberOfBytes bytes. The actual size of the
+   * block is returned in blockSize and must be given back on release. */
+  void * Acquire( SizeValueType numberOfBytes, SizeValueType & blockSize );
+
+  /** Give back a block obtained from Acquire(). */
+  void Release( void * block, SizeValueType blockSize );
+
+  /** Allocate the buffered region of the image from the pool. The pixels
+   * are not initialized. A null pool falls back to Image::Allocate(). */
+  template <typename TImage>
+  static void Allocate( TImage * image, ImageBufferPool * pool );
+
+  /** Free all the idle blocks. */
+  void Clear();
+
+  /** Maximum total size, in bytes, of the idle blocks kept for reuse.
+   * Defaults to 1 GiB. */
+  void SetMaximumIdleSize( SizeValueType size );
+  itkGetConstMacro( MaximumIdleSize, SizeValueType );
+
+  /** Number of requests served by an idle block, and by a new one. */
+  SizeValueType GetNumberOfHits() const;
+  SizeValueType GetNumberOfMisses() const;
+
+  /** Size, in bytes, of the blocks currently handed out, of the idle ones,
+   * and largest size ever handed out at the same time. */
+  SizeValueType GetSizeInUse() const;
+  SizeValueType GetIdleSize() const;
+  SizeValueType GetHighWaterMark() const;
+
+  /** Reset the hit and miss counts, and the high-water mark to the size in
+   * use. */
+  void ResetStatistics();
+
+protected:
+  ImageBufferPool();
+  ~ImageBufferPool() override;
+  void PrintSelf(std::ostream& os, Indent indent) const override;
+
+private:
+  /** Size of the bucket holding requests of the given size. */
+  static SizeValueType ComputeBlockSize( SizeValueType numberOfBytes );
+
+  /** Free idle blocks, largest first, until they fit in MaximumIdleSize.
+   * Must be called with the mutex locked. */
+  void TrimIdleBlocks();
+
+  using BlockListType = std::vector< void * >;
+  using BucketMapType = std::map< SizeValueType, BlockListType >;
+
+  BucketMapType                   m_IdleBlocks;
+
+  SizeValueType                   m_MaximumIdleSize;
+  SizeValueType                   m_IdleSize;
+  SizeValueType                   m_SizeInUse;
+  SizeValueType                   m_HighWaterMark;
+  SizeValueType                   m_NumberOfHits;
+  SizeValueType                   m_NumberOfMisses;
+
+  mutable std::mutex              m_Mutex;
+};
+
+
+/** \class PooledImportImageContainer
+ * \brief Pixel container whose memory is a block of an ImageBufferPool.
+ *
+ * The block is returned to the pool when the container is destroyed or
+ * given another block. Only elements that need neither construction nor
+ * destruction can be stored.
+ *
+ * \ingroup LesionSizingToolkit
+ */
+template <typename TElementIdentifier, typename TElement>
+class PooledImportImageContainer : public ImportImageContainer<TElementIdentifier, TElement>
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(PooledImportImageContainer);
+
+  /** Standard class type alias. */
+  using Self = PooledImportImageContainer;
+  using Superclass = ImportImageContainer<TElementIdentifier, TElement>;
+  using Pointer = SmartPointer<Self>;
+  using ConstPointer = SmartPointer<const Self>;
+
+  using ElementIdentifier = TElementIdentifier;
+  using Element = TElement;
+
+  static_assert( std::is_trivially_copyable< TElement >::value &&
+                 std::is_trivially_destructible< TElement >::value,
+                 "Pooled containers only hold plain data elements" );
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(PooledImportImageContainer, ImportImageContainer);
+
+  /** Use a block of the pool large enough for size elements. */
+  void AcquireFromPool( ImageBufferPool * pool, ElementIdentifier size );
+
+protected:
+  PooledImportImageContainer() = default;
+  ~PooledImportImageContainer() override;
+
+private:
+  void ReturnToPool();
+
+  ImageBufferPool::Pointer        m_Pool;
+  void *                          m_Block{ nullptr };
+  SizeValueType                   m_BlockSize{ 0 };
+};
+
+} // end namespace itk
+
+#include "itkImageBufferPool.hxx"
+
+#endif
@@ -0,0 +1,363 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkImageBufferPool.hxx
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkImageBufferPool_hxx
+#define itkImageBufferPool_hxx
+
+#include "itkImageBufferPool.h"
+
+#include <algorithm>
+#include <new>
+
+namespace itk
+{
+
+/**
+ * Constructor
+ */
+inline
+ImageBufferPool
+::ImageBufferPool()
+{
+  this->m_MaximumIdleSize = 1024 * 1024 * 1024;
+  this->m_IdleSize = 0;
+  this->m_SizeInUse = 0;
+  this->m_HighWaterMark = 0;
+  this->m_NumberOfHits = 0;
+  this->m_NumberOfMisses = 0;
+}
+
+
+/**
+ * Destructor
+ */
+inline
+ImageBufferPool
+::~ImageBufferPool()
+{
+  this->Clear();
+}
+
+
+inline
+ImageBufferPool *
+ImageBufferPool
+::GetGlobalPool()
+{
+  static Pointer globalPool = Self::New();
+  return globalPool.GetPointer();
+}
+
+
+inline
+SizeValueType
+ImageBufferPool
+::ComputeBlockSize( SizeValueType numberOfBytes )
+{
+  // Small requests share a single bucket.
+  const SizeValueType minimumBlockSize = 4096;
+  if( numberOfBytes <= minimumBlockSize )
+    {
+    return minimumBlockSize;
+    }
+
+  // Four buckets per power of two: 4/4, 5/4, 6/4 and 7/4 of it.
+  SizeValueType powerOfTwo = minimumBlockSize;
+  while( 2 * powerOfTwo < numberOfBytes )
+    {
+    powerOfTwo *= 2;
+    }
+
+  const SizeValueType quarter = powerOfTwo / 4;
+  SizeValueType blockSize = powerOfTwo;
+  while( blockSize < numberOfBytes )
+    {
+    blockSize += quarter;
+    }
+  return blockSize;
+}
+
+
+inline
+void *
+ImageBufferPool
+::Acquire( SizeValueType numberOfBytes, SizeValueType & blockSize )
+{
+  blockSize = Self::ComputeBlockSize( numberOfBytes );
+
+    {
+    std::lock_guard< std::mutex > lock( this->m_Mutex );
+
+    auto bucket = this->m_IdleBlocks.find( blockSize );
+    if( bucket != this->m_IdleBlocks.end() && !bucket->second.empty() )
+      {
+      void * block = bucket->second.back();
+      bucket->second.pop_back();
+      this->m_IdleSize -= blockSize;
+      this->m_SizeInUse += blockSize;
+      this->m_HighWaterMark = std::max( this->m_HighWaterMark, this->m_SizeInUse );
+      ++this->m_NumberOfHits;
+      return block;
+      }
+
+    ++this->m_NumberOfMisses;
+    this->m_SizeInUse += blockSize;
+    this->m_HighWaterMark = std::max( this->m_HighWaterMark, this->m_SizeInUse );
+    }
+
+  // Allocate outside of the lock, it may take a while for large blocks.
+  try
+    {
+    return ::operator new( blockSize );
+    }
+  catch( std::bad_alloc & )
+    {
+      {
+      std::lock_guard< std::mutex > lock( this->m_Mutex );
+      this->m_SizeInUse -= blockSize;
+      }
+    itkExceptionMacro( "Failed to allocate a block of " << blockSize << " bytes" );
+    }
+}
+
+
+inline
+void
+ImageBufferPool
+::Release( void * block, SizeValueType blockSize )
+{
+  if( block == nullptr )
+    {
+    return;
+    }
+
+  std::lock_guard< std::mutex > lock( this->m_Mutex );
+
+  this->m_SizeInUse -= blockSize;
+
+  if( blockSize > this->m_MaximumIdleSize )
+    {
+    ::operator delete( block );
+    return;
+    }
+
+  this->m_IdleBlocks[ blockSize ].push_back( block );
+  this->m_IdleSize += blockSize;
+
+  this->TrimIdleBlocks();
+}
+
+
+inline
+void
+ImageBufferPool
+::TrimIdleBlocks()
+{
+  auto bucket = this->m_IdleBlocks.end();
+  while( this->m_IdleSize > this->m_MaximumIdleSize && bucket != this->m_IdleBlocks.begin() )
+    {
+    --bucket;
+    while( !bucket->second.empty() && this->m_IdleSize > this->m_MaximumIdleSize )
+      {
+      ::operator delete( bucket->second.back() );
+      bucket->second.pop_back();
+      this->m_IdleSize -= bucket->first;
+      }
+    }
+}
+
+
+inline
+void
+ImageBufferPool
+::Clear()
+{
+  std::lock_guard< std::mutex > lock( this->m_Mutex );
+
+  for( auto & bucket : this->m_IdleBlocks )
+    {
+    for( void * block : bucket.second )
+      {
+      ::operator delete( block );
+      }
+    }
+  this->m_IdleBlocks.clear();
+  this->m_IdleSize = 0;
+}
+
+
+inline
+void
+ImageBufferPool
+::SetMaximumIdleSize( SizeValueType size )
+{
+  std::lock_guard< std::mutex > lock( this->m_Mutex );
+
+  if( this->m_MaximumIdleSize != size )
+    {
+    this->m_MaximumIdleSize = size;
+    this->TrimIdleBlocks();
+    this->Modified();
+    }
+}
+
+
+inline
+SizeValueType
+ImageBufferPool
+::GetNumberOfHits() const
+{
+  std::lock_guard< std::mutex > lock( this->m_Mutex );
+  return this->m_NumberOfHits;
+}
+
+
+inline
+SizeValueType
+ImageBufferPool
+::GetNumberOfMisses() const
+{
+  std::lock_guard< std::mutex > lock( this->m_Mutex );
+  return this->m_NumberOfMisses;
+}
+
+
+inline
+SizeValueType
+ImageBufferPool
+::GetSizeInUse() const
+{
+  std::lock_guard< std::mutex > lock( this->m_Mutex );
+  return this->m_SizeInUse;
+}
+
+
+inline
+SizeValueType
+ImageBufferPool
+::GetIdleSize() const
+{
+  std::lock_guard< std::mutex > lock( this->m_Mutex );
+  return this->m_IdleSize;
+}
+
+
+inline
+SizeValueType
+ImageBufferPool
+::GetHighWaterMark() const
+{
+  std::lock_guard< std::mutex > lock( this->m_Mutex );
+  return this->m_HighWaterMark;
+}
+
+
+inline
+void
+ImageBufferPool
+::ResetStatistics()
+{
+  std::lock_guard< std::mutex > lock( this->m_Mutex );
+  this->m_NumberOfHits = 0;
+  this->m_NumberOfMisses = 0;
+  this->m_HighWaterMark = this->m_SizeInUse;
+}
+
+
+template <typename TImage>
+void
+ImageBufferPool
+::Allocate( TImage * image, ImageBufferPool * pool )
+{
+  if( pool == nullptr )
+    {
+    image->Allocate();
+    return;
+    }
+
+  using PixelContainerType = PooledImportImageContainer< SizeValueType, typename TImage::PixelType >;
+
+  typename PixelContainerType::Pointer container = PixelContainerType::New();
+  container->AcquireFromPool( pool, image->GetBufferedRegion().GetNumberOfPixels() );
+
+  image->SetPixelContainer( container );
+
+  // Computes the offset table, the container is already large enough.
+  image->Allocate();
+}
+
+
+inline
+void
+ImageBufferPool
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  std::lock_guard< std::mutex > lock( this->m_Mutex );
+  os << indent << "MaximumIdleSize: " << this->m_MaximumIdleSize << std::endl;
+  os << indent << "IdleSize: " << this->m_IdleSize << std::endl;
+  os << indent << "SizeInUse: " << this->m_SizeInUse << std::endl;
+  os << indent << "HighWaterMark: " << this->m_HighWaterMark << std::endl;
+  os << indent << "NumberOfHits: " << this->m_NumberOfHits << std::endl;
+  os << indent << "NumberOfMisses: " << this->m_NumberOfMisses << std::endl;
+}
+
+
+template <typename TElementIdentifier, typename TElement>
+PooledImportImageContainer<TElementIdentifier, TElement>
+::~PooledImportImageContainer()
+{
+  this->ReturnToPool();
+}
+
+
+template <typename TElementIdentifier, typename TElement>
+void
+PooledImportImageContainer<TElementIdentifier, TElement>
+::AcquireFromPool( ImageBufferPool * pool, ElementIdentifier size )
+{
+  SizeValueType blockSize = 0;
+  void * block = pool->Acquire( static_cast< SizeValueType >( size ) * sizeof( TElement ), blockSize );
+
+  // The container does not own the block, the pool does.
+  this->SetImportPointer( static_cast< TElement * >( block ), size, false );
+
+  this->ReturnToPool();
+
+  this->m_Pool = pool;
+  this->m_Block = block;
+  this->m_BlockSize = blockSize;
+}
+
+
+template <typename TElementIdentifier, typename TElement>
+void
+PooledImportImageContainer<TElementIdentifier, TElement>
+::ReturnToPool()
+{
+  if( this->m_Pool )
+    {
+    this->m_Pool->Release( this->m_Block, this->m_BlockSize );
+    }
+  this->m_Pool = nullptr;
+  this->m_Block = nullptr;
+  this->m_BlockSize = 0;
+}
+
+} // end namespace itk
+
+#endif
@@ -0,0 +1,305 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkLesionSegmentationBatchImageFilter.h
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkLesionSegmentationBatchImageFilter_h
+#define itkLesionSegmentationBatchImageFilter_h
+
+#include "itkImageToImageFilter.h"
+#include "itkImage.h"
+#include "itkImageSpatialObject.h"
+#include "itkLandmarkSpatialObject.h"
+#include "itkLungWallFeatureGenerator.h"
+#include "itkLungMaskImageFilter.h"
+#include "itkSatoVesselnessSigmoidFeatureGenerator.h"
+#include "itkSigmoidFeatureGenerator.h"
+#include "itkCannyEdgesFeatureGenerator.h"
+#include "itkFastMarchingAndGeodesicActiveContourLevelSetSegmentationModule.h"
+#include "itkMinimumFeatureAggregator.h"
+#include "itkRegionOfInterestImageFilter.h"
+#include "itkIsotropicResamplerImageFilter.h"
+#include "itkCancellationToken.h"
+#include <mutex>
+#include <vector>
+
+namespace itk
+{
+
+/** \class LesionSegmentationBatchImageFilter
+ * \brief Segments several lesions of the same scan in one pass.
+ *
+ * Every lesion is given by a set of seed points and a region of interest,
+ * in index space of the input image. The regions of interest that overlap
+ * are merged into a single region, which is cropped, resampled and turned
+ * into the combined lung wall, vesselness, intensity and edge feature only
+ * once. The segmentation modules of all the lesions are then run
+ * concurrently, each one on the feature of the merged region holding its
+ * lesion.
+ *
+ * The preprocessing and the segmentation are those of
+ * LesionSegmentationImageFilter8, with the same default parameters, so a
+ * lesion whose region of interest does not overlap any other one gets the
+ * same level set as with that filter.
+ *
+ * The output is a label image on the grid of the input, where the voxels of
+ * the i-th lesion, restricted to its own region of interest, are labeled
+ * i + 1 and the background is 0. Where lesions overlap, a voxel goes to the
+ * lesion it is the deepest inside of. The level set of every lesion is also
+ * available as a spatial object through GetLesionSegmentation().
+ *
+ * \ingroup LesionSizingToolkit
+ */
+template<class TInputImage, class TOutputImage = Image< unsigned short, TInputImage::ImageDimension > >
+class LesionSegmentationBatchImageFilter
+  : public ImageToImageFilter<TInputImage, TOutputImage>
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(LesionSegmentationBatchImageFilter);
+
+  /** Standard "Self" & Superclass type alias.  */
+  using Self = LesionSegmentationBatchImageFilter;
+  using Superclass = ImageToImageFilter<TInputImage, TOutputImage>;
+
+  /** Image type alias support   */
+  using InputImageType = TInputImage;
+  using OutputImageType = TOutputImage;
+
+  /** SmartPointer type alias support  */
+  using Pointer = SmartPointer<Self>;
+  using ConstPointer = SmartPointer<const Self>;
+
+  /** Define pixel types. */
+  using InputImagePixelType = typename TInputImage::PixelType;
+  using OutputImagePixelType = typename TOutputImage::PixelType;
+  using IndexType = typename TInputImage::IndexType;
+  using SpacingType = typename InputImageType::SpacingType;
+  using RegionType = typename InputImageType::RegionType;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(LesionSegmentationBatchImageFilter, ImageToImageFilter);
+
+  /** ImageDimension constant    */
+  static constexpr unsigned int ImageDimension = TInputImage::ImageDimension;
+
+  static constexpr unsigned int OutputImageDimension = TOutputImage::ImageDimension;
+
+#ifdef ITK_USE_CONCEPT_CHECKING
+  /** Begin concept checking */
+  itkConceptMacro(InputHasNumericTraitsCheck,
+    (Concept::HasNumericTraits<InputImagePixelType>));
+  itkConceptMacro(SameDimensionCheck,
+    (Concept::SameDimension<ImageDimension, OutputImageDimension>));
+  itkConceptMacro(OutputIsIntegerCheck,
+    (Concept::IsInteger<OutputImagePixelType>));
+  /** End concept checking */
+#endif
+
+  using SeedSpatialObjectType = LandmarkSpatialObject< ImageDimension >;
+  using PointListType = typename SeedSpatialObjectType::PointListType;
+
+  /** Type of the spatial objects holding the level set of every lesion. */
+  using SegmentationModuleType = FastMarchingAndGeodesicActiveContourLevelSetSegmentationModule< ImageDimension >;
+  using LevelSetImageType = typename SegmentationModuleType::OutputImageType;
+  using LevelSetSpatialObjectType = typename SegmentationModuleType::OutputSpatialObjectType;
+
+  /** Add a lesion to segment, returns its index. The label of the lesion in
+   * the output is that index plus one. */
+  unsigned int AddLesion( const PointListType & seeds, const RegionType & regionOfInterest );
+
+  /** Remove all the lesions. */
+  void ClearLesions();
+
+  unsigned int GetNumberOfLesions() const
+    {
+    return static_cast< unsigned int >( this->m_Lesions.size() );
+    }
+
+  /** Level set of a lesion, on the resampled grid of its merged region.
+   * Available after the filter has been updated. */
+  const LevelSetSpatialObjectType * GetLesionSegmentation( unsigned int lesionId ) const;
+
+  /** Regions over which the features were computed in the last update, and
+   * the one holding a given lesion. */
+  unsigned int GetNumberOfMergedRegions() const
+    {
+    return static_cast< unsigned int >( this->m_MergedRegions.size() );
+    }
+  const RegionType & GetMergedRegion( unsigned int regionId ) const;
+  unsigned int GetMergedRegionOfLesion( unsigned int lesionId ) const;
+
+  /** Set the beta for the sigmoid intensity feature */
+  itkSetMacro( SigmoidBeta, double );
+  itkGetMacro( SigmoidBeta, double );
+
+  /** Turn On/Off isotropic resampling prior to running the segmentation */
+  itkSetMacro( ResampleThickSliceData, bool );
+  itkGetMacro( ResampleThickSliceData, bool );
+  itkBooleanMacro( ResampleThickSliceData );
+
+  /** If ResampleThickSliceData is ON, set the maximum anisotropy. See
+   * LesionSegmentationImageFilter8. */
+  itkSetMacro( AnisotropyThreshold, double );
+  itkGetMacro( AnisotropyThreshold, double );
+
+  /** Stopping time and distance from the seeds of the fast marching that
+   * initializes the level sets. */
+  itkSetMacro( FastMarchingStoppingTime, double );
+  itkGetMacro( FastMarchingStoppingTime, double );
+  itkSetMacro( FastMarchingDistanceFromSeeds, double );
+  itkGetMacro( FastMarchingDistanceFromSeeds, double );
+
+  /** Weights of the curvature, advection and propagation terms of the
+   * geodesic active contours. */
+  itkSetMacro( CurvatureScaling, double );
+  itkGetMacro( CurvatureScaling, double );
+  itkSetMacro( AdvectionScaling, double );
+  itkGetMacro( AdvectionScaling, double );
+  itkSetMacro( PropagationScaling, double );
+  itkGetMacro( PropagationScaling, double );
+
+  /** Value of the level sets at the surface of the lesions. Voxels above it
+   * are inside. Defaults to -0.5, as in the LesionSegmentation example. */
+  itkSetMacro( SegmentationIsoValue, double );
+  itkGetMacro( SegmentationIsoValue, double );
+
+  /** Turn On/Off the concurrent computation of the features of every merged
+   * region. Defaults to false. */
+  itkSetMacro( UseParallelFeatureGeneration, bool );
+  itkGetMacro( UseParallelFeatureGeneration, bool );
+  itkBooleanMacro( UseParallelFeatureGeneration );
+
+  /** Maximum number of lesions segmented at the same time. Zero, the
+   * default, uses the global default number of threads. */
+  itkSetMacro( MaximumNumberOfConcurrentSegmentations, unsigned int );
+  itkGetMacro( MaximumNumberOfConcurrentSegmentations, unsigned int );
+
+  /** Turn On/Off the computation of the lung wall feature once over the
+   * whole scan, with LungMaskImageFilter, rather than over every merged
+   * region. The feature of a region is then a crop of the scan mask, and no
+   * longer depends on where the borders of the region fall. Defaults to
+   * false. */
+  itkSetMacro( UseScanLungMask, bool );
+  itkGetMacro( UseScanLungMask, bool );
+  itkBooleanMacro( UseScanLungMask );
+
+  /** Smallest spacing of the scan lung mask. Zero, the default, computes it
+   * on the grid of the input. See LungMaskImageFilter. */
+  itkSetMacro( LungMaskSpacing, double );
+  itkGetMacro( LungMaskSpacing, double );
+
+  /** Lung mask of the scan computed in the last update, if UseScanLungMask
+   * is on. */
+  using LungMaskFilterType = LungMaskImageFilter< InputImageType >;
+  using LungMaskImageType = typename LungMaskFilterType::OutputImageType;
+  const LungMaskImageType * GetLungMask() const
+    {
+    return this->m_LungMask.GetPointer();
+    }
+
+  /** Token polled by the iterative filters of every lesion pipeline while
+   * the filter executes. SetAbortGenerateData() cancels and resets it, and
+   * it may also be cancelled directly, from any thread. A cancelled filter
+   * releases the segmentations and throws ProcessAborted, leaving its
+   * output out of date. */
+  itkGetModifiableObjectMacro( CancellationToken, CancellationToken );
+
+  /** Set the flag on the token of the lesion pipelines as well. */
+  void SetAbortGenerateData( const bool ) override;
+
+  /** The whole input is needed. */
+  void GenerateInputRequestedRegion() override;
+
+protected:
+  LesionSegmentationBatchImageFilter();
+  ~LesionSegmentationBatchImageFilter() override;
+  void PrintSelf(std::ostream& os, Indent indent) const override;
+
+  void GenerateData() override;
+
+  using VesselnessGeneratorType = SatoVesselnessSigmoidFeatureGenerator< ImageDimension >;
+  using LungWallGeneratorType = LungWallFeatureGenerator< ImageDimension >;
+  using SigmoidFeatureGeneratorType = SigmoidFeatureGenerator< ImageDimension >;
+  using CannyEdgesFeatureGeneratorType = CannyEdgesFeatureGenerator< ImageDimension >;
+  using FeatureAggregatorType = MinimumFeatureAggregator< ImageDimension >;
+  using CropFilterType = RegionOfInterestImageFilter< InputImageType, InputImageType >;
+  using IsotropicResamplerType = IsotropicResamplerImageFilter< InputImageType, InputImageType >;
+  using SpatialObjectType = typename SegmentationModuleType::SpatialObjectType;
+  using InputImageSpatialObjectType = ImageSpatialObject< ImageDimension, InputImagePixelType >;
+
+  /** Group the regions of interest that overlap, directly or through other
+   * regions, and fill m_MergedRegions with their bounding boxes. */
+  void MergeRegionsOfInterest();
+
+  /** Crop, resample and compute the combined feature of a merged region. */
+  typename SpatialObjectType::ConstPointer ComputeFeature( const RegionType & region ) const;
+
+  /** Run the segmentation modules of all the lesions. */
+  void SegmentLesions( const std::vector< typename SpatialObjectType::ConstPointer > & features );
+
+  /** Write the labels of all the lesions in the output. */
+  void LabelLesions();
+
+  bool IsCancelled() const
+    {
+    return this->GetAbortGenerateData() || this->m_CancellationToken->IsCancellationRequested();
+    }
+
+  /** Release the segmentations and the lung mask, and throw
+   * ProcessAborted. */
+  void AbortLesionSegmentation();
+
+private:
+  struct LesionType
+    {
+    PointListType                                        Seeds;
+    RegionType                                           RegionOfInterest;
+    unsigned int                                         MergedRegionId;
+    typename LevelSetSpatialObjectType::ConstPointer     Segmentation;
+    };
+
+  std::vector< LesionType >       m_Lesions;
+  std::vector< RegionType >       m_MergedRegions;
+
+  double                          m_SigmoidBeta;
+  bool                            m_ResampleThickSliceData;
+  double                          m_AnisotropyThreshold;
+  double                          m_FastMarchingStoppingTime;
+  double                          m_FastMarchingDistanceFromSeeds;
+  double                          m_CurvatureScaling;
+  double                          m_AdvectionScaling;
+  double                          m_PropagationScaling;
+  double                          m_SegmentationIsoValue;
+  bool                            m_UseParallelFeatureGeneration;
+  unsigned int                    m_MaximumNumberOfConcurrentSegmentations;
+  bool                            m_UseScanLungMask;
+  double                          m_LungMaskSpacing;
+
+  typename LungMaskImageType::Pointer   m_LungMask;
+
+  CancellationToken::Pointer      m_CancellationToken;
+
+  std::mutex                      m_ProgressMutex;
+};
+
+} //end of namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkLesionSegmentationBatchImageFilter.hxx"
+#endif
+
+#endif
@@ -0,0 +1,572 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkLesionSegmentationBatchImageFilter.hxx
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkLesionSegmentationBatchImageFilter_hxx
+#define itkLesionSegmentationBatchImageFilter_hxx
+#include "itkLesionSegmentationBatchImageFilter.h"
+
+#include "itkNumericTraits.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkLinearInterpolateImageFunction.h"
+#include "itkPlatformMultiThreader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+namespace itk
+{
+
+template <class TInputImage, class TOutputImage>
+LesionSegmentationBatchImageFilter<TInputImage, TOutputImage>::
+LesionSegmentationBatchImageFilter()
+{
+  // Same defaults as LesionSegmentationImageFilter8.
+  m_SigmoidBeta = -500.0;
+  m_ResampleThickSliceData = true;
+  m_AnisotropyThreshold = 1.0;
+  m_FastMarchingStoppingTime = 5.0;
+  m_FastMarchingDistanceFromSeeds = 0.5;
+  m_CurvatureScaling = 1.0;
+  m_AdvectionScaling = 0.0;
+  m_PropagationScaling = 500.0;
+  m_SegmentationIsoValue = -0.5;
+  m_UseParallelFeatureGeneration = false;
+  m_MaximumNumberOfConcurrentSegmentations = 0;
+  m_UseScanLungMask = false;
+  m_LungMaskSpacing = 0.0;
+  m_CancellationToken = CancellationToken::New();
+}
+
+template <class TInputImage, class TOutputImage>
+LesionSegmentationBatchImageFilter<TInputImage, TOutputImage>::
+~LesionSegmentationBatchImageFilter()
+{
+}
+
+template <class TInputImage, class TOutputImage>
+unsigned int
+LesionSegmentationBatchImageFilter<TInputImage,TOutputImage>
+::AddLesion( const PointListType & seeds, const RegionType & regionOfInterest )
+{
+  LesionType lesion;
+  lesion.Seeds = seeds;
+  lesion.RegionOfInterest = regionOfInterest;
+  lesion.MergedRegionId = 0;
+  this->m_Lesions.push_back( lesion );
+  this->Modified();
+  return static_cast< unsigned int >( this->m_Lesions.size() - 1 );
+}
+
+template <class TInputImage, class TOutputImage>
+void
+LesionSegmentationBatchImageFilter<TInputImage,TOutputImage>
+::ClearLesions()
+{
+  this->m_Lesions.clear();
+  this->m_MergedRegions.clear();
+  this->Modified();
+}
+
+template <class TInputImage, class TOutputImage>
+const typename LesionSegmentationBatchImageFilter<TInputImage,TOutputImage>::LevelSetSpatialObjectType *
+LesionSegmentationBatchImageFilter<TInputImage,TOutputImage>
+::GetLesionSegmentation( unsigned int lesionId ) const
+{
+  if( lesionId >= this->m_Lesions.size() )
+    {
+    itkExceptionMacro("Lesion " << lesionId << " does not exist");
+    }
+  return this->m_Lesions[lesionId].Segmentation.GetPointer();
+}
+
+template <class TInputImage, class TOutputImage>
+const typename LesionSegmentationBatchImageFilter<TInputImage,TOutputImage>::RegionType &
+LesionSegmentationBatchImageFilter<TInputImage,TOutputImage>
+::GetMergedRegion( unsigned int regionId ) const
+{
+  if( regionId >= this->m_MergedRegions.size() )
+    {
+    itkExceptionMacro("Merged region " << regionId << " does not exist");
+    }
+  return this->m_MergedRegions[regionId];
+}
+
+template <class TInputImage, class TOutputImage>
+unsigned int
+LesionSegmentationBatchImageFilter<TInputImage,TOutputImage>
+::GetMergedRegionOfLesion( unsigned int lesionId ) const
+{
+  if( lesionId >= this->m_Lesions.size() )
+    {
+    itkExceptionMacro("Lesion " << lesionId << " does not exist");
+    }
+  return this->m_Lesions[lesionId].MergedRegionId;
+}
+
+template <class TInputImage, class TOutputImage>
+void
+LesionSegmentationBatchImageFilter<TInputImage,TOutputImage>
+::GenerateInputRequestedRegion()
+{
+  // call the superclass' implementation of this method
+  Superclass::GenerateInputRequestedRegion();
+
+  if ( this->GetInput() )
+    {
+    typename InputImageType::Pointer inputPtr  =
+      const_cast< TInputImage *>( this->GetInput() );
+
+    // Request the entire input image
+    inputPtr->SetRequestedRegion(inputPtr->GetLargestPossibleRegion());
+    }
+}
+
+template <class TInputImage, class TOutputImage>
+void
+LesionSegmentationBatchImageFilter<TInputImage,TOutputImage>
+::SetAbortGenerateData( const bool abort )
+{
+  this->Superclass::SetAbortGenerateData( abort );
+
+  if( abort )
+    {
+    this->m_CancellationToken->Cancel();
+    }
+  else
+    {
+    this->m_CancellationToken->Reset();
+    }
+}
+
+template <class TInputImage, class TOutputImage>
+void
+LesionSegmentationBatchImageFilter<TInputImage,TOutputImage>
+::MergeRegionsOfInterest()
+{
+  const RegionType largestRegion = this->GetInput()->GetLargestPossibleRegion();
+
+  std::vector< RegionType > regions;
+  std::vector< std::vector< unsigned int > > members;
+
+  for( unsigned int i = 0; i < this->m_Lesions.size(); i++ )
+    {
+    RegionType region = this->m_Lesions[i].RegionOfInterest;
+    if( !region.Crop( largestRegion ) )
+      {
+      itkExceptionMacro("The region of interest of lesion " << i << " is outside of the image");
+      }
+    regions.push_back( region );
+    members.push_back( std::vector< unsigned int >( 1, i ) );
+    }
+
+  // A merged region may overlap regions that none of its parts did, keep
+  // merging until no two regions overlap.
+  bool merged = true;
+  while( merged )
+    {
+    merged = false;
+    for( unsigned int a = 0; a < regions.size() && !merged; a++ )
+      {
+      for( unsigned int b = a + 1; b < regions.size() && !merged; b++ )
+        {
+        RegionType intersection = regions[a];
+        if( !intersection.Crop( regions[b] ) )
+          {
+          continue;
+          }
+
+        IndexType start;
+        typename RegionType::SizeType size;
+        for( unsigned int d = 0; d < ImageDimension; d++ )
+          {
+          const IndexValueType endA = regions[a].GetIndex(d) + static_cast< IndexValueType >( regions[a].GetSize(d) );
+          const IndexValueType endB = regions[b].GetIndex(d) + static_cast< IndexValueType >( regions[b].GetSize(d) );
+          start[d] = std::min( regions[a].GetIndex(d), regions[b].GetIndex(d) );
+          size[d] = static_cast< SizeValueType >( std::max( endA, endB ) - start[d] );
+          }
+        regions[a].SetIndex( start );
+        regions[a].SetSize( size );
+        members[a].insert( members[a].end(), members[b].begin(), members[b].end() );
+        regions.erase( regions.begin() + b );
+        members.erase( members.begin() + b );
+        merged = true;
+        }
+      }
+    }
+
+  this->m_MergedRegions = regions;
+  for( unsigned int r = 0; r < members.size(); r++ )
+    {
+    for( const auto & lesionId : members[r] )
+      {
+      this->m_Lesions[lesionId].MergedRegionId = r;
+      }
+    }
+}
+
+template <class TInputImage, class TOutputImage>
+typename LesionSegmentationBatchImageFilter<TInputImage,TOutputImage>::SpatialObjectType::ConstPointer
+LesionSegmentationBatchImageFilter<TInputImage,TOutputImage>
+::ComputeFeature( const RegionType & region ) const
+{
+  const InputImageType * input = this->GetInput();
+
+  typename CropFilterType::Pointer cropFilter = CropFilterType::New();
+  cropFilter->SetInput( input );
+  cropFilter->SetRegionOfInterest( region );
+  cropFilter->Update();
+
+  typename InputImageType::Pointer image = cropFilter->GetOutput();
+
+  if( this->m_ResampleThickSliceData )
+    {
+    // Compute the spacing after isotropic resampling, as in
+    // LesionSegmentationImageFilter8.
+    double minSpacing = NumericTraits< double >::max();
+    for (unsigned int i = 0; i < ImageDimension; i++)
+      {
+      minSpacing = (minSpacing > input->GetSpacing()[i] ?
+                    input->GetSpacing()[i] : minSpacing);
+      }
+
+    SpacingType outputSpacing = input->GetSpacing();
+    for (unsigned int i = 0; i < ImageDimension; i++)
+      {
+      if (outputSpacing[i]/minSpacing > m_AnisotropyThreshold)
+        {
+        outputSpacing[i] = minSpacing * m_AnisotropyThreshold;
+        }
+      }
+
+    typename IsotropicResamplerType::Pointer resampler = IsotropicResamplerType::New();
+    resampler->SetInput( image );
+    resampler->SetOutputSpacing( outputSpacing );
+    resampler->Update();
+    image = resampler->GetOutput();
+    }
+
+  image->DisconnectPipeline();
+
+  typename InputImageSpatialObjectType::Pointer inputObject = InputImageSpatialObjectType::New();
+  inputObject->SetImage( image );
+
+  typename LungWallGeneratorType::Pointer lungWallGenerator = LungWallGeneratorType::New();
+  typename VesselnessGeneratorType::Pointer vesselnessGenerator = VesselnessGeneratorType::New();
+  typename SigmoidFeatureGeneratorType::Pointer sigmoidGenerator = SigmoidFeatureGeneratorType::New();
+  typename CannyEdgesFeatureGeneratorType::Pointer cannyEdgesGenerator = CannyEdgesFeatureGeneratorType::New();
+  typename FeatureAggregatorType::Pointer featureAggregator = FeatureAggregatorType::New();
+
+  lungWallGenerator->SetInput( inputObject );
+  vesselnessGenerator->SetInput( inputObject );
+  sigmoidGenerator->SetInput( inputObject );
+  cannyEdgesGenerator->SetInput( inputObject );
+  featureAggregator->AddFeatureGenerator( lungWallGenerator );
+  featureAggregator->AddFeatureGenerator( vesselnessGenerator );
+  featureAggregator->AddFeatureGenerator( sigmoidGenerator );
+  featureAggregator->AddFeatureGenerator( cannyEdgesGenerator );
+  featureAggregator->SetUseParallelFeatureGeneration( this->m_UseParallelFeatureGeneration );
+
+  lungWallGenerator->SetLungThreshold( -400 );
+  lungWallGenerator->SetLungMask( this->m_LungMask );
+  vesselnessGenerator->SetSigma( 1.0 );
+  vesselnessGenerator->SetAlpha1( 0.1 );
+  vesselnessGenerator->SetAlpha2( 2.0 );
+  vesselnessGenerator->SetSigmoidAlpha( -10.0 );
+  vesselnessGenerator->SetSigmoidBeta( 40.0 );
+  sigmoidGenerator->SetAlpha( 100.0 );
+  sigmoidGenerator->SetBeta( this->m_SigmoidBeta );
+  cannyEdgesGenerator->SetUpperThreshold( 150.0 );
+  cannyEdgesGenerator->SetLowerThreshold( 75.0 );
+
+  // Sigma for the canny is the max spacing of the original input (before
+  // resampling)
+  double maxSpacing = NumericTraits< double >::min();
+  for (unsigned int i = 0; i < ImageDimension; i++)
+    {
+    maxSpacing = (maxSpacing < input->GetSpacing()[i] ?
+                    input->GetSpacing()[i] : maxSpacing);
+    }
+  cannyEdgesGenerator->SetSigma( maxSpacing );
+
+  featureAggregator->Update();
+
+  // The feature outlives the aggregator that produced it.
+  return featureAggregator->GetFeature();
+}
+
+template <class TInputImage, class TOutputImage>
+void
+LesionSegmentationBatchImageFilter<TInputImage,TOutputImage>
+::SegmentLesions( const std::vector< typename SpatialObjectType::ConstPointer > & features )
+{
+  const unsigned int numberOfLesions = static_cast< unsigned int >( this->m_Lesions.size() );
+
+  std::vector< typename SegmentationModuleType::Pointer > modules( numberOfLesions );
+  std::vector< typename SeedSpatialObjectType::Pointer > seedObjects( numberOfLesions );
+
+  for( unsigned int i = 0; i < numberOfLesions; i++ )
+    {
+    seedObjects[i] = SeedSpatialObjectType::New();
+    seedObjects[i]->SetPoints( this->m_Lesions[i].Seeds );
+
+    modules[i] = SegmentationModuleType::New();
+    modules[i]->SetCurvatureScaling( this->m_CurvatureScaling );
+    modules[i]->SetAdvectionScaling( this->m_AdvectionScaling );
+    modules[i]->SetPropagationScaling( this->m_PropagationScaling );
+    modules[i]->SetMaximumRMSError( 0.0002 );
+    modules[i]->SetMaximumNumberOfIterations( 300 );
+    modules[i]->SetDistanceFromSeeds( this->m_FastMarchingDistanceFromSeeds );
+    modules[i]->SetStoppingValue( this->m_FastMarchingStoppingTime );
+    modules[i]->SetInput( seedObjects[i] );
+    modules[i]->SetFeature( features[this->m_Lesions[i].MergedRegionId] );
+    }
+
+  unsigned int numberOfWorkers = this->m_MaximumNumberOfConcurrentSegmentations;
+  if( numberOfWorkers == 0 )
+    {
+    numberOfWorkers = MultiThreaderBase::GetGlobalDefaultNumberOfThreads();
+    }
+  numberOfWorkers = std::max( 1u, std::min( numberOfWorkers, numberOfLesions ) );
+
+  std::atomic< unsigned int > nextLesion( 0 );
+  unsigned int                numberOfSegmentedLesions = 0;
+  std::exception_ptr          firstException;
+  std::mutex                  exceptionMutex;
+
+  // As in FeatureAggregator, dedicated workers are used so that the modules,
+  // whose filters are multi-threaded, do not wait on work queued to a pool
+  // they are occupying.
+  PlatformMultiThreader::Pointer threader = PlatformMultiThreader::New();
+  threader->SetNumberOfWorkUnits( numberOfWorkers );
+  threader->ParallelizeArray( 0, numberOfWorkers,
+    [&]( SizeValueType )
+      {
+      CancellationToken::Scope cancellationScope( this->m_CancellationToken );
+
+      unsigned int lesionId;
+      while( ( lesionId = nextLesion++ ) < numberOfLesions )
+        {
+        if( this->IsCancelled() )
+          {
+          return;
+          }
+        try
+          {
+          modules[lesionId]->Update();
+          this->m_Lesions[lesionId].Segmentation =
+            dynamic_cast< const LevelSetSpatialObjectType * >( modules[lesionId]->GetOutput() );
+          }
+        catch( ... )
+          {
+          // A lesion that failed is not counted as segmented.
+          std::lock_guard< std::mutex > lock( exceptionMutex );
+          if( !firstException )
+            {
+            firstException = std::current_exception();
+            }
+          continue;
+          }
+
+        std::lock_guard< std::mutex > lock( this->m_ProgressMutex );
+        ++numberOfSegmentedLesions;
+        this->UpdateProgress( 0.5f + 0.4f * numberOfSegmentedLesions / numberOfLesions );
+        }
+      },
+    nullptr );
+
+  if( firstException )
+    {
+    std::rethrow_exception( firstException );
+    }
+}
+
+template <class TInputImage, class TOutputImage>
+void
+LesionSegmentationBatchImageFilter<TInputImage,TOutputImage>
+::AbortLesionSegmentation()
+{
+  for( auto & lesion : this->m_Lesions )
+    {
+    lesion.Segmentation = nullptr;
+    }
+  this->m_LungMask = nullptr;
+
+  CancellationToken::ThrowProcessAborted( this );
+}
+
+template <class TInputImage, class TOutputImage>
+void
+LesionSegmentationBatchImageFilter<TInputImage,TOutputImage>
+::LabelLesions()
+{
+  OutputImageType * output = this->GetOutput();
+
+  using InterpolatorType = LinearInterpolateImageFunction< LevelSetImageType, double >;
+  std::vector< typename InterpolatorType::Pointer > interpolators( this->m_Lesions.size() );
+
+  for( unsigned int i = 0; i < this->m_Lesions.size(); i++ )
+    {
+    interpolators[i] = InterpolatorType::New();
+    interpolators[i]->SetInputImage( this->m_Lesions[i].Segmentation->GetImage() );
+    }
+
+  using IteratorType = ImageRegionIteratorWithIndex< OutputImageType >;
+  typename OutputImageType::PointType point;
+
+  for( unsigned int i = 0; i < this->m_Lesions.size(); i++ )
+    {
+    RegionType region = this->m_Lesions[i].RegionOfInterest;
+    if( !region.Crop( output->GetBufferedRegion() ) )
+      {
+      continue;
+      }
+
+    const OutputImagePixelType label = static_cast< OutputImagePixelType >( i + 1 );
+
+    IteratorType itr( output, region );
+    for( itr.GoToBegin(); !itr.IsAtEnd(); ++itr )
+      {
+      output->TransformIndexToPhysicalPoint( itr.GetIndex(), point );
+      if( !interpolators[i]->IsInsideBuffer( point ) )
+        {
+        continue;
+        }
+
+      const double value = interpolators[i]->Evaluate( point );
+      if( value <= this->m_SegmentationIsoValue )
+        {
+        continue;
+        }
+
+      // Overlapping lesions, keep the one the voxel is deepest inside of.
+      const OutputImagePixelType current = itr.Get();
+      if( current != NumericTraits< OutputImagePixelType >::ZeroValue() )
+        {
+        const auto & other = interpolators[static_cast< unsigned int >( current ) - 1];
+        if( other->IsInsideBuffer( point ) && other->Evaluate( point ) >= value )
+          {
+          continue;
+          }
+        }
+
+      itr.Set( label );
+      }
+    }
+}
+
+template< class TInputImage, class TOutputImage >
+void
+LesionSegmentationBatchImageFilter< TInputImage, TOutputImage >
+::GenerateData()
+{
+  // The filters of the lesion pipelines poll the token of this filter.
+  CancellationToken::Scope cancellationScope( m_CancellationToken );
+
+  this->AllocateOutputs();
+  this->GetOutput()->FillBuffer( NumericTraits< OutputImagePixelType >::ZeroValue() );
+  this->UpdateProgress( 0.0f );
+
+  for( auto & lesion : this->m_Lesions )
+    {
+    lesion.Segmentation = nullptr;
+    }
+
+  if( this->m_Lesions.empty() )
+    {
+    this->m_MergedRegions.clear();
+    this->UpdateProgress( 1.0f );
+    return;
+    }
+
+  this->MergeRegionsOfInterest();
+
+  // The lung mask of the scan, computed once, replaces the lung wall
+  // feature of every merged region.
+  this->m_LungMask = nullptr;
+  if( this->m_UseScanLungMask )
+    {
+    typename LungMaskFilterType::Pointer lungMaskFilter = LungMaskFilterType::New();
+    lungMaskFilter->SetInput( this->GetInput() );
+    lungMaskFilter->SetMaskSpacing( this->m_LungMaskSpacing );
+    lungMaskFilter->SetLungThreshold( -400 );
+      {
+      CancellationToken::AbortObserver abortObserver( this->m_CancellationToken, lungMaskFilter );
+      lungMaskFilter->Update();
+      }
+    this->m_LungMask = lungMaskFilter->GetOutput();
+    this->m_LungMask->DisconnectPipeline();
+    }
+
+  // The features are computed one merged region after the other, each of
+  // them is then shared by all the lesions of the region.
+  std::vector< typename SpatialObjectType::ConstPointer > features;
+  for( unsigned int r = 0; r < this->m_MergedRegions.size(); r++ )
+    {
+    if( this->IsCancelled() )
+      {
+      this->AbortLesionSegmentation();
+      }
+    features.push_back( this->ComputeFeature( this->m_MergedRegions[r] ) );
+    this->UpdateProgress( 0.5f * ( r + 1 ) / this->m_MergedRegions.size() );
+    }
+
+  try
+    {
+    this->SegmentLesions( features );
+    }
+  catch( ProcessAborted & )
+    {
+    this->AbortLesionSegmentation();
+    }
+
+  // The workers stop picking lesions once the filter is cancelled, some
+  // lesions may then be left without segmentation.
+  if( this->IsCancelled() )
+    {
+    this->AbortLesionSegmentation();
+    }
+
+  this->LabelLesions();
+  this->UpdateProgress( 1.0f );
+}
+
+template <class TInputImage, class TOutputImage>
+void
+LesionSegmentationBatchImageFilter<TInputImage,TOutputImage>
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf(os,indent);
+  os << indent << "Number of lesions = " << this->m_Lesions.size() << std::endl;
+  os << indent << "Number of merged regions = " << this->m_MergedRegions.size() << std::endl;
+  os << indent << "Sigmoid beta = " << this->m_SigmoidBeta << std::endl;
+  os << indent << "Resample thick slice data = " << this->m_ResampleThickSliceData << std::endl;
+  os << indent << "Anisotropy threshold = " << this->m_AnisotropyThreshold << std::endl;
+  os << indent << "Fast marching stopping time = " << this->m_FastMarchingStoppingTime << std::endl;
+  os << indent << "Fast marching distance from seeds = " << this->m_FastMarchingDistanceFromSeeds << std::endl;
+  os << indent << "Curvature scaling = " << this->m_CurvatureScaling << std::endl;
+  os << indent << "Advection scaling = " << this->m_AdvectionScaling << std::endl;
+  os << indent << "Propagation scaling = " << this->m_PropagationScaling << std::endl;
+  os << indent << "Segmentation iso value = " << this->m_SegmentationIsoValue << std::endl;
+  os << indent << "Use parallel feature generation = " << this->m_UseParallelFeatureGeneration << std::endl;
+  os << indent << "Maximum number of concurrent segmentations = " << this->m_MaximumNumberOfConcurrentSegmentations << std::endl;
+  os << indent << "Use scan lung mask = " << this->m_UseScanLungMask << std::endl;
+  os << indent << "Lung mask spacing = " << this->m_LungMaskSpacing << std::endl;
+}
+
+}//end of itk namespace
+
+#endif
@@ -33,6 +33,9 @@
 #include "itkLesionSegmentationMethod.h"
 #include "itkMinimumFeatureAggregator.h"
 #include "itkIsotropicResamplerImageFilter.h"
+#include "itkSegmentationStageReport.h"
+#include "itkCancellationToken.h"
+#include <mutex>
 #include <string>
 
 namespace itk
@@ -126,12 +129,76 @@ public:
   virtual void SetUseVesselEnhancingDiffusion( bool );
   itkBooleanMacro( UseVesselEnhancingDiffusion );
 
+  /** Turn On/Off the concurrent computation of the lung wall, vesselness,
+   * intensity and edge features. Defaults to false. */
+  virtual void SetUseParallelFeatureGeneration( bool );
+  itkBooleanMacro( UseParallelFeatureGeneration );
+
+  /** Turn On/Off the computation of the features and of their aggregation
+   * one tile of the region of interest at a time, which bounds the memory
+   * used by the intermediate features of large regions. The lung wall and
+   * the Canny edges features, which are not local, are still computed over
+   * the whole region. Defaults to false. */
+  virtual void SetUseTiledFeatureGeneration( bool );
+  itkBooleanMacro( UseTiledFeatureGeneration );
+
+  /** Persistent cache of the features. When set, a run on the same data
+   * with the same feature parameters as a previous run takes the combined
+   * feature from the cache and goes straight to the segmentation. */
+  using FeatureCacheType = FeatureCache< ImageDimension >;
+  virtual void SetFeatureCache( FeatureCacheType * );
+
+  /** Lung mask of the whole scan, computed once with LungMaskImageFilter
+   * and shared by the filters segmenting the lesions of that scan. When set,
+   * the lung wall feature of the region of interest is a crop of the mask
+   * instead of being computed from the region. Null by default. */
+  using LungMaskImageType = typename LungWallFeatureGenerator< ImageDimension >::LungMaskImageType;
+  virtual void SetLungMask( const LungMaskImageType * );
+  virtual const LungMaskImageType * GetLungMask() const;
+
+  /** Report of the time and memory used by the stages of the pipeline:
+   * crop, resampling, every feature generator, aggregation, fast marching
+   * and geodesic active contour. The report is cleared at the start of
+   * every execution, so it only lists the stages that executed last. No
+   * report is attached by default. */
+  using StageReportType = SegmentationStageReport< ImageDimension >;
+  virtual void SetStageReport( StageReportType * );
+  itkGetModifiableObjectMacro( StageReport, StageReportType );
+
+  /** Token polled by the iterative filters of the pipeline while the
+   * filter executes. SetAbortGenerateData() cancels and resets it, and it
+   * may also be cancelled directly, from any thread. */
+  itkGetModifiableObjectMacro( CancellationToken, CancellationToken );
+
   using SeedSpatialObjectType = itk::LandmarkSpatialObject< ImageDimension >;
   using PointListType = typename SeedSpatialObjectType::PointListType;
 
-  void SetSeeds( PointListType p ) { this->m_Seeds = p; }
+  void SetSeeds( PointListType p );
   PointListType GetSeeds() { return m_Seeds; }
 
+  /** Stopping time and distance from the seeds of the fast marching that
+   * initializes the level set. */
+  itkSetMacro( FastMarchingStoppingTime, double );
+  itkGetMacro( FastMarchingStoppingTime, double );
+  itkSetMacro( FastMarchingDistanceFromSeeds, double );
+  itkGetMacro( FastMarchingDistanceFromSeeds, double );
+
+  /** Weights of the curvature, advection and propagation terms of the
+   * geodesic active contour. */
+  virtual void SetCurvatureScaling( double );
+  virtual double GetCurvatureScaling() const;
+  virtual void SetAdvectionScaling( double );
+  virtual double GetAdvectionScaling() const;
+  virtual void SetPropagationScaling( double );
+  virtual double GetPropagationScaling() const;
+
+  /** Check the internal pipeline and return the consolidated MTime. The
+   * stages of the pipeline keep their results between executions, so that
+   * changing the seeds or the level set parameters only re-executes the
+   * segmentation, and changing the sigmoid beta only recomputes the
+   * intensity feature and the aggregation. */
+  unsigned long GetMTime() const override;
+
   /** Report progress */
   void ProgressUpdate( Object * caller, const EventObject & event );
 
@@ -190,13 +257,19 @@ private:
   typename CropFilterType::Pointer                    m_CropFilter;
   typename IsotropicResamplerType::Pointer            m_IsotropicResampler;
   typename CommandType::Pointer                       m_CommandObserver;
+  typename StageReportType::Pointer                   m_StageReport;
+  CancellationToken::Pointer                          m_CancellationToken;
   RegionType                                          m_RegionOfInterest;
   std::string                                         m_StatusMessage;
   typename SeedSpatialObjectType::PointListType       m_Seeds;
+  typename SeedSpatialObjectType::Pointer             m_SeedSpatialObject;
   typename InputImageSpatialObjectType::Pointer       m_InputSpatialObject;
+  const InputImageType *                              m_InputSpatialObjectSource;
+  unsigned long                                       m_InputSpatialObjectUpdateTime;
   bool                                                m_ResampleThickSliceData;
   double                                              m_AnisotropyThreshold;
   bool                                                m_UserSpecifiedSigmas;
+  std::mutex                                          m_ProgressMutex;
 };
 
 } //end of namespace itk
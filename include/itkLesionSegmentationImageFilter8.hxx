@@ -41,6 +41,10 @@ LesionSegmentationImageFilter8()
   m_CropFilter = CropFilterType::New();
   m_IsotropicResampler = IsotropicResamplerType::New();
   m_InputSpatialObject = InputImageSpatialObjectType::New();
+  m_InputSpatialObjectSource = nullptr;
+  m_InputSpatialObjectUpdateTime = 0;
+  m_SeedSpatialObject = SeedSpatialObjectType::New();
+  m_CancellationToken = CancellationToken::New();
 
   // Report progress.
   m_CommandObserver    = CommandType::New();
@@ -72,6 +76,7 @@ LesionSegmentationImageFilter8()
   m_FeatureAggregator->AddFeatureGenerator( m_CannyEdgesFeatureGenerator );
   m_LesionSegmentationMethod->AddFeatureGenerator( m_FeatureAggregator );
   m_LesionSegmentationMethod->SetSegmentationModule( m_SegmentationModule );
+  m_LesionSegmentationMethod->SetInitialSegmentation( m_SeedSpatialObject );
 
   // Populate some parameters
   m_LungWallFeatureGenerator->SetLungThreshold( -400 );
@@ -182,6 +187,14 @@ void
 LesionSegmentationImageFilter8< TInputImage, TOutputImage >
 ::GenerateData()
 {
+  // The filters of the pipeline poll the token of this filter.
+  CancellationToken::Scope cancellationScope( m_CancellationToken );
+
+  if (m_StageReport)
+    {
+    m_StageReport->Clear();
+    }
+
   m_SigmoidFeatureGenerator->SetBeta( m_SigmoidBeta );
   m_SegmentationModule->SetDistanceFromSeeds(m_FastMarchingDistanceFromSeeds);
   m_SegmentationModule->SetStoppingValue(m_FastMarchingStoppingTime);
@@ -193,26 +206,36 @@ LesionSegmentationImageFilter8< TInputImage, TOutputImage >
   // Get the input image
   typename InputImageType::ConstPointer  input  = this->GetInput();
 
-  // Crop and perform thin slice resampling (done only if necessary)
+  // Crop and perform thin slice resampling (done only if necessary). The
+  // outputs are kept connected, so that these filters only execute again
+  // when the input, the region of interest or the resampling change.
   m_CropFilter->Update();
 
-  typename InputImageType::Pointer inputImage = nullptr;
+  InputImageType * inputImage = m_CropFilter->GetOutput();
   if (m_ResampleThickSliceData)
     {
     m_IsotropicResampler->Update();
     inputImage = this->m_IsotropicResampler->GetOutput();
     }
-  else
-    {
-    inputImage = m_CropFilter->GetOutput();
-    }
 
   // Convert the output of resampling (or cropping based on
   // m_ResampleThickSliceData) to a spatial object that can be fed into
-  // the lesion segmentation method
-
-  inputImage->DisconnectPipeline();
-  m_InputSpatialObject->SetImage(inputImage);
+  // the lesion segmentation method. This is only done when the image was
+  // regenerated, since it invalidates every feature. The spatial object
+  // holds a graft of the output, which shares its buffer but has no
+  // source, so that the generators executing in parallel never update
+  // the crop filter and the resampler.
+
+  if (m_InputSpatialObjectSource != inputImage ||
+      m_InputSpatialObjectUpdateTime != inputImage->GetUpdateMTime())
+    {
+    typename InputImageType::Pointer img = InputImageType::New();
+    img->Graft(inputImage);
+    m_InputSpatialObject->SetImage(img);
+    m_InputSpatialObject->Modified();
+    m_InputSpatialObjectSource = inputImage;
+    m_InputSpatialObjectUpdateTime = inputImage->GetUpdateMTime();
+    }
 
   // Sigma for the canny is the max spacing of the original input (before
   // resampling)
@@ -228,14 +251,8 @@ LesionSegmentationImageFilter8< TInputImage, TOutputImage >
     m_CannyEdgesFeatureGenerator->SetSigma( maxSpacing );
     }
 
-  // Seeds
-
-  typename SeedSpatialObjectType::Pointer seedSpatialObject =
-    SeedSpatialObjectType::New();
-  seedSpatialObject->SetPoints(m_Seeds);
-  m_LesionSegmentationMethod->SetInitialSegmentation(seedSpatialObject);
-
-  // Do the actual segmentation.
+  // Do the actual segmentation. The seeds were handed to the method in
+  // SetSeeds().
   m_LesionSegmentationMethod->Update();
 
   // Graft the output.
@@ -263,6 +280,9 @@ void LesionSegmentationImageFilter8< TInputImage,TOutputImage >
 ::ProgressUpdate( Object * caller,
                   const EventObject & e )
 {
+  // Feature generators may report from several threads at once.
+  std::lock_guard< std::mutex > lock( this->m_ProgressMutex );
+
   if( typeid( itk::ProgressEvent ) == typeid( e ) )
     {
     if (dynamic_cast< CropFilterType * >(caller))
@@ -300,7 +320,7 @@ void LesionSegmentationImageFilter8< TInputImage,TOutputImage >
     else if (dynamic_cast< VesselnessGeneratorType * >(caller))
       {
       m_StatusMessage = "Generating vesselness feature (Sato et al.)..";
-      this->UpdateProgress( m_LungWallFeatureGenerator->GetProgress() );
+      this->UpdateProgress( m_VesselnessFeatureGenerator->GetProgress() );
       }
 
     else if (dynamic_cast< SegmentationModuleType * >(caller))
@@ -319,6 +339,15 @@ void LesionSegmentationImageFilter8< TInputImage,TOutputImage >
   this->m_CropFilter->SetAbortGenerateData(abort);
   this->m_IsotropicResampler->SetAbortGenerateData(abort);
   this->m_LesionSegmentationMethod->SetAbortGenerateData(abort);
+
+  if (abort)
+    {
+    this->m_CancellationToken->Cancel();
+    }
+  else
+    {
+    this->m_CancellationToken->Reset();
+    }
 }
 
 template <class TInputImage, class TOutputImage>
@@ -328,12 +357,160 @@ void LesionSegmentationImageFilter8< TInputImage,TOutputImage >
   this->m_VesselnessFeatureGenerator->SetUseVesselEnhancingDiffusion(b);
 }
 
+template <class TInputImage, class TOutputImage>
+void LesionSegmentationImageFilter8< TInputImage,TOutputImage >
+::SetUseParallelFeatureGeneration( bool b )
+{
+  this->m_FeatureAggregator->SetUseParallelFeatureGeneration(b);
+}
+
+template <class TInputImage, class TOutputImage>
+void LesionSegmentationImageFilter8< TInputImage,TOutputImage >
+::SetUseTiledFeatureGeneration( bool b )
+{
+  this->m_FeatureAggregator->SetUseTiledFeatureGeneration(b);
+}
+
+template <class TInputImage, class TOutputImage>
+void LesionSegmentationImageFilter8< TInputImage,TOutputImage >
+::SetFeatureCache( FeatureCacheType * cache )
+{
+  // The aggregated feature is looked up first. The individual features are
+  // cached as well, so that changing the parameters of one of them does not
+  // require recomputing the others.
+  this->m_FeatureAggregator->SetFeatureCache(cache);
+  this->m_LungWallFeatureGenerator->SetFeatureCache(cache);
+  this->m_VesselnessFeatureGenerator->SetFeatureCache(cache);
+  this->m_SigmoidFeatureGenerator->SetFeatureCache(cache);
+  this->m_CannyEdgesFeatureGenerator->SetFeatureCache(cache);
+  this->Modified();
+}
+
+template <class TInputImage, class TOutputImage>
+void LesionSegmentationImageFilter8< TInputImage,TOutputImage >
+::SetLungMask( const LungMaskImageType * lungMask )
+{
+  if (this->m_LungWallFeatureGenerator->GetLungMask() == lungMask)
+    {
+    return;
+    }
+  this->m_LungWallFeatureGenerator->SetLungMask(lungMask);
+  this->Modified();
+}
+
+template <class TInputImage, class TOutputImage>
+const typename LesionSegmentationImageFilter8< TInputImage,TOutputImage >::LungMaskImageType *
+LesionSegmentationImageFilter8< TInputImage,TOutputImage >
+::GetLungMask() const
+{
+  return this->m_LungWallFeatureGenerator->GetLungMask();
+}
+
+template <class TInputImage, class TOutputImage>
+void LesionSegmentationImageFilter8< TInputImage,TOutputImage >
+::SetStageReport( StageReportType * report )
+{
+  if (this->m_StageReport == report)
+    {
+    return;
+    }
+
+  if (this->m_StageReport)
+    {
+    this->m_StageReport->StopObserving();
+    }
+
+  this->m_StageReport = report;
+
+  if (report)
+    {
+    report->Observe( this->m_CropFilter, "Crop" );
+    report->Observe( this->m_IsotropicResampler, "Resample" );
+    report->Observe( this->m_FeatureAggregator, "Aggregation" );
+    report->Observe( this->m_LungWallFeatureGenerator, "LungWallFeature", this->m_FeatureAggregator );
+    report->Observe( this->m_VesselnessFeatureGenerator, "VesselnessFeature", this->m_FeatureAggregator );
+    report->Observe( this->m_SigmoidFeatureGenerator, "IntensityFeature", this->m_FeatureAggregator );
+    report->Observe( this->m_CannyEdgesFeatureGenerator, "EdgeFeature", this->m_FeatureAggregator );
+    report->Observe( this->m_SegmentationModule->GetFastMarchingModule(), "FastMarching" );
+    report->Observe( this->m_SegmentationModule->GetGeodesicActiveContourLevelSetModule(),
+      "GeodesicActiveContour" );
+    }
+}
+
+template <class TInputImage, class TOutputImage>
+void LesionSegmentationImageFilter8< TInputImage,TOutputImage >
+::SetSeeds( PointListType p )
+{
+  this->m_Seeds = p;
+  this->m_SeedSpatialObject->SetPoints(this->m_Seeds);
+  this->m_SeedSpatialObject->Modified();
+  this->Modified();
+}
+
+template <class TInputImage, class TOutputImage>
+void LesionSegmentationImageFilter8< TInputImage,TOutputImage >
+::SetCurvatureScaling( double d )
+{
+  this->m_SegmentationModule->SetCurvatureScaling(d);
+}
+
+template <class TInputImage, class TOutputImage>
+double LesionSegmentationImageFilter8< TInputImage,TOutputImage >
+::GetCurvatureScaling() const
+{
+  return this->m_SegmentationModule->GetCurvatureScaling();
+}
+
+template <class TInputImage, class TOutputImage>
+void LesionSegmentationImageFilter8< TInputImage,TOutputImage >
+::SetAdvectionScaling( double d )
+{
+  this->m_SegmentationModule->SetAdvectionScaling(d);
+}
+
+template <class TInputImage, class TOutputImage>
+double LesionSegmentationImageFilter8< TInputImage,TOutputImage >
+::GetAdvectionScaling() const
+{
+  return this->m_SegmentationModule->GetAdvectionScaling();
+}
+
+template <class TInputImage, class TOutputImage>
+void LesionSegmentationImageFilter8< TInputImage,TOutputImage >
+::SetPropagationScaling( double d )
+{
+  this->m_SegmentationModule->SetPropagationScaling(d);
+}
+
+template <class TInputImage, class TOutputImage>
+double LesionSegmentationImageFilter8< TInputImage,TOutputImage >
+::GetPropagationScaling() const
+{
+  return this->m_SegmentationModule->GetPropagationScaling();
+}
+
+template <class TInputImage, class TOutputImage>
+unsigned long LesionSegmentationImageFilter8< TInputImage,TOutputImage >
+::GetMTime() const
+{
+  // The parameters forwarded to the internal pipeline do not modify this
+  // filter, account for them here.
+  unsigned long mtime = this->Superclass::GetMTime();
+  const unsigned long t = this->m_LesionSegmentationMethod->GetMTime();
+  if (t > mtime)
+    {
+    mtime = t;
+    }
+  return mtime;
+}
+
 template <class TInputImage, class TOutputImage>
 void
 LesionSegmentationImageFilter8<TInputImage,TOutputImage>
 ::PrintSelf(std::ostream& os, Indent indent) const
 {
   Superclass::PrintSelf(os,indent);
+  os << indent << "StageReport: " << m_StageReport.GetPointer() << std::endl;
 }
 
 }//end of itk namespace
@@ -98,6 +98,10 @@ public:
    */
   itkSetObjectMacro( SegmentationModule, SegmentationModuleType );
 
+  /** Check the feature generators, the segmentation module and the initial
+   * segmentation, and return the consolidated MTime. */
+  unsigned long GetMTime() const override;
+
 
 protected:
   LesionSegmentationMethod();
@@ -100,6 +100,42 @@ LesionSegmentationMethod<NDimension>
 }
 
 
+template <unsigned int NDimension>
+unsigned long
+LesionSegmentationMethod<NDimension>
+::GetMTime() const
+{
+  // Changing the parameters of a feature generator, of the segmentation
+  // module, or the seeds, must re-execute the method. Only the parts that
+  // are out of date will actually be recomputed.
+  unsigned long mtime = this->Superclass::GetMTime();
+
+  auto gitr = this->m_FeatureGenerators.begin();
+  auto gend = this->m_FeatureGenerators.end();
+  while( gitr != gend )
+    {
+    const unsigned long t = (*gitr)->GetMTime();
+    if (t > mtime)
+      {
+      mtime = t;
+      }
+    ++gitr;
+    }
+
+  if( this->m_SegmentationModule && this->m_SegmentationModule->GetMTime() > mtime )
+    {
+    mtime = this->m_SegmentationModule->GetMTime();
+    }
+
+  if( this->m_InitialSegmentation && this->m_InitialSegmentation->GetMTime() > mtime )
+    {
+    mtime = this->m_InitialSegmentation->GetMTime();
+    }
+
+  return mtime;
+}
+
+
 /*
  * Generate Data
  */
@@ -113,6 +149,11 @@ LesionSegmentationMethod<NDimension>
     itkExceptionMacro("Segmentation Module has not been connected");
     }
 
+  // Filters registered in a previous execution would otherwise be counted
+  // twice, and the accumulated progress would exceed one.
+  this->m_ProgressAccumulator->ResetProgress();
+  this->m_ProgressAccumulator->UnregisterAllFilters();
+
   this->UpdateAllFeatureGenerators();
 
   this->VerifyNumberOfAvailableFeaturesMatchedExpectations();
@@ -0,0 +1,149 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkLungMaskImageFilter.h
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkLungMaskImageFilter_h
+#define itkLungMaskImageFilter_h
+
+#include "itkImageToImageFilter.h"
+#include "itkImage.h"
+#include "itkBinShrinkImageFilter.h"
+#include "itkLungWallFeatureGenerator.h"
+
+namespace itk
+{
+
+/** \class LungMaskImageFilter
+ * \brief Computes the lung wall feature of a whole scan once.
+ *
+ * The filter produces, over the whole input scan, the feature that
+ * LungWallFeatureGenerator computes over a region of interest. It is meant
+ * to be computed once per scan and handed to the lung wall generators of
+ * every lesion with LungWallFeatureGenerator::SetLungMask(), which then
+ * only crop it. Since the mask is computed away from the borders of the
+ * regions of interest, lesions near those borders get a consistent wall.
+ *
+ * When MaskSpacing is larger than the spacing of the input along an axis,
+ * the scan is first averaged over bins of voxels along that axis, so that
+ * the mask is computed on a coarser grid. The generators interpolate it
+ * back onto the grid of their regions.
+ *
+ * The mask is closed with distance maps by default, since the run time of
+ * the iterative hole filling grows with the size of the concavities, which
+ * is large over a whole scan.
+ *
+ * \ingroup LesionSizingToolkit
+ */
+template<class TInputImage>
+class LungMaskImageFilter
+  : public ImageToImageFilter<TInputImage,
+      typename LungWallFeatureGenerator< TInputImage::ImageDimension >::LungMaskImageType >
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(LungMaskImageFilter);
+
+  /** Standard "Self" & Superclass type alias.  */
+  using Self = LungMaskImageFilter;
+  using LungWallGeneratorType = LungWallFeatureGenerator< TInputImage::ImageDimension >;
+  using Superclass = ImageToImageFilter<TInputImage, typename LungWallGeneratorType::LungMaskImageType>;
+
+  /** Image type alias support   */
+  using InputImageType = TInputImage;
+  using OutputImageType = typename LungWallGeneratorType::LungMaskImageType;
+
+  /** SmartPointer type alias support  */
+  using Pointer = SmartPointer<Self>;
+  using ConstPointer = SmartPointer<const Self>;
+
+  /** Define pixel types. */
+  using InputImagePixelType = typename TInputImage::PixelType;
+  using OutputImagePixelType = typename OutputImageType::PixelType;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(LungMaskImageFilter, ImageToImageFilter);
+
+  /** ImageDimension constant    */
+  static constexpr unsigned int ImageDimension = TInputImage::ImageDimension;
+
+#ifdef ITK_USE_CONCEPT_CHECKING
+  /** Begin concept checking */
+  itkConceptMacro(InputIsLungWallInputCheck,
+    (Concept::SameType<InputImageType, typename LungWallGeneratorType::InputImageType>));
+  /** End concept checking */
+#endif
+
+  /** Smallest spacing of the mask, in physical units. Axes of the input
+   * with a smaller spacing are binned by the largest integer factor that
+   * does not exceed it. Zero, the default, keeps the grid of the input. */
+  itkSetMacro( MaskSpacing, double );
+  itkGetConstMacro( MaskSpacing, double );
+
+  /** Hounsfield Unit value to threshold the lung. */
+  itkSetMacro( LungThreshold, InputImagePixelType );
+  itkGetConstMacro( LungThreshold, InputImagePixelType );
+
+  /** Close the lung mask with distance maps rather than with the iterative
+   * hole filling. On by default. See LungWallFeatureGenerator. */
+  itkSetMacro( UseDistanceClosing, bool );
+  itkGetConstMacro( UseDistanceClosing, bool );
+  itkBooleanMacro( UseDistanceClosing );
+
+  /** Radius of the distance closing, in physical units. */
+  itkSetMacro( ClosingRadius, double );
+  itkGetConstMacro( ClosingRadius, double );
+
+  /** The whole scan is needed, and the whole mask is produced. */
+  void GenerateInputRequestedRegion() override;
+  void EnlargeOutputRequestedRegion( DataObject * ) override;
+
+  /** The output is on the binned grid. */
+  void GenerateOutputInformation() override;
+
+protected:
+  LungMaskImageFilter();
+  ~LungMaskImageFilter() override;
+  void PrintSelf(std::ostream& os, Indent indent) const override;
+
+  void GenerateData() override;
+
+private:
+  using BinShrinkFilterType = BinShrinkImageFilter< InputImageType, InputImageType >;
+  using ShrinkFactorsType = typename BinShrinkFilterType::ShrinkFactorsType;
+  using InputImageSpatialObjectType = typename LungWallGeneratorType::InputImageSpatialObjectType;
+  using MaskSpatialObjectType = typename LungWallGeneratorType::LungMaskSpatialObjectType;
+
+  /** Binning factors for the MaskSpacing, all one when the input is not
+   * binned. */
+  ShrinkFactorsType ComputeShrinkFactors() const;
+
+  typename BinShrinkFilterType::Pointer       m_BinShrinkFilter;
+  typename LungWallGeneratorType::Pointer     m_LungWallGenerator;
+
+  double                                      m_MaskSpacing;
+  InputImagePixelType                         m_LungThreshold;
+  bool                                        m_UseDistanceClosing;
+  double                                      m_ClosingRadius;
+};
+
+} //end of namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkLungMaskImageFilter.hxx"
+#endif
+
+#endif
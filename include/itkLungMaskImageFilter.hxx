@@ -0,0 +1,181 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkLungMaskImageFilter.hxx
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkLungMaskImageFilter_hxx
+#define itkLungMaskImageFilter_hxx
+
+#include "itkLungMaskImageFilter.h"
+#include "itkProgressAccumulator.h"
+
+#include <cmath>
+
+namespace itk
+{
+
+template <class TInputImage>
+LungMaskImageFilter<TInputImage>::
+LungMaskImageFilter()
+{
+  this->SetNumberOfRequiredInputs( 1 );
+  this->SetNumberOfRequiredOutputs( 1 );
+
+  this->m_BinShrinkFilter = BinShrinkFilterType::New();
+  this->m_LungWallGenerator = LungWallGeneratorType::New();
+
+  this->m_MaskSpacing = 0.0;
+  this->m_LungThreshold = -400;
+  this->m_UseDistanceClosing = true;
+  this->m_ClosingRadius = 5.0;
+}
+
+template <class TInputImage>
+LungMaskImageFilter<TInputImage>::
+~LungMaskImageFilter()
+{
+}
+
+template <class TInputImage>
+void
+LungMaskImageFilter<TInputImage>
+::GenerateInputRequestedRegion()
+{
+  // call the superclass' implementation of this method
+  Superclass::GenerateInputRequestedRegion();
+
+  if ( this->GetInput() )
+    {
+    typename InputImageType::Pointer inputPtr  =
+      const_cast< TInputImage *>( this->GetInput() );
+
+    // Request the entire input image
+    inputPtr->SetRequestedRegion(inputPtr->GetLargestPossibleRegion());
+    }
+}
+
+template <class TInputImage>
+void
+LungMaskImageFilter<TInputImage>
+::EnlargeOutputRequestedRegion( DataObject * output )
+{
+  Superclass::EnlargeOutputRequestedRegion( output );
+  output->SetRequestedRegionToLargestPossibleRegion();
+}
+
+template <class TInputImage>
+typename LungMaskImageFilter<TInputImage>::ShrinkFactorsType
+LungMaskImageFilter<TInputImage>
+::ComputeShrinkFactors() const
+{
+  const typename InputImageType::SpacingType & spacing = this->GetInput()->GetSpacing();
+
+  ShrinkFactorsType factors;
+  for( unsigned int d = 0; d < ImageDimension; d++ )
+    {
+    factors[d] = 1;
+    if( this->m_MaskSpacing > spacing[d] )
+      {
+      factors[d] = static_cast< typename ShrinkFactorsType::ValueType >(
+        std::floor( this->m_MaskSpacing / spacing[d] ) );
+      }
+    }
+  return factors;
+}
+
+template <class TInputImage>
+void
+LungMaskImageFilter<TInputImage>
+::GenerateOutputInformation()
+{
+  // call the superclass' implementation of this method
+  Superclass::GenerateOutputInformation();
+
+  OutputImageType * outputPtr = this->GetOutput();
+  const InputImageType * inputPtr = this->GetInput();
+  if ( !outputPtr || !inputPtr )
+    {
+    return;
+    }
+
+  this->m_BinShrinkFilter->SetInput( inputPtr );
+  this->m_BinShrinkFilter->SetShrinkFactors( this->ComputeShrinkFactors() );
+  this->m_BinShrinkFilter->UpdateOutputInformation();
+
+  outputPtr->CopyInformation( this->m_BinShrinkFilter->GetOutput() );
+}
+
+template <class TInputImage>
+void
+LungMaskImageFilter<TInputImage>
+::GenerateData()
+{
+  // Report progress.
+  ProgressAccumulator::Pointer progress = ProgressAccumulator::New();
+  progress->SetMiniPipelineFilter(this);
+
+  const InputImageType * inputImage = this->GetInput();
+
+  const ShrinkFactorsType factors = this->ComputeShrinkFactors();
+
+  bool binned = false;
+  for( unsigned int d = 0; d < ImageDimension; d++ )
+    {
+    binned = binned || ( factors[d] > 1 );
+    }
+
+  typename InputImageType::Pointer maskInput = const_cast< InputImageType * >( inputImage );
+
+  if( binned )
+    {
+    progress->RegisterInternalFilter( this->m_BinShrinkFilter, 0.1 );
+    this->m_BinShrinkFilter->SetInput( inputImage );
+    this->m_BinShrinkFilter->SetShrinkFactors( factors );
+    this->m_BinShrinkFilter->Update();
+    maskInput = this->m_BinShrinkFilter->GetOutput();
+    maskInput->DisconnectPipeline();
+    }
+
+  typename InputImageSpatialObjectType::Pointer inputObject = InputImageSpatialObjectType::New();
+  inputObject->SetImage( maskInput );
+
+  progress->RegisterInternalFilter( this->m_LungWallGenerator, binned ? 0.9 : 1.0 );
+
+  this->m_LungWallGenerator->SetInput( inputObject );
+  this->m_LungWallGenerator->SetLungThreshold( this->m_LungThreshold );
+  this->m_LungWallGenerator->SetUseDistanceClosing( this->m_UseDistanceClosing );
+  this->m_LungWallGenerator->SetClosingRadius( this->m_ClosingRadius );
+  this->m_LungWallGenerator->Update();
+
+  const auto * maskObject =
+    dynamic_cast< const MaskSpatialObjectType * >( this->m_LungWallGenerator->GetFeature() );
+
+  this->GraftOutput( const_cast< OutputImageType * >( maskObject->GetImage() ) );
+}
+
+template <class TInputImage>
+void
+LungMaskImageFilter<TInputImage>
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf(os,indent);
+  os << indent << "Mask spacing = " << this->m_MaskSpacing << std::endl;
+  os << indent << "Lung threshold = " << this->m_LungThreshold << std::endl;
+  os << indent << "Use distance closing = " << this->m_UseDistanceClosing << std::endl;
+  os << indent << "Closing radius = " << this->m_ClosingRadius << std::endl;
+}
+
+} //end of namespace itk
+
+#endif
@@ -22,6 +22,9 @@
 #include "itkImageSpatialObject.h"
 #include "itkBinaryThresholdImageFilter.h"
 #include "itkVotingBinaryHoleFillFloodingImageFilter.h"
+#include "itkSignedMaurerDistanceMapImageFilter.h"
+#include "itkResampleImageFilter.h"
+#include "itkProgressAccumulator.h"
 
 namespace itk
 {
@@ -34,6 +37,20 @@ namespace itk
  * transformation is very close to a simply thresholding selection on the input
  * image, but with the advantage of a smooth transition of intensities.
  *
+ * The thresholded lung mask is grown into the concavities of the wall by
+ * default with an iterative voting hole filling, whose number of iterations
+ * grows with the size of the concavities. When UseDistanceClosing is on, the
+ * mask is instead closed by a ball of radius ClosingRadius, computed from two
+ * exact Euclidean distance maps, which takes a time independent of the
+ * anatomy.
+ *
+ * When a lung mask computed over the whole scan, for example by
+ * LungMaskImageFilter, is given with SetLungMask(), the generator does not
+ * threshold nor close its input: it copies the box of the mask under the
+ * input when the input lies on the grid of the mask, shares the mask when
+ * the input covers it exactly, and interpolates it onto the grid of the
+ * input otherwise.
+ *
  * SpatialObjects are used as inputs and outputs of this class.
  *
  * \ingroup SpatialObjectFilters
@@ -68,6 +85,10 @@ public:
   using InputImageSpatialObjectPointer = typename InputImageSpatialObjectType::Pointer;
   using SpatialObjectType = typename Superclass::SpatialObjectType;
 
+  /** Type of the feature, and of the lung masks computed over whole scans. */
+  using LungMaskImageType = Image< float, Dimension >;
+  using LungMaskSpatialObjectType = ImageSpatialObject< NDimension, float >;
+
   /** Input data that will be used for generating the feature. */
   using ProcessObject::SetInput;
   void SetInput( const SpatialObjectType * input );
@@ -81,6 +102,22 @@ public:
   itkSetMacro( LungThreshold, InputPixelType );
   itkGetMacro( LungThreshold, InputPixelType );
 
+  /** Close the lung mask with distance maps instead of the iterative hole
+   * filling. Off by default. */
+  itkSetMacro( UseDistanceClosing, bool );
+  itkGetConstMacro( UseDistanceClosing, bool );
+  itkBooleanMacro( UseDistanceClosing );
+
+  /** Radius, in physical units, of the ball closing the lung mask when
+   * UseDistanceClosing is on. */
+  itkSetMacro( ClosingRadius, double );
+  itkGetConstMacro( ClosingRadius, double );
+
+  /** Lung mask of the whole scan, that the feature is taken from instead of
+   * being computed from the input. Null by default. */
+  itkSetConstObjectMacro( LungMask, LungMaskImageType );
+  itkGetConstObjectMacro( LungMask, LungMaskImageType );
+
 protected:
   LungWallFeatureGenerator();
   ~LungWallFeatureGenerator() override;
@@ -90,14 +127,17 @@ protected:
    * the segmentation. */
   void  GenerateData () override;
 
+  /** Parameters that identify the feature in a FeatureCache. */
+  bool GetFeatureCacheParameters( std::ostream & os ) const override;
+
 private:
   using InternalPixelType = float;
   using InternalImageType = Image< InternalPixelType, Dimension >;
 
   using OutputPixelType = float;
-  using OutputImageType = Image< OutputPixelType, Dimension >;
+  using OutputImageType = LungMaskImageType;
 
-  using OutputImageSpatialObjectType = ImageSpatialObject< NDimension, OutputPixelType >;
+  using OutputImageSpatialObjectType = LungMaskSpatialObjectType;
 
   using ThresholdFilterType = BinaryThresholdImageFilter<
     InputImageType, InternalImageType >;
@@ -107,10 +147,44 @@ private:
     InternalImageType, OutputImageType >;
   using VotingHoleFillingFilterPointer = typename VotingHoleFillingFilterType::Pointer;
 
+  using DistanceMapFilterType = SignedMaurerDistanceMapImageFilter<
+    InternalImageType, InternalImageType >;
+  using DistanceMapFilterPointer = typename DistanceMapFilterType::Pointer;
+
+  using DistanceThresholdFilterType = BinaryThresholdImageFilter<
+    InternalImageType, InternalImageType >;
+  using DistanceThresholdFilterPointer = typename DistanceThresholdFilterType::Pointer;
+
+  using ClosingThresholdFilterType = BinaryThresholdImageFilter<
+    InternalImageType, OutputImageType >;
+  using ClosingThresholdFilterPointer = typename ClosingThresholdFilterType::Pointer;
+
+  using MaskResampleFilterType = ResampleImageFilter< LungMaskImageType, OutputImageType >;
+
+  /** Closes the lung mask with the iterative hole filling. */
+  typename OutputImageType::Pointer FillHoles( ProgressAccumulator * progress );
+
+  /** Closes the lung mask with the distance maps. */
+  typename OutputImageType::Pointer CloseByDistance( ProgressAccumulator * progress );
+
+  /** Takes the feature of the input from the lung mask. */
+  typename OutputImageType::ConstPointer CropLungMask( const InputImageType * inputImage,
+    ProgressAccumulator * progress );
+
   ThresholdFilterPointer                m_ThresholdFilter;
   VotingHoleFillingFilterPointer        m_VotingHoleFillingFilter;
 
+  DistanceMapFilterPointer              m_DilationDistanceFilter;
+  DistanceThresholdFilterPointer        m_DilationThresholdFilter;
+  DistanceMapFilterPointer              m_ErosionDistanceFilter;
+  ClosingThresholdFilterPointer         m_ErosionThresholdFilter;
+
   InputPixelType                        m_LungThreshold;
+
+  bool                                  m_UseDistanceClosing;
+  double                                m_ClosingRadius;
+
+  typename LungMaskImageType::ConstPointer  m_LungMask;
 };
 
 } // end namespace itk
@@ -19,6 +19,10 @@
 
 #include "itkLungWallFeatureGenerator.h"
 #include "itkProgressAccumulator.h"
+#include "itkImageAlgorithm.h"
+#include "itkMath.h"
+
+#include <cmath>
 
 
 namespace itk
@@ -37,14 +41,26 @@ LungWallFeatureGenerator<NDimension>
   this->m_ThresholdFilter = ThresholdFilterType::New();
   this->m_VotingHoleFillingFilter = VotingHoleFillingFilterType::New();
 
+  this->m_DilationDistanceFilter = DistanceMapFilterType::New();
+  this->m_DilationThresholdFilter = DistanceThresholdFilterType::New();
+  this->m_ErosionDistanceFilter = DistanceMapFilterType::New();
+  this->m_ErosionThresholdFilter = ClosingThresholdFilterType::New();
+
   this->m_ThresholdFilter->ReleaseDataFlagOn();
   this->m_VotingHoleFillingFilter->ReleaseDataFlagOn();
+  this->m_DilationDistanceFilter->ReleaseDataFlagOn();
+  this->m_DilationThresholdFilter->ReleaseDataFlagOn();
+  this->m_ErosionDistanceFilter->ReleaseDataFlagOn();
+  this->m_ErosionThresholdFilter->ReleaseDataFlagOn();
 
   typename OutputImageSpatialObjectType::Pointer outputObject = OutputImageSpatialObjectType::New();
 
   this->ProcessObject::SetNthOutput( 0, outputObject.GetPointer() );
 
   this->m_LungThreshold = -400;
+
+  this->m_UseDistanceClosing = false;
+  this->m_ClosingRadius = 5.0;
 }
 
 
@@ -91,6 +107,9 @@ LungWallFeatureGenerator<NDimension>
 {
   Superclass::PrintSelf( os, indent );
   os << indent << "Lung threshold " << this->m_ThresholdFilter << std::endl;
+  os << indent << "Use distance closing " << this->m_UseDistanceClosing << std::endl;
+  os << indent << "Closing radius " << this->m_ClosingRadius << std::endl;
+  os << indent << "Lung mask " << this->m_LungMask.GetPointer() << std::endl;
 }
 
 
@@ -120,11 +139,18 @@ LungWallFeatureGenerator<NDimension>
   // Report progress.
   ProgressAccumulator::Pointer progress = ProgressAccumulator::New();
   progress->SetMiniPipelineFilter(this);
+
+  auto * outputObject = dynamic_cast< OutputImageSpatialObjectType * >(this->ProcessObject::GetOutput(0));
+
+  if( this->m_LungMask )
+    {
+    outputObject->SetImage( this->CropLungMask( inputImage, progress ) );
+    return;
+    }
+
   progress->RegisterInternalFilter( this->m_ThresholdFilter, 0.1 );
-  progress->RegisterInternalFilter( this->m_VotingHoleFillingFilter, 0.9 );
 
   this->m_ThresholdFilter->SetInput( inputImage );
-  this->m_VotingHoleFillingFilter->SetInput( this->m_ThresholdFilter->GetOutput() );
 
   this->m_ThresholdFilter->SetLowerThreshold( this->m_LungThreshold );
   this->m_ThresholdFilter->SetUpperThreshold( 3000 );
@@ -132,6 +158,32 @@ LungWallFeatureGenerator<NDimension>
   this->m_ThresholdFilter->SetInsideValue( 0.0 );
   this->m_ThresholdFilter->SetOutsideValue( 1.0 );
 
+  typename OutputImageType::Pointer outputImage;
+
+  if( this->m_UseDistanceClosing )
+    {
+    outputImage = this->CloseByDistance( progress );
+    }
+  else
+    {
+    outputImage = this->FillHoles( progress );
+    }
+
+  outputImage->DisconnectPipeline();
+
+  outputObject->SetImage( outputImage );
+}
+
+
+template <unsigned int NDimension>
+typename LungWallFeatureGenerator<NDimension>::OutputImageType::Pointer
+LungWallFeatureGenerator<NDimension>
+::FillHoles( ProgressAccumulator * progress )
+{
+  progress->RegisterInternalFilter( this->m_VotingHoleFillingFilter, 0.9 );
+
+  this->m_VotingHoleFillingFilter->SetInput( this->m_ThresholdFilter->GetOutput() );
+
   typename InternalImageType::SizeType  ballManhattanRadius;
 
   ballManhattanRadius.Fill( 3 );
@@ -147,13 +199,156 @@ LungWallFeatureGenerator<NDimension>
   std::cout << "Used " << this->m_VotingHoleFillingFilter->GetCurrentIterationNumber() << " iterations " << std::endl;
   std::cout << "Changed " << this->m_VotingHoleFillingFilter->GetTotalNumberOfPixelsChanged() << " pixels " << std::endl;
 
-  typename OutputImageType::Pointer outputImage = this->m_VotingHoleFillingFilter->GetOutput();
+  return this->m_VotingHoleFillingFilter->GetOutput();
+}
 
-  outputImage->DisconnectPipeline();
 
-  auto * outputObject = dynamic_cast< OutputImageSpatialObjectType * >(this->ProcessObject::GetOutput(0));
+/*
+ * The closing of the lung mask by a ball of radius R is the erosion of its
+ * dilation. A pixel is in the dilation when its distance to the lung is at
+ * most R, and stays in the erosion when its distance to the outside of the
+ * dilation is more than R. Each distance map is exact and computed in a
+ * fixed number of passes over the image.
+ */
+template <unsigned int NDimension>
+typename LungWallFeatureGenerator<NDimension>::OutputImageType::Pointer
+LungWallFeatureGenerator<NDimension>
+::CloseByDistance( ProgressAccumulator * progress )
+{
+  progress->RegisterInternalFilter( this->m_DilationDistanceFilter, 0.4 );
+  progress->RegisterInternalFilter( this->m_DilationThresholdFilter, 0.05 );
+  progress->RegisterInternalFilter( this->m_ErosionDistanceFilter, 0.4 );
+  progress->RegisterInternalFilter( this->m_ErosionThresholdFilter, 0.05 );
+
+  const InternalPixelType radius = static_cast< InternalPixelType >( this->m_ClosingRadius );
+
+  // Distance from every pixel to the lung.
+  this->m_DilationDistanceFilter->SetInput( this->m_ThresholdFilter->GetOutput() );
+  this->m_DilationDistanceFilter->SetBackgroundValue( 0.0 );
+  this->m_DilationDistanceFilter->SquaredDistanceOff();
+  this->m_DilationDistanceFilter->UseImageSpacingOn();
+  this->m_DilationDistanceFilter->InsideIsPositiveOff();
+
+  // The pixels farther than the radius from the lung are the outside of the
+  // dilation.
+  this->m_DilationThresholdFilter->SetInput( this->m_DilationDistanceFilter->GetOutput() );
+  this->m_DilationThresholdFilter->SetLowerThreshold( NumericTraits< InternalPixelType >::NonpositiveMin() );
+  this->m_DilationThresholdFilter->SetUpperThreshold( radius );
+  this->m_DilationThresholdFilter->SetInsideValue( 0.0 );
+  this->m_DilationThresholdFilter->SetOutsideValue( 1.0 );
+
+  // Distance from every pixel to the outside of the dilation.
+  this->m_ErosionDistanceFilter->SetInput( this->m_DilationThresholdFilter->GetOutput() );
+  this->m_ErosionDistanceFilter->SetBackgroundValue( 0.0 );
+  this->m_ErosionDistanceFilter->SquaredDistanceOff();
+  this->m_ErosionDistanceFilter->UseImageSpacingOn();
+  this->m_ErosionDistanceFilter->InsideIsPositiveOff();
+
+  // The pixels farther than the radius from the outside of the dilation are
+  // the closed lung.
+  this->m_ErosionThresholdFilter->SetInput( this->m_ErosionDistanceFilter->GetOutput() );
+  this->m_ErosionThresholdFilter->SetLowerThreshold( NumericTraits< InternalPixelType >::NonpositiveMin() );
+  this->m_ErosionThresholdFilter->SetUpperThreshold( radius );
+  this->m_ErosionThresholdFilter->SetInsideValue( 0.0 );
+  this->m_ErosionThresholdFilter->SetOutsideValue( 1.0 );
+
+  this->m_ErosionThresholdFilter->Update();
+
+  return this->m_ErosionThresholdFilter->GetOutput();
+}
 
-  outputObject->SetImage( outputImage );
+
+/*
+ * A crop of the mask is a copy of the box of the mask under the input,
+ * unless the input covers the whole mask, which is then shared. Inputs off
+ * the grid of the mask, such as resampled regions or masks computed on a
+ * binned grid, get the mask interpolated onto their grid.
+ */
+template <unsigned int NDimension>
+typename LungWallFeatureGenerator<NDimension>::OutputImageType::ConstPointer
+LungWallFeatureGenerator<NDimension>
+::CropLungMask( const InputImageType * inputImage, ProgressAccumulator * progress )
+{
+  const LungMaskImageType * lungMask = this->m_LungMask;
+
+  const typename InputImageType::RegionType & inputRegion = inputImage->GetBufferedRegion();
+
+  bool onMaskGrid = true;
+  for( unsigned int i = 0; i < Dimension; i++ )
+    {
+    onMaskGrid = onMaskGrid &&
+      std::abs( inputImage->GetSpacing()[i] - lungMask->GetSpacing()[i] ) <= 1e-6 * lungMask->GetSpacing()[i];
+    for( unsigned int j = 0; j < Dimension; j++ )
+      {
+      onMaskGrid = onMaskGrid &&
+        std::abs( inputImage->GetDirection()[i][j] - lungMask->GetDirection()[i][j] ) <= 1e-6;
+      }
+    }
+
+  typename InputImageType::PointType inputStart;
+  inputImage->TransformIndexToPhysicalPoint( inputRegion.GetIndex(), inputStart );
+
+  ContinuousIndex< double, Dimension > maskStart;
+  lungMask->TransformPhysicalPointToContinuousIndex( inputStart, maskStart );
+
+  typename LungMaskImageType::IndexType maskIndex;
+  for( unsigned int i = 0; i < Dimension; i++ )
+    {
+    maskIndex[i] = Math::Round< IndexValueType >( maskStart[i] );
+    onMaskGrid = onMaskGrid && std::abs( maskStart[i] - maskIndex[i] ) <= 1e-3;
+    }
+
+  const typename LungMaskImageType::RegionType maskRegion( maskIndex, inputRegion.GetSize() );
+
+  if( onMaskGrid && lungMask->GetBufferedRegion().IsInside( maskRegion ) )
+    {
+    if( maskRegion == lungMask->GetBufferedRegion() && maskIndex == inputRegion.GetIndex() )
+      {
+      return lungMask;
+      }
+
+    typename OutputImageType::Pointer croppedMask = OutputImageType::New();
+    croppedMask->CopyInformation( inputImage );
+    croppedMask->SetRegions( inputRegion );
+    croppedMask->Allocate();
+
+    ImageAlgorithm::Copy( lungMask, croppedMask.GetPointer(), maskRegion, inputRegion );
+
+    return croppedMask;
+    }
+
+  // Outside of the mask is taken as wall.
+  typename MaskResampleFilterType::Pointer resampler = MaskResampleFilterType::New();
+  progress->RegisterInternalFilter( resampler, 1.0 );
+  resampler->SetInput( lungMask );
+  resampler->SetOutputParametersFromImage( inputImage );
+  resampler->SetDefaultPixelValue( 0.0 );
+  resampler->Update();
+
+  typename OutputImageType::Pointer resampledMask = resampler->GetOutput();
+  resampledMask->DisconnectPipeline();
+
+  return resampledMask;
+}
+
+
+template <unsigned int NDimension>
+bool
+LungWallFeatureGenerator<NDimension>
+::GetFeatureCacheParameters( std::ostream & os ) const
+{
+  if( this->m_LungMask )
+    {
+    // Taking the feature from the mask is as fast as a cache lookup.
+    return false;
+    }
+
+  os << " LungThreshold " << this->m_LungThreshold;
+  if( this->m_UseDistanceClosing )
+    {
+    os << " ClosingRadius " << this->m_ClosingRadius;
+    }
+  return true;
 }
 
 } // end namespace itk
@@ -70,9 +70,9 @@ protected:
   ~MaximumFeatureAggregator() override;
   void PrintSelf(std::ostream& os, Indent indent) const override;
 
-
-private:
-  void ConsolidateFeatures() override;
+  /** Pixel-wise maximum of the features over the region. */
+  void ConsolidateFeaturesInRegion( OutputImageType * consolidatedImage,
+    const typename OutputImageType::RegionType & region ) override;
 
 };
 
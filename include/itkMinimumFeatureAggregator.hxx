@@ -61,22 +61,21 @@ MinimumFeatureAggregator<NDimension>
 template <unsigned int NDimension>
 void
 MinimumFeatureAggregator<NDimension>
-::ConsolidateFeatures()
+::ConsolidateFeaturesInRegion( OutputImageType * consolidatedFeatureImage,
+  const typename OutputImageType::RegionType & region )
 {
   using FeaturePixelType = float;
   using FeatureImageType = Image< FeaturePixelType, NDimension >;
   using FeatureSpatialObjectType = ImageSpatialObject< NDimension, FeaturePixelType >;
 
-  const auto * firstFeatureObject = dynamic_cast< const FeatureSpatialObjectType * >( this->GetInputFeature(0) );
+  using FeatureIterator = ImageRegionIterator< FeatureImageType >;
+  using FeatureConstIterator = ImageRegionConstIterator< FeatureImageType >;
 
-  const FeatureImageType * firstFeatureImage = firstFeatureObject->GetImage();
-
-  typename FeatureImageType::Pointer consolidatedFeatureImage = FeatureImageType::New();
-
-  consolidatedFeatureImage->CopyInformation( firstFeatureImage );
-  consolidatedFeatureImage->SetRegions( firstFeatureImage->GetBufferedRegion() );
-  consolidatedFeatureImage->Allocate();
-  consolidatedFeatureImage->FillBuffer( NumericTraits< FeaturePixelType >::max() );
+  FeatureIterator initializationItr( consolidatedFeatureImage, region );
+  for( initializationItr.GoToBegin(); !initializationItr.IsAtEnd(); ++initializationItr )
+    {
+    initializationItr.Set( NumericTraits< FeaturePixelType >::max() );
+    }
 
   const unsigned int numberOfFeatures = this->GetNumberOfInputFeatures();
 
@@ -86,11 +85,8 @@ MinimumFeatureAggregator<NDimension>
 
     const FeatureImageType * featureImage = featureObject->GetImage();
 
-    using FeatureIterator = ImageRegionIterator< FeatureImageType >;
-    using FeatureConstIterator = ImageRegionConstIterator< FeatureImageType >;
-
-    FeatureIterator       dstitr( consolidatedFeatureImage, consolidatedFeatureImage->GetBufferedRegion() );
-    FeatureConstIterator  srcitr( featureImage, featureImage->GetBufferedRegion() );
+    FeatureIterator       dstitr( consolidatedFeatureImage, region );
+    FeatureConstIterator  srcitr( featureImage, region );
 
     dstitr.GoToBegin();
     srcitr.GoToBegin();
@@ -105,10 +101,6 @@ MinimumFeatureAggregator<NDimension>
       ++dstitr;
       }
     }
-
-  auto * outputObject = dynamic_cast< FeatureSpatialObjectType * >(this->ProcessObject::GetOutput(0));
-
-  outputObject->SetImage( consolidatedFeatureImage );
 }
 
 } // end namespace itk
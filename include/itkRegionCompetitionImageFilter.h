@@ -19,6 +19,8 @@
 
 #include "itkImage.h"
 #include "itkImageToImageFilter.h"
+#include "itkImageBufferPool.h"
+#include "itkCancellationToken.h"
 
 #include <vector>
 
@@ -34,6 +36,18 @@ namespace itk
  * propagated until they collide with other labeled regions. Each labeled front
  * will compete for pixels against other labels.
  *
+ * Every label has its own front: the unlabeled pixels next to the pixels it
+ * gained in the previous iteration. A pixel reached by several fronts in the
+ * same iteration goes to the lowest label, that is the largest region when
+ * the labels come from a RelabelComponentImageFilter. The fronts are
+ * visited on several threads and the pixels they reach are merged in the
+ * order of the fronts, therefore the result does not depend on the number
+ * of threads.
+ *
+ * Progress is reported after every iteration. When the filter is aborted,
+ * it stops at the end of the current iteration, and its output holds the
+ * regions grown so far.
+ *
  * \ingroup RegionGrowingSegmentation
  * \ingroup LesionSizingToolkit
  */
@@ -86,6 +100,22 @@ public:
   /** Returned the number of pixels changed in total. */
   itkGetMacro( TotalNumberOfPixelsChanged, unsigned int );
 
+  /** Returned the number of labels found in the input labels. */
+  itkGetMacro( NumberOfLabels, unsigned int );
+
+  /** Pool from which the image of the claims is allocated. Defaults to the
+   * global pool, a null pool allocates it from the heap. */
+  itkSetObjectMacro( BufferPool, ImageBufferPool );
+  itkGetModifiableObjectMacro( BufferPool, ImageBufferPool );
+
+  /** Token polled by the propagation of the fronts. Once the token is
+   * cancelled, or the filter aborted, the filter releases its working
+   * memory and throws ProcessAborted, its output being left out of date.
+   * Defaults to null, in which case the current token of the executing
+   * thread, if any, is polled. */
+  itkSetObjectMacro( CancellationToken, CancellationToken );
+  itkGetModifiableObjectMacro( CancellationToken, CancellationToken );
+
   /** Input Labels */
   void SetInputLabels( const TOutputImage * inputLabelImage );
 
@@ -123,41 +153,75 @@ private:
 
   void VisitAllSeedsAndTransitionTheirState();
 
-  void PasteNewSeedValuesToOutputImage();
-
   void SwapSeedArrays();
 
   void ClearSecondSeedArray();
 
-  bool TestForAvailabilityAtCurrentPixel() const;
+  void ComputeArrayOfNeighborhoodBufferOffsets();
 
-  void PutCurrentPixelNeighborsIntoSeedArray();
+  /** Free the fronts and the visit buffers. */
+  void ReleaseWorkingMemory();
 
-  void ComputeArrayOfNeighborhoodBufferOffsets();
+  /** Either the filter was aborted or its cancellation token cancelled. */
+  bool IsCancelled() const
+    {
+    return this->GetAbortGenerateData() ||
+      ( this->m_ActiveCancellationToken && this->m_ActiveCancellationToken->IsCancellationRequested() );
+    }
 
-  void ComputeBirthThreshold();
+  /** Seeds are stored as offsets in the buffer of the output image, which
+   * is also the one of the image of the claims. */
+  using SeedArrayType = std::vector< OffsetValueType >;
 
-  itkSetMacro( CurrentPixelIndex, IndexType );
-  itkGetConstReferenceMacro( CurrentPixelIndex, IndexType );
+  /** Fronts, one per label. The front at index lb is the one of label lb + 1. */
+  using FrontArrayType = std::vector< SeedArrayType >;
 
-  using SeedArrayType = std::vector<IndexType>;
+  /** Pixels reached while visiting a range of the seeds, each one with the
+   * label of the front that reached it. */
+  struct SeedVisitBufferType
+    {
+    SeedArrayType                     Seeds;
+    std::vector< OutputImagePixelType > Labels;
+    };
 
-  SeedArrayType *                   m_SeedArray1;
-  SeedArrayType *                   m_SeedArray2;
+  /** Range of the seeds of a label, the work of a thread. */
+  struct SeedRangeType
+    {
+    unsigned int                      Label;
+    SizeValueType                     Begin;
+    SizeValueType                     End;
+    };
 
-  InputImageRegionType              m_InternalRegion;
+  void ComputeSeedRanges();
+
+  void VisitSeedsInRange( const SeedRangeType & range, SeedVisitBufferType & buffer ) const;
 
-  using SeedNewValuesArrayType = std::vector<OutputImagePixelType>;
+  void PasteSeedsInRange( const SeedRangeType & range );
 
-  SeedNewValuesArrayType *          m_SeedsNewValues;
+  void MergeSeedVisitBuffers();
+
+  /** Below this number of seeds per thread, the fronts are visited on fewer
+   * threads. */
+  static constexpr SizeValueType    MinimumNumberOfSeedsPerWorkUnit = 256;
+
+  FrontArrayType                    m_SeedArray1;
+  FrontArrayType                    m_SeedArray2;
+
+  std::vector< SeedRangeType >      m_SeedRanges;
+
+  std::vector< SeedVisitBufferType > m_SeedVisitBuffers;
+
+  /** Pixels claimed by at least one front during the merge, in the order in
+   * which they were first claimed. */
+  SeedArrayType                     m_ClaimedSeeds;
+
+  InputImageRegionType              m_InternalRegion;
 
   unsigned int                      m_CurrentIterationNumber;
   unsigned int                      m_MaximumNumberOfIterations;
   unsigned int                      m_NumberOfPixelsChangedInLastIteration;
   unsigned int                      m_TotalNumberOfPixelsChanged;
 
-  IndexType                         m_CurrentPixelIndex;
-
   //
   // Variables used for addressing the Neighbors.
   // This could be factorized into a helper class.
@@ -176,16 +240,21 @@ private:
   const OutputImageType*       m_inputLabelsImage;
   OutputImageType *                 m_OutputImage;
 
-  using SeedMaskImageType = itk::Image< unsigned char, InputImageDimension >;
-  using SeedMaskImagePointer = typename SeedMaskImageType::Pointer;
+  /** Lowest label that claimed each pixel in the current merge, zero for
+   * the pixels that no front claimed, and the maximum label value for the
+   * pixels of the boundary, that are never labeled. */
+  OutputImagePointer                m_ClaimsImage;
+
+  ImageBufferPool::Pointer          m_BufferPool;
 
-  SeedMaskImagePointer              m_SeedsMask;
+  CancellationToken::Pointer        m_CancellationToken;
+  CancellationToken::Pointer        m_ActiveCancellationToken;
 
   using NeighborhoodType = itk::Neighborhood< InputImagePixelType, InputImageDimension >;
 
   NeighborhoodType                  m_Neighborhood;
 
-  mutable unsigned int              m_NumberOfLabels;
+  unsigned int                      m_NumberOfLabels;
 };
 
 } // end namespace itk
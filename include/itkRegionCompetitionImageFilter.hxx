@@ -24,6 +24,9 @@
 #include "itkNeighborhoodAlgorithm.h"
 #include "itkOffset.h"
 
+#include <algorithm>
+#include <mutex>
+
 namespace itk
 {
 
@@ -42,16 +45,15 @@ RegionCompetitionImageFilter<TInputImage, TOutputImage>
   this->m_NumberOfPixelsChangedInLastIteration = 0;
   this->m_TotalNumberOfPixelsChanged = 0;
 
-  this->m_SeedArray1 = nullptr;
-  this->m_SeedArray2 = nullptr;
-  this->m_SeedsNewValues = nullptr;
-
-  this->m_CurrentPixelIndex.Fill( 0 );
-
+  this->m_InputImage = nullptr;
   this->m_OutputImage = nullptr;
 
   this->m_NumberOfLabels = 0;
- this->m_inputLabelsImage = nullptr;
+  this->m_inputLabelsImage = nullptr;
+
+  this->m_BufferPool = ImageBufferPool::GetGlobalPool();
+  this->m_CancellationToken = nullptr;
+  this->m_ActiveCancellationToken = nullptr;
 }
 
 /**
@@ -61,23 +63,6 @@ template <class TInputImage, class TOutputImage>
 RegionCompetitionImageFilter<TInputImage, TOutputImage>
 ::~RegionCompetitionImageFilter()
 {
-  if( this->m_SeedArray1 )
-    {
-    delete [] this->m_SeedArray1;
-    this->m_SeedArray1 = nullptr;
-    }
-
-  if( this->m_SeedArray2 )
-    {
-    delete [] this->m_SeedArray2;
-    this->m_SeedArray2 = nullptr;
-    }
-
-  if( this->m_SeedsNewValues )
-    {
-    delete [] this->m_SeedsNewValues;
-    this->m_SeedsNewValues = nullptr;
-    }
 }
 
 
@@ -90,6 +75,10 @@ RegionCompetitionImageFilter<TInputImage, TOutputImage>
 ::PrintSelf(std::ostream& os, Indent indent) const
 {
   this->Superclass::PrintSelf(os, indent);
+  os << indent << "MaximumNumberOfIterations: " << this->m_MaximumNumberOfIterations << std::endl;
+  os << indent << "NumberOfLabels: " << this->m_NumberOfLabels << std::endl;
+  os << indent << "BufferPool: " << this->m_BufferPool.GetPointer() << std::endl;
+  os << indent << "CancellationToken: " << this->m_CancellationToken.GetPointer() << std::endl;
 }
 
 
@@ -110,6 +99,13 @@ void
 RegionCompetitionImageFilter<TInputImage,TOutputImage>
 ::GenerateData()
 {
+  if( this->m_inputLabelsImage == nullptr )
+    {
+    itkExceptionMacro("The input labels have not been set");
+    }
+
+  this->m_ActiveCancellationToken = CancellationToken::Resolve( this->m_CancellationToken );
+
   this->AllocateOutputImageWorkingMemory();
   this->ComputeNumberOfInputLabels();
   this->AllocateFrontsWorkingMemory();
@@ -117,6 +113,31 @@ RegionCompetitionImageFilter<TInputImage,TOutputImage>
   this->ComputeArrayOfNeighborhoodBufferOffsets();
   this->FindAllPixelsInTheBoundaryAndAddThemAsSeeds();
   this->IterateFrontPropagations();
+
+  // Give the claims back to the pool for the next run.
+  this->m_ClaimsImage = nullptr;
+
+  if( this->IsCancelled() )
+    {
+    this->ReleaseWorkingMemory();
+    this->m_ActiveCancellationToken = nullptr;
+    CancellationToken::ThrowProcessAborted( this );
+    }
+
+  this->m_ActiveCancellationToken = nullptr;
+}
+
+
+template <class TInputImage, class TOutputImage>
+void
+RegionCompetitionImageFilter<TInputImage,TOutputImage>
+::ReleaseWorkingMemory()
+{
+  FrontArrayType().swap( this->m_SeedArray1 );
+  FrontArrayType().swap( this->m_SeedArray2 );
+  std::vector< SeedRangeType >().swap( this->m_SeedRanges );
+  std::vector< SeedVisitBufferType >().swap( this->m_SeedVisitBuffers );
+  SeedArrayType().swap( this->m_ClaimedSeeds );
 }
 
 
@@ -129,15 +150,29 @@ RegionCompetitionImageFilter<TInputImage,TOutputImage>
   this->m_TotalNumberOfPixelsChanged = 0;
   this->m_NumberOfPixelsChangedInLastIteration = 0;
 
+  this->UpdateProgress( 0.0f );
+
   while( this->m_CurrentIterationNumber < this->m_MaximumNumberOfIterations )
     {
     this->VisitAllSeedsAndTransitionTheirState();
     this->m_CurrentIterationNumber++;
+
+    this->UpdateProgress( static_cast< float >( this->m_CurrentIterationNumber ) /
+                          this->m_MaximumNumberOfIterations );
+    this->InvokeEvent( IterationEvent() );
+
     if( this->m_NumberOfPixelsChangedInLastIteration ==  0 )
       {
       break;
       }
+
+    if( this->IsCancelled() )
+      {
+      return;
+      }
     }
+
+  this->UpdateProgress( 1.0f );
 }
 
 
@@ -154,10 +189,10 @@ RegionCompetitionImageFilter<TInputImage,TOutputImage>
   this->m_OutputImage->Allocate();
   this->m_OutputImage->FillBuffer( 0 );
 
-  this->m_SeedsMask = SeedMaskImageType::New();
-  this->m_SeedsMask->SetRegions( region );
-  this->m_SeedsMask->Allocate();
-  this->m_SeedsMask->FillBuffer( 0 );
+  this->m_ClaimsImage = OutputImageType::New();
+  this->m_ClaimsImage->SetRegions( region );
+  ImageBufferPool::Allocate( this->m_ClaimsImage.GetPointer(), this->m_BufferPool );
+  this->m_ClaimsImage->FillBuffer( 0 );
 }
 
 
@@ -166,23 +201,37 @@ void
 RegionCompetitionImageFilter<TInputImage,TOutputImage>
 ::ComputeNumberOfInputLabels()
 {
+  //
+  // The largest label of each region of the image is found on its own
+  // thread, then the largest of them.
+  //
+  OutputImagePixelType maximumLabel = 0;
+  std::mutex           maximumLabelMutex;
 
-  using IteratorType = itk::ImageRegionConstIterator< TOutputImage >;
-
-  IteratorType  itr( m_inputLabelsImage,m_inputLabelsImage->GetBufferedRegion() );
+  this->GetMultiThreader()->template ParallelizeImageRegion< OutputImageDimension >(
+    this->m_inputLabelsImage->GetBufferedRegion(),
+    [this, &maximumLabel, &maximumLabelMutex]( const OutputImageRegionType & region )
+      {
+      ImageRegionConstIterator< OutputImageType > itr( this->m_inputLabelsImage, region );
 
-  itr.GoToBegin();
+      OutputImagePixelType regionMaximumLabel = 0;
+      for( itr.GoToBegin(); !itr.IsAtEnd(); ++itr )
+        {
+        regionMaximumLabel = std::max( regionMaximumLabel, itr.Get() );
+        }
 
-  this->m_NumberOfLabels = 0;
+      std::lock_guard< std::mutex > lock( maximumLabelMutex );
+      maximumLabel = std::max( maximumLabel, regionMaximumLabel );
+      },
+    nullptr );
 
-  while( !itr.IsAtEnd() )
+  // The largest value marks the boundary in the image of the claims.
+  if( maximumLabel == NumericTraits< OutputImagePixelType >::max() )
     {
-    if( itr.Get() > this->m_NumberOfLabels )
-      {
-      this->m_NumberOfLabels = itr.Get();
-      }
-    ++itr;
+    itkExceptionMacro("The input labels can not use the largest value of the pixel type");
     }
+
+  this->m_NumberOfLabels = static_cast< unsigned int >( maximumLabel );
 }
 
 template <class TInputImage, class TOutputImage>
@@ -190,9 +239,14 @@ void
 RegionCompetitionImageFilter<TInputImage,TOutputImage>
 ::AllocateFrontsWorkingMemory()
 {
-  this->m_SeedArray1 = new SeedArrayType[ this->m_NumberOfLabels ];
-  this->m_SeedArray2 = new SeedArrayType[ this->m_NumberOfLabels ];
-  this->m_SeedsNewValues = new SeedNewValuesArrayType[ this->m_NumberOfLabels ];
+  this->m_SeedArray1.resize( this->m_NumberOfLabels );
+  this->m_SeedArray2.resize( this->m_NumberOfLabels );
+
+  for( unsigned int lb = 0; lb < this->m_NumberOfLabels; lb++ )
+    {
+    this->m_SeedArray1[lb].clear();
+    this->m_SeedArray2[lb].clear();
+    }
 }
 
 template <class TInputImage, class TOutputImage>
@@ -216,7 +270,6 @@ RegionCompetitionImageFilter<TInputImage,TOutputImage>
 
   ConstNeighborhoodIterator< TOutputImage >   bit;
   ImageRegionIterator< TOutputImage >        itr;
-  ImageRegionIterator< SeedMaskImageType >      mtr;
 
   InputSizeType radius;
   radius.Fill( 1 );
@@ -234,72 +287,102 @@ RegionCompetitionImageFilter<TInputImage,TOutputImage>
 
   this->m_InternalRegion = *fit;
 
-  // Mark all the pixels in the boundary of the seed image as visited
-  using ExclusionIteratorType = itk::ImageRegionExclusionIteratorWithIndex< SeedMaskImageType >;
+  // Mark all the pixels in the boundary as never to be claimed
+  using ExclusionIteratorType = itk::ImageRegionExclusionIteratorWithIndex< OutputImageType >;
 
-  ExclusionIteratorType exIt( this->m_SeedsMask, region );
+  ExclusionIteratorType exIt( this->m_ClaimsImage, region );
 
   exIt.SetExclusionRegion( this->m_InternalRegion );
 
   exIt.GoToBegin();
 
+  const OutputImagePixelType boundaryClaim = NumericTraits< OutputImagePixelType >::max();
+
   while( !exIt.IsAtEnd() )
     {
-    exIt.Set( 255 );
+    exIt.Set( boundaryClaim );
     ++exIt;
     }
 
   bit = ConstNeighborhoodIterator<TOutputImage>( radius, m_inputLabelsImage, this->m_InternalRegion );
   itr  = ImageRegionIterator<TOutputImage>(    this->m_OutputImage, this->m_InternalRegion );
-  mtr  = ImageRegionIterator<SeedMaskImageType>(  this->m_SeedsMask,   this->m_InternalRegion );
 
   bit.GoToBegin();
   itr.GoToBegin();
-  mtr.GoToBegin();
 
   unsigned int neighborhoodSize = bit.Size();
 
   constexpr OutputImagePixelType backgroundValue  = 0;  // no-label value.
 
-  for( unsigned int lb = 0; lb < this->m_NumberOfLabels; lb++ )
-    {
-    this->m_SeedArray1[ lb ].clear();
-    this->m_SeedsNewValues[ lb ].clear();
-    }
-
-
   while ( ! bit.IsAtEnd() )
     {
     if( bit.GetCenterPixel() != backgroundValue )
       {
       itr.Set( bit.GetCenterPixel() );
-      mtr.Set( 255 );
       }
     else
       {
       itr.Set( backgroundValue );
-      mtr.Set( 0 );
 
-      // Search for foreground pixels in the neighborhood
+      // The pixel goes to the front of the lowest label in its neighborhood,
+      // as it would if the labels were competing for it.
+      OutputImagePixelType lowestLabel = backgroundValue;
       for (unsigned int i = 0; i < neighborhoodSize; ++i)
         {
         OutputImagePixelType value = bit.GetPixel(i);
-        if( value != backgroundValue )
+        if( value != backgroundValue && ( lowestLabel == backgroundValue || value < lowestLabel ) )
           {
-          this->m_SeedArray1[value-1].push_back( bit.GetIndex() );
-          break;
+          lowestLabel = value;
           }
         }
+
+      if( lowestLabel != backgroundValue )
+        {
+        this->m_SeedArray1[lowestLabel-1].push_back( this->m_OutputImage->ComputeOffset( bit.GetIndex() ) );
+        }
       }
     ++bit;
     ++itr;
-    ++mtr;
     }
+}
 
 
+template <class TInputImage, class TOutputImage>
+void
+RegionCompetitionImageFilter<TInputImage,TOutputImage>
+::ComputeSeedRanges()
+{
+  //
+  // Split the fronts in contiguous ranges of about the same size, one per
+  // work unit, unless the fronts are too small to be worth it. A range
+  // never spans two fronts.
+  //
+  SizeValueType numberOfSeeds = 0;
+  for( const SeedArrayType & front : this->m_SeedArray1 )
+    {
+    numberOfSeeds += front.size();
+    }
+
+  const SizeValueType numberOfWorkUnits = std::max< SizeValueType >( 1, this->GetNumberOfWorkUnits() );
+  const SizeValueType minimumRangeSize = MinimumNumberOfSeedsPerWorkUnit;
+  const SizeValueType rangeSize = std::max( minimumRangeSize,
+    ( numberOfSeeds + numberOfWorkUnits - 1 ) / numberOfWorkUnits );
+
+  this->m_SeedRanges.clear();
+
   for( unsigned int lb = 0; lb < this->m_NumberOfLabels; lb++ )
     {
-    this->m_SeedsNewValues[lb].reserve( this->m_SeedArray1[lb].size() );
+    const SizeValueType frontSize = this->m_SeedArray1[lb].size();
+    const SizeValueType numberOfRanges = ( frontSize + rangeSize - 1 ) / rangeSize;
+
+    for( SizeValueType rangeId = 0; rangeId < numberOfRanges; rangeId++ )
+      {
+      SeedRangeType range;
+      range.Label = lb + 1;
+      range.Begin = frontSize * rangeId / numberOfRanges;
+      range.End = frontSize * ( rangeId + 1 ) / numberOfRanges;
+      this->m_SeedRanges.push_back( range );
+      }
     }
 }
 
@@ -309,47 +392,51 @@ void
 RegionCompetitionImageFilter<TInputImage,TOutputImage>
 ::VisitAllSeedsAndTransitionTheirState()
 {
-  for( unsigned int lb = 0; lb < this->m_NumberOfLabels; lb++ )
-    {
-    using SeedIterator = typename SeedArrayType::const_iterator;
-
-    SeedIterator seedItr = this->m_SeedArray1[lb].begin();
+  this->ComputeSeedRanges();
 
-    this->m_NumberOfPixelsChangedInLastIteration = 0;
+  const SizeValueType numberOfRanges = this->m_SeedRanges.size();
 
-    // Clear the array of new values
-    this->m_SeedsNewValues[lb].clear();
+  this->m_SeedVisitBuffers.resize( numberOfRanges );
 
-    while( seedItr != this->m_SeedArray1[lb].end() )
+  //
+  // The seeds of the fronts were resolved in the previous merge, all of
+  // them are labeled. The output image is only read while the fronts are
+  // visited, and written once all of them have been visited.
+  //
+  auto visitRange = [this]( SizeValueType rangeId )
+    {
+    if( !this->IsCancelled() )
       {
-      this->SetCurrentPixelIndex( *seedItr );
-
-      if( this->TestForAvailabilityAtCurrentPixel() )
-        {
-        this->m_SeedsNewValues[lb].push_back( 255 ); // FIXME: Use label value here
-        this->PutCurrentPixelNeighborsIntoSeedArray();
-        this->m_NumberOfPixelsChangedInLastIteration++;
-        }
-      else
-        {
-        this->m_SeedsNewValues[lb].push_back( 0 ); // FIXME: Use No-label value here
-        // Keep the seed to try again in the next iteration.
-        this->m_SeedArray2->push_back( this->GetCurrentPixelIndex() );
-        }
-
-      ++seedItr;
+      this->VisitSeedsInRange( this->m_SeedRanges[rangeId], this->m_SeedVisitBuffers[rangeId] );
       }
+    };
 
-    this->PasteNewSeedValuesToOutputImage();
-
-    this->m_TotalNumberOfPixelsChanged += this->m_NumberOfPixelsChangedInLastIteration;
+  auto pasteRange = [this]( SizeValueType rangeId )
+    {
+    this->PasteSeedsInRange( this->m_SeedRanges[rangeId] );
+    };
 
-    // Now that the values have been copied to the output image, we can empty the
-    // array in preparation for the next iteration
-    this->m_SeedsNewValues[lb].clear();
+  if( numberOfRanges > 1 )
+    {
+    this->GetMultiThreader()->ParallelizeArray( 0, numberOfRanges, visitRange, nullptr );
+    this->GetMultiThreader()->ParallelizeArray( 0, numberOfRanges, pasteRange, nullptr );
+    }
+  else if( numberOfRanges == 1 )
+    {
+    visitRange( 0 );
+    pasteRange( 0 );
+    }
 
+  this->m_NumberOfPixelsChangedInLastIteration = 0;
+  for( const SeedArrayType & front : this->m_SeedArray1 )
+    {
+    this->m_NumberOfPixelsChangedInLastIteration += front.size();
     }
 
+  this->m_TotalNumberOfPixelsChanged += this->m_NumberOfPixelsChangedInLastIteration;
+
+  this->MergeSeedVisitBuffers();
+
   this->SwapSeedArrays();
   this->ClearSecondSeedArray();
 }
@@ -358,115 +445,144 @@ RegionCompetitionImageFilter<TInputImage,TOutputImage>
 template <class TInputImage, class TOutputImage>
 void
 RegionCompetitionImageFilter<TInputImage,TOutputImage>
-::PasteNewSeedValuesToOutputImage()
+::VisitSeedsInRange( const SeedRangeType & range, SeedVisitBufferType & buffer ) const
 {
-  //
-  // For each one of the label values
-  //
-  for( unsigned int lb = 0; lb < this->m_NumberOfLabels; lb++ )
-    {
-    //
-    //  Paste new values into the output image
-    //
-    using SeedIterator = typename SeedArrayType::const_iterator;
+  buffer.Seeds.clear();
+  buffer.Labels.clear();
 
-    SeedIterator seedItr = this->m_SeedArray1[lb].begin();
+  const OutputImagePixelType * output = this->m_OutputImage->GetBufferPointer();
+  const OutputImagePixelType * claims = this->m_ClaimsImage->GetBufferPointer();
 
-    using SeedsNewValuesIterator = typename SeedNewValuesArrayType::const_iterator;
+  constexpr OutputImagePixelType backgroundValue  = 0;  // no-label value.
+
+  const OutputImagePixelType boundaryClaim = NumericTraits< OutputImagePixelType >::max();
+
+  const auto label = static_cast< OutputImagePixelType >( range.Label );
 
-    SeedsNewValuesIterator newValueItr = this->m_SeedsNewValues[lb].begin();
+  const SeedArrayType & front = this->m_SeedArray1[range.Label - 1];
 
-    while (seedItr != this->m_SeedArray1[lb].end() )
+  for( SizeValueType seedId = range.Begin; seedId < range.End; ++seedId )
+    {
+    if( ( seedId - range.Begin ) % CancellationToken::PollingInterval == 0 && this->IsCancelled() )
       {
-      this->m_OutputImage->SetPixel( *seedItr, *newValueItr );
-      ++seedItr;
-      ++newValueItr;
+      return;
+      }
+
+    const OffsetValueType offset = front[seedId];
+
+    //
+    // Unlabeled neighbors are reached by the front. The ones that are
+    // labeled in this iteration are discarded when the buffers are merged.
+    //
+    for( const OffsetValueType neighborOffset : this->m_NeighborBufferOffset )
+      {
+      const OffsetValueType neighbor = offset + neighborOffset;
+      if( output[neighbor] == backgroundValue && claims[neighbor] != boundaryClaim && neighborOffset != 0 )
+        {
+        buffer.Seeds.push_back( neighbor );
+        buffer.Labels.push_back( label );
+        }
       }
     }
 }
 
+
 template <class TInputImage, class TOutputImage>
 void
 RegionCompetitionImageFilter<TInputImage,TOutputImage>
-::SwapSeedArrays()
+::PasteSeedsInRange( const SeedRangeType & range )
 {
-  SeedArrayType * temporary = this->m_SeedArray1;
-  this->m_SeedArray1 = this->m_SeedArray2;
-  this->m_SeedArray2 = temporary;
-}
+  //
+  //  Paste new values into the output image. The fronts do not share any
+  //  pixel, so the ranges can be pasted concurrently.
+  //
+  OutputImagePixelType * output = this->m_OutputImage->GetBufferPointer();
 
+  const auto label = static_cast< OutputImagePixelType >( range.Label );
 
-template <class TInputImage, class TOutputImage>
-void
-RegionCompetitionImageFilter<TInputImage,TOutputImage>
-::ClearSecondSeedArray()
-{
-  if( this->m_SeedArray2 )
+  const SeedArrayType & front = this->m_SeedArray1[range.Label - 1];
+
+  for( SizeValueType seedId = range.Begin; seedId < range.End; ++seedId )
     {
-    delete [] this->m_SeedArray2;
+    output[ front[seedId] ] = label;
     }
-  this->m_SeedArray2 = new SeedArrayType[ this->m_NumberOfLabels ];
-}
-
-
-template <class TInputImage, class TOutputImage>
-bool
-RegionCompetitionImageFilter<TInputImage,TOutputImage>
-::TestForAvailabilityAtCurrentPixel() const
-{
-  return true; // FIXME
 }
 
 
 template <class TInputImage, class TOutputImage>
 void
 RegionCompetitionImageFilter<TInputImage,TOutputImage>
-::PutCurrentPixelNeighborsIntoSeedArray()
+::MergeSeedVisitBuffers()
 {
   //
-  // Find the location of the current pixel in the image memory buffer
+  // A pixel reached by several fronts goes to the lowest of their labels.
+  // The buffers are visited in the order of the ranges, so the next fronts
+  // hold the same pixels, in the same order, whatever the number of
+  // threads.
   //
-  const OffsetValueType pixelOffset = this->m_OutputImage->ComputeOffset( this->GetCurrentPixelIndex() );
-
-  const OutputImagePixelType * buffer = this->m_OutputImage->GetBufferPointer();
-
-  const OutputImagePixelType * currentPixelPointer = buffer + pixelOffset;
-
+  const OutputImagePixelType * output = this->m_OutputImage->GetBufferPointer();
+  OutputImagePixelType * claims = this->m_ClaimsImage->GetBufferPointer();
 
-  const unsigned int neighborhoodSize = this->m_Neighborhood.Size();
-
-  //
-  // Visit the offset of each neighbor in Index as well as buffer space
-  // and if they are backgroundValue then insert them as new seeds
-  //
-  using NeighborOffsetType = typename NeighborhoodType::OffsetType;
-
-  using NeigborOffsetIterator = typename NeighborOffsetArrayType::const_iterator;
-
-  NeigborOffsetIterator neighborItr = this->m_NeighborBufferOffset.begin();
+  constexpr OutputImagePixelType backgroundValue  = 0;  // no-label value.
 
-  constexpr OutputImagePixelType backgroundValue  = 0;  // FIXME: replace with NO-Label.
+  this->m_ClaimedSeeds.clear();
 
-  for( unsigned int i = 0; i < neighborhoodSize; ++i, ++neighborItr )
+  for( SeedVisitBufferType & buffer : this->m_SeedVisitBuffers )
     {
-    const OutputImagePixelType * neighborPixelPointer = currentPixelPointer + *neighborItr;
+    const SizeValueType numberOfSeeds = buffer.Seeds.size();
 
-    if( *neighborPixelPointer == backgroundValue )
+    for( SizeValueType seedId = 0; seedId < numberOfSeeds; ++seedId )
       {
-      NeighborOffsetType neighborOffset = this->m_Neighborhood.GetOffset(i);
-      IndexType neighborIndex = this->GetCurrentPixelIndex() + neighborOffset;
+      const OffsetValueType offset = buffer.Seeds[seedId];
+      const OutputImagePixelType label = buffer.Labels[seedId];
 
-      //if( this->m_InternalRegion.IsInside( neighborIndex ) )
+      if( output[offset] != backgroundValue )
         {
-        if( this->m_SeedsMask->GetPixel( neighborIndex ) == 0 )
-          {
-          this->m_SeedArray2->push_back( neighborIndex );
-          this->m_SeedsMask->SetPixel( neighborIndex, 255 );
-          }
+        continue;
+        }
+
+      if( claims[offset] == backgroundValue )
+        {
+        claims[offset] = label;
+        this->m_ClaimedSeeds.push_back( offset );
+        }
+      else if( label < claims[offset] )
+        {
+        claims[offset] = label;
         }
       }
+
+    buffer.Seeds.clear();
+    buffer.Labels.clear();
+    }
+
+  for( const OffsetValueType offset : this->m_ClaimedSeeds )
+    {
+    this->m_SeedArray2[ claims[offset] - 1 ].push_back( offset );
+    claims[offset] = backgroundValue;
     }
+}
+
 
+template <class TInputImage, class TOutputImage>
+void
+RegionCompetitionImageFilter<TInputImage,TOutputImage>
+::SwapSeedArrays()
+{
+  this->m_SeedArray1.swap( this->m_SeedArray2 );
+}
+
+
+template <class TInputImage, class TOutputImage>
+void
+RegionCompetitionImageFilter<TInputImage,TOutputImage>
+::ClearSecondSeedArray()
+{
+  // Keeps the capacity of the fronts for the next iteration.
+  for( SeedArrayType & front : this->m_SeedArray2 )
+    {
+    front.clear();
+    }
 }
 
 
@@ -479,7 +595,7 @@ RegionCompetitionImageFilter<TInputImage,TOutputImage>
   // Copy the offsets from the Input image.
   // We assume that they are the same for the output image.
   //
-  const size_t sizeOfOffsetTableInBytes = (InputImageDimension+1)*sizeof(unsigned long);
+  const size_t sizeOfOffsetTableInBytes = (InputImageDimension+1)*sizeof(OffsetValueType);
 
   memcpy( this->m_OffsetTable, this->m_OutputImage->GetOffsetTable(), sizeOfOffsetTableInBytes );
 
@@ -502,7 +618,7 @@ RegionCompetitionImageFilter<TInputImage,TOutputImage>
     {
     NeighborOffsetType offset = this->m_Neighborhood.GetOffset(i);
 
-    signed int bufferOffset = 0; // must be a signed number
+    OffsetValueType bufferOffset = 0; // must be a signed number
 
     for( unsigned int d = 0; d < InputImageDimension; d++ )
       {
@@ -21,6 +21,7 @@
 #include "itkImage.h"
 #include "itkImageSpatialObject.h"
 #include "itkHessianRecursiveGaussianImageFilter.h"
+#include "itkHessianImageProvider.h"
 #include "itkSymmetricSecondRankTensor.h"
 #include "itkSymmetricEigenAnalysisImageFilter.h"
 #include "itkLocalStructureImageFilter.h"
@@ -89,6 +90,15 @@ public:
   itkSetMacro( Gamma, double );
   itkGetMacro( Gamma, double );
 
+  /** Type of the object that shares Hessian computations among generators. */
+  using HessianProviderType = HessianImageProvider< NDimension >;
+
+  /** Optional provider from which the Hessian is taken instead of being
+   * computed internally. Generators attached to the same provider, and
+   * configured with the same sigma on the same input, share one Hessian. */
+  itkSetObjectMacro( HessianProvider, HessianProviderType );
+  itkGetModifiableObjectMacro( HessianProvider, HessianProviderType );
+
 protected:
   SatoLocalStructureFeatureGenerator();
   ~SatoLocalStructureFeatureGenerator() override;
@@ -122,6 +132,8 @@ private:
   typename EigenAnalysisFilterType::Pointer       m_EigenAnalysisFilter;
   typename LocalStructureFilterType::Pointer      m_LocalStructureFilter;
 
+  typename HessianProviderType::Pointer           m_HessianProvider;
+
   double      m_Sigma;
   double      m_Alpha;
   double      m_Gamma;
@@ -110,9 +110,17 @@ SatoLocalStructureFeatureGenerator<NDimension>
     itkExceptionMacro("Missing input image");
     }
 
-  this->m_HessianFilter->SetInput( inputImage );
-  this->m_EigenAnalysisFilter->SetInput( this->m_HessianFilter->GetOutput() );
-  this->m_LocalStructureFilter->SetInput( this->m_EigenAnalysisFilter->GetOutput() );
+  if( this->m_HessianProvider )
+    {
+    this->m_LocalStructureFilter->SetInput(
+      this->m_HessianProvider->GetEigenValues( inputImage, this->m_Sigma ) );
+    }
+  else
+    {
+    this->m_HessianFilter->SetInput( inputImage );
+    this->m_EigenAnalysisFilter->SetInput( this->m_HessianFilter->GetOutput() );
+    this->m_LocalStructureFilter->SetInput( this->m_EigenAnalysisFilter->GetOutput() );
+    }
 
   this->m_HessianFilter->SetSigma( this->m_Sigma );
   this->m_EigenAnalysisFilter->SetDimension( Dimension );
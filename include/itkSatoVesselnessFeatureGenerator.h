@@ -22,6 +22,7 @@
 #include "itkImageSpatialObject.h"
 #include "itkHessian3DToVesselnessMeasureImageFilter.h"
 #include "itkHessianRecursiveGaussianImageFilter.h"
+#include "itkHessianImageProvider.h"
 #include "itkSymmetricSecondRankTensor.h"
 #include "itkVesselEnhancingDiffusion3DImageFilter.h"
 
@@ -96,6 +97,21 @@ public:
   itkGetMacro( UseVesselEnhancingDiffusion, bool );
   itkBooleanMacro( UseVesselEnhancingDiffusion );
 
+  /** Type of the object that shares Hessian computations among generators. */
+  using HessianProviderType = HessianImageProvider< NDimension >;
+
+  /** Optional provider from which the Hessian is taken instead of being
+   * computed internally. Generators attached to the same provider, and
+   * configured with the same sigma on the same input, share one Hessian. */
+  itkSetObjectMacro( HessianProvider, HessianProviderType );
+  itkGetModifiableObjectMacro( HessianProvider, HessianProviderType );
+
+  /** The Hessian only needs a few sigmas of input around a tile, the vessel
+   * enhancing diffusion on the other hand spreads over the whole input, and
+   * disables tiling. */
+  bool GetSupportsTiling() const override;
+  double GetTileHaloRadius() const override;
+
 protected:
   SatoVesselnessFeatureGenerator();
   ~SatoVesselnessFeatureGenerator() override;
@@ -105,6 +121,15 @@ protected:
    * the segmentation. */
   void  GenerateData () override;
 
+  /** Parameters that identify the feature in a FeatureCache. */
+  bool GetFeatureCacheParameters( std::ostream & os ) const override;
+
+  /** Copy of the generator with the same parameters, from which the
+   * aggregators compute the vesselness one tile at a time. The Hessian
+   * provider is not shared with the copy, every tile would otherwise leave
+   * an entry in its cache that is never reused. */
+  LightObject::Pointer InternalClone() const override;
+
 private:
   using InternalPixelType = float;
   using InternalImageType = Image< InternalPixelType, Dimension >;
@@ -122,6 +147,8 @@ private:
   typename VesselnessMeasureFilterType::Pointer           m_VesselnessFilter;
   typename VesselEnhancingDiffusionFilterType::Pointer    m_VesselEnhancingDiffusionFilter;
 
+  typename HessianProviderType::Pointer           m_HessianProvider;
+
   double      m_Sigma;
   double      m_Alpha1;
   double      m_Alpha2;
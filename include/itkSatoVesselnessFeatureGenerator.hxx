@@ -133,6 +133,11 @@ SatoVesselnessFeatureGenerator<NDimension>
   //   Input -> VED -> Sato
   //   Input -> Hessian -> Sato
   //
+  // where the Hessian may be taken from a shared provider.
+  //
+  const InputImageType * hessianInputImage = inputImage;
+  double hessianAndVesselnessWeight = 1.0;
+
   if (this->m_UseVesselEnhancingDiffusion)
     {
     // Set the default scales for the vessel enhancing diffusion filter.
@@ -157,19 +162,36 @@ SatoVesselnessFeatureGenerator<NDimension>
     this->m_VesselEnhancingDiffusionFilter->SetScales(scales);
 
     this->m_VesselEnhancingDiffusionFilter->SetInput( inputImage );
-    this->m_HessianFilter->SetInput( m_VesselEnhancingDiffusionFilter->GetOutput() );
-    this->m_VesselnessFilter->SetInput( this->m_HessianFilter->GetOutput() );
-
     progress->RegisterInternalFilter( this->m_VesselEnhancingDiffusionFilter, .8 );
-    progress->RegisterInternalFilter( this->m_HessianFilter, .1 );
-    progress->RegisterInternalFilter( this->m_VesselnessFilter, .1 );
+
+    hessianInputImage = this->m_VesselEnhancingDiffusionFilter->GetOutput();
+    hessianAndVesselnessWeight = .2;
+    }
+
+  if( this->m_HessianProvider )
+    {
+    if (this->m_UseVesselEnhancingDiffusion)
+      {
+      this->m_VesselEnhancingDiffusionFilter->Update();
+      }
+    this->m_VesselnessFilter->SetInput(
+      this->m_HessianProvider->GetHessian( hessianInputImage, this->m_Sigma ) );
+    progress->RegisterInternalFilter( this->m_VesselnessFilter, hessianAndVesselnessWeight );
     }
   else
     {
-    this->m_HessianFilter->SetInput( inputImage );
+    this->m_HessianFilter->SetInput( hessianInputImage );
     this->m_VesselnessFilter->SetInput( this->m_HessianFilter->GetOutput() );
-    progress->RegisterInternalFilter( this->m_HessianFilter, .7 );
-    progress->RegisterInternalFilter( this->m_VesselnessFilter, .3 );
+    if (this->m_UseVesselEnhancingDiffusion)
+      {
+      progress->RegisterInternalFilter( this->m_HessianFilter, .1 );
+      progress->RegisterInternalFilter( this->m_VesselnessFilter, .1 );
+      }
+    else
+      {
+      progress->RegisterInternalFilter( this->m_HessianFilter, .7 );
+      progress->RegisterInternalFilter( this->m_VesselnessFilter, .3 );
+      }
     }
 
   this->m_HessianFilter->SetSigma( this->m_Sigma );
@@ -187,6 +209,59 @@ SatoVesselnessFeatureGenerator<NDimension>
   outputObject->SetImage( outputImage );
 }
 
+
+template <unsigned int NDimension>
+LightObject::Pointer
+SatoVesselnessFeatureGenerator<NDimension>
+::InternalClone() const
+{
+  LightObject::Pointer loPtr = Superclass::InternalClone();
+
+  auto * clone = dynamic_cast< Self * >( loPtr.GetPointer() );
+  if( clone == nullptr )
+    {
+    itkExceptionMacro("Downcast to type " << this->GetNameOfClass() << " failed");
+    }
+
+  clone->m_Sigma = this->m_Sigma;
+  clone->m_Alpha1 = this->m_Alpha1;
+  clone->m_Alpha2 = this->m_Alpha2;
+  clone->m_UseVesselEnhancingDiffusion = this->m_UseVesselEnhancingDiffusion;
+
+  return loPtr;
+}
+
+
+template <unsigned int NDimension>
+bool
+SatoVesselnessFeatureGenerator<NDimension>
+::GetFeatureCacheParameters( std::ostream & os ) const
+{
+  os << " Sigma " << this->m_Sigma;
+  os << " Alpha1 " << this->m_Alpha1 << " Alpha2 " << this->m_Alpha2;
+  os << " UseVesselEnhancingDiffusion " << this->m_UseVesselEnhancingDiffusion;
+  return true;
+}
+
+
+template <unsigned int NDimension>
+bool
+SatoVesselnessFeatureGenerator<NDimension>
+::GetSupportsTiling() const
+{
+  return !this->m_UseVesselEnhancingDiffusion;
+}
+
+
+template <unsigned int NDimension>
+double
+SatoVesselnessFeatureGenerator<NDimension>
+::GetTileHaloRadius() const
+{
+  // The recursive Gaussian has a negligible response beyond four sigmas.
+  return 4.0 * this->m_Sigma;
+}
+
 } // end namespace itk
 
 #endif
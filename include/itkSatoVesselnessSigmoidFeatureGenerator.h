@@ -77,6 +77,12 @@ protected:
    * the segmentation. */
   void  GenerateData () override;
 
+  /** Parameters that identify the feature in a FeatureCache. */
+  bool GetFeatureCacheParameters( std::ostream & os ) const override;
+
+  /** The copy carries the sigmoid parameters as well. */
+  LightObject::Pointer InternalClone() const override;
+
 private:
   using InternalPixelType = float;
   using InternalImageType = Image< InternalPixelType, Dimension >;
@@ -106,6 +106,37 @@ SatoVesselnessSigmoidFeatureGenerator<NDimension>
   outputObject->SetImage( outputImage );
 }
 
+
+template <unsigned int NDimension>
+LightObject::Pointer
+SatoVesselnessSigmoidFeatureGenerator<NDimension>
+::InternalClone() const
+{
+  LightObject::Pointer loPtr = Superclass::InternalClone();
+
+  auto * clone = dynamic_cast< Self * >( loPtr.GetPointer() );
+  if( clone == nullptr )
+    {
+    itkExceptionMacro("Downcast to type " << this->GetNameOfClass() << " failed");
+    }
+
+  clone->m_SigmoidAlpha = this->m_SigmoidAlpha;
+  clone->m_SigmoidBeta = this->m_SigmoidBeta;
+
+  return loPtr;
+}
+
+
+template <unsigned int NDimension>
+bool
+SatoVesselnessSigmoidFeatureGenerator<NDimension>
+::GetFeatureCacheParameters( std::ostream & os ) const
+{
+  this->Superclass::GetFeatureCacheParameters( os );
+  os << " SigmoidAlpha " << this->m_SigmoidAlpha << " SigmoidBeta " << this->m_SigmoidBeta;
+  return true;
+}
+
 } // end namespace itk
 
 #endif
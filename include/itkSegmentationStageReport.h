@@ -0,0 +1,190 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkSegmentationStageReport.h
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkSegmentationStageReport_h
+#define itkSegmentationStageReport_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkProcessObject.h"
+#include "itkCommand.h"
+
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace itk
+{
+
+/** \class SegmentationStageReport
+ * \brief Time and memory used by every stage of a segmentation pipeline.
+ *
+ * The report observes the start and end events of the process objects it
+ * is given, feature generators, filters and segmentation modules alike, and
+ * records for each execution of a stage:
+ *
+ * - the wall clock time,
+ * - the CPU time of the whole process, which includes the work of the other
+ *   stages running concurrently, if any,
+ * - the increase of the peak resident set size of the process, that is the
+ *   memory the stage needed beyond what the process had used so far,
+ * - the number of voxels of its output image.
+ *
+ * A stage may be declared as the parent of other stages that it executes,
+ * as an aggregator executes its feature generators. Its exclusive wall time
+ * is then its wall time minus the time during which any of its children
+ * was running.
+ *
+ * Observing costs two events per stage execution, and nothing when no
+ * report is attached. Defining LSTK_DISABLE_INSTRUMENTATION at compile time
+ * turns Observe() into a no-op, so that no probe is installed at all.
+ *
+ * \ingroup LesionSizingToolkit
+ */
+template <unsigned int NDimension>
+class ITK_EXPORT SegmentationStageReport : public Object
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(SegmentationStageReport);
+
+  /** Standard class type alias. */
+  using Self = SegmentationStageReport;
+  using Superclass = Object;
+  using Pointer = SmartPointer<Self>;
+  using ConstPointer = SmartPointer<const Self>;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(SegmentationStageReport, Object);
+
+  /** Dimension of the space */
+  static constexpr unsigned int Dimension = NDimension;
+
+  /** Measurements of one stage. Times are in seconds and sizes in bytes.
+   * When a stage executes several times, its measurements are summed and
+   * its number of voxels is the one of the last execution. */
+  struct StageType
+    {
+    std::string       Name;
+    std::string       ParentName;
+    unsigned int      NumberOfExecutions{ 0 };
+    double            WallTime{ 0.0 };
+    double            ExclusiveWallTime{ 0.0 };
+    double            CPUTime{ 0.0 };
+    SizeValueType     PeakResidentSetSizeIncrease{ 0 };
+    SizeValueType     NumberOfVoxels{ 0 };
+    };
+
+  /** Record the executions of the stage under the given name. The parent,
+   * if any, must be observed as well. */
+  void Observe( ProcessObject * stage, const std::string & name, ProcessObject * parent = nullptr );
+
+  /** Stop observing all the stages. The measurements are kept. */
+  void StopObserving();
+
+  /** Forget the measurements, the stages remain observed. */
+  void Clear();
+
+  /** Stages that executed since the last Clear(), in the order in which
+   * they first started. */
+  unsigned int GetNumberOfStages() const;
+  StageType GetStage( unsigned int stageId ) const;
+
+  /** Measurements of the stage with the given name, or a default
+   * constructed stage, with no execution, if it did not execute. */
+  StageType GetStage( const std::string & name ) const;
+
+  /** Write the measurements as a JSON object holding an array of stages. */
+  void WriteJSON( std::ostream & os ) const;
+
+  /** Process wide measurements, exposed for other instrumentation.
+   * Return zero where the platform does not provide them. */
+  static double GetProcessCPUTime();
+  static SizeValueType GetProcessPeakResidentSetSize();
+
+protected:
+  SegmentationStageReport();
+  ~SegmentationStageReport() override;
+  void PrintSelf(std::ostream& os, Indent indent) const override;
+
+private:
+  using ClockType = std::chrono::steady_clock;
+  using TimePointType = ClockType::time_point;
+
+  struct ObservedStageType
+    {
+    ProcessObject::Pointer  Stage;
+    std::string             Name;
+    ProcessObject *         Parent;
+    unsigned long           StartTag;
+    unsigned long           EndTag;
+    };
+
+  /** State of a stage between its start and end events. */
+  struct ExecutionType
+    {
+    const ProcessObject *   Stage;
+    TimePointType           StartTime;
+    double                  StartCPUTime;
+    SizeValueType           StartPeakResidentSetSize;
+    };
+
+  /** Interval during which a child stage ran, to compute the exclusive
+   * time of its parent. */
+  struct IntervalType
+    {
+    const ProcessObject *   Parent;
+    TimePointType           Start;
+    TimePointType           End;
+    };
+
+  void StartStage( Object * caller, const EventObject & event );
+  void EndStage( Object * caller, const EventObject & event );
+
+  const ObservedStageType * FindObservedStage( const Object * stage ) const;
+  StageType & FindOrAddStage( const ObservedStageType & observed );
+
+  /** Sum of the durations of the union of the intervals of the children of
+   * a stage, clipped to the given interval. */
+  double ComputeChildrenWallTime( const ProcessObject * parent, const TimePointType & start,
+    const TimePointType & end ) const;
+
+  static SizeValueType GetNumberOfOutputVoxels( const ProcessObject * stage );
+
+  using CommandType = MemberCommand< Self >;
+
+  typename CommandType::Pointer       m_StartCommand;
+  typename CommandType::Pointer       m_EndCommand;
+
+  std::vector< ObservedStageType >    m_ObservedStages;
+  std::vector< ExecutionType >        m_Executions;
+  std::vector< IntervalType >         m_Intervals;
+  std::vector< StageType >            m_Stages;
+
+  mutable std::mutex                  m_Mutex;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+# include "itkSegmentationStageReport.hxx"
+#endif
+
+#endif
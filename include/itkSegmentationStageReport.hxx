@@ -0,0 +1,475 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkSegmentationStageReport.hxx
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkSegmentationStageReport_hxx
+#define itkSegmentationStageReport_hxx
+
+#include "itkSegmentationStageReport.h"
+#include "itkImageBase.h"
+#include "itkImageSpatialObject.h"
+
+#if defined(_WIN32)
+# include "itkWindows.h"
+# include <psapi.h>
+#else
+# include <sys/resource.h>
+# include <sys/time.h>
+#endif
+
+#include <algorithm>
+#include <iomanip>
+
+namespace itk
+{
+
+/**
+ * Constructor
+ */
+template <unsigned int NDimension>
+SegmentationStageReport<NDimension>
+::SegmentationStageReport()
+{
+  this->m_StartCommand = CommandType::New();
+  this->m_StartCommand->SetCallbackFunction( this, &Self::StartStage );
+  this->m_EndCommand = CommandType::New();
+  this->m_EndCommand->SetCallbackFunction( this, &Self::EndStage );
+}
+
+
+/**
+ * Destructor
+ */
+template <unsigned int NDimension>
+SegmentationStageReport<NDimension>
+::~SegmentationStageReport()
+{
+  this->StopObserving();
+}
+
+
+template <unsigned int NDimension>
+void
+SegmentationStageReport<NDimension>
+::Observe( ProcessObject * stage, const std::string & name, ProcessObject * parent )
+{
+#ifdef LSTK_DISABLE_INSTRUMENTATION
+  (void)stage;
+  (void)name;
+  (void)parent;
+#else
+  if( stage == nullptr )
+    {
+    itkExceptionMacro( "Cannot observe a null stage" );
+    }
+
+  std::lock_guard< std::mutex > lock( this->m_Mutex );
+
+  if( this->FindObservedStage( stage ) )
+    {
+    itkExceptionMacro( "Stage " << name << " is already observed" );
+    }
+
+  ObservedStageType observed;
+  observed.Stage = stage;
+  observed.Name = name;
+  observed.Parent = parent;
+  observed.StartTag = stage->AddObserver( StartEvent(), this->m_StartCommand );
+  observed.EndTag = stage->AddObserver( EndEvent(), this->m_EndCommand );
+  this->m_ObservedStages.push_back( observed );
+#endif
+}
+
+
+template <unsigned int NDimension>
+void
+SegmentationStageReport<NDimension>
+::StopObserving()
+{
+  std::lock_guard< std::mutex > lock( this->m_Mutex );
+
+  for( auto & observed : this->m_ObservedStages )
+    {
+    observed.Stage->RemoveObserver( observed.StartTag );
+    observed.Stage->RemoveObserver( observed.EndTag );
+    }
+  this->m_ObservedStages.clear();
+  this->m_Executions.clear();
+}
+
+
+template <unsigned int NDimension>
+void
+SegmentationStageReport<NDimension>
+::Clear()
+{
+  std::lock_guard< std::mutex > lock( this->m_Mutex );
+
+  this->m_Stages.clear();
+  this->m_Intervals.clear();
+  this->Modified();
+}
+
+
+template <unsigned int NDimension>
+unsigned int
+SegmentationStageReport<NDimension>
+::GetNumberOfStages() const
+{
+  std::lock_guard< std::mutex > lock( this->m_Mutex );
+  return static_cast< unsigned int >( this->m_Stages.size() );
+}
+
+
+template <unsigned int NDimension>
+typename SegmentationStageReport<NDimension>::StageType
+SegmentationStageReport<NDimension>
+::GetStage( unsigned int stageId ) const
+{
+  std::lock_guard< std::mutex > lock( this->m_Mutex );
+
+  if( stageId >= this->m_Stages.size() )
+    {
+    itkExceptionMacro( "Stage " << stageId << " does not exist" );
+    }
+  return this->m_Stages[ stageId ];
+}
+
+
+template <unsigned int NDimension>
+typename SegmentationStageReport<NDimension>::StageType
+SegmentationStageReport<NDimension>
+::GetStage( const std::string & name ) const
+{
+  std::lock_guard< std::mutex > lock( this->m_Mutex );
+
+  for( const auto & stage : this->m_Stages )
+    {
+    if( stage.Name == name )
+      {
+      return stage;
+      }
+    }
+
+  StageType stage;
+  stage.Name = name;
+  return stage;
+}
+
+
+template <unsigned int NDimension>
+const typename SegmentationStageReport<NDimension>::ObservedStageType *
+SegmentationStageReport<NDimension>
+::FindObservedStage( const Object * stage ) const
+{
+  for( const auto & observed : this->m_ObservedStages )
+    {
+    if( observed.Stage.GetPointer() == stage )
+      {
+      return &observed;
+      }
+    }
+  return nullptr;
+}
+
+
+template <unsigned int NDimension>
+typename SegmentationStageReport<NDimension>::StageType &
+SegmentationStageReport<NDimension>
+::FindOrAddStage( const ObservedStageType & observed )
+{
+  for( auto & stage : this->m_Stages )
+    {
+    if( stage.Name == observed.Name )
+      {
+      return stage;
+      }
+    }
+
+  StageType stage;
+  stage.Name = observed.Name;
+  if( observed.Parent )
+    {
+    const ObservedStageType * parent = this->FindObservedStage( observed.Parent );
+    if( parent )
+      {
+      stage.ParentName = parent->Name;
+      }
+    }
+  this->m_Stages.push_back( stage );
+  return this->m_Stages.back();
+}
+
+
+template <unsigned int NDimension>
+void
+SegmentationStageReport<NDimension>
+::StartStage( Object * caller, const EventObject & )
+{
+  ExecutionType execution;
+  execution.Stage = dynamic_cast< const ProcessObject * >( caller );
+  execution.StartPeakResidentSetSize = Self::GetProcessPeakResidentSetSize();
+  execution.StartCPUTime = Self::GetProcessCPUTime();
+  execution.StartTime = ClockType::now();
+
+  std::lock_guard< std::mutex > lock( this->m_Mutex );
+  this->m_Executions.push_back( execution );
+}
+
+
+template <unsigned int NDimension>
+void
+SegmentationStageReport<NDimension>
+::EndStage( Object * caller, const EventObject & )
+{
+  const TimePointType endTime = ClockType::now();
+  const double endCPUTime = Self::GetProcessCPUTime();
+  const SizeValueType endPeakResidentSetSize = Self::GetProcessPeakResidentSetSize();
+
+  const auto * stage = dynamic_cast< const ProcessObject * >( caller );
+  const SizeValueType numberOfVoxels = Self::GetNumberOfOutputVoxels( stage );
+
+  std::lock_guard< std::mutex > lock( this->m_Mutex );
+
+  const ObservedStageType * observed = this->FindObservedStage( stage );
+
+  auto execution = std::find_if( this->m_Executions.rbegin(), this->m_Executions.rend(),
+    [stage]( const ExecutionType & e ) { return e.Stage == stage; } );
+
+  if( observed == nullptr || execution == this->m_Executions.rend() )
+    {
+    return;
+    }
+
+  const double wallTime = std::chrono::duration< double >( endTime - execution->StartTime ).count();
+
+  StageType & record = this->FindOrAddStage( *observed );
+  record.NumberOfExecutions++;
+  record.WallTime += wallTime;
+  record.ExclusiveWallTime += wallTime -
+    this->ComputeChildrenWallTime( stage, execution->StartTime, endTime );
+  record.CPUTime += endCPUTime - execution->StartCPUTime;
+  record.PeakResidentSetSizeIncrease += endPeakResidentSetSize - execution->StartPeakResidentSetSize;
+  record.NumberOfVoxels = numberOfVoxels;
+
+  if( observed->Parent )
+    {
+    IntervalType interval;
+    interval.Parent = observed->Parent;
+    interval.Start = execution->StartTime;
+    interval.End = endTime;
+    this->m_Intervals.push_back( interval );
+    }
+
+  this->m_Executions.erase( std::next( execution ).base() );
+}
+
+
+template <unsigned int NDimension>
+double
+SegmentationStageReport<NDimension>
+::ComputeChildrenWallTime( const ProcessObject * parent, const TimePointType & start,
+  const TimePointType & end ) const
+{
+  std::vector< std::pair< TimePointType, TimePointType > > intervals;
+  for( const auto & interval : this->m_Intervals )
+    {
+    if( interval.Parent == parent && interval.End > start && interval.Start < end )
+      {
+      intervals.emplace_back( std::max( interval.Start, start ), std::min( interval.End, end ) );
+      }
+    }
+
+  // Children running concurrently are only counted once.
+  std::sort( intervals.begin(), intervals.end() );
+
+  double childrenWallTime = 0.0;
+  TimePointType coveredUntil = start;
+  for( const auto & interval : intervals )
+    {
+    const TimePointType from = std::max( interval.first, coveredUntil );
+    if( interval.second > from )
+      {
+      childrenWallTime += std::chrono::duration< double >( interval.second - from ).count();
+      coveredUntil = interval.second;
+      }
+    }
+  return childrenWallTime;
+}
+
+
+template <unsigned int NDimension>
+SizeValueType
+SegmentationStageReport<NDimension>
+::GetNumberOfOutputVoxels( const ProcessObject * stage )
+{
+  if( stage == nullptr )
+    {
+    return 0;
+    }
+
+  const DataObject * output = stage->GetPrimaryOutput();
+
+  if( const auto * image = dynamic_cast< const ImageBase< NDimension > * >( output ) )
+    {
+    return image->GetBufferedRegion().GetNumberOfPixels();
+    }
+
+  using FeatureSpatialObjectType = ImageSpatialObject< NDimension, float >;
+  if( const auto * feature = dynamic_cast< const FeatureSpatialObjectType * >( output ) )
+    {
+    if( feature->GetImage() )
+      {
+      return feature->GetImage()->GetBufferedRegion().GetNumberOfPixels();
+      }
+    }
+
+  return 0;
+}
+
+
+template <unsigned int NDimension>
+double
+SegmentationStageReport<NDimension>
+::GetProcessCPUTime()
+{
+#if defined(_WIN32)
+  FILETIME creationTime, exitTime, kernelTime, userTime;
+  if( !GetProcessTimes( GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime ) )
+    {
+    return 0.0;
+    }
+  ULARGE_INTEGER kernel, user;
+  kernel.LowPart = kernelTime.dwLowDateTime;
+  kernel.HighPart = kernelTime.dwHighDateTime;
+  user.LowPart = userTime.dwLowDateTime;
+  user.HighPart = userTime.dwHighDateTime;
+  // Units of 100 ns.
+  return static_cast< double >( kernel.QuadPart + user.QuadPart ) * 1e-7;
+#else
+  struct rusage usage;
+  if( getrusage( RUSAGE_SELF, &usage ) != 0 )
+    {
+    return 0.0;
+    }
+  return static_cast< double >( usage.ru_utime.tv_sec + usage.ru_stime.tv_sec ) +
+         static_cast< double >( usage.ru_utime.tv_usec + usage.ru_stime.tv_usec ) * 1e-6;
+#endif
+}
+
+
+template <unsigned int NDimension>
+SizeValueType
+SegmentationStageReport<NDimension>
+::GetProcessPeakResidentSetSize()
+{
+#if defined(_WIN32)
+  PROCESS_MEMORY_COUNTERS counters;
+  if( !GetProcessMemoryInfo( GetCurrentProcess(), &counters, sizeof( counters ) ) )
+    {
+    return 0;
+    }
+  return static_cast< SizeValueType >( counters.PeakWorkingSetSize );
+#else
+  struct rusage usage;
+  if( getrusage( RUSAGE_SELF, &usage ) != 0 )
+    {
+    return 0;
+    }
+# if defined(__APPLE__)
+  // Bytes on macOS.
+  return static_cast< SizeValueType >( usage.ru_maxrss );
+# else
+  // Kilobytes on Linux and the BSDs.
+  return static_cast< SizeValueType >( usage.ru_maxrss ) * 1024;
+# endif
+#endif
+}
+
+
+template <unsigned int NDimension>
+void
+SegmentationStageReport<NDimension>
+::WriteJSON( std::ostream & os ) const
+{
+  std::lock_guard< std::mutex > lock( this->m_Mutex );
+
+  auto quote = []( const std::string & s )
+    {
+    std::string quoted = "\"";
+    for( const char c : s )
+      {
+      if( c == '"' || c == '\\' )
+        {
+        quoted += '\\';
+        }
+      quoted += c;
+      }
+    return quoted + "\"";
+    };
+
+  const std::streamsize precision = os.precision( 6 );
+  const std::ios_base::fmtflags flags = os.flags();
+  os << std::fixed;
+
+  os << "{" << std::endl;
+  os << "  \"Stages\": [";
+  for( size_t i = 0; i < this->m_Stages.size(); i++ )
+    {
+    const StageType & stage = this->m_Stages[i];
+    os << ( i ? "," : "" ) << std::endl;
+    os << "    {" << std::endl;
+    os << "      \"Name\": " << quote( stage.Name ) << "," << std::endl;
+    os << "      \"Parent\": " << quote( stage.ParentName ) << "," << std::endl;
+    os << "      \"NumberOfExecutions\": " << stage.NumberOfExecutions << "," << std::endl;
+    os << "      \"WallTime\": " << stage.WallTime << "," << std::endl;
+    os << "      \"ExclusiveWallTime\": " << stage.ExclusiveWallTime << "," << std::endl;
+    os << "      \"CPUTime\": " << stage.CPUTime << "," << std::endl;
+    os << "      \"PeakResidentSetSizeIncrease\": " << stage.PeakResidentSetSizeIncrease << "," << std::endl;
+    os << "      \"NumberOfVoxels\": " << stage.NumberOfVoxels << std::endl;
+    os << "    }";
+    }
+  os << std::endl << "  ]" << std::endl;
+  os << "}" << std::endl;
+
+  os.precision( precision );
+  os.flags( flags );
+}
+
+
+/**
+ * PrintSelf
+ */
+template <unsigned int NDimension>
+void
+SegmentationStageReport<NDimension>
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  std::lock_guard< std::mutex > lock( this->m_Mutex );
+  os << indent << "Number of observed stages: " << this->m_ObservedStages.size() << std::endl;
+  for( const auto & stage : this->m_Stages )
+    {
+    os << indent << stage.Name << ": " << stage.NumberOfExecutions << " executions, "
+       << stage.WallTime << " s wall (" << stage.ExclusiveWallTime << " s exclusive), "
+       << stage.CPUTime << " s CPU, " << stage.PeakResidentSetSizeIncrease << " bytes peak increase, "
+       << stage.NumberOfVoxels << " voxels" << std::endl;
+    }
+}
+
+} // end namespace itk
+
+#endif
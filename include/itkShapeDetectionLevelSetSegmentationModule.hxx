@@ -19,6 +19,7 @@
 
 #include "itkShapeDetectionLevelSetSegmentationModule.h"
 #include "itkShapeDetectionLevelSetImageFilter.h"
+#include "itkCancellationToken.h"
 
 
 namespace itk
@@ -84,7 +85,12 @@ ShapeDetectionLevelSetSegmentationModule<NDimension>
   std::cout << "Propagation Scaling = " << this->GetPropagationScaling() << std::endl;
   std::cout << "Curvature Scaling = " << this->GetCurvatureScaling() << std::endl;
 
-  filter->Update();
+  // the filter does not poll the cancellation token of
+  // the segmentation, it is aborted from its events
+    {
+    CancellationToken::AbortObserver abortObserver( CancellationToken::GetCurrent(), filter );
+    filter->Update();
+    }
 
   std::cout << "Max. no. iterations: " << filter->GetNumberOfIterations() << std::endl;
   std::cout << "Max. RMS error: " << filter->GetMaximumRMSError() << std::endl;
@@ -85,6 +85,10 @@ public:
   itkSetMacro( Beta, double );
   itkGetMacro( Beta, double );
 
+  /** The sigmoid is computed voxel by voxel, any tile can be computed on
+   * its own. */
+  bool GetSupportsTiling() const override;
+
 protected:
   SigmoidFeatureGenerator();
   ~SigmoidFeatureGenerator() override;
@@ -94,6 +98,13 @@ protected:
    * the segmentation. */
   void  GenerateData () override;
 
+  /** Parameters that identify the feature in a FeatureCache. */
+  bool GetFeatureCacheParameters( std::ostream & os ) const override;
+
+  /** Copy of the generator with the same parameters, from which the
+   * aggregators compute the feature one tile at a time. */
+  LightObject::Pointer InternalClone() const override;
+
 private:
   using OutputPixelType = float;
   using OutputImageType = Image< OutputPixelType, Dimension >;
@@ -130,6 +130,45 @@ SigmoidFeatureGenerator<NDimension>
   outputObject->SetImage( outputImage );
 }
 
+
+template <unsigned int NDimension>
+LightObject::Pointer
+SigmoidFeatureGenerator<NDimension>
+::InternalClone() const
+{
+  LightObject::Pointer loPtr = Superclass::InternalClone();
+
+  auto * clone = dynamic_cast< Self * >( loPtr.GetPointer() );
+  if( clone == nullptr )
+    {
+    itkExceptionMacro("Downcast to type " << this->GetNameOfClass() << " failed");
+    }
+
+  clone->m_Alpha = this->m_Alpha;
+  clone->m_Beta = this->m_Beta;
+
+  return loPtr;
+}
+
+
+template <unsigned int NDimension>
+bool
+SigmoidFeatureGenerator<NDimension>
+::GetFeatureCacheParameters( std::ostream & os ) const
+{
+  os << " Alpha " << this->m_Alpha << " Beta " << this->m_Beta;
+  return true;
+}
+
+
+template <unsigned int NDimension>
+bool
+SigmoidFeatureGenerator<NDimension>
+::GetSupportsTiling() const
+{
+  return true;
+}
+
 } // end namespace itk
 
 #endif
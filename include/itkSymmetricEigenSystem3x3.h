@@ -0,0 +1,85 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkSymmetricEigenSystem3x3.h
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkSymmetricEigenSystem3x3_h
+#define itkSymmetricEigenSystem3x3_h
+
+#include "itkIntTypes.h"
+
+namespace itk
+{
+
+/** \class SymmetricEigenSystem3x3
+ * \brief Closed form eigen-decomposition of symmetric 3x3 matrices.
+ *
+ * The eigenvalues are computed with the trigonometric solution of the
+ * characteristic polynomial (O. K. Smith, "Eigenvalues of a symmetric 3x3
+ * matrix", Communications of the ACM, 1961), and an eigenvector from the
+ * cross products of the rows of the shifted matrix. Neither allocates
+ * memory nor iterates, unlike vnl_symmetric_eigensystem or
+ * SymmetricEigenAnalysis, which remain the reference for their accuracy.
+ *
+ * A matrix is given by its upper triangle, xx, xy, xz, yy, yz and zz. The
+ * computations are carried out in double precision whatever the ValueType.
+ *
+ * The batched ComputeEigenValues() takes the matrices as six arrays, one
+ * per element, as they are stored by the callers. It solves them one after
+ * the other with the scalar solution, the acos and cos of which keep the
+ * loop from being vectorized.
+ *
+ * \ingroup LesionSizingToolkit
+ */
+template <class TValue>
+class SymmetricEigenSystem3x3
+{
+public:
+  /** Type of the elements and the eigenvalues. */
+  using ValueType = TValue;
+
+  /** Type in which the decomposition is computed. */
+  using RealType = double;
+
+  /** Suggested number of matrices per call of the batched
+   * ComputeEigenValues(), small enough for the arrays of a batch to stay
+   * in the first level cache. */
+  static constexpr unsigned int BatchSize = 256;
+
+  /** Eigenvalues of a matrix, in ascending order. */
+  static inline void ComputeEigenValues( ValueType xx, ValueType xy, ValueType xz,
+    ValueType yy, ValueType yz, ValueType zz, ValueType eigenValues[3] );
+
+  /** Eigenvalues of numberOfMatrices matrices, the elements of the i-th
+   * matrix being xx[i], xy[i]... The eigenvalues of the i-th matrix, in
+   * ascending order, are written to eigenValues0[i], eigenValues1[i] and
+   * eigenValues2[i]. */
+  static void ComputeEigenValues( SizeValueType numberOfMatrices,
+    const ValueType * xx, const ValueType * xy, const ValueType * xz,
+    const ValueType * yy, const ValueType * yz, const ValueType * zz,
+    ValueType * eigenValues0, ValueType * eigenValues1, ValueType * eigenValues2 );
+
+  /** Unit eigenvector of a matrix for one of its eigenvalues. When the
+   * eigenvalue is repeated, the vector is one of its eigenspace. */
+  static inline void ComputeEigenVector( ValueType xx, ValueType xy, ValueType xz,
+    ValueType yy, ValueType yz, ValueType zz, ValueType eigenValue, ValueType eigenVector[3] );
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkSymmetricEigenSystem3x3.hxx"
+#endif
+
+#endif
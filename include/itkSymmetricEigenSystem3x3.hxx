@@ -0,0 +1,194 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkSymmetricEigenSystem3x3.hxx
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkSymmetricEigenSystem3x3_hxx
+#define itkSymmetricEigenSystem3x3_hxx
+
+#include "itkSymmetricEigenSystem3x3.h"
+#include "itkMath.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace itk
+{
+
+template <class TValue>
+void
+SymmetricEigenSystem3x3<TValue>
+::ComputeEigenValues( ValueType xx, ValueType xy, ValueType xz,
+  ValueType yy, ValueType yz, ValueType zz, ValueType eigenValues[3] )
+{
+  //
+  // The eigenvalues of A are m + 2 sqrt(p) cos(phi + 2 k pi / 3), where m is
+  // the mean of the diagonal, p the mean square of the elements of
+  // B = A - m I, and phi a third of the angle whose cosine is det(B) / 2
+  // divided by p^3/2.
+  //
+  const RealType m = ( static_cast< RealType >( xx ) + yy + zz ) / 3.0;
+
+  const RealType a = xx - m;
+  const RealType d = yy - m;
+  const RealType f = zz - m;
+  const RealType b = xy;
+  const RealType c = xz;
+  const RealType e = yz;
+
+  const RealType p = ( a * a + d * d + f * f + 2.0 * ( b * b + c * c + e * e ) ) / 6.0;
+  const RealType q = 0.5 * ( a * ( d * f - e * e ) - b * ( b * f - c * e ) + c * ( b * e - c * d ) );
+
+  const RealType sqrtP = std::sqrt( p );
+  const RealType p3 = p * sqrtP;
+
+  // A multiple of the identity has p = 0, and its eigenvalues are all m.
+  RealType r = p3 > 0.0 ? q / p3 : 0.0;
+  r = r < -1.0 ? -1.0 : ( r > 1.0 ? 1.0 : r );
+
+  const RealType phi = std::acos( r ) / 3.0;
+
+  const RealType largest = m + 2.0 * sqrtP * std::cos( phi );
+  const RealType smallest = m + 2.0 * sqrtP * std::cos( phi + 2.0 * Math::pi / 3.0 );
+
+  eigenValues[0] = static_cast< ValueType >( smallest );
+  eigenValues[1] = static_cast< ValueType >( 3.0 * m - largest - smallest );
+  eigenValues[2] = static_cast< ValueType >( largest );
+}
+
+
+template <class TValue>
+void
+SymmetricEigenSystem3x3<TValue>
+::ComputeEigenValues( SizeValueType numberOfMatrices,
+  const ValueType * xx, const ValueType * xy, const ValueType * xz,
+  const ValueType * yy, const ValueType * yz, const ValueType * zz,
+  ValueType * eigenValues0, ValueType * eigenValues1, ValueType * eigenValues2 )
+{
+  for( SizeValueType i = 0; i < numberOfMatrices; i++ )
+    {
+    ValueType eigenValues[3];
+    ComputeEigenValues( xx[i], xy[i], xz[i], yy[i], yz[i], zz[i], eigenValues );
+    eigenValues0[i] = eigenValues[0];
+    eigenValues1[i] = eigenValues[1];
+    eigenValues2[i] = eigenValues[2];
+    }
+}
+
+
+template <class TValue>
+void
+SymmetricEigenSystem3x3<TValue>
+::ComputeEigenVector( ValueType xx, ValueType xy, ValueType xz,
+  ValueType yy, ValueType yz, ValueType zz, ValueType eigenValue, ValueType eigenVector[3] )
+{
+  //
+  // The eigenvector is orthogonal to the rows of A - lambda I. For a simple
+  // eigenvalue the rows span a plane, and the largest of their cross
+  // products is the most accurate normal to it.
+  //
+  const RealType row0[3] = { static_cast< RealType >( xx ) - eigenValue, static_cast< RealType >( xy ),
+                             static_cast< RealType >( xz ) };
+  const RealType row1[3] = { static_cast< RealType >( xy ), static_cast< RealType >( yy ) - eigenValue,
+                             static_cast< RealType >( yz ) };
+  const RealType row2[3] = { static_cast< RealType >( xz ), static_cast< RealType >( yz ),
+                             static_cast< RealType >( zz ) - eigenValue };
+
+  const RealType * rows[3] = { row0, row1, row2 };
+
+  RealType bestCross[3] = { 0.0, 0.0, 0.0 };
+  RealType bestCrossNorm2 = 0.0;
+  const RealType * bestRow = row0;
+  RealType bestRowNorm2 = 0.0;
+
+  for( unsigned int i = 0; i < 3; i++ )
+    {
+    const RealType * u = rows[i];
+    const RealType * v = rows[( i + 1 ) % 3];
+
+    const RealType cross[3] = { u[1] * v[2] - u[2] * v[1],
+                                u[2] * v[0] - u[0] * v[2],
+                                u[0] * v[1] - u[1] * v[0] };
+    const RealType crossNorm2 = cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2];
+    if( crossNorm2 > bestCrossNorm2 )
+      {
+      bestCrossNorm2 = crossNorm2;
+      bestCross[0] = cross[0];
+      bestCross[1] = cross[1];
+      bestCross[2] = cross[2];
+      }
+
+    const RealType rowNorm2 = u[0] * u[0] + u[1] * u[1] + u[2] * u[2];
+    if( rowNorm2 > bestRowNorm2 )
+      {
+      bestRowNorm2 = rowNorm2;
+      bestRow = u;
+      }
+    }
+
+  // Rounding errors of the rows are relative to the largest element of the
+  // matrix, or to the eigenvalue.
+  const RealType scale = std::max( { std::abs( static_cast< RealType >( xx ) ),
+    std::abs( static_cast< RealType >( xy ) ), std::abs( static_cast< RealType >( xz ) ),
+    std::abs( static_cast< RealType >( yy ) ), std::abs( static_cast< RealType >( yz ) ),
+    std::abs( static_cast< RealType >( zz ) ), std::abs( static_cast< RealType >( eigenValue ) ) } );
+  const RealType tolerance = 64.0 * std::numeric_limits< RealType >::epsilon() * scale * scale;
+
+  if( bestCrossNorm2 > tolerance * tolerance )
+    {
+    const RealType norm = std::sqrt( bestCrossNorm2 );
+    eigenVector[0] = static_cast< ValueType >( bestCross[0] / norm );
+    eigenVector[1] = static_cast< ValueType >( bestCross[1] / norm );
+    eigenVector[2] = static_cast< ValueType >( bestCross[2] / norm );
+    return;
+    }
+
+  if( bestRowNorm2 > tolerance )
+    {
+    //
+    // Double eigenvalue, the rows are parallel and the eigenspace is the
+    // plane orthogonal to them. Take its vector orthogonal to the axis the
+    // rows are the least aligned with.
+    //
+    unsigned int axis = 0;
+    for( unsigned int i = 1; i < 3; i++ )
+      {
+      if( std::abs( bestRow[i] ) < std::abs( bestRow[axis] ) )
+        {
+        axis = i;
+        }
+      }
+    RealType unit[3] = { 0.0, 0.0, 0.0 };
+    unit[axis] = 1.0;
+
+    const RealType cross[3] = { bestRow[1] * unit[2] - bestRow[2] * unit[1],
+                                bestRow[2] * unit[0] - bestRow[0] * unit[2],
+                                bestRow[0] * unit[1] - bestRow[1] * unit[0] };
+    const RealType norm = std::sqrt( cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2] );
+    eigenVector[0] = static_cast< ValueType >( cross[0] / norm );
+    eigenVector[1] = static_cast< ValueType >( cross[1] / norm );
+    eigenVector[2] = static_cast< ValueType >( cross[2] / norm );
+    return;
+    }
+
+  // Multiple of the identity, every vector is an eigenvector.
+  eigenVector[0] = 0;
+  eigenVector[1] = 0;
+  eigenVector[2] = 1;
+}
+
+} // end namespace itk
+
+#endif
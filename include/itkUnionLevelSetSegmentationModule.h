@@ -0,0 +1,200 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkUnionLevelSetSegmentationModule.h
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkUnionLevelSetSegmentationModule_h
+#define itkUnionLevelSetSegmentationModule_h
+
+#include "itkSinglePhaseLevelSetSegmentationModule.h"
+#include "itkFastMarchingSegmentationModule.h"
+#include "itkGeodesicActiveContourLevelSetSegmentationModule.h"
+#include "itkLandmarkSpatialObject.h"
+
+#include <vector>
+
+namespace itk
+{
+
+/** \class UnionLevelSetSegmentationModule
+ * \brief Segments the union of several adjacent lesions, then splits it
+ * among them.
+ *
+ * Instead of running a FastMarchingAndGeodesicActiveContourLevelSetSegmentationModule
+ * per lesion and resolving the overlaps afterwards, a single level set is
+ * evolved for the union of the lesions: a fast marching from the seeds of
+ * all the lesions initializes one geodesic active contour, computed over the
+ * feature image, typically the speed image of a MinimumFeatureAggregator.
+ * The lesions do not compete during this evolution, it is not a multi-phase
+ * level set.
+ *
+ * The inside of the resulting contour is then split among the lesions by a
+ * geodesic Voronoi partition: every label propagates from its seeds through
+ * the inside of the contour, at the speed given by the feature, and a pixel
+ * goes to the label that reaches it first, the lower label winning the
+ * ties. The interfaces between the lesions therefore lie where their fronts
+ * meet, in the valleys of the feature, and the boundaries of the lesions
+ * elsewhere are those of the union.
+ *
+ * Seeds outside of the contour do not label anything, and the parts of the
+ * contour that no seed reaches are left to the background. Both are
+ * reported by a warning.
+ *
+ * The output of the module is the level set of the union of the lesions.
+ * The label map, where lesion i has label i+1 and the background is zero,
+ * and the level set of every lesion, whose zero set is the boundary of the
+ * lesion, are available after the update.
+ *
+ * SpatialObjects are used as inputs and outputs of this class.
+ *
+ * \ingroup SpatialObjectFilters
+ * \ingroup LesionSizingToolkit
+ */
+template <unsigned int NDimension>
+class ITK_EXPORT UnionLevelSetSegmentationModule :
+  public SinglePhaseLevelSetSegmentationModule<NDimension>
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(UnionLevelSetSegmentationModule);
+
+  /** Standard class type alias. */
+  using Self = UnionLevelSetSegmentationModule;
+  using Superclass = SinglePhaseLevelSetSegmentationModule<NDimension>;
+  using Pointer = SmartPointer<Self>;
+  using ConstPointer = SmartPointer<const Self>;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(UnionLevelSetSegmentationModule, SinglePhaseLevelSetSegmentationModule);
+
+  /** Dimension of the space */
+  static constexpr unsigned int Dimension = NDimension;
+
+  /** Type of spatialObject that will be passed as input and output of this
+   * segmentation method. */
+  using SpatialObjectType = typename Superclass::SpatialObjectType;
+  using SpatialObjectPointer = typename Superclass::SpatialObjectPointer;
+
+  /** Types of images and spatial objects inherited from the superclass. */
+  using OutputPixelType = typename Superclass::OutputPixelType;
+  using InputImageType = typename Superclass::InputImageType;
+  using FeatureImageType = typename Superclass::FeatureImageType;
+  using OutputImageType = typename Superclass::OutputImageType;
+  using FeatureSpatialObjectType = typename Superclass::FeatureSpatialObjectType;
+  using OutputSpatialObjectType = typename Superclass::OutputSpatialObjectType;
+
+  /** Type of the input set of seed points. They are stored in a Landmark Spatial Object. */
+  using InputSpatialObjectType = LandmarkSpatialObject< NDimension >;
+  using PointListType = typename InputSpatialObjectType::PointListType;
+
+  /** Type of the label map. */
+  using LabelPixelType = unsigned short;
+  using LabelImageType = Image< LabelPixelType, NDimension >;
+  using LabelSpatialObjectType = ImageSpatialObject< NDimension, LabelPixelType >;
+
+  /** Add a lesion to segment, returns its index. The label of the lesion in
+   * the label map is that index plus one. The seeds of all the lesions are
+   * set as the input of the module. When the input is set directly instead,
+   * every one of its points seeds a lesion of its own. */
+  unsigned int AddLesion( const PointListType & seeds );
+
+  /** Remove all the lesions. */
+  void ClearLesions();
+
+  /** Number of lesions segmented in the last update. */
+  unsigned int GetNumberOfLesions() const
+    {
+    return static_cast< unsigned int >( this->m_LesionSegmentations.size() );
+    }
+
+  /** Label map of the lesions. Available after the module has been updated. */
+  const LabelSpatialObjectType * GetLabelMap() const;
+
+  /** Level set of a lesion, encoded as the output of the module. Available
+   * after the module has been updated. */
+  const OutputSpatialObjectType * GetLesionSegmentation( unsigned int lesionId ) const;
+
+  /** Set the Fast Marching algorithm Stopping Value. The Fast Marching
+   * algorithm is terminated when the value of the smallest trial point
+   * is greater than the stopping value. */
+  virtual void SetStoppingValue( double d )
+    { m_FastMarchingModule->SetStoppingValue( d ); }
+  virtual double GetStoppingValue() const
+    { return m_FastMarchingModule->GetStoppingValue(); }
+
+  /** Set the Fast Marching algorithm distance from seeds. */
+  virtual void SetDistanceFromSeeds( double d )
+    { m_FastMarchingModule->SetDistanceFromSeeds( d ); }
+  virtual double GetDistanceFromSeeds() const
+    { return m_FastMarchingModule->GetDistanceFromSeeds(); }
+
+  /** The fast marching parameters are held by the internal module, account
+   * for its MTime as well. */
+  unsigned long GetMTime() const override;
+
+  /** Internal modules, exposed so that their executions can be observed. */
+  using FastMarchingModuleType = FastMarchingSegmentationModule< Dimension >;
+  using GeodesicActiveContourLevelSetModuleType = GeodesicActiveContourLevelSetSegmentationModule< Dimension >;
+  itkGetModifiableObjectMacro( FastMarchingModule, FastMarchingModuleType );
+  itkGetModifiableObjectMacro( GeodesicActiveContourLevelSetModule, GeodesicActiveContourLevelSetModuleType );
+
+protected:
+  UnionLevelSetSegmentationModule();
+  ~UnionLevelSetSegmentationModule() override;
+  void PrintSelf(std::ostream& os, Indent indent) const override;
+
+  /** Method invoked by the pipeline in order to trigger the computation of
+   * the segmentation. */
+  void  GenerateData () override;
+
+  typename FastMarchingModuleType::Pointer m_FastMarchingModule;
+  typename GeodesicActiveContourLevelSetModuleType::Pointer m_GeodesicActiveContourLevelSetModule;
+
+private:
+  /** Number of seeds of every lesion, one per point when the seeds are not
+   * the ones of the added lesions. Throws if the lesions do not account for
+   * every point. */
+  std::vector< unsigned int > ComputeNumberOfSeedsPerLesion( const InputSpatialObjectType * seeds ) const;
+
+  /** Label of every input seed, in the order of the points of the input. */
+  std::vector< LabelPixelType > ComputeSeedLabels( const std::vector< unsigned int > & numberOfSeedsPerLesion ) const;
+
+  /** Share the inside of the level set, the pixels with a non positive
+   * value, among the labels of the seeds. Warns about the seeds outside of
+   * the level set and about the inside pixels that no seed reaches. */
+  typename LabelImageType::Pointer ComputeLabelMap( const OutputImageType * levelSet,
+    const InputSpatialObjectType * seeds, const std::vector< LabelPixelType > & seedLabels ) const;
+
+  /** Level set of a single label, equal to the shared level set inside of
+   * the label and to its absolute value elsewhere. The level set of a label
+   * without pixels, such as the one of a lesion without seeds, is empty. */
+  typename OutputImageType::Pointer ComputeLabelLevelSet( const OutputImageType * levelSet,
+    const LabelImageType * labelMap, LabelPixelType label ) const;
+
+  typename InputSpatialObjectType::Pointer                m_LesionSeeds;
+  std::vector< unsigned int >                             m_NumberOfSeedsPerLesion;
+
+  typename LabelSpatialObjectType::Pointer                m_LabelMap;
+  std::vector< typename OutputSpatialObjectType::Pointer > m_LesionSegmentations;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+# include "itkUnionLevelSetSegmentationModule.hxx"
+#endif
+
+#endif
@@ -0,0 +1,464 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkUnionLevelSetSegmentationModule.hxx
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#ifndef itkUnionLevelSetSegmentationModule_hxx
+#define itkUnionLevelSetSegmentationModule_hxx
+
+#include "itkUnionLevelSetSegmentationModule.h"
+#include "itkIntensityWindowingImageFilter.h"
+#include "itkMinimumMaximumImageCalculator.h"
+#include "itkProgressAccumulator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <tuple>
+
+
+namespace itk
+{
+
+
+/**
+ * Constructor
+ */
+template <unsigned int NDimension>
+UnionLevelSetSegmentationModule<NDimension>
+::UnionLevelSetSegmentationModule()
+{
+  this->m_FastMarchingModule = FastMarchingModuleType::New();
+  this->m_FastMarchingModule->SetDistanceFromSeeds(1.0);
+  this->m_FastMarchingModule->SetStoppingValue( 100.0 );
+  this->m_FastMarchingModule->InvertOutputIntensitiesOff();
+  this->m_GeodesicActiveContourLevelSetModule = GeodesicActiveContourLevelSetModuleType::New();
+  this->m_GeodesicActiveContourLevelSetModule->InvertOutputIntensitiesOff();
+
+  this->m_LesionSeeds = InputSpatialObjectType::New();
+  this->m_LabelMap = LabelSpatialObjectType::New();
+}
+
+
+/**
+ * Destructor
+ */
+template <unsigned int NDimension>
+UnionLevelSetSegmentationModule<NDimension>
+::~UnionLevelSetSegmentationModule()
+{
+}
+
+
+/**
+ * PrintSelf
+ */
+template <unsigned int NDimension>
+void
+UnionLevelSetSegmentationModule<NDimension>
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf( os, indent );
+  os << indent << "Number of added lesions = " << this->m_NumberOfSeedsPerLesion.size() << std::endl;
+  os << indent << "Number of segmented lesions = " << this->m_LesionSegmentations.size() << std::endl;
+}
+
+
+template <unsigned int NDimension>
+unsigned long
+UnionLevelSetSegmentationModule<NDimension>
+::GetMTime() const
+{
+  unsigned long mtime = this->Superclass::GetMTime();
+  const unsigned long t = this->m_FastMarchingModule->GetMTime();
+  if (t > mtime)
+    {
+    mtime = t;
+    }
+  return mtime;
+}
+
+
+template <unsigned int NDimension>
+unsigned int
+UnionLevelSetSegmentationModule<NDimension>
+::AddLesion( const PointListType & seeds )
+{
+  PointListType points = this->m_LesionSeeds->GetPoints();
+  points.insert( points.end(), seeds.begin(), seeds.end() );
+  this->m_LesionSeeds->SetPoints( points );
+
+  this->m_NumberOfSeedsPerLesion.push_back( static_cast< unsigned int >( seeds.size() ) );
+
+  this->SetInput( this->m_LesionSeeds );
+  this->Modified();
+
+  return static_cast< unsigned int >( this->m_NumberOfSeedsPerLesion.size() - 1 );
+}
+
+
+template <unsigned int NDimension>
+void
+UnionLevelSetSegmentationModule<NDimension>
+::ClearLesions()
+{
+  PointListType points;
+  this->m_LesionSeeds->SetPoints( points );
+  this->m_NumberOfSeedsPerLesion.clear();
+  this->Modified();
+}
+
+
+template <unsigned int NDimension>
+const typename UnionLevelSetSegmentationModule<NDimension>::LabelSpatialObjectType *
+UnionLevelSetSegmentationModule<NDimension>
+::GetLabelMap() const
+{
+  return this->m_LabelMap.GetPointer();
+}
+
+
+template <unsigned int NDimension>
+const typename UnionLevelSetSegmentationModule<NDimension>::OutputSpatialObjectType *
+UnionLevelSetSegmentationModule<NDimension>
+::GetLesionSegmentation( unsigned int lesionId ) const
+{
+  if( lesionId >= this->m_LesionSegmentations.size() )
+    {
+    itkExceptionMacro("Lesion " << lesionId << " was not segmented, the last update segmented "
+      << this->m_LesionSegmentations.size() << " lesions");
+    }
+  return this->m_LesionSegmentations[lesionId].GetPointer();
+}
+
+
+template <unsigned int NDimension>
+std::vector< unsigned int >
+UnionLevelSetSegmentationModule<NDimension>
+::ComputeNumberOfSeedsPerLesion( const InputSpatialObjectType * seeds ) const
+{
+  const unsigned int numberOfPoints = seeds->GetNumberOfPoints();
+
+  // Without added lesions, every point is a lesion.
+  std::vector< unsigned int > numberOfSeedsPerLesion( numberOfPoints, 1 );
+  if( seeds == this->m_LesionSeeds.GetPointer() )
+    {
+    numberOfSeedsPerLesion = this->m_NumberOfSeedsPerLesion;
+    }
+
+  SizeValueType numberOfLesionSeeds = 0;
+  for( const auto & n : numberOfSeedsPerLesion )
+    {
+    numberOfLesionSeeds += n;
+    }
+
+  if( numberOfLesionSeeds != numberOfPoints )
+    {
+    itkExceptionMacro("The lesions hold " << numberOfLesionSeeds << " seeds but the input has "
+      << numberOfPoints << " points");
+    }
+
+  if( numberOfSeedsPerLesion.size() > NumericTraits< LabelPixelType >::max() )
+    {
+    itkExceptionMacro("Cannot label " << numberOfSeedsPerLesion.size() << " lesions");
+    }
+
+  return numberOfSeedsPerLesion;
+}
+
+
+template <unsigned int NDimension>
+std::vector< typename UnionLevelSetSegmentationModule<NDimension>::LabelPixelType >
+UnionLevelSetSegmentationModule<NDimension>
+::ComputeSeedLabels( const std::vector< unsigned int > & numberOfSeedsPerLesion ) const
+{
+  std::vector< LabelPixelType > seedLabels;
+  for( unsigned int i = 0; i < numberOfSeedsPerLesion.size(); i++ )
+    {
+    seedLabels.insert( seedLabels.end(), numberOfSeedsPerLesion[i], static_cast< LabelPixelType >( i + 1 ) );
+    }
+
+  return seedLabels;
+}
+
+
+template <unsigned int NDimension>
+typename UnionLevelSetSegmentationModule<NDimension>::LabelImageType::Pointer
+UnionLevelSetSegmentationModule<NDimension>
+::ComputeLabelMap( const OutputImageType * levelSet, const InputSpatialObjectType * seeds,
+  const std::vector< LabelPixelType > & seedLabels ) const
+{
+  const FeatureImageType * featureImage = this->GetInternalFeatureImage();
+
+  using RegionType = typename OutputImageType::RegionType;
+  using IndexType = typename OutputImageType::IndexType;
+
+  const RegionType region = levelSet->GetBufferedRegion();
+
+  if( featureImage->GetBufferedRegion() != region )
+    {
+    itkExceptionMacro("The level set and the feature image do not have the same buffered region");
+    }
+
+  typename LabelImageType::Pointer labelMap = LabelImageType::New();
+  labelMap->CopyInformation( levelSet );
+  labelMap->SetRegions( region );
+  labelMap->Allocate();
+  labelMap->FillBuffer( NumericTraits< LabelPixelType >::ZeroValue() );
+
+  const OutputPixelType * phi = levelSet->GetBufferPointer();
+  const typename FeatureImageType::PixelType * speed = featureImage->GetBufferPointer();
+  LabelPixelType * labels = labelMap->GetBufferPointer();
+
+  const SizeValueType numberOfPixels = region.GetNumberOfPixels();
+  const typename OutputImageType::OffsetValueType * offsetTable = levelSet->GetOffsetTable();
+  const typename OutputImageType::SpacingType & spacing = levelSet->GetSpacing();
+
+  // Pixels where the feature vanishes are still crossed, slowly.
+  constexpr double minimumSpeed = 1e-6;
+
+  // Every label propagates from its seeds through the inside of the level
+  // set, and settles the pixels it reaches first. Among the fronts that
+  // reach a pixel at the same time, the lowest label pops out first.
+  using FrontNodeType = std::tuple< double, LabelPixelType, OffsetValueType >;
+  using FrontType = std::priority_queue< FrontNodeType, std::vector< FrontNodeType >, std::greater< FrontNodeType > >;
+
+  FrontType front;
+  std::vector< double > arrivalTimes( numberOfPixels, std::numeric_limits< double >::max() );
+
+  const PointListType & points = seeds->GetPoints();
+
+  if( seedLabels.size() != points.size() )
+    {
+    itkExceptionMacro("Got " << seedLabels.size() << " seed labels for " << points.size() << " seeds");
+    }
+
+  IndexType index;
+
+  unsigned int numberOfDroppedSeeds = 0;
+
+  for( unsigned int i = 0; i < points.size(); i++ )
+    {
+    levelSet->TransformPhysicalPointToIndex( points[i].GetPosition(), index );
+
+    if( region.IsInside( index ) )
+      {
+      const OffsetValueType offset = levelSet->ComputeOffset( index );
+      if( phi[offset] <= 0.0 )
+        {
+        arrivalTimes[offset] = 0.0;
+        front.emplace( 0.0, seedLabels[i], offset );
+        continue;
+        }
+      }
+    ++numberOfDroppedSeeds;
+    }
+
+  if( numberOfDroppedSeeds > 0 )
+    {
+    itkWarningMacro( << numberOfDroppedSeeds << " of the " << points.size()
+      << " seeds are outside of the segmented union and label nothing" );
+    }
+
+  while( !front.empty() )
+    {
+    const double time = std::get<0>( front.top() );
+    const LabelPixelType label = std::get<1>( front.top() );
+    const OffsetValueType offset = std::get<2>( front.top() );
+    front.pop();
+
+    if( labels[offset] != NumericTraits< LabelPixelType >::ZeroValue() )
+      {
+      continue;
+      }
+
+    labels[offset] = label;
+
+    index = levelSet->ComputeIndex( offset );
+
+    for( unsigned int d = 0; d < NDimension; d++ )
+      {
+      for( int side = -1; side <= 1; side += 2 )
+        {
+        const IndexValueType neighborIndex = index[d] + side;
+        if( neighborIndex < region.GetIndex(d) ||
+            neighborIndex >= region.GetIndex(d) + static_cast< IndexValueType >( region.GetSize(d) ) )
+          {
+          continue;
+          }
+
+        const OffsetValueType neighbor = offset + side * offsetTable[d];
+        if( phi[neighbor] > 0.0 || labels[neighbor] != NumericTraits< LabelPixelType >::ZeroValue() )
+          {
+          continue;
+          }
+
+        const double meanSpeed = std::max( 0.5 * ( speed[offset] + speed[neighbor] ), minimumSpeed );
+        const double neighborTime = time + spacing[d] / meanSpeed;
+
+        // Equal arrival times are all queued, the order of the front
+        // decides which label takes the pixel.
+        if( neighborTime <= arrivalTimes[neighbor] )
+          {
+          arrivalTimes[neighbor] = neighborTime;
+          front.emplace( neighborTime, label, neighbor );
+          }
+        }
+      }
+    }
+
+  // Components of the union without seed stay in the background.
+  SizeValueType numberOfUnlabeledPixels = 0;
+  for( SizeValueType i = 0; i < numberOfPixels; i++ )
+    {
+    if( phi[i] <= 0.0 && labels[i] == NumericTraits< LabelPixelType >::ZeroValue() )
+      {
+      ++numberOfUnlabeledPixels;
+      }
+    }
+
+  if( numberOfUnlabeledPixels > 0 )
+    {
+    itkWarningMacro( << numberOfUnlabeledPixels
+      << " pixels of the segmented union are reached by no seed and left unlabeled" );
+    }
+
+  return labelMap;
+}
+
+
+template <unsigned int NDimension>
+typename UnionLevelSetSegmentationModule<NDimension>::OutputImageType::Pointer
+UnionLevelSetSegmentationModule<NDimension>
+::ComputeLabelLevelSet( const OutputImageType * levelSet, const LabelImageType * labelMap,
+  LabelPixelType label ) const
+{
+  typename OutputImageType::Pointer labelLevelSet = OutputImageType::New();
+  labelLevelSet->CopyInformation( levelSet );
+  labelLevelSet->SetRegions( levelSet->GetBufferedRegion() );
+  labelLevelSet->Allocate();
+
+  const OutputPixelType * phi = levelSet->GetBufferPointer();
+  const LabelPixelType * labels = labelMap->GetBufferPointer();
+  OutputPixelType * labelPhi = labelLevelSet->GetBufferPointer();
+
+  // The other lesions are outside of this one, the zero set of the label
+  // runs along its interfaces with them.
+  const SizeValueType numberOfPixels = levelSet->GetBufferedRegion().GetNumberOfPixels();
+  for( SizeValueType i = 0; i < numberOfPixels; i++ )
+    {
+    labelPhi[i] = ( labels[i] == label ) ? phi[i] : std::abs( phi[i] );
+    }
+
+  return labelLevelSet;
+}
+
+
+/**
+ * Generate Data
+ */
+template <unsigned int NDimension>
+void
+UnionLevelSetSegmentationModule<NDimension>
+::GenerateData()
+{
+  const auto * seeds = dynamic_cast< const InputSpatialObjectType * >( this->GetInput() );
+  if( !seeds )
+    {
+    itkExceptionMacro("The input of the module must be a LandmarkSpatialObject holding the seeds of the lesions");
+    }
+
+  const std::vector< unsigned int > numberOfSeedsPerLesion = this->ComputeNumberOfSeedsPerLesion( seeds );
+  const std::vector< LabelPixelType > seedLabels = this->ComputeSeedLabels( numberOfSeedsPerLesion );
+
+  // Report progress. The last tenth goes to the split of the union among
+  // the lesions.
+  ProgressAccumulator::Pointer progress = ProgressAccumulator::New();
+  progress->SetMiniPipelineFilter(this);
+  progress->RegisterInternalFilter( this->m_FastMarchingModule, 0.3 );
+  progress->RegisterInternalFilter(
+      this->m_GeodesicActiveContourLevelSetModule, 0.6 );
+
+  // A single front, started from the seeds of all the lesions.
+  this->m_FastMarchingModule->SetInput( seeds );
+  this->m_FastMarchingModule->SetFeature( this->GetFeature() );
+  this->m_FastMarchingModule->Update();
+
+  m_GeodesicActiveContourLevelSetModule->SetInput( m_FastMarchingModule->GetOutput() );
+  m_GeodesicActiveContourLevelSetModule->SetFeature( this->GetFeature() );
+  m_GeodesicActiveContourLevelSetModule->SetMaximumRMSError( this->GetMaximumRMSError() );
+  m_GeodesicActiveContourLevelSetModule->SetMaximumNumberOfIterations( this->GetMaximumNumberOfIterations() );
+  m_GeodesicActiveContourLevelSetModule->SetPropagationScaling( this->GetPropagationScaling() );
+  m_GeodesicActiveContourLevelSetModule->SetCurvatureScaling( this->GetCurvatureScaling() );
+  m_GeodesicActiveContourLevelSetModule->SetAdvectionScaling( this->GetAdvectionScaling() );
+  m_GeodesicActiveContourLevelSetModule->Update();
+
+  auto * levelSet = const_cast< OutputImageType * >(
+        dynamic_cast< const OutputSpatialObjectType * >(
+        m_GeodesicActiveContourLevelSetModule->GetOutput())->GetImage() );
+
+  typename LabelImageType::Pointer labelMap = this->ComputeLabelMap( levelSet, seeds, seedLabels );
+  this->m_LabelMap->SetImage( labelMap );
+  this->UpdateProgress( 0.95f );
+
+  // Every lesion gets a level set, even the ones without seeds, which label
+  // no pixel and are therefore empty.
+  const LabelPixelType numberOfLesions = static_cast< LabelPixelType >( numberOfSeedsPerLesion.size() );
+
+  // The level sets of the lesions are encoded as the output, with the same
+  // intensity window, so that they share its iso value.
+  using CalculatorType = MinimumMaximumImageCalculator< OutputImageType >;
+  typename CalculatorType::Pointer calculator = CalculatorType::New();
+  if( this->GetInvertOutputIntensities() )
+    {
+    calculator->SetImage( levelSet );
+    calculator->Compute();
+    }
+
+  this->m_LesionSegmentations.clear();
+  for( LabelPixelType label = 1; label <= numberOfLesions; label++ )
+    {
+    typename OutputImageType::Pointer labelLevelSet = this->ComputeLabelLevelSet( levelSet, labelMap, label );
+
+    if( this->GetInvertOutputIntensities() )
+      {
+      using RescaleFilterType = IntensityWindowingImageFilter< OutputImageType, OutputImageType >;
+      typename RescaleFilterType::Pointer rescaler = RescaleFilterType::New();
+      rescaler->SetInput( labelLevelSet );
+      rescaler->SetWindowMinimum( calculator->GetMinimum() );
+      rescaler->SetWindowMaximum( calculator->GetMaximum() );
+      rescaler->SetOutputMinimum(  4.0 );
+      rescaler->SetOutputMaximum( -4.0 );
+      rescaler->InPlaceOn();
+      rescaler->Update();
+      labelLevelSet = rescaler->GetOutput();
+      labelLevelSet->DisconnectPipeline();
+      }
+
+    typename OutputSpatialObjectType::Pointer lesionObject = OutputSpatialObjectType::New();
+    lesionObject->SetImage( labelLevelSet );
+    this->m_LesionSegmentations.push_back( lesionObject );
+
+    this->UpdateProgress( 0.95f + 0.05f * label / numberOfLesions );
+    }
+
+  this->PackOutputImageInOutputSpatialObject( levelSet );
+  this->UpdateProgress( 1.0f );
+}
+
+} // end namespace itk
+
+#endif
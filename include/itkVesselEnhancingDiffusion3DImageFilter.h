@@ -18,6 +18,9 @@
 #define itkVesselEnhancingDiffusion3DImageFilter_h
 
 #include "itkImageToImageFilter.h"
+#include "itkImageBufferPool.h"
+#include "itkCancellationToken.h"
+#include "itkSymmetricSecondRankTensor.h"
 #include <vector>
 
 namespace itk
@@ -41,8 +44,16 @@ namespace itk
  *   scale for which the vesselness has maximum response, and to
  *   recalculate the hessian (locally) during diffusion. Also stores
  *   the current image, ie at iteration i + temp image, therefore the complete
- *   memory consumption approximately peaks at 8 times the input image
- *   (input image in float)
+ *   memory consumption approximately peaks at 9 times the input image
+ *   (input image in float), with the vesselness image
+ * - optionally, UseInterleavedTensorOn(), the six elements of the
+ *   hessian/tensor of a voxel are stored next to each other in a
+ *   single buffer, so that the stencil and the eigensystem
+ *   calculations read the tensor from one stream instead of six
+ * - these buffers are allocated once per update. the current and
+ *   the temp image are swapped after each iteration instead of
+ *   copying, and the hessian/tensor and the vesselness are
+ *   overwritten by each recalculation instead of being reallocated
  * - The hessian is stored as six individual images, an alternative
  *   implementation is to use the itk symmetric second rank tensor
  *   as pixeltype (and eg using the class SymmetricEigenAnalysisImage
@@ -50,6 +61,15 @@ namespace itk
  *   on vnl datatypes and its eigensystem calculations
  * - note: most of computation time is spent at calculation of vesselness
  *   response
+ * - the eigenvalues of the hessian, and the eigenvector the diffusion
+ *   tensor depends on, can be computed in closed form by
+ *   SymmetricEigenSystem3x3, in batches of voxels, with
+ *   UseClosedFormEigenSystemOn(). the vnl eigensystem remains the
+ *   default
+ * - the diffusion of the inner region of the image reads the seven
+ *   images at precomputed buffer offsets, one row along x at a time,
+ *   the boundary faces keep the neighborhood iterators and the zero
+ *   flux neumann boundary condition
  *
  *   9 feb 2009
  *      changed imagetype to precisionimage type of function call,
@@ -59,8 +79,13 @@ namespace itk
  *   Precision      float, 3D
  *
  *
+ * - the three phases of an iteration (vesselness, tensor and
+ *   diffusion) are split over slabs of the image, computed on the
+ *   thread pool of the filter. each voxel is written by a single
+ *   slab, so that the result does not depend on the number of
+ *   work units
+ *
  * - todo
- *   - using parallelism/threading eg over scales
  *   - completely itk-fying, eg eigenvalues calculation
  *   - possibly embedding within itk-diffusion framework
  *   - itk expert to have a look at use of iterators
@@ -82,6 +107,9 @@ public:
   using Precision = float;
   using ImageType = Image<PixelType, NDimension>;
   using PrecisionImageType = Image<Precision,NDimension>;
+  using RegionType = typename PrecisionImageType::RegionType;
+  using HessianPixelType = SymmetricSecondRankTensor<double,NDimension>;
+  using HessianImageType = Image<HessianPixelType,NDimension>;
 
   using Self = VesselEnhancingDiffusion3DImageFilter;
   using Superclass = ImageToImageFilter<ImageType,ImageType>;
@@ -112,6 +140,41 @@ public:
   itkBooleanMacro(Verbose);
   itkSetMacro(Verbose,bool);
 
+  // eigenvalues and eigenvectors of the hessian/tensor with the
+  // closed form solver of SymmetricEigenSystem3x3, or with
+  // vnl_symmetric_eigensystem (default)
+  itkBooleanMacro(UseClosedFormEigenSystem);
+  itkSetMacro(UseClosedFormEigenSystem,bool);
+  itkGetConstMacro(UseClosedFormEigenSystem,bool);
+
+  // diffusion of the inner region of the image with a kernel
+  // addressing the neighbors by their buffer offsets (default),
+  // or with neighborhood iterators, kept as a reference. the
+  // boundary faces always use the neighborhood iterators
+  itkBooleanMacro(UseStridedStencil);
+  itkSetMacro(UseStridedStencil,bool);
+  itkGetConstMacro(UseStridedStencil,bool);
+
+  // hessian/tensor stored as one buffer interleaving the six
+  // elements of each voxel, aligned on a cache line, instead
+  // of six images (default). the diffusion then always uses
+  // the strided kernels, UseStridedStencil is ignored
+  itkBooleanMacro(UseInterleavedTensor);
+  itkSetMacro(UseInterleavedTensor,bool);
+  itkGetConstMacro(UseInterleavedTensor,bool);
+
+  // pool from which the hessian/tensor and temporary images
+  // are allocated, defaults to the global pool
+  itkSetObjectMacro(BufferPool, ImageBufferPool);
+  itkGetModifiableObjectMacro(BufferPool, ImageBufferPool);
+
+  // token polled by the iterations, which also aborts the hessian
+  // and the casts. once it is cancelled the buffers are given back
+  // and ProcessAborted is thrown, the output being left out of
+  // date. defaults to the current token of the executing thread
+  itkSetObjectMacro(CancellationToken, CancellationToken);
+  itkGetModifiableObjectMacro(CancellationToken, CancellationToken);
+
   // some defaults for lowdose example
   // used in the paper
   void SetDefaultPars()
@@ -139,7 +202,7 @@ public:
 
 protected:
   VesselEnhancingDiffusion3DImageFilter();
-  ~VesselEnhancingDiffusion3DImageFilter() override {};
+  ~VesselEnhancingDiffusion3DImageFilter() override;
   void PrintSelf(std::ostream &os, Indent indent) const override;
   void GenerateData() override;
 
@@ -156,6 +219,9 @@ private:
   std::vector<Precision>    m_Scales;
   bool                      m_DarkObjectLightBackground;
   bool                      m_Verbose;
+  bool                      m_UseClosedFormEigenSystem;
+  bool                      m_UseStridedStencil;
+  bool                      m_UseInterleavedTensor;
   unsigned int              m_CurrentIteration;
 
   // current hessian for which we have max vesselresponse
@@ -166,18 +232,90 @@ private:
   typename PrecisionImageType::Pointer m_Dyz;
   typename PrecisionImageType::Pointer m_Dzz;
 
-  void VED3DSingleIteration (typename PrecisionImageType::Pointer );
+  // current hessian/tensor, interleaved: xx, xy, xz, yy, yz
+  // and zz of each voxel in turn, in a block of the pool
+  ImageBufferPool::Pointer m_TensorPool;
+  void *                   m_TensorBlock;
+  SizeValueType            m_TensorBlockSize;
+
+  // distance between the elements of consecutive voxels
+  // in the interleaved tensor
+  static constexpr unsigned int InterleavedTensorStride = 6;
+
+  // first xx, xy, xz, yy, yz and zz of the tensor, in the six
+  // images or in the interleaved block. the elements of the
+  // voxel at buffer offset o are at o times the stride
+  Precision * m_TensorElements[InterleavedTensorStride];
+
+  // maximum vesselness over the scales
+  typename PrecisionImageType::Pointer m_Vesselness;
+
+  ImageBufferPool::Pointer m_BufferPool;
+
+  CancellationToken::Pointer m_CancellationToken;
+  CancellationToken::Pointer m_ActiveCancellationToken;
+
+  bool IsCancelled() const
+    {
+    return m_ActiveCancellationToken && m_ActiveCancellationToken->IsCancellationRequested();
+    }
+
+  // allocates an image on the grid of the reference image
+  // from the buffer pool, its values are left undefined
+  typename PrecisionImageType::Pointer AllocatePrecisionImage (const PrecisionImageType *);
+
+  // allocates the hessian/tensor on the grid of the reference
+  // image, as six images or interleaved, and gives it back
+  void AllocateTensor (const PrecisionImageType *);
+  void ReleaseTensor ();
+
+  // one iteration, diffusion of ci into d
+  void VED3DSingleIteration (const PrecisionImageType *, PrecisionImageType *);
+
+  // diffusion of ci into d over a slab of the image
+  void VED3DSingleIterationRegion (const PrecisionImageType *, PrecisionImageType *, const RegionType &);
+
+  // diffusion of ci into d over a slab of the image, with the
+  // interleaved tensor
+  void VED3DSingleIterationInterleavedRegion (const PrecisionImageType *, PrecisionImageType *,
+                                              const RegionType &);
+
+  // diffusion of ci into d over a region away from the boundary
+  // of the image, with the neighbors addressed by buffer offsets.
+  // TStride is the stride of the tensor storage
+  template <unsigned int TStride>
+  void VED3DSingleIterationInterior (const PrecisionImageType *, PrecisionImageType *, const RegionType &);
+
+  // the same over a boundary face, the offsets of the neighbors
+  // outside the image being clamped to the image
+  template <unsigned int TStride>
+  void VED3DSingleIterationBoundary (const PrecisionImageType *, PrecisionImageType *, const RegionType &);
 
   // Calculates maxvessel response of the range
   // of scales and stores the hessian of each voxel
   // into the member images m_Dij.
-  void MaxVesselResponse (const typename PrecisionImageType::Pointer);
+  void MaxVesselResponse (const PrecisionImageType *);
+
+  // maxvessel response of a scale over a slab of the image,
+  // updating the vesselness image and the hessian. the first
+  // scale overwrites them, with the identity where the
+  // vesselness vanishes
+  template <unsigned int TStride>
+  void MaxVesselResponseRegion (const HessianImageType *, PrecisionImageType *, bool, const RegionType &);
+  template <unsigned int TStride>
+  void MaxVesselResponseRegionVnl (const HessianImageType *, PrecisionImageType *, bool, const RegionType &);
 
   // calculates diffusion tensor
   // based on current values of hessian (for which we have
   // maximim vessel response).
   void DiffusionTensor();
 
+  // diffusion tensor over a slab of the image
+  template <unsigned int TStride>
+  void DiffusionTensorRegion (const RegionType &);
+  template <unsigned int TStride>
+  void DiffusionTensorRegionVnl (const RegionType &);
+
   // Sorted magnitude increasing
   inline Precision VesselnessFunction3D ( Precision, Precision, Precision );
 };
@@ -22,18 +22,21 @@
 #include "itkCastImageFilter.h"
 #include "itkConstShapedNeighborhoodIterator.h"
 #include "itkHessianRecursiveGaussianImageFilter.h"
-#include "itkImageRegionConstIterator.h"
 #include "itkImageRegionIterator.h"
 #include "itkMinimumMaximumImageFilter.h"
 #include "itkNeighborhoodAlgorithm.h"
 #include "itkNumericTraits.h"
+#include "itkSymmetricEigenSystem3x3.h"
 #include "itkZeroFluxNeumannBoundaryCondition.h"
 
 #include <vnl/vnl_vector.h>
 #include <vnl/vnl_matrix.h>
 #include <vnl/algo/vnl_symmetric_eigensystem.h>
 
+#include<algorithm>
+#include<cstdint>
 #include<iostream>
+#include<utility>
 
 namespace itk
 {
@@ -48,9 +51,30 @@ VesselEnhancingDiffusion3DImageFilter<PixelType, NDimension>
     m_Epsilon(0.0),
     m_Omega(0.0),
     m_Sensitivity(0.0),
-    m_DarkObjectLightBackground(false)
+    m_DarkObjectLightBackground(false),
+    m_UseClosedFormEigenSystem(false),
+    m_UseStridedStencil(true),
+    m_UseInterleavedTensor(false),
+    m_TensorBlock(nullptr),
+    m_TensorBlockSize(0)
 {
   this->SetNumberOfRequiredInputs(1);
+  m_BufferPool = ImageBufferPool::GetGlobalPool();
+  m_CancellationToken = nullptr;
+  m_ActiveCancellationToken = nullptr;
+  for (unsigned int k = 0; k < InterleavedTensorStride; ++k)
+    {
+    m_TensorElements[k] = nullptr;
+    }
+}
+
+// destructor
+template <class PixelType, unsigned int NDimension>
+VesselEnhancingDiffusion3DImageFilter<PixelType, NDimension>
+::~VesselEnhancingDiffusion3DImageFilter()
+{
+  // the tensor outlives an update interrupted by an exception
+  ReleaseTensor();
 }
 
 // printself for debugging
@@ -72,11 +96,115 @@ void VesselEnhancingDiffusion3DImageFilter<PixelType, NDimension>
   os << indent << "Omega                   : " << m_Omega << std::endl;
   os << indent << "Sensitivity             : " << m_Sensitivity << std::endl;
  os << indent << "DarkObjectLightBackground  : " << m_DarkObjectLightBackground << std::endl;
+  os << indent << "UseClosedFormEigenSystem : " << m_UseClosedFormEigenSystem << std::endl;
+  os << indent << "UseStridedStencil       : " << m_UseStridedStencil << std::endl;
+  os << indent << "UseInterleavedTensor    : " << m_UseInterleavedTensor << std::endl;
+  os << indent << "BufferPool              : " << m_BufferPool.GetPointer() << std::endl;
+}
+
+// allocprecisionimage
+template <class PixelType, unsigned int NDimension>
+typename VesselEnhancingDiffusion3DImageFilter<PixelType, NDimension>::PrecisionImageType::Pointer
+VesselEnhancingDiffusion3DImageFilter<PixelType, NDimension>
+::AllocatePrecisionImage(const PrecisionImageType * im)
+{
+  typename PrecisionImageType::Pointer p = PrecisionImageType::New();
+  p->SetOrigin(im->GetOrigin());
+  p->SetSpacing(im->GetSpacing());
+  p->SetDirection(im->GetDirection());
+  p->SetRegions(im->GetLargestPossibleRegion());
+  ImageBufferPool::Allocate(p.GetPointer(), m_BufferPool);
+  return p;
+}
+
+// alloctensor
+template <class PixelType, unsigned int NDimension>
+void VesselEnhancingDiffusion3DImageFilter<PixelType, NDimension>
+::AllocateTensor(const PrecisionImageType * im)
+{
+  ReleaseTensor();
+
+  if (!m_UseInterleavedTensor)
+    {
+    m_Dxx = AllocatePrecisionImage(im);
+    m_Dxy = AllocatePrecisionImage(im);
+    m_Dxz = AllocatePrecisionImage(im);
+    m_Dyy = AllocatePrecisionImage(im);
+    m_Dyz = AllocatePrecisionImage(im);
+    m_Dzz = AllocatePrecisionImage(im);
+
+    m_TensorElements[0] = m_Dxx->GetBufferPointer();
+    m_TensorElements[1] = m_Dxy->GetBufferPointer();
+    m_TensorElements[2] = m_Dxz->GetBufferPointer();
+    m_TensorElements[3] = m_Dyy->GetBufferPointer();
+    m_TensorElements[4] = m_Dyz->GetBufferPointer();
+    m_TensorElements[5] = m_Dzz->GetBufferPointer();
+    return;
+    }
+
+  // one block for the six elements of every voxel, with
+  // room to start the tensor on a cache line boundary
+  constexpr std::uintptr_t CacheLineSize = 64;
+  const SizeValueType numberOfBytes =
+    im->GetBufferedRegion().GetNumberOfPixels() * InterleavedTensorStride * sizeof(Precision)
+    + CacheLineSize - 1;
+
+  m_TensorPool = m_BufferPool;
+  if (m_TensorPool)
+    {
+    m_TensorBlock = m_TensorPool->Acquire(numberOfBytes, m_TensorBlockSize);
+    }
+  else
+    {
+    m_TensorBlock = ::operator new(numberOfBytes);
+    m_TensorBlockSize = numberOfBytes;
+    }
+
+  const std::uintptr_t address = reinterpret_cast<std::uintptr_t>(m_TensorBlock);
+  Precision * tensor = reinterpret_cast<Precision *>((address + CacheLineSize - 1) & ~(CacheLineSize - 1));
+
+  for (unsigned int k = 0; k < InterleavedTensorStride; ++k)
+    {
+    m_TensorElements[k] = tensor + k;
+    }
+}
+
+// releasetensor
+template <class PixelType, unsigned int NDimension>
+void VesselEnhancingDiffusion3DImageFilter<PixelType, NDimension>
+::ReleaseTensor()
+{
+  m_Dxx = nullptr;
+  m_Dxy = nullptr;
+  m_Dxz = nullptr;
+  m_Dyy = nullptr;
+  m_Dyz = nullptr;
+  m_Dzz = nullptr;
+
+  if (m_TensorBlock)
+    {
+    if (m_TensorPool)
+      {
+      m_TensorPool->Release(m_TensorBlock, m_TensorBlockSize);
+      }
+    else
+      {
+      ::operator delete(m_TensorBlock);
+      }
+    m_TensorPool = nullptr;
+    m_TensorBlock = nullptr;
+    m_TensorBlockSize = 0;
+    }
+
+  for (unsigned int k = 0; k < InterleavedTensorStride; ++k)
+    {
+    m_TensorElements[k] = nullptr;
+    }
 }
 // singleiter
 template <class PixelType, unsigned int NDimension>
 void VesselEnhancingDiffusion3DImageFilter<PixelType, NDimension>
-::VED3DSingleIteration(typename PrecisionImageType::Pointer ci)
+::VED3DSingleIteration(const PrecisionImageType * ci, PrecisionImageType * d)
 {
   bool rec(false);
   if (    (m_CurrentIteration == 1) ||
@@ -93,6 +221,12 @@ void VesselEnhancingDiffusion3DImageFilter<PixelType, NDimension>
     MaxVesselResponse (ci);
     DiffusionTensor ();
     }
+
+  // the tensor may be incomplete, leave d as is
+  if (IsCancelled())
+    {
+    return;
+    }
   if (m_Verbose)
     {
     if (!rec)
@@ -104,16 +238,63 @@ void VesselEnhancingDiffusion3DImageFilter<PixelType, NDimension>
 
 
   // calculate d = nonlineardiffusion(ci)
-  // using 3x3x3 stencil, afterwards copy
-  // result from d back to ci
-  typename PrecisionImageType::Pointer d = PrecisionImageType::New();
-  d->SetOrigin(ci->GetOrigin());
-  d->SetSpacing(ci->GetSpacing());
-  d->SetDirection(ci->GetDirection());
-  d->SetRegions(ci->GetLargestPossibleRegion());
-  d->Allocate();
-  d->FillBuffer(NumericTraits<Precision>::Zero);
+  // using 3x3x3 stencil. each voxel of d only
+  // depends on ci and the tensor, so the slabs of d
+  // are computed independently on the thread pool,
+  // and the result does not depend on the splitting.
+  // every voxel of d is written, it needs no clearing
+  this->GetMultiThreader()->template ParallelizeImageRegion<NDimension>(
+    d->GetLargestPossibleRegion(),
+    [this, ci, d](const RegionType & region)
+      {
+      if (m_UseInterleavedTensor)
+        {
+        this->VED3DSingleIterationInterleavedRegion(ci, d, region);
+        }
+      else
+        {
+        this->VED3DSingleIterationRegion(ci, d, region);
+        }
+      },
+    nullptr);
+}
+
+// singleiter over a slab, interleaved tensor
+template <class PixelType, unsigned int NDimension>
+void VesselEnhancingDiffusion3DImageFilter<PixelType, NDimension>
+::VED3DSingleIterationInterleavedRegion(const PrecisionImageType * ci, PrecisionImageType * d,
+                                        const RegionType & region)
+{
+  // the same faces as with the six tensor images, but the
+  // neighbors are always addressed by their buffer offsets,
+  // there are no neighborhood iterators over the interleaved
+  // tensor. the first face is the inner region of the slab
+  using FT = typename NeighborhoodAlgorithm::ImageBoundaryFacesCalculator<PrecisionImageType>;
+  Size<NDimension> r;
+  r.Fill(1);
 
+  FT                            fc;
+  typename FT::FaceListType     fci = fc(ci,region,r);
+
+  for (typename FT::FaceListType::iterator fitci = fci.begin(); fitci != fci.end(); ++fitci)
+    {
+    if (fitci == fci.begin())
+      {
+      this->template VED3DSingleIterationInterior<InterleavedTensorStride>(ci, d, *fitci);
+      }
+    else
+      {
+      this->template VED3DSingleIterationBoundary<InterleavedTensorStride>(ci, d, *fitci);
+      }
+    }
+}
+
+// singleiter over a slab
+template <class PixelType, unsigned int NDimension>
+void VesselEnhancingDiffusion3DImageFilter<PixelType, NDimension>
+::VED3DSingleIterationRegion(const PrecisionImageType * ci, PrecisionImageType * d,
+                             const RegionType & region)
+{
   // shapedneighborhood iter, zeroflux boundary condition
   // division into faces and inner region
   using BT = ZeroFluxNeumannBoundaryCondition<PrecisionImageType>;
@@ -156,24 +337,37 @@ void VesselEnhancingDiffusion3DImageFilter<PixelType, NDimension>
   const Precision rxz = m_TimeStep / (4.0 * ispacing[0] * ispacing[2]);
   const Precision ryz = m_TimeStep / (4.0 * ispacing[1] * ispacing[2]);
 
-  // faces
+  // faces of the slab, the inner region of the slab
+  // only differs from the inner region of the image
+  // where the slab touches the boundary of the image
   FT                            fc;
-  typename FT::FaceListType     fci = fc(ci,d->GetLargestPossibleRegion(),r);
-  typename FT::FaceListType     fxx = fc(m_Dxx,d->GetLargestPossibleRegion(),r);
-  typename FT::FaceListType     fxy = fc(m_Dxy,d->GetLargestPossibleRegion(),r);
-  typename FT::FaceListType     fxz = fc(m_Dxz,d->GetLargestPossibleRegion(),r);
-  typename FT::FaceListType     fyy = fc(m_Dyy,d->GetLargestPossibleRegion(),r);
-  typename FT::FaceListType     fyz = fc(m_Dyz,d->GetLargestPossibleRegion(),r);
-  typename FT::FaceListType     fzz = fc(m_Dzz,d->GetLargestPossibleRegion(),r);
+  typename FT::FaceListType     fci = fc(ci,region,r);
+  typename FT::FaceListType     fxx = fc(m_Dxx,region,r);
+  typename FT::FaceListType     fxy = fc(m_Dxy,region,r);
+  typename FT::FaceListType     fxz = fc(m_Dxz,region,r);
+  typename FT::FaceListType     fyy = fc(m_Dyy,region,r);
+  typename FT::FaceListType     fyz = fc(m_Dyz,region,r);
+  typename FT::FaceListType     fzz = fc(m_Dzz,region,r);
 
   typename FT::FaceListType::iterator fitci,fitxx,fitxy,fitxz,fityy,fityz,fitzz;
 
+  SizeValueType visited = 0;
+
   for ( fitci = fci.begin(),
         fitxx = fxx.begin(), fitxy = fxy.begin(), fitxz = fxz.begin(),
         fityy = fyy.begin(), fityz = fyz.begin(), fitzz = fzz.begin();
         fitci != fci.end();
         ++fitci, ++fitxx, ++fitxy, ++fitxz, ++fityy, ++fityz, ++fitzz)
     {
+    // the first face is the inner region of the slab, away
+    // from the boundary of the image, where no boundary
+    // condition applies. it is diffused by the strided kernel
+    if (m_UseStridedStencil && fitci == fci.begin())
+      {
+      this->template VED3DSingleIterationInterior<1>(ci, d, *fitci);
+      continue;
+      }
+
     // output iter
     ImageRegionIterator<PrecisionImageType> dit(d,*fitci);
 
@@ -355,6 +549,12 @@ void VesselEnhancingDiffusion3DImageFilter<PixelType, NDimension>
             !itci.IsAtEnd();
             ++itci, ++dit, ++itxx, ++itxy, ++itxz, ++ityy, ++ityz, ++itzz)
       {
+      // d is incomplete, it is discarded
+      if (++visited % CancellationToken::PollingInterval == 0 && IsCancelled())
+        {
+        return;
+        }
+
       // weights
       const Precision xp = itxx.GetPixel(oxp) + itxx.GetCenterPixel();
       const Precision xm = itxx.GetPixel(oxm) + itxx.GetCenterPixel();
@@ -402,140 +602,543 @@ void VesselEnhancingDiffusion3DImageFilter<PixelType, NDimension>
 
       }
     }
+}
 
-  // copying
-  ImageRegionConstIterator<PrecisionImageType> iti (d,d->GetLargestPossibleRegion());
-  ImageRegionIterator<PrecisionImageType>      ito (ci,ci->GetLargestPossibleRegion());
-  for (iti.GoToBegin(), ito.GoToBegin(); !iti.IsAtEnd(); ++iti,++ito)
+// singleiter over the inner region of a slab
+template <class PixelType, unsigned int NDimension>
+template <unsigned int TStride>
+void VesselEnhancingDiffusion3DImageFilter<PixelType, NDimension>
+::VED3DSingleIterationInterior(const PrecisionImageType * ci, PrecisionImageType * d,
+                               const RegionType & region)
+{
+  // ci, d and the tensor share the same buffered region, the
+  // neighbors of a voxel are at the same offsets in every buffer,
+  // times the stride of the tensor storage for the tensor
+  const typename RegionType::SizeType bsize = ci->GetBufferedRegion().GetSize();
+  const OffsetValueType sy = static_cast<OffsetValueType>(bsize[0]);
+  const OffsetValueType sz = static_cast<OffsetValueType>(bsize[0] * bsize[1]);
+
+  // offsets
+  const OffsetValueType oxp = 1;
+  const OffsetValueType oxm = -1;
+  const OffsetValueType oyp = sy;
+  const OffsetValueType oym = -sy;
+  const OffsetValueType ozp = sz;
+  const OffsetValueType ozm = -sz;
+
+  const OffsetValueType oxpyp = 1 + sy;
+  const OffsetValueType oxmym = -1 - sy;
+  const OffsetValueType oxpym = 1 - sy;
+  const OffsetValueType oxmyp = -1 + sy;
+
+  const OffsetValueType oxpzp = 1 + sz;
+  const OffsetValueType oxmzm = -1 - sz;
+  const OffsetValueType oxpzm = 1 - sz;
+  const OffsetValueType oxmzp = -1 + sz;
+
+  const OffsetValueType oypzp = sy + sz;
+  const OffsetValueType oymzm = -sy - sz;
+  const OffsetValueType oypzm = sy - sz;
+  const OffsetValueType oymzp = -sy + sz;
+
+  // fixed weights (timers)
+  const typename PrecisionImageType::SpacingType ispacing = ci->GetSpacing();
+  const Precision rxx = m_TimeStep / (2.0 * ispacing[0] * ispacing[0]);
+  const Precision ryy = m_TimeStep / (2.0 * ispacing[1] * ispacing[1]);
+  const Precision rzz = m_TimeStep / (2.0 * ispacing[2] * ispacing[2]);
+  const Precision rxy = m_TimeStep / (4.0 * ispacing[0] * ispacing[1]);
+  const Precision rxz = m_TimeStep / (4.0 * ispacing[0] * ispacing[2]);
+  const Precision ryz = m_TimeStep / (4.0 * ispacing[1] * ispacing[2]);
+
+  const OffsetValueType nx = static_cast<OffsetValueType>(region.GetSize(0));
+  const OffsetValueType ny = static_cast<OffsetValueType>(region.GetSize(1));
+  const OffsetValueType nz = static_cast<OffsetValueType>(region.GetSize(2));
+
+  typename RegionType::IndexType rowIndex = region.GetIndex();
+
+  // one row along x at a time, the inner loop only reads
+  // the seven buffers at constant offsets, and vectorizes
+  for (OffsetValueType z = 0; z < nz; ++z)
     {
-    ito.Value() = iti.Value();
+    for (OffsetValueType y = 0; y < ny; ++y)
+      {
+      // d is incomplete, it is discarded
+      if (IsCancelled())
+        {
+        return;
+        }
+
+      rowIndex[1] = region.GetIndex(1) + y;
+      rowIndex[2] = region.GetIndex(2) + z;
+      const OffsetValueType o = ci->ComputeOffset(rowIndex);
+
+      const Precision * c   = ci->GetBufferPointer() + o;
+      const Precision * dxx = m_TensorElements[0] + o * TStride;
+      const Precision * dxy = m_TensorElements[1] + o * TStride;
+      const Precision * dxz = m_TensorElements[2] + o * TStride;
+      const Precision * dyy = m_TensorElements[3] + o * TStride;
+      const Precision * dyz = m_TensorElements[4] + o * TStride;
+      const Precision * dzz = m_TensorElements[5] + o * TStride;
+      Precision *       out = d->GetBufferPointer() + o;
+
+      for (OffsetValueType i = 0; i < nx; ++i)
+        {
+        // weights
+        const Precision xp = dxx[(i + oxp) * TStride] + dxx[i * TStride];
+        const Precision xm = dxx[(i + oxm) * TStride] + dxx[i * TStride];
+        const Precision yp = dyy[(i + oyp) * TStride] + dyy[i * TStride];
+        const Precision ym = dyy[(i + oym) * TStride] + dyy[i * TStride];
+        const Precision zp = dzz[(i + ozp) * TStride] + dzz[i * TStride];
+        const Precision zm = dzz[(i + ozm) * TStride] + dzz[i * TStride];
+
+        const Precision xpyp =   dxy[(i + oxpyp) * TStride] + dxy[i * TStride];
+        const Precision xmym =   dxy[(i + oxmym) * TStride] + dxy[i * TStride];
+        const Precision xpym = - dxy[(i + oxpym) * TStride] - dxy[i * TStride];
+        const Precision xmyp = - dxy[(i + oxmyp) * TStride] - dxy[i * TStride];
+
+        const Precision xpzp =   dxz[(i + oxpzp) * TStride] + dxz[i * TStride];
+        const Precision xmzm =   dxz[(i + oxmzm) * TStride] + dxz[i * TStride];
+        const Precision xpzm = - dxz[(i + oxpzm) * TStride] - dxz[i * TStride];
+        const Precision xmzp = - dxz[(i + oxmzp) * TStride] - dxz[i * TStride];
+
+        const Precision ypzp =   dyz[(i + oypzp) * TStride] + dyz[i * TStride];
+        const Precision ymzm =   dyz[(i + oymzm) * TStride] + dyz[i * TStride];
+        const Precision ypzm = - dyz[(i + oypzm) * TStride] - dyz[i * TStride];
+        const Precision ymzp = - dyz[(i + oymzp) * TStride] - dyz[i * TStride];
+
+        // evolution
+        const Precision cv = c[i];
+        out[i] = cv +
+            + rxx * ( xp * (c[i + oxp] - cv)
+                    + xm * (c[i + oxm] - cv) )
+            + ryy * ( yp * (c[i + oyp] - cv)
+                    + ym * (c[i + oym] - cv) )
+            + rzz * ( zp * (c[i + ozp] - cv)
+                    + zm * (c[i + ozm] - cv) )
+            + rxy * ( xpyp * (c[i + oxpyp] - cv)
+                    + xmym * (c[i + oxmym] - cv)
+                    + xpym * (c[i + oxpym] - cv)
+                    + xmyp * (c[i + oxmyp] - cv) )
+            + rxz * ( xpzp * (c[i + oxpzp] - cv)
+                    + xmzm * (c[i + oxmzm] - cv)
+                    + xpzm * (c[i + oxpzm] - cv)
+                    + xmzp * (c[i + oxmzp] - cv) )
+            + ryz * ( ypzp * (c[i + oypzp] - cv)
+                    + ymzm * (c[i + oymzm] - cv)
+                    + ypzm * (c[i + oypzm] - cv)
+                    + ymzp * (c[i + oymzp] - cv) );
+        }
+      }
     }
 }
 
-// maxvesselresponse
+// singleiter over a boundary face of a slab
 template <class PixelType, unsigned int NDimension>
+template <unsigned int TStride>
 void VesselEnhancingDiffusion3DImageFilter<PixelType, NDimension>
-::MaxVesselResponse(const typename PrecisionImageType::Pointer im)
+::VED3DSingleIterationBoundary(const PrecisionImageType * ci, PrecisionImageType * d,
+                               const RegionType & region)
 {
+  // zero flux neumann boundary condition, a neighbor
+  // outside the image is replaced by the voxel of the
+  // image nearest to it, along each axis in turn
+  const RegionType & bregion = ci->GetBufferedRegion();
+  const typename RegionType::IndexType bfirst = bregion.GetIndex();
+  const typename RegionType::IndexType blast = bregion.GetUpperIndex();
 
-  // alloc memory for hessian/tensor
-  m_Dxx = PrecisionImageType::New();
-  m_Dxx->SetOrigin(im->GetOrigin());
-  m_Dxx->SetSpacing(im->GetSpacing());
-  m_Dxx->SetDirection(im->GetDirection());
-  m_Dxx->SetRegions(im->GetLargestPossibleRegion());
-  m_Dxx->Allocate();
-  m_Dxx->FillBuffer(NumericTraits<Precision>::One);
-
-  m_Dxy = PrecisionImageType::New();
-  m_Dxy->SetOrigin(im->GetOrigin());
-  m_Dxy->SetSpacing(im->GetSpacing());
-  m_Dxy->SetDirection(im->GetDirection());
-  m_Dxy->SetRegions(im->GetLargestPossibleRegion());
-  m_Dxy->Allocate();
-  m_Dxy->FillBuffer(NumericTraits<Precision>::Zero);
-
-  m_Dxz = PrecisionImageType::New();
-  m_Dxz->SetOrigin(im->GetOrigin());
-  m_Dxz->SetSpacing(im->GetSpacing());
-  m_Dxz->SetDirection(im->GetDirection());
-  m_Dxz->SetRegions(im->GetLargestPossibleRegion());
-  m_Dxz->Allocate();
-  m_Dxz->FillBuffer(NumericTraits<Precision>::Zero);
-
-  m_Dyy = PrecisionImageType::New();
-  m_Dyy->SetOrigin(im->GetOrigin());
-  m_Dyy->SetSpacing(im->GetSpacing());
-  m_Dyy->SetDirection(im->GetDirection());
-  m_Dyy->SetRegions(im->GetLargestPossibleRegion());
-  m_Dyy->Allocate();
-  m_Dyy->FillBuffer(NumericTraits<Precision>::One);
-
-  m_Dyz = PrecisionImageType::New();
-  m_Dyz->SetOrigin(im->GetOrigin());
-  m_Dyz->SetSpacing(im->GetSpacing());
-  m_Dyz->SetDirection(im->GetDirection());
-  m_Dyz->SetRegions(im->GetLargestPossibleRegion());
-  m_Dyz->Allocate();
-  m_Dyz->FillBuffer(NumericTraits<Precision>::Zero);
-
-  m_Dzz = PrecisionImageType::New();
-  m_Dzz->SetOrigin(im->GetOrigin());
-  m_Dzz->SetSpacing(im->GetSpacing());
-  m_Dzz->SetDirection(im->GetDirection());
-  m_Dzz->SetRegions(im->GetLargestPossibleRegion());
-  m_Dzz->Allocate();
-  m_Dzz->FillBuffer(NumericTraits<Precision>::One);
-
-
-  // create temp vesselness image to store maxvessel
-  typename PrecisionImageType::Pointer vi = PrecisionImageType::New();
-
-  vi->SetOrigin(im->GetOrigin());
-  vi->SetSpacing(im->GetSpacing());
-  vi->SetDirection(im->GetDirection());
-  vi->SetRegions(im->GetLargestPossibleRegion());
-  vi->Allocate();
-  vi->FillBuffer(NumericTraits<Precision>::Zero);
+  const OffsetValueType sy = static_cast<OffsetValueType>(bregion.GetSize(0));
+  const OffsetValueType sz = static_cast<OffsetValueType>(bregion.GetSize(0) * bregion.GetSize(1));
 
+  // fixed weights (timers)
+  const typename PrecisionImageType::SpacingType ispacing = ci->GetSpacing();
+  const Precision rxx = m_TimeStep / (2.0 * ispacing[0] * ispacing[0]);
+  const Precision ryy = m_TimeStep / (2.0 * ispacing[1] * ispacing[1]);
+  const Precision rzz = m_TimeStep / (2.0 * ispacing[2] * ispacing[2]);
+  const Precision rxy = m_TimeStep / (4.0 * ispacing[0] * ispacing[1]);
+  const Precision rxz = m_TimeStep / (4.0 * ispacing[0] * ispacing[2]);
+  const Precision ryz = m_TimeStep / (4.0 * ispacing[1] * ispacing[2]);
+
+  const Precision * c   = ci->GetBufferPointer();
+  const Precision * dxx = m_TensorElements[0];
+  const Precision * dxy = m_TensorElements[1];
+  const Precision * dxz = m_TensorElements[2];
+  const Precision * dyy = m_TensorElements[3];
+  const Precision * dyz = m_TensorElements[4];
+  const Precision * dzz = m_TensorElements[5];
+  Precision *       out = d->GetBufferPointer();
+
+  const OffsetValueType nx = static_cast<OffsetValueType>(region.GetSize(0));
+  const OffsetValueType ny = static_cast<OffsetValueType>(region.GetSize(1));
+  const OffsetValueType nz = static_cast<OffsetValueType>(region.GetSize(2));
+
+  typename RegionType::IndexType index = region.GetIndex();
+
+  for (OffsetValueType z = 0; z < nz; ++z)
+    {
+    index[2] = region.GetIndex(2) + z;
+    const OffsetValueType zp = (index[2] < blast[2]) ? sz : 0;
+    const OffsetValueType zm = (index[2] > bfirst[2]) ? -sz : 0;
+
+    for (OffsetValueType y = 0; y < ny; ++y)
+      {
+      // d is incomplete, it is discarded
+      if (IsCancelled())
+        {
+        return;
+        }
+
+      index[1] = region.GetIndex(1) + y;
+      const OffsetValueType yp = (index[1] < blast[1]) ? sy : 0;
+      const OffsetValueType ym = (index[1] > bfirst[1]) ? -sy : 0;
+
+      for (OffsetValueType x = 0; x < nx; ++x)
+        {
+        index[0] = region.GetIndex(0) + x;
+        const OffsetValueType xp = (index[0] < blast[0]) ? 1 : 0;
+        const OffsetValueType xm = (index[0] > bfirst[0]) ? -1 : 0;
+
+        const OffsetValueType o = ci->ComputeOffset(index);
+
+        // offsets
+        const OffsetValueType oxp = o + xp;
+        const OffsetValueType oxm = o + xm;
+        const OffsetValueType oyp = o + yp;
+        const OffsetValueType oym = o + ym;
+        const OffsetValueType ozp = o + zp;
+        const OffsetValueType ozm = o + zm;
+
+        const OffsetValueType oxpyp = o + xp + yp;
+        const OffsetValueType oxmym = o + xm + ym;
+        const OffsetValueType oxpym = o + xp + ym;
+        const OffsetValueType oxmyp = o + xm + yp;
+
+        const OffsetValueType oxpzp = o + xp + zp;
+        const OffsetValueType oxmzm = o + xm + zm;
+        const OffsetValueType oxpzm = o + xp + zm;
+        const OffsetValueType oxmzp = o + xm + zp;
+
+        const OffsetValueType oypzp = o + yp + zp;
+        const OffsetValueType oymzm = o + ym + zm;
+        const OffsetValueType oypzm = o + yp + zm;
+        const OffsetValueType oymzp = o + ym + zp;
+
+        // weights
+        const Precision xpw = dxx[oxp * TStride] + dxx[o * TStride];
+        const Precision xmw = dxx[oxm * TStride] + dxx[o * TStride];
+        const Precision ypw = dyy[oyp * TStride] + dyy[o * TStride];
+        const Precision ymw = dyy[oym * TStride] + dyy[o * TStride];
+        const Precision zpw = dzz[ozp * TStride] + dzz[o * TStride];
+        const Precision zmw = dzz[ozm * TStride] + dzz[o * TStride];
+
+        const Precision xpyp =   dxy[oxpyp * TStride] + dxy[o * TStride];
+        const Precision xmym =   dxy[oxmym * TStride] + dxy[o * TStride];
+        const Precision xpym = - dxy[oxpym * TStride] - dxy[o * TStride];
+        const Precision xmyp = - dxy[oxmyp * TStride] - dxy[o * TStride];
+
+        const Precision xpzp =   dxz[oxpzp * TStride] + dxz[o * TStride];
+        const Precision xmzm =   dxz[oxmzm * TStride] + dxz[o * TStride];
+        const Precision xpzm = - dxz[oxpzm * TStride] - dxz[o * TStride];
+        const Precision xmzp = - dxz[oxmzp * TStride] - dxz[o * TStride];
+
+        const Precision ypzp =   dyz[oypzp * TStride] + dyz[o * TStride];
+        const Precision ymzm =   dyz[oymzm * TStride] + dyz[o * TStride];
+        const Precision ypzm = - dyz[oypzm * TStride] - dyz[o * TStride];
+        const Precision ymzp = - dyz[oymzp * TStride] - dyz[o * TStride];
+
+        // evolution
+        const Precision cv = c[o];
+        out[o] = cv +
+            + rxx * ( xpw * (c[oxp] - cv)
+                    + xmw * (c[oxm] - cv) )
+            + ryy * ( ypw * (c[oyp] - cv)
+                    + ymw * (c[oym] - cv) )
+            + rzz * ( zpw * (c[ozp] - cv)
+                    + zmw * (c[ozm] - cv) )
+            + rxy * ( xpyp * (c[oxpyp] - cv)
+                    + xmym * (c[oxmym] - cv)
+                    + xpym * (c[oxpym] - cv)
+                    + xmyp * (c[oxmyp] - cv) )
+            + rxz * ( xpzp * (c[oxpzp] - cv)
+                    + xmzm * (c[oxmzm] - cv)
+                    + xpzm * (c[oxpzm] - cv)
+                    + xmzp * (c[oxmzp] - cv) )
+            + ryz * ( ypzp * (c[oypzp] - cv)
+                    + ymzm * (c[oymzm] - cv)
+                    + ypzm * (c[oypzm] - cv)
+                    + ymzp * (c[oymzp] - cv) );
+        }
+      }
+    }
+}
+
+// maxvesselresponse
+template <class PixelType, unsigned int NDimension>
+void VesselEnhancingDiffusion3DImageFilter<PixelType, NDimension>
+::MaxVesselResponse(const PrecisionImageType * im)
+{
+  // the hessian/tensor and the vesselness are written
+  // unconditionally at the first scale, so the buffers
+  // kept from the previous recalculation need no reset
+  if (m_Scales.empty())
+    {
+    const SizeValueType   n = m_Vesselness->GetBufferedRegion().GetNumberOfPixels();
+    const OffsetValueType s = m_UseInterleavedTensor ? InterleavedTensorStride : 1;
+    for (SizeValueType o = 0; o < n; ++o)
+      {
+      m_TensorElements[0][o * s] = NumericTraits<Precision>::One;
+      m_TensorElements[1][o * s] = NumericTraits<Precision>::Zero;
+      m_TensorElements[2][o * s] = NumericTraits<Precision>::Zero;
+      m_TensorElements[3][o * s] = NumericTraits<Precision>::One;
+      m_TensorElements[4][o * s] = NumericTraits<Precision>::Zero;
+      m_TensorElements[5][o * s] = NumericTraits<Precision>::One;
+      }
+    m_Vesselness->FillBuffer(NumericTraits<Precision>::Zero);
+    return;
+    }
 
   for (unsigned int i=0; i< m_Scales.size(); ++i)
     {
-    using HessianType = HessianRecursiveGaussianImageFilter<PrecisionImageType>;
+    using HessianType = HessianRecursiveGaussianImageFilter<PrecisionImageType,HessianImageType>;
     typename HessianType::Pointer hessian = HessianType::New();
     hessian->SetInput(im);
     hessian->SetNormalizeAcrossScale(true);
     hessian->SetSigma(m_Scales[i]);
-    hessian->Update();
-
-    ImageRegionIterator<PrecisionImageType> itxx (m_Dxx, m_Dxx->GetLargestPossibleRegion());
-    ImageRegionIterator<PrecisionImageType> itxy (m_Dxy, m_Dxy->GetLargestPossibleRegion());
-    ImageRegionIterator<PrecisionImageType> itxz (m_Dxz, m_Dxz->GetLargestPossibleRegion());
-    ImageRegionIterator<PrecisionImageType> ityy (m_Dyy, m_Dyy->GetLargestPossibleRegion());
-    ImageRegionIterator<PrecisionImageType> ityz (m_Dyz, m_Dyz->GetLargestPossibleRegion());
-    ImageRegionIterator<PrecisionImageType> itzz (m_Dzz, m_Dzz->GetLargestPossibleRegion());
-    ImageRegionIterator<PrecisionImageType> vit(vi, vi->GetLargestPossibleRegion());
-
-    ImageRegionConstIterator<typename HessianType::OutputImageType> hit
-        (hessian->GetOutput(), hessian->GetOutput()->GetLargestPossibleRegion());
-
-    for (itxx.GoToBegin(), itxy.GoToBegin(), itxz.GoToBegin(),
-            ityy.GoToBegin(), ityz.GoToBegin(), itzz.GoToBegin(),
-            vit.GoToBegin(), hit.GoToBegin(); !vit.IsAtEnd();
-            ++itxx, ++itxy, ++itxz, ++ityy, ++ityz, ++itzz, ++hit, ++vit)
+    hessian->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
       {
-      vnl_matrix<Precision> H(3,3);
+      // the recursive gaussians do not poll the token, they
+      // are aborted from their progress reports instead
+      CancellationToken::AbortObserver abortObserver(m_ActiveCancellationToken, hessian);
+      hessian->Update();
+      }
 
-      H(0,0) = hit.Value()(0,0);
-      H(0,1) = H(1,0) = hit.Value()(0,1);
-      H(0,2) = H(2,0) = hit.Value()(0,2);
-      H(1,1) = hit.Value()(1,1);
-      H(1,2) = H(2,1) = hit.Value()(1,2);
-      H(2,2) = hit.Value()(2,2);
+    // the maximum is taken per voxel, over the slabs
+    // of the image in parallel
+    const HessianImageType * h = hessian->GetOutput();
+    PrecisionImageType *     vp = m_Vesselness.GetPointer();
+    const bool               firstScale = (i == 0);
 
-      vnl_symmetric_eigensystem<Precision> ES(H);
-      vnl_vector<Precision> ev(3);
+    this->GetMultiThreader()->template ParallelizeImageRegion<NDimension>(
+      vp->GetLargestPossibleRegion(),
+      [this, h, vp, firstScale](const RegionType & region)
+        {
+        if (m_UseInterleavedTensor)
+          {
+          if (m_UseClosedFormEigenSystem)
+            {
+            this->template MaxVesselResponseRegion<InterleavedTensorStride>(h, vp, firstScale, region);
+            }
+          else
+            {
+            this->template MaxVesselResponseRegionVnl<InterleavedTensorStride>(h, vp, firstScale, region);
+            }
+          }
+        else
+          {
+          if (m_UseClosedFormEigenSystem)
+            {
+            this->template MaxVesselResponseRegion<1>(h, vp, firstScale, region);
+            }
+          else
+            {
+            this->template MaxVesselResponseRegionVnl<1>(h, vp, firstScale, region);
+            }
+          }
+        },
+      nullptr);
+
+    if (IsCancelled())
+      {
+      return;
+      }
+    }
+}
+
+// maxvesselresponse over a slab, closed form eigenvalues
+template <class PixelType, unsigned int NDimension>
+template <unsigned int TStride>
+void VesselEnhancingDiffusion3DImageFilter<PixelType, NDimension>
+::MaxVesselResponseRegion(const HessianImageType * hessian, PrecisionImageType * vi,
+                          bool firstScale, const RegionType & region)
+{
+  using EigenSystemType = SymmetricEigenSystem3x3<Precision>;
+  constexpr OffsetValueType BatchSize = EigenSystemType::BatchSize;
 
-      ev[0] = ES.get_eigenvalue(0);
-      ev[1] = ES.get_eigenvalue(1);
-      ev[2] = ES.get_eigenvalue(2);
+  // the hessian of a batch of voxels, and its eigenvalues
+  Precision hxx[BatchSize], hxy[BatchSize], hxz[BatchSize];
+  Precision hyy[BatchSize], hyz[BatchSize], hzz[BatchSize];
+  Precision l0[BatchSize], l1[BatchSize], l2[BatchSize];
 
-      if ( vcl_abs(ev[0]) > vcl_abs(ev[1])  ) std::swap(ev[0], ev[1]);
-      if ( vcl_abs(ev[1]) > vcl_abs(ev[2])  ) std::swap(ev[1], ev[2]);
-      if ( vcl_abs(ev[0]) > vcl_abs(ev[1])  ) std::swap(ev[0], ev[1]);
+  Precision * const txx = m_TensorElements[0];
+  Precision * const txy = m_TensorElements[1];
+  Precision * const txz = m_TensorElements[2];
+  Precision * const tyy = m_TensorElements[3];
+  Precision * const tyz = m_TensorElements[4];
+  Precision * const tzz = m_TensorElements[5];
 
-      const Precision vesselness = VesselnessFunction3D(ev[0],ev[1],ev[2]);
+  const OffsetValueType nx = static_cast<OffsetValueType>(region.GetSize(0));
+  const OffsetValueType ny = static_cast<OffsetValueType>(region.GetSize(1));
+  const OffsetValueType nz = static_cast<OffsetValueType>(region.GetSize(2));
 
-      if ( vesselness > 0 && vesselness > vit.Value() )
+  typename RegionType::IndexType rowIndex = region.GetIndex();
+
+  // one row along x at a time, in batches of voxels
+  for (OffsetValueType z = 0; z < nz; ++z)
+    {
+    for (OffsetValueType y = 0; y < ny; ++y)
+      {
+      if (IsCancelled())
+        {
+        return;
+        }
+
+      rowIndex[1] = region.GetIndex(1) + y;
+      rowIndex[2] = region.GetIndex(2) + z;
+      const OffsetValueType o = vi->ComputeOffset(rowIndex);
+
+      const HessianPixelType * h = hessian->GetBufferPointer() + o;
+      Precision *              v = vi->GetBufferPointer() + o;
+
+      for (OffsetValueType b = 0; b < nx; b += BatchSize)
+        {
+        const OffsetValueType n = std::min(BatchSize, nx - b);
+
+        for (OffsetValueType k = 0; k < n; ++k)
+          {
+          const HessianPixelType & H = h[b + k];
+          hxx[k] = H(0,0);
+          hxy[k] = H(0,1);
+          hxz[k] = H(0,2);
+          hyy[k] = H(1,1);
+          hyz[k] = H(1,2);
+          hzz[k] = H(2,2);
+          }
+
+        EigenSystemType::ComputeEigenValues(n, hxx, hxy, hxz, hyy, hyz, hzz, l0, l1, l2);
+
+        for (OffsetValueType k = 0; k < n; ++k)
+          {
+          Precision ev[3] = { l0[k], l1[k], l2[k] };
+
+          if ( vcl_abs(ev[0]) > vcl_abs(ev[1])  ) std::swap(ev[0], ev[1]);
+          if ( vcl_abs(ev[1]) > vcl_abs(ev[2])  ) std::swap(ev[1], ev[2]);
+          if ( vcl_abs(ev[0]) > vcl_abs(ev[1])  ) std::swap(ev[0], ev[1]);
+
+          const Precision vesselness = VesselnessFunction3D(ev[0],ev[1],ev[2]);
+
+          const OffsetValueType t = (o + b + k) * TStride;
+
+          if ( vesselness > 0 && (firstScale || vesselness > v[b + k]) )
+            {
+            v[b + k] = vesselness;
+
+            txx[t] = hxx[k];
+            txy[t] = hxy[k];
+            txz[t] = hxz[k];
+            tyy[t] = hyy[k];
+            tyz[t] = hyz[k];
+            tzz[t] = hzz[k];
+            }
+          else if (firstScale)
+            {
+            v[b + k] = NumericTraits<Precision>::Zero;
+
+            txx[t] = NumericTraits<Precision>::One;
+            txy[t] = NumericTraits<Precision>::Zero;
+            txz[t] = NumericTraits<Precision>::Zero;
+            tyy[t] = NumericTraits<Precision>::One;
+            tyz[t] = NumericTraits<Precision>::Zero;
+            tzz[t] = NumericTraits<Precision>::One;
+            }
+          }
+        }
+      }
+    }
+}
+
+// maxvesselresponse over a slab, vnl eigenvalues
+template <class PixelType, unsigned int NDimension>
+template <unsigned int TStride>
+void VesselEnhancingDiffusion3DImageFilter<PixelType, NDimension>
+::MaxVesselResponseRegionVnl(const HessianImageType * hessian, PrecisionImageType * vi,
+                             bool firstScale, const RegionType & region)
+{
+  Precision * const txx = m_TensorElements[0];
+  Precision * const txy = m_TensorElements[1];
+  Precision * const txz = m_TensorElements[2];
+  Precision * const tyy = m_TensorElements[3];
+  Precision * const tyz = m_TensorElements[4];
+  Precision * const tzz = m_TensorElements[5];
+
+  const OffsetValueType nx = static_cast<OffsetValueType>(region.GetSize(0));
+  const OffsetValueType ny = static_cast<OffsetValueType>(region.GetSize(1));
+  const OffsetValueType nz = static_cast<OffsetValueType>(region.GetSize(2));
+
+  typename RegionType::IndexType rowIndex = region.GetIndex();
+
+  for (OffsetValueType z = 0; z < nz; ++z)
+    {
+    for (OffsetValueType y = 0; y < ny; ++y)
+      {
+      if (IsCancelled())
         {
-        vit.Value() = vesselness;
-
-        itxx.Value() = hit.Value()(0,0);
-        itxy.Value() = hit.Value()(0,1);
-        itxz.Value() = hit.Value()(0,2);
-        ityy.Value() = hit.Value()(1,1);
-        ityz.Value() = hit.Value()(1,2);
-        itzz.Value() = hit.Value()(2,2);
+        return;
+        }
+
+      rowIndex[1] = region.GetIndex(1) + y;
+      rowIndex[2] = region.GetIndex(2) + z;
+      const OffsetValueType o = vi->ComputeOffset(rowIndex);
+
+      const HessianPixelType * h = hessian->GetBufferPointer() + o;
+      Precision *              v = vi->GetBufferPointer() + o;
+
+      for (OffsetValueType i = 0; i < nx; ++i)
+        {
+        vnl_matrix<Precision> H(3,3);
+
+        H(0,0) = h[i](0,0);
+        H(0,1) = H(1,0) = h[i](0,1);
+        H(0,2) = H(2,0) = h[i](0,2);
+        H(1,1) = h[i](1,1);
+        H(1,2) = H(2,1) = h[i](1,2);
+        H(2,2) = h[i](2,2);
+
+        vnl_symmetric_eigensystem<Precision> ES(H);
+        vnl_vector<Precision> ev(3);
+
+        ev[0] = ES.get_eigenvalue(0);
+        ev[1] = ES.get_eigenvalue(1);
+        ev[2] = ES.get_eigenvalue(2);
+
+        if ( vcl_abs(ev[0]) > vcl_abs(ev[1])  ) std::swap(ev[0], ev[1]);
+        if ( vcl_abs(ev[1]) > vcl_abs(ev[2])  ) std::swap(ev[1], ev[2]);
+        if ( vcl_abs(ev[0]) > vcl_abs(ev[1])  ) std::swap(ev[0], ev[1]);
+
+        const Precision vesselness = VesselnessFunction3D(ev[0],ev[1],ev[2]);
+
+        const OffsetValueType t = (o + i) * TStride;
+
+        if ( vesselness > 0 && (firstScale || vesselness > v[i]) )
+          {
+          v[i] = vesselness;
+
+          txx[t] = h[i](0,0);
+          txy[t] = h[i](0,1);
+          txz[t] = h[i](0,2);
+          tyy[t] = h[i](1,1);
+          tyz[t] = h[i](1,2);
+          tzz[t] = h[i](2,2);
+          }
+        else if (firstScale)
+          {
+          v[i] = NumericTraits<Precision>::Zero;
+
+          txx[t] = NumericTraits<Precision>::One;
+          txy[t] = NumericTraits<Precision>::Zero;
+          txz[t] = NumericTraits<Precision>::Zero;
+          tyy[t] = NumericTraits<Precision>::One;
+          tyz[t] = NumericTraits<Precision>::Zero;
+          tzz[t] = NumericTraits<Precision>::One;
+          }
         }
       }
     }
@@ -582,65 +1185,222 @@ template <class PixelType, unsigned int NDimension>
 void VesselEnhancingDiffusion3DImageFilter<PixelType, NDimension>
 ::DiffusionTensor()
 {
-  ImageRegionIterator<PrecisionImageType> itxx (m_Dxx, m_Dxx->GetLargestPossibleRegion());
-  ImageRegionIterator<PrecisionImageType> itxy (m_Dxy, m_Dxy->GetLargestPossibleRegion());
-  ImageRegionIterator<PrecisionImageType> itxz (m_Dxz, m_Dxz->GetLargestPossibleRegion());
-  ImageRegionIterator<PrecisionImageType> ityy (m_Dyy, m_Dyy->GetLargestPossibleRegion());
-  ImageRegionIterator<PrecisionImageType> ityz (m_Dyz, m_Dyz->GetLargestPossibleRegion());
-  ImageRegionIterator<PrecisionImageType> itzz (m_Dzz, m_Dzz->GetLargestPossibleRegion());
-
-  for  ( itxx.GoToBegin(), itxy.GoToBegin(), itxz.GoToBegin(),
-          ityy.GoToBegin(), ityz.GoToBegin(), itzz.GoToBegin();
-          !itxx.IsAtEnd();
-          ++itxx, ++itxy, ++itxz, ++ityy, ++ityz, ++itzz)
-    {
-    vnl_matrix<Precision> H(3,3);
-    H(0,0) = itxx.Value();
-    H(0,1) = H(1,0) = itxy.Value();
-    H(0,2) = H(2,0) = itxz.Value();
-    H(1,1) = ityy.Value();
-    H(1,2) = H(2,1) = ityz.Value();
-    H(2,2) = itzz.Value();
-
-    vnl_symmetric_eigensystem<Precision> ES(H);
-
-    vnl_matrix<Precision> EV(3,3);
-    EV.set_column(0,ES.get_eigenvector(0));
-    EV.set_column(1,ES.get_eigenvector(1));
-    EV.set_column(2,ES.get_eigenvector(2));
-
-    vnl_vector<Precision> ev(3);
-    ev[0] = ES.get_eigenvalue(0);
-    ev[1] = ES.get_eigenvalue(1);
-    ev[2] = ES.get_eigenvalue(2);
-
-    if ( vcl_abs(ev[0]) > vcl_abs(ev[1])  ) std::swap(ev[0], ev[1]);
-    if ( vcl_abs(ev[1]) > vcl_abs(ev[2])  ) std::swap(ev[1], ev[2]);
-    if ( vcl_abs(ev[0]) > vcl_abs(ev[1])  ) std::swap(ev[0], ev[1]);
-
-    const Precision V=VesselnessFunction3D(ev[0],ev[1],ev[2]);
-    vnl_vector<Precision> evn(3);
-
-    // adjusting eigenvalues
-    // static_cast required to prevent error with gcc 4.1.2
-    evn[0]   = 1.0 + (m_Epsilon - 1.0) * vcl_pow(V,static_cast<Precision>(1.0/m_Sensitivity));
-    evn[1]   = 1.0 + (m_Epsilon - 1.0) * vcl_pow(V,static_cast<Precision>(1.0/m_Sensitivity));
-    evn[2]   = 1.0 + (m_Omega - 1.0 ) * vcl_pow(V,static_cast<Precision>(1.0/m_Sensitivity));
-
-    vnl_matrix<Precision> LAM(3,3);
-    LAM.fill(0);
-    LAM(0,0) = evn[0];
-    LAM(1,1) = evn[1];
-    LAM(2,2) = evn[2];
-
-    const vnl_matrix<Precision> HN = EV * LAM * EV.transpose();
-
-    itxx.Value() = HN(0,0);
-    itxy.Value() = HN(0,1);
-    itxz.Value() = HN(0,2);
-    ityy.Value() = HN(1,1);
-    ityz.Value() = HN(1,2);
-    itzz.Value() = HN(2,2);
+  // the tensor of each voxel only depends on its
+  // hessian, the slabs are computed in parallel
+  this->GetMultiThreader()->template ParallelizeImageRegion<NDimension>(
+    m_Vesselness->GetLargestPossibleRegion(),
+    [this](const RegionType & region)
+      {
+      if (m_UseInterleavedTensor)
+        {
+        if (m_UseClosedFormEigenSystem)
+          {
+          this->template DiffusionTensorRegion<InterleavedTensorStride>(region);
+          }
+        else
+          {
+          this->template DiffusionTensorRegionVnl<InterleavedTensorStride>(region);
+          }
+        }
+      else
+        {
+        if (m_UseClosedFormEigenSystem)
+          {
+          this->template DiffusionTensorRegion<1>(region);
+          }
+        else
+          {
+          this->template DiffusionTensorRegionVnl<1>(region);
+          }
+        }
+      },
+    nullptr);
+}
+
+// diffusiontensor over a slab, closed form eigensystem
+template <class PixelType, unsigned int NDimension>
+template <unsigned int TStride>
+void VesselEnhancingDiffusion3DImageFilter<PixelType, NDimension>
+::DiffusionTensorRegion(const RegionType & region)
+{
+  using EigenSystemType = SymmetricEigenSystem3x3<Precision>;
+  constexpr OffsetValueType BatchSize = EigenSystemType::BatchSize;
+
+  // the hessian of a batch of voxels, and its eigenvalues
+  Precision hxx[BatchSize], hxy[BatchSize], hxz[BatchSize];
+  Precision hyy[BatchSize], hyz[BatchSize], hzz[BatchSize];
+  Precision l0[BatchSize], l1[BatchSize], l2[BatchSize];
+
+  // the tensor is computed in place, a batch is
+  // read entirely before any of it is written
+  Precision * const txx = m_TensorElements[0];
+  Precision * const txy = m_TensorElements[1];
+  Precision * const txz = m_TensorElements[2];
+  Precision * const tyy = m_TensorElements[3];
+  Precision * const tyz = m_TensorElements[4];
+  Precision * const tzz = m_TensorElements[5];
+
+  const Precision exponent = static_cast<Precision>(1.0/m_Sensitivity);
+
+  const OffsetValueType nx = static_cast<OffsetValueType>(region.GetSize(0));
+  const OffsetValueType ny = static_cast<OffsetValueType>(region.GetSize(1));
+  const OffsetValueType nz = static_cast<OffsetValueType>(region.GetSize(2));
+
+  typename RegionType::IndexType rowIndex = region.GetIndex();
+
+  // one row along x at a time, in batches of voxels
+  for (OffsetValueType z = 0; z < nz; ++z)
+    {
+    for (OffsetValueType y = 0; y < ny; ++y)
+      {
+      if (IsCancelled())
+        {
+        return;
+        }
+
+      rowIndex[1] = region.GetIndex(1) + y;
+      rowIndex[2] = region.GetIndex(2) + z;
+      const OffsetValueType o = m_Vesselness->ComputeOffset(rowIndex);
+
+      for (OffsetValueType b = 0; b < nx; b += BatchSize)
+        {
+        const OffsetValueType n = std::min(BatchSize, nx - b);
+
+        for (OffsetValueType k = 0; k < n; ++k)
+          {
+          const OffsetValueType t = (o + b + k) * TStride;
+          hxx[k] = txx[t];
+          hxy[k] = txy[t];
+          hxz[k] = txz[t];
+          hyy[k] = tyy[t];
+          hyz[k] = tyz[t];
+          hzz[k] = tzz[t];
+          }
+
+        EigenSystemType::ComputeEigenValues(n, hxx, hxy, hxz, hyy, hyz, hzz, l0, l1, l2);
+
+        for (OffsetValueType k = 0; k < n; ++k)
+          {
+          Precision ev[3] = { l0[k], l1[k], l2[k] };
+
+          if ( vcl_abs(ev[0]) > vcl_abs(ev[1])  ) std::swap(ev[0], ev[1]);
+          if ( vcl_abs(ev[1]) > vcl_abs(ev[2])  ) std::swap(ev[1], ev[2]);
+          if ( vcl_abs(ev[0]) > vcl_abs(ev[1])  ) std::swap(ev[0], ev[1]);
+
+          const Precision V=VesselnessFunction3D(ev[0],ev[1],ev[2]);
+          const Precision VS = vcl_pow(V,exponent);
+
+          // the eigenvalues in ascending order are adjusted to
+          // (a, a, b), so that the tensor is a I + (b - a) e e^T,
+          // with e the eigenvector of the largest eigenvalue
+          const Precision ea = 1.0 + (m_Epsilon - 1.0) * VS;
+          const Precision eb = 1.0 + (m_Omega - 1.0 ) * VS;
+
+          Precision e[3] = { 0, 0, 0 };
+          if (eb != ea)
+            {
+            EigenSystemType::ComputeEigenVector(hxx[k], hxy[k], hxz[k], hyy[k], hyz[k], hzz[k], l2[k], e);
+            }
+          const Precision w = eb - ea;
+
+          const OffsetValueType t = (o + b + k) * TStride;
+          txx[t] = ea + w * e[0] * e[0];
+          txy[t] =      w * e[0] * e[1];
+          txz[t] =      w * e[0] * e[2];
+          tyy[t] = ea + w * e[1] * e[1];
+          tyz[t] =      w * e[1] * e[2];
+          tzz[t] = ea + w * e[2] * e[2];
+          }
+        }
+      }
+    }
+}
+
+// diffusiontensor over a slab, vnl eigensystem
+template <class PixelType, unsigned int NDimension>
+template <unsigned int TStride>
+void VesselEnhancingDiffusion3DImageFilter<PixelType, NDimension>
+::DiffusionTensorRegionVnl(const RegionType & region)
+{
+  Precision * const txx = m_TensorElements[0];
+  Precision * const txy = m_TensorElements[1];
+  Precision * const txz = m_TensorElements[2];
+  Precision * const tyy = m_TensorElements[3];
+  Precision * const tyz = m_TensorElements[4];
+  Precision * const tzz = m_TensorElements[5];
+
+  const OffsetValueType nx = static_cast<OffsetValueType>(region.GetSize(0));
+  const OffsetValueType ny = static_cast<OffsetValueType>(region.GetSize(1));
+  const OffsetValueType nz = static_cast<OffsetValueType>(region.GetSize(2));
+
+  typename RegionType::IndexType rowIndex = region.GetIndex();
+
+  for (OffsetValueType z = 0; z < nz; ++z)
+    {
+    for (OffsetValueType y = 0; y < ny; ++y)
+      {
+      if (IsCancelled())
+        {
+        return;
+        }
+
+      rowIndex[1] = region.GetIndex(1) + y;
+      rowIndex[2] = region.GetIndex(2) + z;
+      const OffsetValueType o = m_Vesselness->ComputeOffset(rowIndex);
+
+      for (OffsetValueType i = 0; i < nx; ++i)
+        {
+        const OffsetValueType t = (o + i) * TStride;
+
+        vnl_matrix<Precision> H(3,3);
+        H(0,0) = txx[t];
+        H(0,1) = H(1,0) = txy[t];
+        H(0,2) = H(2,0) = txz[t];
+        H(1,1) = tyy[t];
+        H(1,2) = H(2,1) = tyz[t];
+        H(2,2) = tzz[t];
+
+        vnl_symmetric_eigensystem<Precision> ES(H);
+
+        vnl_matrix<Precision> EV(3,3);
+        EV.set_column(0,ES.get_eigenvector(0));
+        EV.set_column(1,ES.get_eigenvector(1));
+        EV.set_column(2,ES.get_eigenvector(2));
+
+        vnl_vector<Precision> ev(3);
+        ev[0] = ES.get_eigenvalue(0);
+        ev[1] = ES.get_eigenvalue(1);
+        ev[2] = ES.get_eigenvalue(2);
+
+        if ( vcl_abs(ev[0]) > vcl_abs(ev[1])  ) std::swap(ev[0], ev[1]);
+        if ( vcl_abs(ev[1]) > vcl_abs(ev[2])  ) std::swap(ev[1], ev[2]);
+        if ( vcl_abs(ev[0]) > vcl_abs(ev[1])  ) std::swap(ev[0], ev[1]);
+
+        const Precision V=VesselnessFunction3D(ev[0],ev[1],ev[2]);
+        vnl_vector<Precision> evn(3);
+
+        // adjusting eigenvalues
+        // static_cast required to prevent error with gcc 4.1.2
+        evn[0]   = 1.0 + (m_Epsilon - 1.0) * vcl_pow(V,static_cast<Precision>(1.0/m_Sensitivity));
+        evn[1]   = 1.0 + (m_Epsilon - 1.0) * vcl_pow(V,static_cast<Precision>(1.0/m_Sensitivity));
+        evn[2]   = 1.0 + (m_Omega - 1.0 ) * vcl_pow(V,static_cast<Precision>(1.0/m_Sensitivity));
+
+        vnl_matrix<Precision> LAM(3,3);
+        LAM.fill(0);
+        LAM(0,0) = evn[0];
+        LAM(1,1) = evn[1];
+        LAM(2,2) = evn[2];
+
+        const vnl_matrix<Precision> HN = EV * LAM * EV.transpose();
+
+        txx[t] = HN(0,0);
+        txy[t] = HN(0,1);
+        txz[t] = HN(0,2);
+        tyy[t] = HN(1,1);
+        tyz[t] = HN(1,2);
+        tzz[t] = HN(2,2);
+        }
+      }
     }
 }
 
@@ -654,11 +1414,7 @@ void VesselEnhancingDiffusion3DImageFilter<PixelType, NDimension>
     std::cout << std::endl << "begin vesselenhancingdiffusion3Dimagefilter ... " << std::endl;
     }
 
-  using MinMaxType = MinimumMaximumImageFilter<ImageType>;
-  typename MinMaxType::Pointer minmax = MinMaxType::New();
-
-  minmax->SetInput(this->GetInput());
-  minmax->Update();
+  m_ActiveCancellationToken = CancellationToken::Resolve(m_CancellationToken);
 
   const typename ImageType::SpacingType ispacing = this->GetInput()->GetSpacing();
   const Precision htmax = 0.5 /
@@ -674,12 +1430,20 @@ void VesselEnhancingDiffusion3DImageFilter<PixelType, NDimension>
   if (m_TimeStep> htmax)
     {
     std::cerr << "the time step size is too large!" << std::endl;
+    m_ActiveCancellationToken = nullptr;
     this->AllocateOutputs();
     return;
     }
 
+  // the extrema are only reported
   if (m_Verbose)
     {
+    using MinMaxType = MinimumMaximumImageFilter<ImageType>;
+    typename MinMaxType::Pointer minmax = MinMaxType::New();
+
+    minmax->SetInput(this->GetInput());
+    minmax->Update();
+
     std::cout << "min/max             \t" << minmax->GetMinimum() << " " << minmax->GetMaximum() << std::endl;
     std::cout << "iterations/timestep \t" << m_Iterations << " " << m_TimeStep << std::endl;
     std::cout << "recalc v            \t" << m_RecalculateVesselness << std::endl;
@@ -697,7 +1461,16 @@ void VesselEnhancingDiffusion3DImageFilter<PixelType, NDimension>
   using CT = CastImageFilter<ImageType,PrecisionImageType>;
   typename CT::Pointer cast = CT::New();
   cast->SetInput(this->GetInput());
-  cast->Update();
+  try
+    {
+    CancellationToken::AbortObserver abortObserver(m_ActiveCancellationToken, cast);
+    cast->Update();
+    }
+  catch (ProcessAborted &)
+    {
+    m_ActiveCancellationToken = nullptr;
+    throw;
+    }
 
   typename PrecisionImageType::Pointer ci = cast->GetOutput();
 
@@ -707,18 +1480,63 @@ void VesselEnhancingDiffusion3DImageFilter<PixelType, NDimension>
     std::cout << "start algorithm ... " << std::endl;
     }
 
-  for (m_CurrentIteration=1; m_CurrentIteration<=m_Iterations; m_CurrentIteration++)
+  // the phases of the iterations are split over
+  // as many slabs as the work units of the filter
+  this->GetMultiThreader()->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
+
+  // the hessian/tensor, the vesselness and the second
+  // iterate are allocated once for all the iterations
+  AllocateTensor(ci);
+  m_Vesselness = AllocatePrecisionImage(ci);
+
+  typename PrecisionImageType::Pointer next = AllocatePrecisionImage(ci);
+
+  // a cancelled iteration, or an aborted hessian, leaves
+  // no complete result, the output is not generated
+  bool cancelled = false;
+  try
     {
-    VED3DSingleIteration (ci);
+    for (m_CurrentIteration=1; m_CurrentIteration<=m_Iterations; m_CurrentIteration++)
+      {
+      VED3DSingleIteration (ci, next);
+      if (IsCancelled())
+        {
+        cancelled = true;
+        break;
+        }
+      // the new iterate becomes the current one, the
+      // old one is overwritten by the next iteration
+      std::swap(ci, next);
+      }
+    }
+  catch (...)
+    {
+    next = nullptr;
+    m_Vesselness = nullptr;
+    ReleaseTensor();
+    m_ActiveCancellationToken = nullptr;
+    throw;
     }
 
-  using MMT = MinimumMaximumImageFilter<PrecisionImageType>;
-  typename MMT::Pointer mm = MMT::New();
-  mm->SetInput(ci);
-  mm->Update();
+  m_ActiveCancellationToken = nullptr;
+
+  // give the buffers back to the pool
+  next = nullptr;
+  m_Vesselness = nullptr;
+  ReleaseTensor();
+
+  if (cancelled)
+    {
+    CancellationToken::ThrowProcessAborted(this);
+    }
 
   if (m_Verbose)
     {
+    using MMT = MinimumMaximumImageFilter<PrecisionImageType>;
+    typename MMT::Pointer mm = MMT::New();
+    mm->SetInput(ci);
+    mm->Update();
+
     std::cout << std::endl;
     std::cout << "min/max             \t" << mm->GetMinimum() << " " << mm->GetMaximum() << std::endl;
     std::cout << "end vesselenhancingdiffusion3Dimagefilter" << std::endl;
@@ -19,7 +19,10 @@
 
 #include "itkImage.h"
 #include "itkVotingBinaryImageFilter.h"
+#include "itkImageBufferPool.h"
+#include "itkCancellationToken.h"
 
+#include <cstdint>
 #include <vector>
 
 namespace itk
@@ -33,6 +36,24 @@ namespace itk
  * This is an alternative implementation of the
  * VotingBinaryIterativeHoleFillingImageFilter.
  *
+ * Every iteration visits the seeds of the front on several threads. The
+ * quorum of a seed is evaluated on the output of the previous iteration,
+ * and the seeds found by each thread are merged in the order of the front,
+ * therefore the result does not depend on the number of threads.
+ *
+ * Pixels only ever change from background to foreground, so a seed that
+ * fails the quorum would fail it again until one of its neighbors changes.
+ * Such a seed leaves the front, unvisited, and only goes back to it when a
+ * neighbor reaches the quorum. The work of an
+ * iteration is then proportional to the pixels that changed in the previous
+ * one, not to the size of the front.
+ *
+ * When UseBitPackedImages is ON, the default, the foreground pixels and the
+ * state of the other pixels are kept as bits, packed along the rows of the
+ * image in 64 bit words. The foreground neighbors of a seed are then counted
+ * with one population count per row of the neighborhood, instead of one
+ * comparison per neighbor. The result is the same as with the images.
+ *
  * \ingroup RegionGrowingSegmentation 
  * \ingroup LesionSizingToolkit
  */
@@ -94,6 +115,26 @@ public:
   /** Returned the number of pixels changed in total. */
   itkGetMacro( TotalNumberOfPixelsChanged, unsigned int );
 
+  /** Pool from which the seeds mask is allocated, and to which it is
+   * returned at the end of every run. Defaults to the global pool, a null
+   * pool allocates from the heap. */
+  itkSetObjectMacro( BufferPool, ImageBufferPool );
+  itkGetModifiableObjectMacro( BufferPool, ImageBufferPool );
+
+  /** Token polled by the front propagation. Once the token is cancelled
+   * the filter releases its working memory and throws ProcessAborted, its
+   * output being left out of date. Defaults to null, in which case the
+   * current token of the executing thread, if any, is polled. */
+  itkSetObjectMacro( CancellationToken, CancellationToken );
+  itkGetModifiableObjectMacro( CancellationToken, CancellationToken );
+
+  /** Propagate the front on bit planes instead of the output image and the
+   * seeds mask. It is ignored when the neighborhood is wider than 64 pixels
+   * along the first dimension. Defaults to ON. */
+  itkSetMacro( UseBitPackedImages, bool );
+  itkGetConstMacro( UseBitPackedImages, bool );
+  itkBooleanMacro( UseBitPackedImages );
+
 
 #ifdef ITK_USE_CONCEPT_CHECKING
   /** Begin concept checking */
@@ -131,9 +172,72 @@ private:
 
   void ClearSecondSeedArray();
 
-  bool TestForQuorumAtCurrentPixel() const;
- 
-  void PutCurrentPixelNeighborsIntoSeedArray();
+  /** Free the fronts, the visit buffers and the bit planes. */
+  void ReleaseWorkingMemory();
+
+  bool IsCancelled() const
+    {
+    return this->m_ActiveCancellationToken && this->m_ActiveCancellationToken->IsCancellationRequested();
+    }
+
+  /** Seeds are stored as offsets in the buffer of the output image, which
+   * is also the one of the seeds mask. */
+  using SeedArrayType = std::vector< OffsetValueType >;
+
+  /** States of the pixels in the seeds mask. Pixels become visited when
+   * they reach the foreground, boundary pixels are visited from the start.
+   * Seeds that fail the quorum are unvisited again. */
+  enum SeedMaskValueType : unsigned char
+    {
+    UnvisitedPixel = 0,
+    FrontPixel = 2,
+    VisitedPixel = 255
+    };
+
+  /** Neighbors of the seeds of a range of the front that reached the
+   * quorum. They go to the next front if they are neither visited nor
+   * already in it when the ranges are merged. */
+  struct SeedVisitBufferType
+    {
+    SeedArrayType                   Seeds;
+    unsigned int                    NumberOfPixelsChanged;
+    };
+
+  /** The visits are compiled for the neighborhoods of radius VRadius along
+   * all the dimensions, so that the loops over the neighbors have a known
+   * trip count. VRadius is zero for the neighborhoods of any other radius. */
+  template <unsigned int VRadius>
+  void VisitSeedsInRange( SizeValueType begin, SizeValueType end, SeedVisitBufferType & buffer );
+
+  void MergeSeedVisitBuffers();
+
+  template <unsigned int VRadius>
+  bool TestForQuorumAtPixel( OffsetValueType offset ) const;
+
+  template <unsigned int VRadius>
+  void PutPixelNeighborsIntoSeedVisitBuffer( OffsetValueType offset, SeedVisitBufferType & buffer ) const;
+
+  /** Bit plane counterparts of the methods above. */
+  void PackBitPlanes();
+
+  template <unsigned int VRadius>
+  bool TestForQuorumInBitPlanes( OffsetValueType offset ) const;
+
+  template <unsigned int VRadius>
+  void PutPixelNeighborsIntoSeedVisitBufferFromBitPlanes( OffsetValueType offset,
+    SeedVisitBufferType & buffer ) const;
+
+  using BitWordType = std::uint64_t;
+  using BitPlaneType = std::vector< BitWordType >;
+
+  /** Bits [start, start + length) of a row, with length of at most 64. */
+  static BitWordType GetBitWindow( const BitWordType * row, OffsetValueType start, unsigned int length );
+
+  static unsigned int CountBits( BitWordType word );
+
+  /** Word of a bit plane holding the pixel at the given buffer offset, and
+   * the bit of the pixel in that word. */
+  BitWordType & GetBitPlaneWord( BitPlaneType & plane, OffsetValueType offset, BitWordType & bit ) const;
 
   void ComputeArrayOfNeighborhoodBufferOffsets();
 
@@ -141,15 +245,30 @@ private:
 
   unsigned int GetNeighborhoodSize() const;
 
-  itkSetMacro( CurrentPixelIndex, IndexType );
-  itkGetConstReferenceMacro( CurrentPixelIndex, IndexType );
+  /** Number of pixels of a neighborhood of the given radius along all the
+   * dimensions. */
+  static constexpr unsigned int GetFixedNeighborhoodSize( unsigned int radius, unsigned int dimension )
+    {
+    return ( dimension == 0 ) ? 1 : ( 2 * radius + 1 ) * GetFixedNeighborhoodSize( radius, dimension - 1 );
+    }
 
-  unsigned int                      m_MajorityThreshold;
+  /** Number of neighbors, width of a row of the neighborhood and number of
+   * rows, known at compile time when VRadius is not zero. */
+  template <unsigned int VRadius>
+  unsigned int GetNumberOfNeighbors() const;
 
-  using SeedArrayType = std::vector<IndexType>;
+  template <unsigned int VRadius>
+  unsigned int GetNeighborhoodRowWidth() const;
 
-  SeedArrayType *                   m_SeedArray1;
-  SeedArrayType *                   m_SeedArray2;
+  template <unsigned int VRadius>
+  unsigned int GetNumberOfNeighborhoodRows() const;
+
+  unsigned int                      m_MajorityThreshold;
+
+  // The arrays are swapped and cleared, never freed, between iterations so
+  // that their capacity is reused.
+  SeedArrayType                     m_SeedArray1;
+  SeedArrayType                     m_SeedArray2;
 
   InputImageRegionType              m_InternalRegion;
   
@@ -162,7 +281,11 @@ private:
   unsigned int                      m_NumberOfPixelsChangedInLastIteration;
   unsigned int                      m_TotalNumberOfPixelsChanged;
   
-  IndexType                         m_CurrentPixelIndex;
+  /** Below this number of seeds per thread, the front is visited on fewer
+   * threads. */
+  static constexpr SizeValueType    MinimumNumberOfSeedsPerWorkUnit = 256;
+
+  std::vector< SeedVisitBufferType > m_SeedVisitBuffers;
 
   //
   // Variables used for addressing the Neighbors.
@@ -174,6 +297,29 @@ private:
 
   NeighborOffsetArrayType           m_NeighborBufferOffset;
 
+  /** Radius of the neighborhood if the visits are compiled for it, zero
+   * otherwise. */
+  unsigned int                      m_FixedRadius;
+
+  //
+  // Bit planes of the foreground pixels and of the pixels in each state of
+  // the seeds mask but the unvisited one, one bit per pixel, every row of
+  // the buffered region starting on a new word.
+  //
+  bool                              m_UseBitPackedImages;
+  bool                              m_PropagateOnBitPlanes;
+
+  BitPlaneType                      m_ForegroundBits;
+  BitPlaneType                      m_VisitedBits;
+  BitPlaneType                      m_FrontBits;
+
+  OffsetValueType                   m_RowLength;
+  OffsetValueType                   m_WordsPerRow;
+
+  /** Offset, in rows of the buffered region, of every row of the
+   * neighborhood relative to the row of its center. */
+  NeighborOffsetArrayType           m_NeighborRowOffsets;
+
 
   //
   // Helper cache variables 
@@ -186,6 +332,11 @@ private:
 
   SeedMaskImagePointer              m_SeedsMask;
 
+  ImageBufferPool::Pointer          m_BufferPool;
+
+  CancellationToken::Pointer        m_CancellationToken;
+  CancellationToken::Pointer        m_ActiveCancellationToken;
+
   using NeighborhoodType = itk::Neighborhood< InputImagePixelType, InputImageDimension >;
 
   NeighborhoodType                  m_Neighborhood;
@@ -25,6 +25,12 @@
 #include "itkOffset.h"
 #include "itkProgressReporter.h"
 
+#include <algorithm>
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
 namespace itk
 {
 
@@ -41,12 +47,19 @@ VotingBinaryHoleFillFloodingImageFilter<TInputImage, TOutputImage>
   this->m_NumberOfPixelsChangedInLastIteration = 0;
   this->m_TotalNumberOfPixelsChanged = 0;
 
-  this->m_SeedArray1 = new SeedArrayType;
-  this->m_SeedArray2 = new SeedArrayType;
-
   this->m_OutputImage = nullptr;
 
   this->m_MajorityThreshold = 1;
+
+  this->m_UseBitPackedImages = true;
+  this->m_PropagateOnBitPlanes = false;
+  this->m_FixedRadius = 0;
+  this->m_RowLength = 0;
+  this->m_WordsPerRow = 0;
+
+  this->m_BufferPool = ImageBufferPool::GetGlobalPool();
+  this->m_CancellationToken = nullptr;
+  this->m_ActiveCancellationToken = nullptr;
 }
 
 /**
@@ -56,8 +69,6 @@ template <class TInputImage, class TOutputImage>
 VotingBinaryHoleFillFloodingImageFilter<TInputImage, TOutputImage>
 ::~VotingBinaryHoleFillFloodingImageFilter()
 {
-  delete this->m_SeedArray1;
-  delete this->m_SeedArray2;
 }
 
 
@@ -70,6 +81,9 @@ VotingBinaryHoleFillFloodingImageFilter<TInputImage, TOutputImage>
 ::PrintSelf(std::ostream& os, Indent indent) const
 {
   this->Superclass::PrintSelf(os, indent);
+  os << indent << "BufferPool: " << this->m_BufferPool.GetPointer() << std::endl;
+  os << indent << "UseBitPackedImages: " << this->m_UseBitPackedImages << std::endl;
+  os << indent << "CancellationToken: " << this->m_CancellationToken.GetPointer() << std::endl;
 }
 
 
@@ -78,12 +92,68 @@ void
 VotingBinaryHoleFillFloodingImageFilter<TInputImage,TOutputImage>
 ::GenerateData()
 {
+  this->m_ActiveCancellationToken = CancellationToken::Resolve( this->m_CancellationToken );
+
   this->AllocateOutputImageWorkingMemory();
   this->InitializeNeighborhood();
   this->ComputeBirthThreshold();
   this->ComputeArrayOfNeighborhoodBufferOffsets();
   this->FindAllPixelsInTheBoundaryAndAddThemAsSeeds();
+
+  const InputSizeType & radius = this->GetRadius();
+
+  // Use the visits compiled for the radius, if any.
+  bool isotropic = true;
+  for( unsigned int d = 1; d < InputImageDimension; d++ )
+    {
+    isotropic = isotropic && ( radius[d] == radius[0] );
+    }
+
+  this->m_FixedRadius = 0;
+  if( isotropic && ( radius[0] == 1 || radius[0] == 3 ) )
+    {
+    this->m_FixedRadius = static_cast< unsigned int >( radius[0] );
+    }
+
+  this->m_PropagateOnBitPlanes = this->m_UseBitPackedImages &&
+    2 * radius[0] + 1 <= 8 * sizeof( BitWordType ) &&
+    this->GetForegroundValue() != this->GetBackgroundValue();
+
+  if( this->m_PropagateOnBitPlanes )
+    {
+    // The bit planes replace the seeds mask from now on.
+    this->PackBitPlanes();
+    this->m_SeedsMask = nullptr;
+    }
+
   this->IterateFrontPropagations();
+
+  // Give the mask back to the pool for the next run.
+  this->m_SeedsMask = nullptr;
+
+  if( this->IsCancelled() )
+    {
+    this->ReleaseWorkingMemory();
+    this->m_ActiveCancellationToken = nullptr;
+    CancellationToken::ThrowProcessAborted( this );
+    }
+
+  this->m_ActiveCancellationToken = nullptr;
+}
+
+
+template <class TInputImage, class TOutputImage>
+void
+VotingBinaryHoleFillFloodingImageFilter<TInputImage,TOutputImage>
+::ReleaseWorkingMemory()
+{
+  SeedArrayType().swap( this->m_SeedArray1 );
+  SeedArrayType().swap( this->m_SeedArray2 );
+  SeedNewValuesArrayType().swap( this->m_SeedsNewValues );
+  std::vector< SeedVisitBufferType >().swap( this->m_SeedVisitBuffers );
+  BitPlaneType().swap( this->m_ForegroundBits );
+  BitPlaneType().swap( this->m_VisitedBits );
+  BitPlaneType().swap( this->m_FrontBits );
 }
 
 
@@ -107,7 +177,7 @@ VotingBinaryHoleFillFloodingImageFilter<TInputImage,TOutputImage>
     progress.CompletedPixel();   // not really a pixel but an iteration
     this->InvokeEvent( IterationEvent() );
     
-    if( this->m_NumberOfPixelsChangedInLastIteration ==  0 )
+    if( this->m_NumberOfPixelsChangedInLastIteration ==  0 || this->IsCancelled() )
       {
       break;
       }
@@ -130,7 +200,7 @@ VotingBinaryHoleFillFloodingImageFilter<TInputImage,TOutputImage>
 
   this->m_SeedsMask = SeedMaskImageType::New();
   this->m_SeedsMask->SetRegions( region );
-  this->m_SeedsMask->Allocate();
+  ImageBufferPool::Allocate( this->m_SeedsMask.GetPointer(), this->m_BufferPool );
   this->m_SeedsMask->FillBuffer( 0 );
 }
 
@@ -178,7 +248,7 @@ VotingBinaryHoleFillFloodingImageFilter<TInputImage,TOutputImage>
   exIt.SetExclusionRegion( this->m_InternalRegion );
   for (exIt.GoToBegin(); !exIt.IsAtEnd(); ++exIt)
     {
-    exIt.Set( 255 );
+    exIt.Set( VisitedPixel );
     }
 
   bit = ConstNeighborhoodIterator<InputImageType>( radius, inputImage, this->m_InternalRegion );
@@ -194,7 +264,8 @@ VotingBinaryHoleFillFloodingImageFilter<TInputImage,TOutputImage>
   const InputImagePixelType foregroundValue = this->GetForegroundValue();
   const InputImagePixelType backgroundValue = this->GetBackgroundValue();
   
-  this->m_SeedArray1->clear();
+  this->m_SeedArray1.clear();
+  this->m_SeedArray2.clear();
   this->m_SeedsNewValues.clear();
 
   while ( ! bit.IsAtEnd() )
@@ -202,12 +273,12 @@ VotingBinaryHoleFillFloodingImageFilter<TInputImage,TOutputImage>
     if( bit.GetCenterPixel() == foregroundValue )
       {
       itr.Set( foregroundValue );
-      mtr.Set( 255 );
+      mtr.Set( VisitedPixel );
       }
     else
       {
       itr.Set( backgroundValue );
-      mtr.Set( 0 );
+      mtr.Set( UnvisitedPixel );
       
       // Search for foreground pixels in the neighborhood
       for (unsigned int i = 0; i < neighborhoodSize; ++i)
@@ -215,7 +286,8 @@ VotingBinaryHoleFillFloodingImageFilter<TInputImage,TOutputImage>
         InputImagePixelType value = bit.GetPixel(i);
         if( value == foregroundValue )
           {
-          this->m_SeedArray1->push_back( bit.GetIndex() );
+          this->m_SeedArray1.push_back( this->m_OutputImage->ComputeOffset( bit.GetIndex() ) );
+          mtr.Set( FrontPixel );
           break;
           }
         }
@@ -224,7 +296,7 @@ VotingBinaryHoleFillFloodingImageFilter<TInputImage,TOutputImage>
     ++itr;
     ++mtr;
     }
-  this->m_SeedsNewValues.reserve( this->m_SeedArray1->size() ); 
+  this->m_SeedsNewValues.reserve( this->m_SeedArray1.size() );
 }
 
 
@@ -233,35 +305,57 @@ void
 VotingBinaryHoleFillFloodingImageFilter<TInputImage,TOutputImage>
 ::VisitAllSeedsAndTransitionTheirState()
 {
-  using SeedIterator = typename SeedArrayType::const_iterator;
+  const SizeValueType numberOfSeeds = this->m_SeedArray1.size();
 
-  SeedIterator seedItr = this->m_SeedArray1->begin();
+  // One new value per seed, written by the thread that visits the seed.
+  this->m_SeedsNewValues.resize( numberOfSeeds );
 
-  this->m_NumberOfPixelsChangedInLastIteration = 0;
+  // Split the front in contiguous ranges, one per work unit, unless the
+  // front is too small to be worth it.
+  SizeValueType numberOfRanges = numberOfSeeds / MinimumNumberOfSeedsPerWorkUnit;
+  numberOfRanges = std::max< SizeValueType >( 1,
+    std::min< SizeValueType >( numberOfRanges, this->GetNumberOfWorkUnits() ) );
 
-  // Clear the array of new values
-  this->m_SeedsNewValues.clear();
+  this->m_SeedVisitBuffers.resize( numberOfRanges );
 
-  while( seedItr != this->m_SeedArray1->end() )
+  auto visitRange = [this, numberOfSeeds, numberOfRanges]( SizeValueType rangeId )
     {
-    this->m_CurrentPixelIndex = *seedItr;
-
-    if( this->TestForQuorumAtCurrentPixel() )
-      {
-      this->m_SeedsNewValues.push_back( this->GetForegroundValue() );
-      this->PutCurrentPixelNeighborsIntoSeedArray();
-      this->m_NumberOfPixelsChangedInLastIteration++;
-      }
-    else
+    const SizeValueType begin = numberOfSeeds * rangeId / numberOfRanges;
+    const SizeValueType end = numberOfSeeds * ( rangeId + 1 ) / numberOfRanges;
+    SeedVisitBufferType & buffer = this->m_SeedVisitBuffers[rangeId];
+    switch( this->m_FixedRadius )
       {
-      this->m_SeedsNewValues.push_back( this->GetBackgroundValue() );
-      // Keep the seed to try again in the next iteration.
-      this->m_SeedArray2->push_back( this->GetCurrentPixelIndex() );
+      case 1:
+        this->template VisitSeedsInRange< 1 >( begin, end, buffer );
+        break;
+      case 3:
+        this->template VisitSeedsInRange< 3 >( begin, end, buffer );
+        break;
+      default:
+        this->template VisitSeedsInRange< 0 >( begin, end, buffer );
+        break;
       }
+    };
+
+  if( numberOfRanges > 1 )
+    {
+    this->GetMultiThreader()->ParallelizeArray( 0, numberOfRanges, visitRange, nullptr );
+    }
+  else
+    {
+    visitRange( 0 );
+    }
 
-    ++seedItr;
+  // A cancelled visit may have left seeds without a new value, keep the
+  // output of the previous iteration.
+  if( this->IsCancelled() )
+    {
+    this->m_NumberOfPixelsChangedInLastIteration = 0;
+    return;
     }
 
+  this->MergeSeedVisitBuffers();
+
   this->PasteNewSeedValuesToOutputImage();
    
   this->m_TotalNumberOfPixelsChanged += this->m_NumberOfPixelsChangedInLastIteration;
@@ -275,6 +369,137 @@ VotingBinaryHoleFillFloodingImageFilter<TInputImage,TOutputImage>
 }
 
 
+template <class TInputImage, class TOutputImage>
+template <unsigned int VRadius>
+void 
+VotingBinaryHoleFillFloodingImageFilter<TInputImage,TOutputImage>
+::VisitSeedsInRange( SizeValueType begin, SizeValueType end, SeedVisitBufferType & buffer )
+{
+  // The output image and the seeds mask are only read here, they are
+  // modified once all the ranges have been visited. Seeds that fail the
+  // quorum leave the front when the ranges are merged.
+  buffer.Seeds.clear();
+  buffer.NumberOfPixelsChanged = 0;
+
+  const OutputImagePixelType foregroundValue = this->GetForegroundValue();
+  const OutputImagePixelType backgroundValue = this->GetBackgroundValue();
+
+  for( SizeValueType seedId = begin; seedId < end; ++seedId )
+    {
+    if( ( seedId - begin ) % CancellationToken::PollingInterval == 0 && this->IsCancelled() )
+      {
+      return;
+      }
+
+    const OffsetValueType offset = this->m_SeedArray1[seedId];
+
+    const bool quorum = this->m_PropagateOnBitPlanes ?
+      this->template TestForQuorumInBitPlanes< VRadius >( offset ) :
+      this->template TestForQuorumAtPixel< VRadius >( offset );
+
+    if( quorum )
+      {
+      this->m_SeedsNewValues[seedId] = foregroundValue;
+      if( this->m_PropagateOnBitPlanes )
+        {
+        this->template PutPixelNeighborsIntoSeedVisitBufferFromBitPlanes< VRadius >( offset, buffer );
+        }
+      else
+        {
+        this->template PutPixelNeighborsIntoSeedVisitBuffer< VRadius >( offset, buffer );
+        }
+      buffer.NumberOfPixelsChanged++;
+      }
+    else
+      {
+      this->m_SeedsNewValues[seedId] = backgroundValue;
+      }
+    }
+}
+
+
+template <class TInputImage, class TOutputImage>
+void 
+VotingBinaryHoleFillFloodingImageFilter<TInputImage,TOutputImage>
+::MergeSeedVisitBuffers()
+{
+  //
+  // The seeds of the front are first either visited or unvisited again,
+  // then the neighbors of the seeds that reached the quorum enter the next
+  // front, the unvisited ones among them. A seed that failed the quorum next to one
+  // that reached it is therefore back in the next front.
+  //
+  // Visiting the buffers in the order of the ranges produces the same next
+  // front, in the same order, as visiting all the seeds on a single thread.
+  // A neighbor found by several seeds only enters the front once.
+  //
+  this->m_NumberOfPixelsChangedInLastIteration = 0;
+
+  const OutputImagePixelType foregroundValue = this->GetForegroundValue();
+
+  const SizeValueType numberOfSeeds = this->m_SeedArray1.size();
+
+  if( this->m_PropagateOnBitPlanes )
+    {
+    BitWordType bit;
+
+    for( SizeValueType seedId = 0; seedId < numberOfSeeds; ++seedId )
+      {
+      const OffsetValueType offset = this->m_SeedArray1[seedId];
+      this->GetBitPlaneWord( this->m_FrontBits, offset, bit ) &= ~bit;
+      if( this->m_SeedsNewValues[seedId] == foregroundValue )
+        {
+        this->GetBitPlaneWord( this->m_VisitedBits, offset, bit ) |= bit;
+        }
+      }
+
+    for( SeedVisitBufferType & buffer : this->m_SeedVisitBuffers )
+      {
+      this->m_NumberOfPixelsChangedInLastIteration += buffer.NumberOfPixelsChanged;
+
+      for( const OffsetValueType offset : buffer.Seeds )
+        {
+        BitWordType & frontWord = this->GetBitPlaneWord( this->m_FrontBits, offset, bit );
+        const BitWordType visitedWord = this->GetBitPlaneWord( this->m_VisitedBits, offset, bit );
+        if( ( ( frontWord | visitedWord ) & bit ) == 0 )
+          {
+          this->m_SeedArray2.push_back( offset );
+          frontWord |= bit;
+          }
+        }
+
+      buffer.Seeds.clear();
+      }
+
+    return;
+    }
+
+  unsigned char * mask = this->m_SeedsMask->GetBufferPointer();
+
+  for( SizeValueType seedId = 0; seedId < numberOfSeeds; ++seedId )
+    {
+    mask[ this->m_SeedArray1[seedId] ] =
+      ( this->m_SeedsNewValues[seedId] == foregroundValue ) ? VisitedPixel : UnvisitedPixel;
+    }
+
+  for( SeedVisitBufferType & buffer : this->m_SeedVisitBuffers )
+    {
+    this->m_NumberOfPixelsChangedInLastIteration += buffer.NumberOfPixelsChanged;
+
+    for( const OffsetValueType offset : buffer.Seeds )
+      {
+      if( mask[offset] == UnvisitedPixel )
+        {
+        this->m_SeedArray2.push_back( offset );
+        mask[offset] = FrontPixel;
+        }
+      }
+
+    buffer.Seeds.clear();
+    }
+}
+
+
 template <class TInputImage, class TOutputImage>
 void 
 VotingBinaryHoleFillFloodingImageFilter<TInputImage,TOutputImage>
@@ -283,19 +508,36 @@ VotingBinaryHoleFillFloodingImageFilter<TInputImage,TOutputImage>
   //
   //  Paste new values into the output image
   //
-  using SeedIterator = typename SeedArrayType::const_iterator;
+  OutputImagePixelType * buffer = this->m_OutputImage->GetBufferPointer();
+
+  const SizeValueType numberOfSeeds = this->m_SeedArray1.size();
+
+  for( SizeValueType seedId = 0; seedId < numberOfSeeds; ++seedId )
+    {
+    buffer[ this->m_SeedArray1[seedId] ] = this->m_SeedsNewValues[seedId];
+    }
 
-  SeedIterator seedItr = this->m_SeedArray1->begin();
+  if( !this->m_PropagateOnBitPlanes )
+    {
+    return;
+    }
 
-  using SeedsNewValuesIterator = typename SeedNewValuesArrayType::const_iterator;
+  // Keep the foreground plane in sync with the output image.
+  const OutputImagePixelType foregroundValue = this->GetForegroundValue();
 
-  SeedsNewValuesIterator newValueItr = this->m_SeedsNewValues.begin();
+  BitWordType bit;
 
-  while (seedItr != this->m_SeedArray1->end() )
+  for( SizeValueType seedId = 0; seedId < numberOfSeeds; ++seedId )
     {
-    this->m_OutputImage->SetPixel( *seedItr, *newValueItr );
-    ++seedItr;
-    ++newValueItr;
+    BitWordType & word = this->GetBitPlaneWord( this->m_ForegroundBits, this->m_SeedArray1[seedId], bit );
+    if( this->m_SeedsNewValues[seedId] == foregroundValue )
+      {
+      word |= bit;
+      }
+    else
+      {
+      word &= ~bit;
+      }
     }
 }
 
@@ -304,9 +546,7 @@ void
 VotingBinaryHoleFillFloodingImageFilter<TInputImage,TOutputImage>
 ::SwapSeedArrays()
 {
-  SeedArrayType * temporary = this->m_SeedArray1;
-  this->m_SeedArray1 = this->m_SeedArray2;
-  this->m_SeedArray2 = temporary;
+  this->m_SeedArray1.swap( this->m_SeedArray2 );
 }
 
 
@@ -315,21 +555,17 @@ void
 VotingBinaryHoleFillFloodingImageFilter<TInputImage,TOutputImage>
 ::ClearSecondSeedArray()
 {
-  delete this->m_SeedArray2;
-  this->m_SeedArray2 = new SeedArrayType;
+  // Keeps the capacity for the next iteration.
+  this->m_SeedArray2.clear();
 }
 
 
 template <class TInputImage, class TOutputImage>
+template <unsigned int VRadius>
 bool 
 VotingBinaryHoleFillFloodingImageFilter<TInputImage,TOutputImage>
-::TestForQuorumAtCurrentPixel() const
+::TestForQuorumAtPixel( OffsetValueType offset ) const
 {
-  //
-  // Find the location of the current pixel in the image memory buffer
-  //
-  const OffsetValueType offset = this->m_OutputImage->ComputeOffset( this->GetCurrentPixelIndex() );
-
   const InputImagePixelType * buffer = this->m_OutputImage->GetBufferPointer();
 
   const InputImagePixelType * currentPixelPointer = buffer + offset;
@@ -340,20 +576,15 @@ VotingBinaryHoleFillFloodingImageFilter<TInputImage,TOutputImage>
   // From that buffer position, visit all other neighbor pixels 
   // and check if they are set to the foreground value.
   //
-  auto neighborItr = this->m_NeighborBufferOffset.begin();
+  const OffsetValueType * neighborOffsets = this->m_NeighborBufferOffset.data();
+
+  const unsigned int numberOfNeighbors = this->template GetNumberOfNeighbors< VRadius >();
 
   const InputImagePixelType foregroundValue = this->GetForegroundValue();
 
-  while( neighborItr != this->m_NeighborBufferOffset.end() )
+  for( unsigned int i = 0; i < numberOfNeighbors; ++i )
     {
-    const InputImagePixelType * neighborPixelPointer = currentPixelPointer + *neighborItr;
-
-    if( *neighborPixelPointer == foregroundValue )
-      {
-      numberOfNeighborsAtForegroundValue++;
-      }
-
-    ++neighborItr;
+    numberOfNeighborsAtForegroundValue += ( currentPixelPointer[ neighborOffsets[i] ] == foregroundValue );
     }
 
   bool quorum = (numberOfNeighborsAtForegroundValue > this->GetBirthThreshold() );
@@ -363,54 +594,234 @@ VotingBinaryHoleFillFloodingImageFilter<TInputImage,TOutputImage>
 
 
 template <class TInputImage, class TOutputImage>
+template <unsigned int VRadius>
 void 
 VotingBinaryHoleFillFloodingImageFilter<TInputImage,TOutputImage>
-::PutCurrentPixelNeighborsIntoSeedArray()
+::PutPixelNeighborsIntoSeedVisitBuffer( OffsetValueType offset, SeedVisitBufferType & seedBuffer ) const
 {
+  const InputImagePixelType * buffer = this->m_OutputImage->GetBufferPointer();
+
+  const InputImagePixelType * currentPixelPointer = buffer + offset;
+
+  const unsigned char * maskPixelPointer = this->m_SeedsMask->GetBufferPointer() + offset;
+
   //
-  // Find the location of the current pixel in the image memory buffer
+  // Visit the buffer offset of each neighbor and if they are
+  // backgroundValue then insert them as candidate seeds.
+  // Visited neighbors are skipped early, the others are checked again
+  // against the mask when the buffers are merged.
   //
-  const OffsetValueType offset = this->m_OutputImage->ComputeOffset( this->GetCurrentPixelIndex() );
+  const InputImagePixelType backgroundValue = this->GetBackgroundValue();
 
-  const InputImagePixelType * buffer = this->m_OutputImage->GetBufferPointer();
+  const OffsetValueType * neighborOffsets = this->m_NeighborBufferOffset.data();
 
-  const InputImagePixelType * currentPixelPointer = buffer + offset;
+  const unsigned int numberOfNeighbors = this->template GetNumberOfNeighbors< VRadius >();
 
+  for( unsigned int i = 0; i < numberOfNeighbors; ++i )
+    {
+    const OffsetValueType neighborOffset = neighborOffsets[i];
+    if( currentPixelPointer[ neighborOffset ] == backgroundValue && maskPixelPointer[ neighborOffset ] != VisitedPixel )
+      {
+      seedBuffer.Seeds.push_back( offset + neighborOffset );
+      }
+    }
+}
 
-  const unsigned int neighborhoodSize = this->m_Neighborhood.Size();
 
+template <class TInputImage, class TOutputImage>
+void 
+VotingBinaryHoleFillFloodingImageFilter<TInputImage,TOutputImage>
+::PackBitPlanes()
+{
   //
-  // Visit the offset of each neighbor in Index as well as buffer space
-  // and if they are backgroundValue then insert them as new seeds
+  // One bit per pixel of the buffered region, rows padded to whole words.
+  // A pixel is in the foreground plane when the output image holds the
+  // foreground value, and in the plane of its state in the seeds mask.
   //
-  using NeighborOffsetType = typename NeighborhoodType::OffsetType;
+  const OutputImageRegionType region = this->m_OutputImage->GetBufferedRegion();
 
-  using NeigborOffsetIterator = typename NeighborOffsetArrayType::const_iterator;
+  this->m_RowLength = region.GetSize()[0];
+  this->m_WordsPerRow = ( this->m_RowLength + 63 ) / 64;
 
-  NeigborOffsetIterator neighborItr = this->m_NeighborBufferOffset.begin();
+  const OffsetValueType numberOfRows = region.GetNumberOfPixels() / this->m_RowLength;
 
-  const InputImagePixelType backgroundValue = this->GetBackgroundValue();
+  this->m_ForegroundBits.assign( numberOfRows * this->m_WordsPerRow, 0 );
+  this->m_VisitedBits.assign( numberOfRows * this->m_WordsPerRow, 0 );
+  this->m_FrontBits.assign( numberOfRows * this->m_WordsPerRow, 0 );
+
+  const OutputImagePixelType * output = this->m_OutputImage->GetBufferPointer();
+  const unsigned char * mask = this->m_SeedsMask->GetBufferPointer();
 
-  for( unsigned int i = 0; i < neighborhoodSize; ++i, ++neighborItr )
+  const OutputImagePixelType foregroundValue = this->GetForegroundValue();
+
+  for( OffsetValueType row = 0; row < numberOfRows; ++row )
     {
-    const InputImagePixelType * neighborPixelPointer = currentPixelPointer + *neighborItr;
+    BitWordType * foregroundRow = this->m_ForegroundBits.data() + row * this->m_WordsPerRow;
+    BitWordType * visitedRow = this->m_VisitedBits.data() + row * this->m_WordsPerRow;
+    BitWordType * frontRow = this->m_FrontBits.data() + row * this->m_WordsPerRow;
 
-    if( *neighborPixelPointer == backgroundValue )
+    for( OffsetValueType x = 0; x < this->m_RowLength; ++x, ++output, ++mask )
       {
-      NeighborOffsetType neighborOffset = this->m_Neighborhood.GetOffset(i);
-      IndexType neighborIndex = this->GetCurrentPixelIndex() + neighborOffset;
-
-      //if( this->m_InternalRegion.IsInside( neighborIndex ) )
+      const BitWordType bit = BitWordType( 1 ) << ( x % 64 );
+      if( *output == foregroundValue )
         {
-        if( this->m_SeedsMask->GetPixel( neighborIndex ) == 0 )
-          {
-          this->m_SeedArray2->push_back( neighborIndex );
-          this->m_SeedsMask->SetPixel( neighborIndex, 255 );
-          }
+        foregroundRow[ x / 64 ] |= bit;
+        }
+      if( *mask == VisitedPixel )
+        {
+        visitedRow[ x / 64 ] |= bit;
+        }
+      else if( *mask == FrontPixel )
+        {
+        frontRow[ x / 64 ] |= bit;
         }
       }
     }
 
+  //
+  // The neighborhood is visited one row at a time: keep the offset, in rows,
+  // of every row of the neighborhood. The neighbor offsets are ordered with
+  // the first dimension varying fastest, so each row starts at radius[0].
+  //
+  const OffsetValueType rowWidth = 2 * this->GetRadius()[0] + 1;
+
+  this->m_NeighborRowOffsets.clear();
+
+  for( unsigned int i = 0; i < this->m_NeighborBufferOffset.size(); i += rowWidth )
+    {
+    const OffsetValueType firstNeighborOffset = this->m_NeighborBufferOffset[i];
+    this->m_NeighborRowOffsets.push_back( ( firstNeighborOffset + this->GetRadius()[0] ) / this->m_RowLength );
+    }
+}
+
+
+template <class TInputImage, class TOutputImage>
+typename VotingBinaryHoleFillFloodingImageFilter<TInputImage,TOutputImage>::BitWordType &
+VotingBinaryHoleFillFloodingImageFilter<TInputImage,TOutputImage>
+::GetBitPlaneWord( BitPlaneType & plane, OffsetValueType offset, BitWordType & bit ) const
+{
+  const OffsetValueType x = offset % this->m_RowLength;
+  bit = BitWordType( 1 ) << ( x % 64 );
+  return plane[ ( offset / this->m_RowLength ) * this->m_WordsPerRow + x / 64 ];
+}
+
+
+template <class TInputImage, class TOutputImage>
+typename VotingBinaryHoleFillFloodingImageFilter<TInputImage,TOutputImage>::BitWordType
+VotingBinaryHoleFillFloodingImageFilter<TInputImage,TOutputImage>
+::GetBitWindow( const BitWordType * row, OffsetValueType start, unsigned int length )
+{
+  const OffsetValueType wordId = start / 64;
+  const unsigned int shift = start % 64;
+
+  BitWordType bits = row[wordId] >> shift;
+
+  if( shift + length > 64 )
+    {
+    bits |= row[wordId + 1] << ( 64 - shift );
+    }
+
+  if( length < 64 )
+    {
+    bits &= ( BitWordType( 1 ) << length ) - 1;
+    }
+
+  return bits;
+}
+
+
+template <class TInputImage, class TOutputImage>
+unsigned int
+VotingBinaryHoleFillFloodingImageFilter<TInputImage,TOutputImage>
+::CountBits( BitWordType word )
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return static_cast< unsigned int >( __builtin_popcountll( word ) );
+#elif defined(_MSC_VER) && defined(_M_X64)
+  return static_cast< unsigned int >( __popcnt64( word ) );
+#else
+  word = word - ( ( word >> 1 ) & 0x5555555555555555ULL );
+  word = ( word & 0x3333333333333333ULL ) + ( ( word >> 2 ) & 0x3333333333333333ULL );
+  word = ( word + ( word >> 4 ) ) & 0x0F0F0F0F0F0F0F0FULL;
+  return static_cast< unsigned int >( ( word * 0x0101010101010101ULL ) >> 56 );
+#endif
+}
+
+
+template <class TInputImage, class TOutputImage>
+template <unsigned int VRadius>
+bool 
+VotingBinaryHoleFillFloodingImageFilter<TInputImage,TOutputImage>
+::TestForQuorumInBitPlanes( OffsetValueType offset ) const
+{
+  //
+  // Count the foreground neighbors of each row of the neighborhood at once.
+  // The pixel is in the internal region, so the window never leaves its row.
+  //
+  const unsigned int rowWidth = this->template GetNeighborhoodRowWidth< VRadius >();
+  const unsigned int numberOfRows = this->template GetNumberOfNeighborhoodRows< VRadius >();
+
+  const OffsetValueType * rowOffsets = this->m_NeighborRowOffsets.data();
+
+  const OffsetValueType row = offset / this->m_RowLength;
+  const OffsetValueType start = offset % this->m_RowLength - static_cast< OffsetValueType >( rowWidth / 2 );
+
+  unsigned int numberOfNeighborsAtForegroundValue = 0;
+
+  for( unsigned int i = 0; i < numberOfRows; ++i )
+    {
+    const BitWordType * foregroundRow = this->m_ForegroundBits.data() + ( row + rowOffsets[i] ) * this->m_WordsPerRow;
+    numberOfNeighborsAtForegroundValue += CountBits( GetBitWindow( foregroundRow, start, rowWidth ) );
+    }
+
+  return ( numberOfNeighborsAtForegroundValue > this->GetBirthThreshold() );
+}
+
+
+template <class TInputImage, class TOutputImage>
+template <unsigned int VRadius>
+void 
+VotingBinaryHoleFillFloodingImageFilter<TInputImage,TOutputImage>
+::PutPixelNeighborsIntoSeedVisitBufferFromBitPlanes( OffsetValueType offset, SeedVisitBufferType & seedBuffer ) const
+{
+  //
+  // Internal pixels are either foreground or background, and the others are
+  // visited, so the candidates are the neighbors in neither plane, the ones
+  // in the front included. They are pushed in the order of
+  // PutPixelNeighborsIntoSeedVisitBuffer().
+  //
+  const unsigned int rowWidth = this->template GetNeighborhoodRowWidth< VRadius >();
+  const unsigned int numberOfRows = this->template GetNumberOfNeighborhoodRows< VRadius >();
+
+  const OffsetValueType * rowOffsets = this->m_NeighborRowOffsets.data();
+
+  const OffsetValueType row = offset / this->m_RowLength;
+  const OffsetValueType start = offset % this->m_RowLength - static_cast< OffsetValueType >( rowWidth / 2 );
+
+  for( unsigned int i = 0; i < numberOfRows; ++i )
+    {
+    const OffsetValueType rowOffset = rowOffsets[i];
+    const OffsetValueType wordOffset = ( row + rowOffset ) * this->m_WordsPerRow;
+
+    BitWordType candidates =
+      ~( GetBitWindow( this->m_ForegroundBits.data() + wordOffset, start, rowWidth ) |
+         GetBitWindow( this->m_VisitedBits.data() + wordOffset, start, rowWidth ) );
+
+    if( rowWidth < 64 )
+      {
+      candidates &= ( BitWordType( 1 ) << rowWidth ) - 1;
+      }
+
+    const OffsetValueType firstNeighbor = ( row + rowOffset ) * this->m_RowLength + start;
+
+    for( OffsetValueType x = 0; candidates != 0; ++x, candidates >>= 1 )
+      {
+      if( candidates & 1 )
+        {
+        seedBuffer.Seeds.push_back( firstNeighbor + x );
+        }
+      }
+    }
 }
 
 
@@ -423,6 +834,39 @@ VotingBinaryHoleFillFloodingImageFilter<TInputImage,TOutputImage>
 }
 
 
+template <class TInputImage, class TOutputImage>
+template <unsigned int VRadius>
+unsigned int
+VotingBinaryHoleFillFloodingImageFilter<TInputImage,TOutputImage>
+::GetNumberOfNeighbors() const
+{
+  return ( VRadius > 0 ) ? GetFixedNeighborhoodSize( VRadius, InputImageDimension ) :
+    static_cast< unsigned int >( this->m_NeighborBufferOffset.size() );
+}
+
+
+template <class TInputImage, class TOutputImage>
+template <unsigned int VRadius>
+unsigned int
+VotingBinaryHoleFillFloodingImageFilter<TInputImage,TOutputImage>
+::GetNeighborhoodRowWidth() const
+{
+  return ( VRadius > 0 ) ? 2 * VRadius + 1 :
+    static_cast< unsigned int >( 2 * this->GetRadius()[0] + 1 );
+}
+
+
+template <class TInputImage, class TOutputImage>
+template <unsigned int VRadius>
+unsigned int
+VotingBinaryHoleFillFloodingImageFilter<TInputImage,TOutputImage>
+::GetNumberOfNeighborhoodRows() const
+{
+  return ( VRadius > 0 ) ? GetFixedNeighborhoodSize( VRadius, InputImageDimension - 1 ) :
+    static_cast< unsigned int >( this->m_NeighborRowOffsets.size() );
+}
+
+
 template <class TInputImage, class TOutputImage>
 void 
 VotingBinaryHoleFillFloodingImageFilter<TInputImage,TOutputImage>
@@ -432,7 +876,7 @@ VotingBinaryHoleFillFloodingImageFilter<TInputImage,TOutputImage>
   // Copy the offsets from the Input image.
   // We assume that they are the same for the output image.
   //
-  const size_t sizeOfOffsetTableInBytes = (InputImageDimension+1)*sizeof(unsigned long);
+  const size_t sizeOfOffsetTableInBytes = (InputImageDimension+1)*sizeof(OffsetValueType);
 
   memcpy( this->m_OffsetTable, this->m_OutputImage->GetOffsetTable(), sizeOfOffsetTableInBytes );
 
@@ -455,7 +899,7 @@ VotingBinaryHoleFillFloodingImageFilter<TInputImage,TOutputImage>
     {
     NeighborOffsetType offset = this->m_Neighborhood.GetOffset(i);
 
-    signed int bufferOffset = 0; // must be a signed number
+    OffsetValueType bufferOffset = 0; // must be a signed number
 
     for( unsigned int d = 0; d < InputImageDimension; d++ )
       {
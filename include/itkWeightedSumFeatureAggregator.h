@@ -75,9 +75,14 @@ protected:
   ~WeightedSumFeatureAggregator() override;
   void PrintSelf(std::ostream& os, Indent indent) const override;
 
-private:
-  void ConsolidateFeatures() override;
+  /** The weights are part of the identity of the aggregated feature. */
+  bool GetFeatureCacheParameters( std::ostream & os ) const override;
+
+  /** Pixel-wise weighted sum of the features over the region. */
+  void ConsolidateFeaturesInRegion( OutputImageType * consolidatedImage,
+    const typename OutputImageType::RegionType & region ) override;
 
+private:
   using WeightsArrayType = std::vector< double >;
 
   WeightsArrayType                  m_Weights;
@@ -71,22 +71,21 @@ WeightedSumFeatureAggregator<NDimension>
 template <unsigned int NDimension>
 void
 WeightedSumFeatureAggregator<NDimension>
-::ConsolidateFeatures()
+::ConsolidateFeaturesInRegion( OutputImageType * consolidatedFeatureImage,
+  const typename OutputImageType::RegionType & region )
 {
   using FeaturePixelType = float;
   using FeatureImageType = Image< FeaturePixelType, NDimension >;
   using FeatureSpatialObjectType = ImageSpatialObject< NDimension, FeaturePixelType >;
 
-  const auto * firstFeatureObject = dynamic_cast< const FeatureSpatialObjectType * >( this->GetInputFeature(0) );
+  using FeatureIterator = ImageRegionIterator< FeatureImageType >;
+  using FeatureConstIterator = ImageRegionConstIterator< FeatureImageType >;
 
-  const FeatureImageType * firstFeatureImage = firstFeatureObject->GetImage();
-
-  typename FeatureImageType::Pointer consolidatedFeatureImage = FeatureImageType::New();
-
-  consolidatedFeatureImage->CopyInformation( firstFeatureImage );
-  consolidatedFeatureImage->SetRegions( firstFeatureImage->GetBufferedRegion() );
-  consolidatedFeatureImage->Allocate();
-  consolidatedFeatureImage->FillBuffer( NumericTraits< FeaturePixelType >::ZeroValue() );
+  FeatureIterator initializationItr( consolidatedFeatureImage, region );
+  for( initializationItr.GoToBegin(); !initializationItr.IsAtEnd(); ++initializationItr )
+    {
+    initializationItr.Set( NumericTraits< FeaturePixelType >::ZeroValue() );
+    }
 
   const unsigned int numberOfFeatures = this->GetNumberOfInputFeatures();
 
@@ -111,11 +110,8 @@ WeightedSumFeatureAggregator<NDimension>
 
     const FeatureImageType * featureImage = featureObject->GetImage();
 
-    using FeatureIterator = ImageRegionIterator< FeatureImageType >;
-    using FeatureConstIterator = ImageRegionConstIterator< FeatureImageType >;
-
-    FeatureIterator       dstitr( consolidatedFeatureImage, consolidatedFeatureImage->GetBufferedRegion() );
-    FeatureConstIterator  srcitr( featureImage, featureImage->GetBufferedRegion() );
+    FeatureIterator       dstitr( consolidatedFeatureImage, region );
+    FeatureConstIterator  srcitr( featureImage, region );
 
     dstitr.GoToBegin();
     srcitr.GoToBegin();
@@ -129,10 +125,20 @@ WeightedSumFeatureAggregator<NDimension>
       ++dstitr;
       }
     }
+}
 
-  auto * outputObject = dynamic_cast< FeatureSpatialObjectType * >(this->ProcessObject::GetOutput(0));
 
-  outputObject->SetImage( consolidatedFeatureImage );
+template <unsigned int NDimension>
+bool
+WeightedSumFeatureAggregator<NDimension>
+::GetFeatureCacheParameters( std::ostream & os ) const
+{
+  os << " Weights";
+  for( const double weight : this->m_Weights )
+    {
+    os << " " << weight;
+    }
+  return true;
 }
 
 } // end namespace itk
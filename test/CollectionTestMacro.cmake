@@ -140,6 +140,15 @@ ADD_TEST(LWFG_${DATASET_ID}
   -400.0 # Lung Threshold
   )
 
+# Lung Wall Feature Generator closed by distance maps, compared with the one above
+ADD_TEST(LWFGD_${DATASET_ID}
+  ${CXX_TEST_PATH}/itkLungWallFeatureGeneratorTest2
+  ${DATASET_ROI}
+  ${TEMP}/LWFGD_Test${DATASET_ID}.mha
+  -400.0 # Lung Threshold
+  5.0    # Closing Radius, the disagreement is only reported
+  )
+
 # Morphological Openning Feature Generator
 ADD_TEST(MOFG_${DATASET_ID}
   ${CXX_TEST_PATH}/itkMorphologicalOpenningFeatureGeneratorTest1
@@ -0,0 +1,373 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkCancellationTokenTest1.cxx
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+// Checks the scoping of the cancellation tokens, that the iterative filters
+// throw ProcessAborted at the first iteration when their token is cancelled,
+// whether it is given to them or current on their thread, that their output
+// is not reused by the next update, and that a diffusion cancelled from
+// another thread throws ProcessAborted long before it would have completed.
+
+#include "itkCancellationToken.h"
+#include "itkImage.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkCommand.h"
+#include "itkVotingBinaryHoleFillFloodingImageFilter.h"
+#include "itkRegionCompetitionImageFilter.h"
+#include "itkVesselEnhancingDiffusion3DImageFilter.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+
+int itkCancellationTokenTest1( int itkNotUsed(argc), char * itkNotUsed(argv) [] )
+{
+  using TokenType = itk::CancellationToken;
+
+  TokenType::Pointer outerToken = TokenType::New();
+  TokenType::Pointer innerToken = TokenType::New();
+
+  //
+  // Scopes nest, and restore the enclosing token when they end.
+  //
+  if( TokenType::GetCurrent() != nullptr )
+    {
+    std::cerr << "A token is current outside of any scope" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+    {
+    TokenType::Scope outerScope( outerToken );
+      {
+      TokenType::Scope innerScope( innerToken );
+      if( TokenType::GetCurrent() != innerToken.GetPointer() ||
+          TokenType::Resolve( nullptr ) != innerToken.GetPointer() ||
+          TokenType::Resolve( outerToken ) != outerToken.GetPointer() )
+        {
+        std::cerr << "The inner scope does not make its token current" << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    if( TokenType::GetCurrent() != outerToken.GetPointer() )
+      {
+      std::cerr << "The inner scope did not restore the outer token" << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    // Other threads do not see the token of this one.
+    bool otherThreadSeesToken = true;
+    std::thread otherThread( [&otherThreadSeesToken]()
+      {
+      otherThreadSeesToken = ( TokenType::GetCurrent() != nullptr );
+      } );
+    otherThread.join();
+    if( otherThreadSeesToken )
+      {
+      std::cerr << "The current token leaked to another thread" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  if( TokenType::GetCurrent() != nullptr )
+    {
+    std::cerr << "The outer scope did not restore the absence of token" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  outerToken->Cancel();
+  if( !outerToken->IsCancellationRequested() || innerToken->IsCancellationRequested() )
+    {
+    std::cerr << "Cancel() did not flag the right token" << std::endl;
+    return EXIT_FAILURE;
+    }
+  outerToken->Reset();
+  if( outerToken->IsCancellationRequested() )
+    {
+    std::cerr << "Reset() did not clear the token" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  constexpr unsigned int Dimension = 3;
+
+  using LabelImageType = itk::Image< unsigned short, Dimension >;
+
+  LabelImageType::SizeType size;
+  size.Fill( 32 );
+
+  LabelImageType::RegionType region;
+  region.SetSize( size );
+
+  //
+  // A hollow cube, whose hole takes several iterations to fill.
+  //
+  LabelImageType::Pointer cube = LabelImageType::New();
+  cube->SetRegions( region );
+  cube->Allocate();
+
+  itk::ImageRegionIteratorWithIndex< LabelImageType > citr( cube, region );
+  for( citr.GoToBegin(); !citr.IsAtEnd(); ++citr )
+    {
+    bool inShell = true;
+    bool inHole = true;
+    for( unsigned int d = 0; d < Dimension; d++ )
+      {
+      inShell = inShell && citr.GetIndex()[d] >= 4 && citr.GetIndex()[d] < 28;
+      inHole = inHole && citr.GetIndex()[d] >= 8 && citr.GetIndex()[d] < 24;
+      }
+    citr.Set( ( inShell && !inHole ) ? 1 : 0 );
+    }
+
+  using HoleFillFilterType = itk::VotingBinaryHoleFillFloodingImageFilter< LabelImageType, LabelImageType >;
+
+  LabelImageType::SizeType radius;
+  radius.Fill( 1 );
+
+  //
+  // A token cancelled from the first iteration event aborts the hole
+  // filling after that iteration.
+  //
+  TokenType::Pointer holeFillToken = TokenType::New();
+
+  HoleFillFilterType::Pointer holeFill = HoleFillFilterType::New();
+  holeFill->SetInput( cube );
+  holeFill->SetRadius( radius );
+  holeFill->SetBackgroundValue( 0 );
+  holeFill->SetForegroundValue( 1 );
+  holeFill->SetMajorityThreshold( 1 );
+  holeFill->SetMaximumNumberOfIterations( 100 );
+  holeFill->SetCancellationToken( holeFillToken );
+
+  using TokenCommandType = itk::SimpleMemberCommand< TokenType >;
+  TokenCommandType::Pointer cancelCommand = TokenCommandType::New();
+  cancelCommand->SetCallbackFunction( holeFillToken, &TokenType::Cancel );
+  holeFill->AddObserver( itk::IterationEvent(), cancelCommand );
+
+  bool aborted = false;
+  try
+    {
+    holeFill->Update();
+    }
+  catch( itk::ProcessAborted & )
+    {
+    aborted = true;
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if( !aborted || holeFill->GetCurrentIterationNumber() != 1 )
+    {
+    std::cerr << "The cancelled hole filling ran " << holeFill->GetCurrentIterationNumber()
+              << " iterations and " << ( aborted ? "threw" : "did not throw" )
+              << " ProcessAborted instead of a single aborted iteration" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  //
+  // The aborted output is not up to date, the next update fills the
+  // hole although the filter was not modified.
+  //
+  holeFill->RemoveAllObservers();
+  holeFillToken->Reset();
+
+  try
+    {
+    holeFill->Update();
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if( holeFill->GetCurrentIterationNumber() <= 1 || holeFill->GetTotalNumberOfPixelsChanged() == 0 )
+    {
+    std::cerr << "The update following the cancellation ran " << holeFill->GetCurrentIterationNumber()
+              << " iterations and changed " << holeFill->GetTotalNumberOfPixelsChanged()
+              << " pixels, reusing the aborted output" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  //
+  // A token already cancelled and current on the thread aborts the hole
+  // filling before it changes any pixel.
+  //
+  holeFill->SetCancellationToken( nullptr );
+  holeFillToken->Cancel();
+
+  aborted = false;
+    {
+    TokenType::Scope scope( holeFillToken );
+    try
+      {
+      holeFill->Update();
+      }
+    catch( itk::ProcessAborted & )
+      {
+      aborted = true;
+      }
+    catch( itk::ExceptionObject & excp )
+      {
+      std::cerr << excp << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  if( !aborted || holeFill->GetTotalNumberOfPixelsChanged() != 0 )
+    {
+    std::cerr << "The hole filling changed " << holeFill->GetTotalNumberOfPixelsChanged()
+              << " pixels with a cancelled token" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  //
+  // The competition of two labels is aborted after the first iteration
+  // as well.
+  //
+  using RegionCompetitionFilterType = itk::RegionCompetitionImageFilter< LabelImageType, LabelImageType >;
+
+  LabelImageType::Pointer labels = LabelImageType::New();
+  labels->SetRegions( region );
+  labels->Allocate();
+  labels->FillBuffer( 0 );
+
+  LabelImageType::IndexType index1 = {{ 8, 16, 16 }};
+  LabelImageType::IndexType index2 = {{ 24, 16, 16 }};
+  labels->SetPixel( index1, 1 );
+  labels->SetPixel( index2, 2 );
+
+  TokenType::Pointer competitionToken = TokenType::New();
+
+  RegionCompetitionFilterType::Pointer competition = RegionCompetitionFilterType::New();
+  competition->SetInput( cube );
+  competition->SetInputLabels( labels );
+  competition->SetMaximumNumberOfIterations( 100 );
+  competition->SetCancellationToken( competitionToken );
+
+  TokenCommandType::Pointer cancelCompetitionCommand = TokenCommandType::New();
+  cancelCompetitionCommand->SetCallbackFunction( competitionToken, &TokenType::Cancel );
+  competition->AddObserver( itk::IterationEvent(), cancelCompetitionCommand );
+
+  aborted = false;
+  try
+    {
+    competition->Update();
+    }
+  catch( itk::ProcessAborted & )
+    {
+    aborted = true;
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if( !aborted || competition->GetCurrentIterationNumber() != 1 )
+    {
+    std::cerr << "The cancelled competition ran " << competition->GetCurrentIterationNumber()
+              << " iterations and " << ( aborted ? "threw" : "did not throw" )
+              << " ProcessAborted instead of a single aborted iteration" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  //
+  // A diffusion cancelled from another thread throws, whether it is
+  // diffusing or computing the hessians.
+  //
+  using DiffusionFilterType = itk::VesselEnhancingDiffusion3DImageFilter< short, Dimension >;
+  using DiffusionImageType = DiffusionFilterType::ImageType;
+
+  DiffusionImageType::SizeType diffusionSize;
+  diffusionSize.Fill( 64 );
+
+  DiffusionImageType::RegionType diffusionRegion;
+  diffusionRegion.SetSize( diffusionSize );
+
+  DiffusionImageType::Pointer diffusionInput = DiffusionImageType::New();
+  diffusionInput->SetRegions( diffusionRegion );
+  diffusionInput->Allocate();
+
+  itk::ImageRegionIteratorWithIndex< DiffusionImageType > ditr( diffusionInput, diffusionRegion );
+  for( ditr.GoToBegin(); !ditr.IsAtEnd(); ++ditr )
+    {
+    // A tube along the first axis.
+    const itk::IndexValueType dy = ditr.GetIndex()[1] - 32;
+    const itk::IndexValueType dz = ditr.GetIndex()[2] - 32;
+    ditr.Set( ( dy * dy + dz * dz < 16 ) ? 100 : 0 );
+    }
+
+  TokenType::Pointer diffusionToken = TokenType::New();
+
+  DiffusionFilterType::Pointer diffusion = DiffusionFilterType::New();
+  diffusion->SetInput( diffusionInput );
+  diffusion->SetDefaultPars();
+  diffusion->SetVerbose( false );
+  diffusion->SetIterations( 100000 );
+  diffusion->SetRecalculateVesselness( 1 );
+  diffusion->SetCancellationToken( diffusionToken );
+
+  using ClockType = std::chrono::steady_clock;
+  ClockType::time_point cancelTime;
+
+  std::thread canceller( [&diffusionToken, &cancelTime]()
+    {
+    std::this_thread::sleep_for( std::chrono::milliseconds( 200 ) );
+    cancelTime = ClockType::now();
+    diffusionToken->Cancel();
+    } );
+
+  aborted = false;
+  try
+    {
+    diffusion->Update();
+    }
+  catch( itk::ProcessAborted & )
+    {
+    aborted = true;
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    canceller.join();
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  const ClockType::time_point returnTime = ClockType::now();
+  canceller.join();
+
+  if( !aborted )
+    {
+    std::cerr << "The cancelled diffusion did not throw ProcessAborted" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  const double latency = std::chrono::duration< double >( returnTime - cancelTime ).count();
+  std::cout << "Diffusion returned " << latency * 1000.0 << " ms after the cancellation" << std::endl;
+
+  // The latency is only reported, a few milliseconds in a release build.
+  // The bound only catches a diffusion that ignores the cancellation, and
+  // holds under debug, sanitizer or loaded builds.
+  if( latency > 10.0 )
+    {
+    std::cerr << "The cancelled diffusion took " << latency * 1000.0 << " ms to return" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
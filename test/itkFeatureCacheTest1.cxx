@@ -0,0 +1,259 @@
+/*=========================================================================
+
+  Program:   Lesion Sizing Toolkit
+  Module:    itkFeatureCacheTest1.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#include "itkFeatureCache.h"
+#include "itkSigmoidFeatureGenerator.h"
+#include "itkImage.h"
+#include "itkImageSpatialObject.h"
+#include "itkImageFileReader.h"
+#include "itkImageRegionConstIterator.h"
+#include "itksys/Directory.hxx"
+#include "itksys/SystemTools.hxx"
+
+#include <fstream>
+
+namespace
+{
+
+unsigned int CountCacheEntries( const std::string & directoryName )
+{
+  itksys::Directory directory;
+  directory.Load( directoryName );
+  unsigned int numberOfEntries = 0;
+  for( unsigned long i = 0; i < directory.GetNumberOfFiles(); i++ )
+    {
+    if( itksys::SystemTools::GetFilenameLastExtension( directory.GetFile( i ) ) == ".feature" )
+      {
+      ++numberOfEntries;
+      }
+    }
+  return numberOfEntries;
+}
+
+}
+
+int itkFeatureCacheTest1( int argc, char * argv [] )
+{
+
+  if( argc < 3 )
+    {
+    std::cerr << "Missing Arguments" << std::endl;
+    std::cerr << argv[0] << " inputImage cacheDirectory" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  constexpr unsigned int Dimension = 3;
+
+  using InputPixelType = signed short;
+  using OutputPixelType = float;
+
+  using InputImageType = itk::Image< InputPixelType,  Dimension >;
+  using OutputImageType = itk::Image< OutputPixelType, Dimension >;
+
+  using ReaderType = itk::ImageFileReader< InputImageType >;
+
+  using InputImageSpatialObjectType = itk::ImageSpatialObject< Dimension, InputPixelType  >;
+  using OutputImageSpatialObjectType = itk::ImageSpatialObject< Dimension, OutputPixelType >;
+
+  ReaderType::Pointer reader = ReaderType::New();
+
+  reader->SetFileName( argv[1] );
+
+  try
+    {
+    reader->Update();
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  InputImageSpatialObjectType::Pointer inputObject = InputImageSpatialObjectType::New();
+
+  InputImageType::Pointer inputImage = reader->GetOutput();
+
+  inputImage->DisconnectPipeline();
+
+  inputObject->SetImage( inputImage );
+
+  using FeatureCacheType = itk::FeatureCache< Dimension >;
+  FeatureCacheType::Pointer featureCache = FeatureCacheType::New();
+
+  const std::string cacheDirectory = argv[2];
+  featureCache->SetDirectory( cacheDirectory );
+  featureCache->Clear();
+
+  using FeatureGeneratorType = itk::SigmoidFeatureGenerator< Dimension >;
+
+  FeatureGeneratorType::Pointer generator[3];
+
+  for( unsigned int k = 0; k < 3; k++ )
+    {
+    generator[k] = FeatureGeneratorType::New();
+    generator[k]->SetInput( inputObject );
+    generator[k]->SetAlpha( 1.0 );
+    generator[k]->SetBeta( -200.0 );
+    generator[k]->SetFeatureCache( featureCache );
+    }
+
+  // The third generator computes a different feature.
+  generator[2]->SetBeta( -500.0 );
+
+  try
+    {
+    generator[0]->Update();
+    generator[1]->Update();
+    generator[2]->Update();
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  featureCache->Print( std::cout );
+
+  if( featureCache->GetNumberOfHits() != 1 || featureCache->GetNumberOfMisses() != 2 )
+    {
+    std::cerr << "Expected 1 hit and 2 misses but got " << featureCache->GetNumberOfHits();
+    std::cerr << " and " << featureCache->GetNumberOfMisses() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if( generator[1]->GetProgress() != 1.0f )
+    {
+    std::cerr << "Progress of the cached generator did not reach 1.0" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  //
+  // Up to date features are not looked up again, and the cached one is
+  // not modified.
+  //
+  const itk::ModifiedTimeType cachedFeatureMTime = generator[1]->GetFeature()->GetMTime();
+
+  try
+    {
+    for( unsigned int k = 0; k < 3; k++ )
+      {
+      generator[k]->Update();
+      }
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if( featureCache->GetNumberOfHits() != 1 || featureCache->GetNumberOfMisses() != 2 ||
+      generator[1]->GetFeature()->GetMTime() != cachedFeatureMTime )
+    {
+    std::cerr << "The second update looked up the up to date features" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  //
+  // The cached feature must be identical to the computed one.
+  //
+  OutputImageSpatialObjectType::ConstPointer computedObject =
+    dynamic_cast< const OutputImageSpatialObjectType * >( generator[0]->GetFeature() );
+  OutputImageSpatialObjectType::ConstPointer cachedObject =
+    dynamic_cast< const OutputImageSpatialObjectType * >( generator[1]->GetFeature() );
+
+  const OutputImageType * computedImage = computedObject->GetImage();
+  const OutputImageType * cachedImage = cachedObject->GetImage();
+
+  if( computedImage->GetBufferedRegion() != cachedImage->GetBufferedRegion() ||
+      computedImage->GetSpacing() != cachedImage->GetSpacing() ||
+      computedImage->GetOrigin() != cachedImage->GetOrigin() ||
+      computedImage->GetDirection() != cachedImage->GetDirection() )
+    {
+    std::cerr << "Cached feature geometry differs from the computed one" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  using IteratorType = itk::ImageRegionConstIterator< OutputImageType >;
+  IteratorType citr( computedImage, computedImage->GetBufferedRegion() );
+  IteratorType ritr( cachedImage, cachedImage->GetBufferedRegion() );
+
+  for( citr.GoToBegin(), ritr.GoToBegin(); !citr.IsAtEnd(); ++citr, ++ritr )
+    {
+    if( citr.Get() != ritr.Get() )
+      {
+      std::cerr << "Cached feature differs from the computed one at " << citr.GetIndex() << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  if( CountCacheEntries( cacheDirectory ) != 2 )
+    {
+    std::cerr << "Expected 2 cache entries" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  //
+  // Damage one entry, it must be detected and removed.
+  //
+  const std::string key = generator[0]->ComputeFeatureCacheKey( featureCache );
+  const std::string entryFileName = cacheDirectory + "/" + key + ".feature";
+
+    {
+    std::fstream entry( entryFileName.c_str(), std::ios::in | std::ios::out | std::ios::binary );
+    entry.seekp( -static_cast< std::streamoff >( sizeof( float ) ), std::ios::end );
+    const float damage = 12345.0f;
+    entry.write( reinterpret_cast< const char * >( &damage ), sizeof( damage ) );
+    }
+
+  if( featureCache->RemoveCorruptedEntries() != 1 )
+    {
+    std::cerr << "The damaged entry was not detected" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if( itksys::SystemTools::FileExists( entryFileName ) )
+    {
+    std::cerr << "The damaged entry was not removed" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  //
+  // With room for a single entry, storing a feature evicts the other one.
+  //
+  featureCache->SetMaximumSize( itksys::SystemTools::FileLength(
+    cacheDirectory + "/" + generator[2]->ComputeFeatureCacheKey( featureCache ) + ".feature" ) );
+
+  generator[0]->Modified();
+
+  try
+    {
+    generator[0]->Update();
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if( CountCacheEntries( cacheDirectory ) != 1 )
+    {
+    std::cerr << "Expected the least recently used entry to be evicted" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  featureCache->Clear();
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,186 @@
+/*=========================================================================
+
+  Program:   Lesion Sizing Toolkit
+  Module:    itkHessianImageProviderTest1.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#include "itkHessianImageProvider.h"
+#include "itkFrangiTubularnessFeatureGenerator.h"
+#include "itkDescoteauxSheetnessFeatureGenerator.h"
+#include "itkSatoLocalStructureFeatureGenerator.h"
+#include "itkSatoVesselnessFeatureGenerator.h"
+#include "itkImage.h"
+#include "itkSpatialObject.h"
+#include "itkImageSpatialObject.h"
+#include "itkImageFileReader.h"
+#include "itkImageRegionConstIterator.h"
+
+int itkHessianImageProviderTest1( int argc, char * argv [] )
+{
+
+  if( argc < 2 )
+    {
+    std::cerr << "Missing Arguments" << std::endl;
+    std::cerr << argv[0] << " inputImage [sigma]" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  constexpr unsigned int Dimension = 3;
+
+  using InputPixelType = signed short;
+  using OutputPixelType = float;
+
+  using InputImageType = itk::Image< InputPixelType,  Dimension >;
+  using OutputImageType = itk::Image< OutputPixelType, Dimension >;
+
+  using ReaderType = itk::ImageFileReader< InputImageType >;
+
+  using InputImageSpatialObjectType = itk::ImageSpatialObject< Dimension, InputPixelType  >;
+  using OutputImageSpatialObjectType = itk::ImageSpatialObject< Dimension, OutputPixelType >;
+
+  ReaderType::Pointer reader = ReaderType::New();
+
+  reader->SetFileName( argv[1] );
+
+  try
+    {
+    reader->Update();
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  double sigma = 1.0;
+
+  if( argc > 2 )
+    {
+    sigma = atof( argv[2] );
+    }
+
+  InputImageSpatialObjectType::Pointer inputObject = InputImageSpatialObjectType::New();
+
+  InputImageType::Pointer inputImage = reader->GetOutput();
+
+  inputImage->DisconnectPipeline();
+
+  inputObject->SetImage( inputImage );
+
+  using HessianProviderType = itk::HessianImageProvider< Dimension >;
+  HessianProviderType::Pointer hessianProvider = HessianProviderType::New();
+
+  using FrangiGeneratorType = itk::FrangiTubularnessFeatureGenerator< Dimension >;
+  using DescoteauxGeneratorType = itk::DescoteauxSheetnessFeatureGenerator< Dimension >;
+  using LocalStructureGeneratorType = itk::SatoLocalStructureFeatureGenerator< Dimension >;
+  using VesselnessGeneratorType = itk::SatoVesselnessFeatureGenerator< Dimension >;
+
+  FrangiGeneratorType::Pointer frangiGenerator = FrangiGeneratorType::New();
+  FrangiGeneratorType::Pointer referenceFrangiGenerator = FrangiGeneratorType::New();
+  DescoteauxGeneratorType::Pointer descoteauxGenerator = DescoteauxGeneratorType::New();
+  LocalStructureGeneratorType::Pointer localStructureGenerator = LocalStructureGeneratorType::New();
+  VesselnessGeneratorType::Pointer vesselnessGenerator = VesselnessGeneratorType::New();
+
+  frangiGenerator->SetInput( inputObject );
+  referenceFrangiGenerator->SetInput( inputObject );
+  descoteauxGenerator->SetInput( inputObject );
+  localStructureGenerator->SetInput( inputObject );
+  vesselnessGenerator->SetInput( inputObject );
+
+  frangiGenerator->SetSigma( sigma );
+  referenceFrangiGenerator->SetSigma( sigma );
+  descoteauxGenerator->SetSigma( sigma );
+  localStructureGenerator->SetSigma( sigma );
+  vesselnessGenerator->SetSigma( sigma );
+
+  frangiGenerator->SetHessianProvider( hessianProvider );
+  descoteauxGenerator->SetHessianProvider( hessianProvider );
+  localStructureGenerator->SetHessianProvider( hessianProvider );
+  vesselnessGenerator->SetHessianProvider( hessianProvider );
+
+  try
+    {
+    frangiGenerator->Update();
+    referenceFrangiGenerator->Update();
+    descoteauxGenerator->Update();
+    localStructureGenerator->Update();
+    vesselnessGenerator->Update();
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  hessianProvider->Print( std::cout );
+
+  if( hessianProvider->GetNumberOfComputedHessians() != 1 )
+    {
+    std::cerr << "Expected a single Hessian computation but got ";
+    std::cerr << hessianProvider->GetNumberOfComputedHessians() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if( hessianProvider->GetNumberOfReusedHessians() != 3 )
+    {
+    std::cerr << "Expected three reused Hessians but got ";
+    std::cerr << hessianProvider->GetNumberOfReusedHessians() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  //
+  // The shared Hessian must produce exactly the same feature as the private one.
+  //
+  OutputImageSpatialObjectType::ConstPointer sharedObject =
+    dynamic_cast< const OutputImageSpatialObjectType * >( frangiGenerator->GetFeature() );
+  OutputImageSpatialObjectType::ConstPointer referenceObject =
+    dynamic_cast< const OutputImageSpatialObjectType * >( referenceFrangiGenerator->GetFeature() );
+
+  using IteratorType = itk::ImageRegionConstIterator< OutputImageType >;
+  IteratorType sitr( sharedObject->GetImage(), sharedObject->GetImage()->GetBufferedRegion() );
+  IteratorType ritr( referenceObject->GetImage(), referenceObject->GetImage()->GetBufferedRegion() );
+
+  for( sitr.GoToBegin(), ritr.GoToBegin(); !sitr.IsAtEnd(); ++sitr, ++ritr )
+    {
+    if( sitr.Get() != ritr.Get() )
+      {
+      std::cerr << "Shared and private Hessian features differ at " << sitr.GetIndex() << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  //
+  // Modifying the input image must invalidate the cached entry.
+  //
+  inputImage->Modified();
+  frangiGenerator->Modified();
+
+  try
+    {
+    frangiGenerator->Update();
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if( hessianProvider->GetNumberOfComputedHessians() != 2 )
+    {
+    std::cerr << "Modified input did not trigger a new Hessian computation" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  hessianProvider->ReleaseCachedImages();
+
+  return EXIT_SUCCESS;
+}
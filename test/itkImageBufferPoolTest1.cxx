@@ -0,0 +1,197 @@
+/*=========================================================================
+
+  Program:   Lesion Sizing Toolkit
+  Module:    itkImageBufferPoolTest1.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+// The test checks the reuse of released blocks and the statistics of the
+// pool, and that the hole filling flood gives the same result whether its
+// seeds mask comes from the pool or from the heap.
+
+#include "itkImageBufferPool.h"
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkBinaryThresholdImageFilter.h"
+#include "itkVotingBinaryHoleFillFloodingImageFilter.h"
+
+int itkImageBufferPoolTest1( int argc, char * argv [] )
+{
+
+  if( argc < 2 )
+    {
+    std::cerr << "Missing Arguments" << std::endl;
+    std::cerr << argv[0] << " inputImage" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  constexpr unsigned int Dimension = 3;
+
+  using FloatImageType = itk::Image< float, Dimension >;
+
+  itk::ImageBufferPool::Pointer pool = itk::ImageBufferPool::New();
+
+  FloatImageType::SizeType size;
+  size.Fill( 20 );
+
+  FloatImageType::RegionType region;
+  region.SetSize( size );
+
+  const itk::SizeValueType imageSize = region.GetNumberOfPixels() * sizeof( float );
+
+  //
+  // A released block serves the next request of the same bucket.
+  //
+    {
+    FloatImageType::Pointer image = FloatImageType::New();
+    image->SetRegions( region );
+    itk::ImageBufferPool::Allocate( image.GetPointer(), pool );
+    image->FillBuffer( 1.0f );
+
+    if( pool->GetNumberOfMisses() != 1 || pool->GetNumberOfHits() != 0 ||
+        pool->GetSizeInUse() < imageSize || pool->GetIdleSize() != 0 )
+      {
+      std::cerr << "Unexpected statistics after the first allocation" << std::endl;
+      pool->Print( std::cerr );
+      return EXIT_FAILURE;
+      }
+    }
+
+  if( pool->GetSizeInUse() != 0 || pool->GetIdleSize() < imageSize )
+    {
+    std::cerr << "The block was not returned to the pool" << std::endl;
+    pool->Print( std::cerr );
+    return EXIT_FAILURE;
+    }
+
+  FloatImageType::SizeType smallerSize = size;
+  smallerSize[2] = 19;
+
+  FloatImageType::Pointer images[2];
+  for( auto & image : images )
+    {
+    image = FloatImageType::New();
+    image->SetRegions( smallerSize );
+    itk::ImageBufferPool::Allocate( image.GetPointer(), pool );
+    image->FillBuffer( 2.0f );
+    }
+
+  if( pool->GetNumberOfHits() != 1 || pool->GetNumberOfMisses() != 2 )
+    {
+    std::cerr << "Expected 1 hit and 2 misses but got " << pool->GetNumberOfHits();
+    std::cerr << " and " << pool->GetNumberOfMisses() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if( pool->GetHighWaterMark() < 2 * imageSize * 19 / 20 || pool->GetHighWaterMark() != pool->GetSizeInUse() )
+    {
+    std::cerr << "Unexpected high-water mark " << pool->GetHighWaterMark() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Re-initializing an image releases its block.
+  images[0]->Initialize();
+  images[1] = nullptr;
+
+  if( pool->GetSizeInUse() != 0 )
+    {
+    std::cerr << "The blocks of released images are still in use" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Idle blocks beyond the maximum are freed.
+  pool->SetMaximumIdleSize( 0 );
+
+  if( pool->GetIdleSize() != 0 )
+    {
+    std::cerr << "Idle blocks were not freed" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  pool->SetMaximumIdleSize( 1024 * 1024 * 1024 );
+  pool->ResetStatistics();
+
+  //
+  // The flood gives the same result with a pooled and with a heap allocated
+  // seeds mask, and draws from the pool on repeated runs.
+  //
+  using InputImageType = itk::Image< signed short, Dimension >;
+  using MaskImageType = itk::Image< unsigned char, Dimension >;
+
+  using ReaderType = itk::ImageFileReader< InputImageType >;
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( argv[1] );
+
+  using ThresholderType = itk::BinaryThresholdImageFilter< InputImageType, MaskImageType >;
+  ThresholderType::Pointer thresholder = ThresholderType::New();
+  thresholder->SetInput( reader->GetOutput() );
+  thresholder->SetLowerThreshold( -400 );
+  thresholder->SetUpperThreshold( itk::NumericTraits< signed short >::max() );
+  thresholder->SetOutsideValue(  0 );
+  thresholder->SetInsideValue( 255 );
+
+  using HoleFillType = itk::VotingBinaryHoleFillFloodingImageFilter< MaskImageType, MaskImageType >;
+
+  MaskImageType::SizeType radius;
+  radius.Fill( 1 );
+
+  HoleFillType::Pointer holeFill[2];
+  for( unsigned int k = 0; k < 2; k++ )
+    {
+    holeFill[k] = HoleFillType::New();
+    holeFill[k]->SetInput( thresholder->GetOutput() );
+    holeFill[k]->SetRadius( radius );
+    holeFill[k]->SetBackgroundValue(   0 );
+    holeFill[k]->SetForegroundValue( 255 );
+    holeFill[k]->SetMajorityThreshold( 1 );
+    holeFill[k]->SetMaximumNumberOfIterations( 20 );
+    }
+
+  holeFill[0]->SetBufferPool( nullptr );
+  holeFill[1]->SetBufferPool( pool );
+
+  try
+    {
+    holeFill[0]->Update();
+    holeFill[1]->Update();
+    holeFill[1]->Modified();
+    holeFill[1]->Update();
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  pool->Print( std::cout );
+
+  if( pool->GetNumberOfMisses() != 1 || pool->GetNumberOfHits() != 1 || pool->GetSizeInUse() != 0 )
+    {
+    std::cerr << "The seeds mask was not drawn from and returned to the pool" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  using IteratorType = itk::ImageRegionConstIterator< MaskImageType >;
+  IteratorType hitr( holeFill[0]->GetOutput(), holeFill[0]->GetOutput()->GetBufferedRegion() );
+  IteratorType pitr( holeFill[1]->GetOutput(), holeFill[1]->GetOutput()->GetBufferedRegion() );
+
+  for( hitr.GoToBegin(), pitr.GoToBegin(); !hitr.IsAtEnd(); ++hitr, ++pitr )
+    {
+    if( hitr.Get() != pitr.Get() )
+      {
+      std::cerr << "Pooled and heap allocated floods differ at " << hitr.GetIndex() << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
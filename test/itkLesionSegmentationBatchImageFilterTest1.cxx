@@ -0,0 +1,258 @@
+/*=========================================================================
+
+  Program:   Lesion Sizing Toolkit
+  Module:    itkLesionSegmentationBatchImageFilterTest1.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+// The test segments three lesions, two of them with overlapping regions of
+// interest, checks that the overlapping regions were merged, that every
+// label stays in the region of interest of its lesion, and that the level
+// set of a lesion is the one LesionSegmentationImageFilter8 produces on the
+// same region.
+
+#include "itkLesionSegmentationBatchImageFilter.h"
+#include "itkLesionSegmentationImageFilter8.h"
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkImageFileWriter.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkLandmarksReader.h"
+
+#include <cmath>
+
+int itkLesionSegmentationBatchImageFilterTest1( int argc, char * argv [] )
+{
+
+  if( argc < 3 )
+    {
+    std::cerr << "Missing Arguments" << std::endl;
+    std::cerr << argv[0] << " landmarksFile inputImage [outputLabelImage]" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  constexpr unsigned int Dimension = 3;
+
+  using InputPixelType = signed short;
+  using LabelPixelType = unsigned short;
+  using LevelSetPixelType = float;
+
+  using InputImageType = itk::Image< InputPixelType, Dimension >;
+  using LabelImageType = itk::Image< LabelPixelType, Dimension >;
+  using LevelSetImageType = itk::Image< LevelSetPixelType, Dimension >;
+
+  using BatchFilterType = itk::LesionSegmentationBatchImageFilter< InputImageType, LabelImageType >;
+  using SingleFilterType = itk::LesionSegmentationImageFilter8< InputImageType, LevelSetImageType >;
+
+  using InputImageReaderType = itk::ImageFileReader< InputImageType >;
+  using LandmarksReaderType = itk::LandmarksReader< Dimension >;
+
+  InputImageReaderType::Pointer inputImageReader = InputImageReaderType::New();
+  inputImageReader->SetFileName( argv[2] );
+
+  try
+    {
+    inputImageReader->Update();
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  const InputImageType * inputImage = inputImageReader->GetOutput();
+
+  LandmarksReaderType::Pointer landmarksReader = LandmarksReaderType::New();
+  landmarksReader->SetFileName( argv[1] );
+  landmarksReader->Update();
+
+  const BatchFilterType::PointListType & landmarks = landmarksReader->GetOutput()->GetPoints();
+
+  if( landmarks.size() < 2 )
+    {
+    std::cerr << "Expected at least two seeds" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  const BatchFilterType::RegionType bufferedRegion = inputImage->GetBufferedRegion();
+
+  //
+  // Two lesions around the seeds, with overlapping regions of interest, and
+  // a third one in a corner of the image.
+  //
+  BatchFilterType::RegionType regionsOfInterest[3];
+  BatchFilterType::PointListType seeds[3];
+
+  for( unsigned int k = 0; k < 2; k++ )
+    {
+    seeds[k].push_back( landmarks[k] );
+
+    InputImageType::IndexType seedIndex;
+    inputImage->TransformPhysicalPointToIndex( landmarks[k].GetPosition(), seedIndex );
+
+    InputImageType::IndexType start;
+    InputImageType::SizeType size;
+    for( unsigned int d = 0; d < Dimension; d++ )
+      {
+      const itk::IndexValueType radius = ( d == 2 ) ? 15 : 25;
+      start[d] = seedIndex[d] - radius;
+      size[d] = 2 * radius + 1;
+      }
+    regionsOfInterest[k].SetIndex( start );
+    regionsOfInterest[k].SetSize( size );
+    regionsOfInterest[k].Crop( bufferedRegion );
+    }
+
+  InputImageType::SizeType cornerSize;
+  cornerSize.Fill( 10 );
+  regionsOfInterest[2].SetIndex( bufferedRegion.GetIndex() );
+  regionsOfInterest[2].SetSize( cornerSize );
+
+  InputImageType::IndexType cornerSeedIndex = bufferedRegion.GetIndex();
+  for( unsigned int d = 0; d < Dimension; d++ )
+    {
+    cornerSeedIndex[d] += 5;
+    }
+  InputImageType::PointType cornerSeedPosition;
+  inputImage->TransformIndexToPhysicalPoint( cornerSeedIndex, cornerSeedPosition );
+
+  seeds[2].push_back( landmarks[0] );
+  seeds[2][0].SetPosition( cornerSeedPosition );
+
+  BatchFilterType::Pointer batchFilter = BatchFilterType::New();
+  batchFilter->SetInput( inputImage );
+  batchFilter->SetSigmoidBeta( -500.0 );
+  for( unsigned int k = 0; k < 3; k++ )
+    {
+    batchFilter->AddLesion( seeds[k], regionsOfInterest[k] );
+    }
+
+  try
+    {
+    batchFilter->Update();
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  batchFilter->Print( std::cout );
+
+  if( batchFilter->GetNumberOfMergedRegions() != 2 )
+    {
+    std::cerr << "Expected 2 merged regions but got " << batchFilter->GetNumberOfMergedRegions() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if( batchFilter->GetMergedRegionOfLesion( 0 ) != batchFilter->GetMergedRegionOfLesion( 1 ) ||
+      batchFilter->GetMergedRegionOfLesion( 0 ) == batchFilter->GetMergedRegionOfLesion( 2 ) )
+    {
+    std::cerr << "The overlapping regions of interest were not merged" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  //
+  // Every label lies within the region of interest of its lesion.
+  //
+  const LabelImageType * labelImage = batchFilter->GetOutput();
+
+  unsigned long numberOfLesionVoxels = 0;
+
+  using LabelIteratorType = itk::ImageRegionConstIteratorWithIndex< LabelImageType >;
+  LabelIteratorType litr( labelImage, labelImage->GetBufferedRegion() );
+  for( litr.GoToBegin(); !litr.IsAtEnd(); ++litr )
+    {
+    const LabelPixelType label = litr.Get();
+    if( label == 0 )
+      {
+      continue;
+      }
+    if( label > 3 || !regionsOfInterest[label - 1].IsInside( litr.GetIndex() ) )
+      {
+      std::cerr << "Unexpected label " << label << " at " << litr.GetIndex() << std::endl;
+      return EXIT_FAILURE;
+      }
+    if( label < 3 )
+      {
+      ++numberOfLesionVoxels;
+      }
+    }
+
+  if( numberOfLesionVoxels == 0 )
+    {
+    std::cerr << "The lesions were not segmented" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  //
+  // The level set of the first lesion is the one of the single lesion filter
+  // run on the merged region.
+  //
+  SingleFilterType::Pointer singleFilter = SingleFilterType::New();
+  singleFilter->SetInput( inputImage );
+  singleFilter->SetSeeds( seeds[0] );
+  singleFilter->SetRegionOfInterest( batchFilter->GetMergedRegion( batchFilter->GetMergedRegionOfLesion( 0 ) ) );
+  singleFilter->SetSigmoidBeta( -500.0 );
+
+  try
+    {
+    singleFilter->Update();
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  const LevelSetImageType * batchLevelSet = batchFilter->GetLesionSegmentation( 0 )->GetImage();
+  const LevelSetImageType * singleLevelSet = singleFilter->GetOutput();
+
+  if( batchLevelSet->GetBufferedRegion() != singleLevelSet->GetBufferedRegion() )
+    {
+    std::cerr << "Batch and single lesion level sets have different regions" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  using LevelSetIteratorType = itk::ImageRegionConstIteratorWithIndex< LevelSetImageType >;
+  LevelSetIteratorType bitr( batchLevelSet, batchLevelSet->GetBufferedRegion() );
+  LevelSetIteratorType sitr( singleLevelSet, singleLevelSet->GetBufferedRegion() );
+
+  for( bitr.GoToBegin(), sitr.GoToBegin(); !bitr.IsAtEnd(); ++bitr, ++sitr )
+    {
+    if( std::abs( bitr.Get() - sitr.Get() ) > 1e-4 )
+      {
+      std::cerr << "Batch and single lesion level sets differ at " << bitr.GetIndex() << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  if( argc > 3 )
+    {
+    using LabelWriterType = itk::ImageFileWriter< LabelImageType >;
+    LabelWriterType::Pointer writer = LabelWriterType::New();
+    writer->SetFileName( argv[3] );
+    writer->SetInput( labelImage );
+    writer->UseCompressionOn();
+
+    try
+      {
+      writer->Update();
+      }
+    catch( itk::ExceptionObject & excp )
+      {
+      std::cerr << excp << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,265 @@
+/*=========================================================================
+
+  Program:   Lesion Sizing Toolkit
+  Module:    itkLesionSegmentationImageFilter8Test1.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+// The test checks that re-running the segmentation after changing only the
+// seeds, the level set parameters or the sigmoid beta only re-executes the
+// stages that depend on them, and that the result is the same as the one of
+// a segmentation run from scratch with the final parameters.
+
+#include "itkLesionSegmentationImageFilter8.h"
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkImageFileWriter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkLandmarksReader.h"
+#include "itkCommand.h"
+
+#include <set>
+#include <string>
+
+namespace
+{
+
+constexpr unsigned int Dimension = 3;
+using InputPixelType = signed short;
+using OutputPixelType = float;
+using InputImageType = itk::Image< InputPixelType,  Dimension >;
+using OutputImageType = itk::Image< OutputPixelType, Dimension >;
+using SegmentationMethodType = itk::LesionSegmentationImageFilter8<
+        InputImageType, OutputImageType >;
+
+// Records the stages reported by the segmentation filter while it runs.
+class StageRecorder : public itk::Command
+{
+public:
+  using Self = StageRecorder;
+  using Superclass = itk::Command;
+  using Pointer = itk::SmartPointer<Self>;
+  itkNewMacro( Self );
+
+  void Execute( itk::Object * caller, const itk::EventObject & event ) override
+    {
+    this->Execute( static_cast< const itk::Object * >( caller ), event );
+    }
+
+  void Execute( const itk::Object * caller, const itk::EventObject & event ) override
+    {
+    const auto * filter = dynamic_cast< const SegmentationMethodType * >( caller );
+    if( filter && itk::ProgressEvent().CheckEvent( &event ) && filter->GetStatusMessage() )
+      {
+      this->m_Stages.insert( filter->GetStatusMessage() );
+      }
+    }
+
+  std::set< std::string >   m_Stages;
+
+protected:
+  StageRecorder() = default;
+};
+
+bool Ran( const std::set< std::string > & stages, const std::string & prefix )
+{
+  for( const auto & stage : stages )
+    {
+    if( stage.compare( 0, prefix.size(), prefix ) == 0 )
+      {
+      return true;
+      }
+    }
+  return false;
+}
+
+}
+
+int itkLesionSegmentationImageFilter8Test1( int argc, char * argv [] )
+{
+
+  if( argc < 3 )
+    {
+    std::cerr << "Missing Arguments" << std::endl;
+    std::cerr << argv[0] << " landmarksFile inputImage [outputImage]" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  using InputImageReaderType = itk::ImageFileReader< InputImageType >;
+  using LandmarksReaderType = itk::LandmarksReader< Dimension >;
+  using SeedSpatialObjectType = itk::LandmarkSpatialObject< Dimension >;
+
+  InputImageReaderType::Pointer inputImageReader = InputImageReaderType::New();
+  inputImageReader->SetFileName( argv[2] );
+
+  try
+    {
+    inputImageReader->Update();
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  const InputImageType * inputImage = inputImageReader->GetOutput();
+
+  LandmarksReaderType::Pointer landmarksReader = LandmarksReaderType::New();
+  landmarksReader->SetFileName( argv[1] );
+  landmarksReader->Update();
+  const SeedSpatialObjectType * landmarks = landmarksReader->GetOutput();
+
+  SegmentationMethodType::Pointer segmentationMethod = SegmentationMethodType::New();
+  segmentationMethod->SetInput( inputImage );
+  segmentationMethod->SetSeeds( landmarks->GetPoints() );
+  segmentationMethod->SetRegionOfInterest( inputImage->GetBufferedRegion() );
+  segmentationMethod->SetSigmoidBeta( -500.0 );
+
+  StageRecorder::Pointer recorder = StageRecorder::New();
+  segmentationMethod->AddObserver( itk::ProgressEvent(), recorder );
+
+  const char * lungWallStage = "Generating lung wall feature";
+  const char * intensityStage = "Generating intensity feature";
+  const char * edgeStage = "Generating canny edge feature";
+  const char * vesselnessStage = "Generating vesselness feature";
+  const char * cropStage = "Cropping data";
+  const char * segmentationStage = "Segmenting using level sets";
+
+  try
+    {
+    //
+    // First run, everything is computed.
+    //
+    segmentationMethod->Update();
+
+    if( !Ran( recorder->m_Stages, lungWallStage ) || !Ran( recorder->m_Stages, edgeStage ) ||
+        !Ran( recorder->m_Stages, segmentationStage ) )
+      {
+      std::cerr << "The first run did not compute all the features" << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    //
+    // Updating again without changes does nothing.
+    //
+    recorder->m_Stages.clear();
+    segmentationMethod->Update();
+
+    if( !recorder->m_Stages.empty() )
+      {
+      std::cerr << "An unchanged filter executed again" << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    //
+    // New seeds and level set parameters only re-execute the segmentation.
+    //
+    recorder->m_Stages.clear();
+    segmentationMethod->SetSeeds( landmarks->GetPoints() );
+    segmentationMethod->SetFastMarchingStoppingTime( 4.0 );
+    segmentationMethod->SetPropagationScaling( 400.0 );
+    segmentationMethod->Update();
+
+    if( Ran( recorder->m_Stages, cropStage ) || Ran( recorder->m_Stages, lungWallStage ) ||
+        Ran( recorder->m_Stages, intensityStage ) || Ran( recorder->m_Stages, edgeStage ) ||
+        Ran( recorder->m_Stages, vesselnessStage ) )
+      {
+      std::cerr << "Changing the seeds recomputed the features" << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    if( !Ran( recorder->m_Stages, segmentationStage ) )
+      {
+      std::cerr << "Changing the seeds did not re-execute the segmentation" << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    //
+    // A new sigmoid beta only recomputes the intensity feature.
+    //
+    recorder->m_Stages.clear();
+    segmentationMethod->SetSigmoidBeta( -200.0 );
+    segmentationMethod->Update();
+
+    if( Ran( recorder->m_Stages, lungWallStage ) || Ran( recorder->m_Stages, edgeStage ) ||
+        Ran( recorder->m_Stages, vesselnessStage ) )
+      {
+      std::cerr << "Changing the sigmoid beta recomputed other features" << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    if( !Ran( recorder->m_Stages, intensityStage ) || !Ran( recorder->m_Stages, segmentationStage ) )
+      {
+      std::cerr << "Changing the sigmoid beta did not recompute the intensity feature" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  //
+  // The incremental result matches a run from scratch.
+  //
+  SegmentationMethodType::Pointer referenceMethod = SegmentationMethodType::New();
+  referenceMethod->SetInput( inputImage );
+  referenceMethod->SetSeeds( landmarks->GetPoints() );
+  referenceMethod->SetRegionOfInterest( inputImage->GetBufferedRegion() );
+  referenceMethod->SetSigmoidBeta( -200.0 );
+  referenceMethod->SetFastMarchingStoppingTime( 4.0 );
+  referenceMethod->SetPropagationScaling( 400.0 );
+
+  try
+    {
+    referenceMethod->Update();
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  using IteratorType = itk::ImageRegionConstIterator< OutputImageType >;
+  IteratorType itr( segmentationMethod->GetOutput(), segmentationMethod->GetOutput()->GetBufferedRegion() );
+  IteratorType ritr( referenceMethod->GetOutput(), referenceMethod->GetOutput()->GetBufferedRegion() );
+
+  for( itr.GoToBegin(), ritr.GoToBegin(); !itr.IsAtEnd(); ++itr, ++ritr )
+    {
+    if( itr.Get() != ritr.Get() )
+      {
+      std::cerr << "Incremental and reference segmentations differ at " << itr.GetIndex() << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  if( argc > 3 )
+    {
+    using OutputWriterType = itk::ImageFileWriter< OutputImageType >;
+    OutputWriterType::Pointer writer = OutputWriterType::New();
+    writer->SetFileName( argv[3] );
+    writer->SetInput( segmentationMethod->GetOutput() );
+    writer->UseCompressionOn();
+
+    try
+      {
+      writer->Update();
+      }
+    catch( itk::ExceptionObject & excp )
+      {
+      std::cerr << excp << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
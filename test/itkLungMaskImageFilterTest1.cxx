@@ -0,0 +1,310 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkLungMaskImageFilterTest1.cxx
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+// Computes the lung mask of a synthetic scan once and checks that the lung
+// wall feature of a region of interest taken from it is a crop of the mask,
+// that the mask is shared rather than copied for a region covering the whole
+// scan, and that regions off the grid of the mask, or masks on a binned
+// grid, are interpolated.
+
+#include "itkLungMaskImageFilter.h"
+#include "itkLungWallFeatureGenerator.h"
+#include "itkRegionOfInterestImageFilter.h"
+#include "itkIsotropicResamplerImageFilter.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+
+#include <cmath>
+#include <cstdlib>
+
+int itkLungMaskImageFilterTest1( int itkNotUsed(argc), char * itkNotUsed(argv) [] )
+{
+  constexpr unsigned int Dimension = 3;
+
+  using InputImageType = itk::Image< signed short, Dimension >;
+  using LungMaskFilterType = itk::LungMaskImageFilter< InputImageType >;
+  using LungMaskImageType = LungMaskFilterType::OutputImageType;
+  using LungWallGeneratorType = itk::LungWallFeatureGenerator< Dimension >;
+  using InputSpatialObjectType = LungWallGeneratorType::InputImageSpatialObjectType;
+  using FeatureSpatialObjectType = LungWallGeneratorType::LungMaskSpatialObjectType;
+
+  //
+  // A box of lung surrounded by tissue, with a bump of tissue on one of its
+  // walls.
+  //
+  InputImageType::SizeType size;
+  size[0] = 64;
+  size[1] = 48;
+  size[2] = 40;
+
+  InputImageType::RegionType region;
+  region.SetSize( size );
+
+  InputImageType::SpacingType spacing;
+  spacing[0] = 0.8;
+  spacing[1] = 0.8;
+  spacing[2] = 1.6;
+
+  InputImageType::Pointer scan = InputImageType::New();
+  scan->SetRegions( region );
+  scan->SetSpacing( spacing );
+  scan->Allocate();
+
+  itk::ImageRegionIteratorWithIndex< InputImageType > sitr( scan, region );
+  for( sitr.GoToBegin(); !sitr.IsAtEnd(); ++sitr )
+    {
+    const InputImageType::IndexType & index = sitr.GetIndex();
+    const bool inLung = index[0] >= 8 && index[0] < 56 && index[1] >= 8 && index[1] < 40 &&
+                        index[2] >= 6 && index[2] < 34;
+    const double bx = ( index[0] - 32.0 ) * spacing[0];
+    const double by = ( index[1] - 8.0 ) * spacing[1];
+    const double bz = ( index[2] - 20.0 ) * spacing[2];
+    const bool inBump = bx * bx + by * by + bz * bz < 16.0;
+    sitr.Set( ( inLung && !inBump ) ? -800 : 40 );
+    }
+
+  LungMaskFilterType::Pointer lungMaskFilter = LungMaskFilterType::New();
+  lungMaskFilter->SetInput( scan );
+  lungMaskFilter->SetLungThreshold( -400 );
+  lungMaskFilter->SetClosingRadius( 2.0 );
+
+  try
+    {
+    lungMaskFilter->Update();
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  lungMaskFilter->Print( std::cout );
+
+  LungMaskImageType::Pointer lungMask = lungMaskFilter->GetOutput();
+  lungMask->DisconnectPipeline();
+
+  InputImageType::IndexType lungIndex = {{ 24, 16, 20 }};
+  InputImageType::IndexType tissueIndex = {{ 2, 2, 2 }};
+
+  if( lungMask->GetPixel( lungIndex ) != 1.0 || lungMask->GetPixel( tissueIndex ) != 0.0 )
+    {
+    std::cerr << "The lung mask is " << lungMask->GetPixel( lungIndex ) << " in the lung and "
+              << lungMask->GetPixel( tissueIndex ) << " in the tissue" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  //
+  // The feature of a region of interest is the box of the mask under it.
+  //
+  InputImageType::RegionType regionOfInterest;
+  InputImageType::IndexType roiStart = {{ 20, 4, 10 }};
+  InputImageType::SizeType roiSize = {{ 24, 20, 16 }};
+  regionOfInterest.SetIndex( roiStart );
+  regionOfInterest.SetSize( roiSize );
+
+  using CropFilterType = itk::RegionOfInterestImageFilter< InputImageType, InputImageType >;
+  CropFilterType::Pointer cropFilter = CropFilterType::New();
+  cropFilter->SetInput( scan );
+  cropFilter->SetRegionOfInterest( regionOfInterest );
+
+  using ResamplerType = itk::IsotropicResamplerImageFilter< InputImageType, InputImageType >;
+  ResamplerType::Pointer resampler = ResamplerType::New();
+  InputImageType::SpacingType isotropicSpacing;
+  isotropicSpacing.Fill( 0.8 );
+  resampler->SetInput( cropFilter->GetOutput() );
+  resampler->SetOutputSpacing( isotropicSpacing );
+
+  try
+    {
+    cropFilter->Update();
+    resampler->Update();
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  InputSpatialObjectType::Pointer roiObject = InputSpatialObjectType::New();
+  roiObject->SetImage( cropFilter->GetOutput() );
+
+  LungWallGeneratorType::Pointer roiGenerator = LungWallGeneratorType::New();
+  roiGenerator->SetInput( roiObject );
+  roiGenerator->SetLungMask( lungMask );
+
+  InputSpatialObjectType::Pointer scanObject = InputSpatialObjectType::New();
+  scanObject->SetImage( scan );
+
+  LungWallGeneratorType::Pointer scanGenerator = LungWallGeneratorType::New();
+  scanGenerator->SetInput( scanObject );
+  scanGenerator->SetLungMask( lungMask );
+
+  InputSpatialObjectType::Pointer resampledObject = InputSpatialObjectType::New();
+  resampledObject->SetImage( resampler->GetOutput() );
+
+  LungWallGeneratorType::Pointer resampledGenerator = LungWallGeneratorType::New();
+  resampledGenerator->SetInput( resampledObject );
+  resampledGenerator->SetLungMask( lungMask );
+
+  try
+    {
+    roiGenerator->Update();
+    scanGenerator->Update();
+    resampledGenerator->Update();
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  const LungMaskImageType * roiFeature =
+    dynamic_cast< const FeatureSpatialObjectType * >( roiGenerator->GetFeature() )->GetImage();
+
+  if( roiFeature->GetBufferedRegion() != cropFilter->GetOutput()->GetBufferedRegion() )
+    {
+    std::cerr << "The feature of the region of interest is buffered over "
+              << roiFeature->GetBufferedRegion() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  itk::ImageRegionConstIteratorWithIndex< LungMaskImageType > ritr( roiFeature, roiFeature->GetBufferedRegion() );
+  for( ritr.GoToBegin(); !ritr.IsAtEnd(); ++ritr )
+    {
+    InputImageType::IndexType scanIndex;
+    for( unsigned int d = 0; d < Dimension; d++ )
+      {
+      scanIndex[d] = ritr.GetIndex()[d] + roiStart[d];
+      }
+    if( ritr.Get() != lungMask->GetPixel( scanIndex ) )
+      {
+      std::cerr << "The feature of the region of interest is " << ritr.Get() << " at " << ritr.GetIndex()
+                << " where the mask is " << lungMask->GetPixel( scanIndex ) << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  //
+  // The feature of the whole scan is the mask itself.
+  //
+  const LungMaskImageType * scanFeature =
+    dynamic_cast< const FeatureSpatialObjectType * >( scanGenerator->GetFeature() )->GetImage();
+
+  if( scanFeature != lungMask.GetPointer() )
+    {
+    std::cerr << "The feature of the whole scan is a copy of the mask" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  //
+  // The feature of the resampled region is interpolated from the mask.
+  //
+  const LungMaskImageType * resampledFeature =
+    dynamic_cast< const FeatureSpatialObjectType * >( resampledGenerator->GetFeature() )->GetImage();
+
+  if( resampledFeature->GetSpacing() != isotropicSpacing ||
+      resampledFeature->GetBufferedRegion() != resampler->GetOutput()->GetBufferedRegion() )
+    {
+    std::cerr << "The feature of the resampled region is not on its grid" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  itk::ImageRegionConstIteratorWithIndex< LungMaskImageType > iitr( resampledFeature,
+    resampledFeature->GetBufferedRegion() );
+  for( iitr.GoToBegin(); !iitr.IsAtEnd(); ++iitr )
+    {
+    if( iitr.Get() < 0.0 || iitr.Get() > 1.0 )
+      {
+      std::cerr << "The feature of the resampled region is " << iitr.Get() << " at "
+                << iitr.GetIndex() << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  LungMaskImageType::PointType lungPoint;
+  scan->TransformIndexToPhysicalPoint( lungIndex, lungPoint );
+
+  LungMaskImageType::IndexType resampledLungIndex;
+  resampledFeature->TransformPhysicalPointToIndex( lungPoint, resampledLungIndex );
+
+  if( resampledFeature->GetPixel( resampledLungIndex ) < 0.999 )
+    {
+    std::cerr << "The feature of the resampled region is "
+              << resampledFeature->GetPixel( resampledLungIndex ) << " in the lung" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  //
+  // A mask on a binned grid.
+  //
+  lungMaskFilter->SetMaskSpacing( 1.6 );
+
+  try
+    {
+    lungMaskFilter->Update();
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  const LungMaskImageType * binnedMask = lungMaskFilter->GetOutput();
+
+  // Bins of two voxels across the slices, none along the thick axis.
+  const InputImageType::SizeType binnedSize = {{ 32, 24, 40 }};
+
+  for( unsigned int d = 0; d < Dimension; d++ )
+    {
+    if( std::abs( binnedMask->GetSpacing()[d] - 1.6 ) > 1e-6 ||
+        binnedMask->GetBufferedRegion().GetSize(d) != binnedSize[d] )
+      {
+      std::cerr << "The binned mask has spacing " << binnedMask->GetSpacing() << " and region "
+                << binnedMask->GetBufferedRegion() << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  roiGenerator->SetLungMask( binnedMask );
+
+  try
+    {
+    roiGenerator->Update();
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  roiFeature = dynamic_cast< const FeatureSpatialObjectType * >( roiGenerator->GetFeature() )->GetImage();
+
+  InputImageType::IndexType roiLungIndex;
+  for( unsigned int d = 0; d < Dimension; d++ )
+    {
+    roiLungIndex[d] = lungIndex[d] - roiStart[d];
+    }
+
+  if( roiFeature->GetPixel( roiLungIndex ) < 0.999 )
+    {
+    std::cerr << "The feature interpolated from the binned mask is "
+              << roiFeature->GetPixel( roiLungIndex ) << " in the lung" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
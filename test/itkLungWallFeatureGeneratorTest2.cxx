@@ -0,0 +1,196 @@
+/*=========================================================================
+
+  Program:   Lesion Sizing Toolkit
+  Module:    itkLungWallFeatureGeneratorTest2.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+// Compares the lung wall feature closed by distance maps with the one of the
+// iterative hole filling. The fraction of pixels where they disagree, over
+// the pixels that are lung in either of them, is reported. It must stay below
+// the tolerance when one is given; the registered tests give none until the
+// closing radius and the tolerance are calibrated against the collections.
+
+#include "itkLungWallFeatureGenerator.h"
+#include "itkImage.h"
+#include "itkSpatialObject.h"
+#include "itkImageSpatialObject.h"
+#include "itkImageFileReader.h"
+#include "itkImageFileWriter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkTimeProbe.h"
+
+int itkLungWallFeatureGeneratorTest2( int argc, char * argv [] )
+{
+
+  if( argc < 3 )
+    {
+    std::cerr << "Missing Arguments" << std::endl;
+    std::cerr << argv[0] << " inputImage outputImage [lungThreshold] [closingRadius] [tolerance]" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  constexpr unsigned int Dimension = 3;
+
+  using InputPixelType = signed short;
+  using OutputPixelType = float;
+
+  using InputImageType = itk::Image< InputPixelType,  Dimension >;
+  using OutputImageType = itk::Image< OutputPixelType, Dimension >;
+
+  using ReaderType = itk::ImageFileReader< InputImageType >;
+  using WriterType = itk::ImageFileWriter< OutputImageType >;
+
+  using InputImageSpatialObjectType = itk::ImageSpatialObject< Dimension, InputPixelType  >;
+  using OutputImageSpatialObjectType = itk::ImageSpatialObject< Dimension, OutputPixelType >;
+
+  ReaderType::Pointer reader = ReaderType::New();
+
+  reader->SetFileName( argv[1] );
+
+  try
+    {
+    reader->Update();
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  using LungWallFeatureGeneratorType = itk::LungWallFeatureGenerator< Dimension >;
+
+  InputImageSpatialObjectType::Pointer inputObject = InputImageSpatialObjectType::New();
+
+  InputImageType::Pointer inputImage = reader->GetOutput();
+
+  inputImage->DisconnectPipeline();
+
+  inputObject->SetImage( inputImage );
+
+  LungWallFeatureGeneratorType::Pointer  holeFillingGenerator = LungWallFeatureGeneratorType::New();
+  LungWallFeatureGeneratorType::Pointer  distanceGenerator = LungWallFeatureGeneratorType::New();
+
+  holeFillingGenerator->SetInput( inputObject );
+  distanceGenerator->SetInput( inputObject );
+
+  distanceGenerator->UseDistanceClosingOn();
+
+  if( argc > 3 )
+    {
+    holeFillingGenerator->SetLungThreshold( atoi( argv[3] ) );
+    distanceGenerator->SetLungThreshold( atoi( argv[3] ) );
+    }
+
+  if( argc > 4 )
+    {
+    distanceGenerator->SetClosingRadius( atof( argv[4] ) );
+    }
+
+  const bool   checkTolerance = ( argc > 5 );
+  const double tolerance = checkTolerance ? atof( argv[5] ) : 0.0;
+
+  itk::TimeProbe holeFillingProbe;
+  itk::TimeProbe distanceProbe;
+
+  try
+    {
+    holeFillingProbe.Start();
+    holeFillingGenerator->Update();
+    holeFillingProbe.Stop();
+
+    distanceProbe.Start();
+    distanceGenerator->Update();
+    distanceProbe.Stop();
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  std::cout << "Hole filling time  = " << holeFillingProbe.GetTotal() << std::endl;
+  std::cout << "Distance time      = " << distanceProbe.GetTotal() << std::endl;
+
+  const OutputImageType * holeFillingImage = dynamic_cast< const OutputImageSpatialObjectType * >(
+    holeFillingGenerator->GetFeature() )->GetImage();
+  const OutputImageType * distanceImage = dynamic_cast< const OutputImageSpatialObjectType * >(
+    distanceGenerator->GetFeature() )->GetImage();
+
+  using IteratorType = itk::ImageRegionConstIterator< OutputImageType >;
+
+  IteratorType hitr( holeFillingImage, holeFillingImage->GetBufferedRegion() );
+  IteratorType ditr( distanceImage, holeFillingImage->GetBufferedRegion() );
+
+  itk::SizeValueType numberOfLungPixels = 0;
+  itk::SizeValueType numberOfDisagreements = 0;
+
+  for( hitr.GoToBegin(), ditr.GoToBegin(); !hitr.IsAtEnd(); ++hitr, ++ditr )
+    {
+    const bool holeFillingLung = hitr.Get() > 0.5;
+    const bool distanceLung = ditr.Get() > 0.5;
+    if( holeFillingLung || distanceLung )
+      {
+      numberOfLungPixels++;
+      }
+    if( holeFillingLung != distanceLung )
+      {
+      numberOfDisagreements++;
+      }
+    }
+
+  const double disagreement = numberOfLungPixels ?
+    static_cast< double >( numberOfDisagreements ) / numberOfLungPixels : 0.0;
+
+  std::cout << "Disagreement = " << disagreement << " ( " << numberOfDisagreements
+            << " of " << numberOfLungPixels << " lung pixels )" << std::endl;
+
+  WriterType::Pointer writer = WriterType::New();
+
+  writer->SetFileName( argv[2] );
+  writer->UseCompressionOn();
+  writer->SetInput( distanceImage );
+
+  try
+    {
+    writer->Update();
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  distanceGenerator->Print( std::cout );
+
+  if( checkTolerance && disagreement > tolerance )
+    {
+    std::cerr << "The distance closing disagrees with the hole filling on "
+              << disagreement << " of the lung, more than " << tolerance << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  distanceGenerator->SetClosingRadius( 3.0 );
+  if( distanceGenerator->GetClosingRadius() != 3.0 )
+    {
+    std::cerr << "Error in Set/GetClosingRadius()" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  distanceGenerator->UseDistanceClosingOff();
+  if( distanceGenerator->GetUseDistanceClosing() )
+    {
+    std::cerr << "Error in Set/GetUseDistanceClosing()" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
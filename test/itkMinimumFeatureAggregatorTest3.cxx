@@ -0,0 +1,185 @@
+/*=========================================================================
+
+  Program:   Lesion Sizing Toolkit
+  Module:    itkMinimumFeatureAggregatorTest3.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#include "itkMinimumFeatureAggregator.h"
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkImageFileWriter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkLungWallFeatureGenerator.h"
+#include "itkSatoVesselnessSigmoidFeatureGenerator.h"
+#include "itkCannyEdgesFeatureGenerator.h"
+#include "itkSigmoidFeatureGenerator.h"
+
+//
+// Computes the same aggregated feature serially and with the feature
+// generators running concurrently, and verifies that both are identical.
+//
+int itkMinimumFeatureAggregatorTest3( int argc, char * argv [] )
+{
+
+  if( argc < 3 )
+    {
+    std::cerr << "Missing Arguments" << std::endl;
+    std::cerr << argv[0] << " inputImage outputImage [maximumNumberOfConcurrentGenerators]";
+    return EXIT_FAILURE;
+    }
+
+
+  constexpr unsigned int Dimension = 3;
+  using InputPixelType = signed short;
+
+  using InputImageType = itk::Image< InputPixelType, Dimension >;
+
+  using InputImageReaderType = itk::ImageFileReader< InputImageType >;
+  InputImageReaderType::Pointer inputImageReader = InputImageReaderType::New();
+
+  inputImageReader->SetFileName( argv[1] );
+
+  try
+    {
+    inputImageReader->Update();
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+
+  using AggregatorType = itk::MinimumFeatureAggregator< Dimension >;
+  using VesselnessGeneratorType = itk::SatoVesselnessSigmoidFeatureGenerator< Dimension >;
+  using LungWallGeneratorType = itk::LungWallFeatureGenerator< Dimension >;
+  using SigmoidFeatureGeneratorType = itk::SigmoidFeatureGenerator< Dimension >;
+  using CannyEdgesFeatureGeneratorType = itk::CannyEdgesFeatureGenerator< Dimension >;
+
+  using InputImageSpatialObjectType = itk::ImageSpatialObject< Dimension, InputPixelType  >;
+  InputImageSpatialObjectType::Pointer inputObject = InputImageSpatialObjectType::New();
+
+  InputImageType::Pointer inputImage = inputImageReader->GetOutput();
+
+  inputImage->DisconnectPipeline();
+
+  inputObject->SetImage( inputImage );
+
+  AggregatorType::Pointer featureAggregator[2];
+
+  for( unsigned int k = 0; k < 2; k++ )
+    {
+    featureAggregator[k] = AggregatorType::New();
+
+    VesselnessGeneratorType::Pointer vesselnessGenerator = VesselnessGeneratorType::New();
+    LungWallGeneratorType::Pointer lungWallGenerator = LungWallGeneratorType::New();
+    SigmoidFeatureGeneratorType::Pointer  sigmoidGenerator = SigmoidFeatureGeneratorType::New();
+    CannyEdgesFeatureGeneratorType::Pointer  cannyEdgesGenerator = CannyEdgesFeatureGeneratorType::New();
+
+    featureAggregator[k]->AddFeatureGenerator( lungWallGenerator );
+    featureAggregator[k]->AddFeatureGenerator( vesselnessGenerator );
+    featureAggregator[k]->AddFeatureGenerator( sigmoidGenerator );
+    featureAggregator[k]->AddFeatureGenerator( cannyEdgesGenerator );
+
+    lungWallGenerator->SetInput( inputObject );
+    vesselnessGenerator->SetInput( inputObject );
+    sigmoidGenerator->SetInput( inputObject );
+    cannyEdgesGenerator->SetInput( inputObject );
+
+    lungWallGenerator->SetLungThreshold( -400 );
+
+    vesselnessGenerator->SetSigma( 1.0 );
+    vesselnessGenerator->SetAlpha1( 0.5 );
+    vesselnessGenerator->SetAlpha2( 2.0 );
+    vesselnessGenerator->SetSigmoidAlpha( -10.0 );
+    vesselnessGenerator->SetSigmoidBeta( 80.0 );
+
+    sigmoidGenerator->SetAlpha(   1.0 );
+    sigmoidGenerator->SetBeta( -200.0 );
+
+    cannyEdgesGenerator->SetSigma( 1.0 );
+    cannyEdgesGenerator->SetUpperThreshold( 150.0 );
+    cannyEdgesGenerator->SetLowerThreshold( 75.0 );
+    }
+
+  featureAggregator[1]->UseParallelFeatureGenerationOn();
+
+  if( argc > 3 )
+    {
+    featureAggregator[1]->SetMaximumNumberOfConcurrentGenerators( atoi( argv[3] ) );
+    }
+
+  try
+    {
+    featureAggregator[0]->Update();
+    featureAggregator[1]->Update();
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if( featureAggregator[1]->GetProgress() != 1.0f )
+    {
+    std::cerr << "Concurrent progress did not reach 1.0, got ";
+    std::cerr << featureAggregator[1]->GetProgress() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  using OutputImageSpatialObjectType = AggregatorType::OutputImageSpatialObjectType;
+  using OutputImageType = AggregatorType::OutputImageType;
+
+  OutputImageType::ConstPointer outputImage[2];
+
+  for( unsigned int k = 0; k < 2; k++ )
+    {
+    OutputImageSpatialObjectType::ConstPointer outputObject =
+      dynamic_cast< const OutputImageSpatialObjectType * >( featureAggregator[k]->GetFeature() );
+    outputImage[k] = outputObject->GetImage();
+    }
+
+  using IteratorType = itk::ImageRegionConstIterator< OutputImageType >;
+  IteratorType sitr( outputImage[0], outputImage[0]->GetBufferedRegion() );
+  IteratorType pitr( outputImage[1], outputImage[1]->GetBufferedRegion() );
+
+  for( sitr.GoToBegin(), pitr.GoToBegin(); !sitr.IsAtEnd(); ++sitr, ++pitr )
+    {
+    if( sitr.Get() != pitr.Get() )
+      {
+      std::cerr << "Serial and concurrent features differ at " << sitr.GetIndex() << std::endl;
+      std::cerr << sitr.Get() << " != " << pitr.Get() << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  using OutputWriterType = itk::ImageFileWriter< OutputImageType >;
+  OutputWriterType::Pointer writer = OutputWriterType::New();
+
+  writer->SetFileName( argv[2] );
+  writer->SetInput( outputImage[1] );
+  writer->UseCompressionOn();
+
+  try
+    {
+    writer->Update();
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  featureAggregator[1]->Print( std::cout );
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,227 @@
+/*=========================================================================
+
+  Program:   Lesion Sizing Toolkit
+  Module:    itkMinimumFeatureAggregatorTest4.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#include "itkMinimumFeatureAggregator.h"
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkImageFileWriter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkLungWallFeatureGenerator.h"
+#include "itkSatoVesselnessSigmoidFeatureGenerator.h"
+#include "itkSigmoidFeatureGenerator.h"
+
+#include <cmath>
+
+//
+// Computes the same aggregated feature over the whole image and tile by tile,
+// and verifies that both agree, that the tiled generators are left untouched,
+// and that a second update executes nothing. The Canny edges generator, whose
+// hysteresis is not local, does not support tiling.
+//
+int itkMinimumFeatureAggregatorTest4( int argc, char * argv [] )
+{
+
+  if( argc < 3 )
+    {
+    std::cerr << "Missing Arguments" << std::endl;
+    std::cerr << argv[0] << " inputImage outputImage [tileSize]";
+    return EXIT_FAILURE;
+    }
+
+
+  constexpr unsigned int Dimension = 3;
+  using InputPixelType = signed short;
+
+  using InputImageType = itk::Image< InputPixelType, Dimension >;
+
+  using InputImageReaderType = itk::ImageFileReader< InputImageType >;
+  InputImageReaderType::Pointer inputImageReader = InputImageReaderType::New();
+
+  inputImageReader->SetFileName( argv[1] );
+
+  try
+    {
+    inputImageReader->Update();
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+
+  using AggregatorType = itk::MinimumFeatureAggregator< Dimension >;
+  using VesselnessGeneratorType = itk::SatoVesselnessSigmoidFeatureGenerator< Dimension >;
+  using LungWallGeneratorType = itk::LungWallFeatureGenerator< Dimension >;
+  using SigmoidFeatureGeneratorType = itk::SigmoidFeatureGenerator< Dimension >;
+
+  using InputImageSpatialObjectType = itk::ImageSpatialObject< Dimension, InputPixelType  >;
+  InputImageSpatialObjectType::Pointer inputObject = InputImageSpatialObjectType::New();
+
+  InputImageType::Pointer inputImage = inputImageReader->GetOutput();
+
+  inputImage->DisconnectPipeline();
+
+  inputObject->SetImage( inputImage );
+
+  AggregatorType::Pointer featureAggregator[2];
+  SigmoidFeatureGeneratorType::Pointer sigmoidGenerator[2];
+
+  for( unsigned int k = 0; k < 2; k++ )
+    {
+    featureAggregator[k] = AggregatorType::New();
+
+    VesselnessGeneratorType::Pointer vesselnessGenerator = VesselnessGeneratorType::New();
+    LungWallGeneratorType::Pointer lungWallGenerator = LungWallGeneratorType::New();
+    sigmoidGenerator[k] = SigmoidFeatureGeneratorType::New();
+
+    featureAggregator[k]->AddFeatureGenerator( lungWallGenerator );
+    featureAggregator[k]->AddFeatureGenerator( vesselnessGenerator );
+    featureAggregator[k]->AddFeatureGenerator( sigmoidGenerator[k] );
+
+    lungWallGenerator->SetInput( inputObject );
+    vesselnessGenerator->SetInput( inputObject );
+    sigmoidGenerator[k]->SetInput( inputObject );
+
+    lungWallGenerator->SetLungThreshold( -400 );
+
+    vesselnessGenerator->SetSigma( 1.0 );
+    vesselnessGenerator->SetAlpha1( 0.5 );
+    vesselnessGenerator->SetAlpha2( 2.0 );
+    vesselnessGenerator->SetSigmoidAlpha( -10.0 );
+    vesselnessGenerator->SetSigmoidBeta( 80.0 );
+
+    sigmoidGenerator[k]->SetAlpha(   1.0 );
+    sigmoidGenerator[k]->SetBeta( -200.0 );
+    }
+
+  const itk::ModifiedTimeType sigmoidGeneratorMTime = sigmoidGenerator[1]->GetMTime();
+
+  AggregatorType::TileSizeType tileSize;
+  tileSize.Fill( ( argc > 3 ) ? atoi( argv[3] ) : 16 );
+
+  featureAggregator[1]->UseTiledFeatureGenerationOn();
+  featureAggregator[1]->SetTileSize( tileSize );
+
+  try
+    {
+    featureAggregator[0]->Update();
+    featureAggregator[1]->Update();
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if( featureAggregator[1]->GetProgress() != 1.0f )
+    {
+    std::cerr << "Tiled progress did not reach 1.0, got ";
+    std::cerr << featureAggregator[1]->GetProgress() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if( sigmoidGenerator[1]->GetInput() != inputObject.GetPointer() ||
+      sigmoidGenerator[1]->GetMTime() != sigmoidGeneratorMTime )
+    {
+    std::cerr << "The tiled generation modified a generator" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  using OutputImageSpatialObjectType = AggregatorType::OutputImageSpatialObjectType;
+  using OutputImageType = AggregatorType::OutputImageType;
+
+  // The feature of the tiled generator is not left holding the last tile.
+  const auto * sigmoidFeature =
+    dynamic_cast< const OutputImageSpatialObjectType * >( sigmoidGenerator[1]->GetFeature() );
+  const OutputImageType::RegionType sigmoidFeatureRegion = sigmoidFeature->GetImage()->GetBufferedRegion();
+  if( sigmoidFeatureRegion.GetNumberOfPixels() != 0 &&
+      sigmoidFeatureRegion != inputImage->GetBufferedRegion() )
+    {
+    std::cerr << "The feature of a tiled generator holds the region "
+              << sigmoidFeatureRegion << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Nothing changed, the second update reuses the aggregated feature.
+  const OutputImageType * tiledImage =
+    dynamic_cast< const OutputImageSpatialObjectType * >( featureAggregator[1]->GetFeature() )->GetImage();
+
+  try
+    {
+    featureAggregator[1]->Update();
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if( dynamic_cast< const OutputImageSpatialObjectType * >( featureAggregator[1]->GetFeature() )->GetImage() != tiledImage )
+    {
+    std::cerr << "The tiled aggregation executed again without any change" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  OutputImageType::ConstPointer outputImage[2];
+
+  for( unsigned int k = 0; k < 2; k++ )
+    {
+    OutputImageSpatialObjectType::ConstPointer outputObject =
+      dynamic_cast< const OutputImageSpatialObjectType * >( featureAggregator[k]->GetFeature() );
+    outputImage[k] = outputObject->GetImage();
+    }
+
+  if( outputImage[0]->GetBufferedRegion() != outputImage[1]->GetBufferedRegion() )
+    {
+    std::cerr << "Whole and tiled features have different regions" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  using IteratorType = itk::ImageRegionConstIterator< OutputImageType >;
+  IteratorType witr( outputImage[0], outputImage[0]->GetBufferedRegion() );
+  IteratorType titr( outputImage[1], outputImage[1]->GetBufferedRegion() );
+
+  for( witr.GoToBegin(), titr.GoToBegin(); !witr.IsAtEnd(); ++witr, ++titr )
+    {
+    if( std::abs( witr.Get() - titr.Get() ) > 1e-2 )
+      {
+      std::cerr << "Whole and tiled features differ at " << witr.GetIndex() << std::endl;
+      std::cerr << witr.Get() << " != " << titr.Get() << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  using OutputWriterType = itk::ImageFileWriter< OutputImageType >;
+  OutputWriterType::Pointer writer = OutputWriterType::New();
+
+  writer->SetFileName( argv[2] );
+  writer->SetInput( outputImage[1] );
+  writer->UseCompressionOn();
+
+  try
+    {
+    writer->Update();
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  featureAggregator[1]->Print( std::cout );
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,198 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkRegionCompetitionImageFilterTest2.cxx
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+// Checks that two labels competing for the pixels between them split them
+// at mid distance, the lower label winning the ties, that the result does
+// not depend on the number of threads, and that the propagation stops when
+// the filter is aborted.
+
+#include "itkImage.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkCommand.h"
+#include "itkRegionCompetitionImageFilter.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+int itkRegionCompetitionImageFilterTest2( int itkNotUsed(argc), char * itkNotUsed(argv) [] )
+{
+  constexpr unsigned int Dimension = 3;
+
+  using InputPixelType = signed short;
+  using LabelPixelType = unsigned short;
+
+  using InputImageType = itk::Image< InputPixelType, Dimension >;
+  using LabelImageType = itk::Image< LabelPixelType, Dimension >;
+
+  using FilterType = itk::RegionCompetitionImageFilter< InputImageType, LabelImageType >;
+
+  LabelImageType::SizeType size;
+  size[0] = 35;
+  size[1] = 17;
+  size[2] = 17;
+
+  LabelImageType::RegionType region;
+  region.SetSize( size );
+
+  InputImageType::Pointer inputImage = InputImageType::New();
+  inputImage->SetRegions( region );
+  inputImage->Allocate();
+  inputImage->FillBuffer( 100 );
+
+  // Two single pixel labels, 16 pixels apart along x.
+  LabelImageType::Pointer labelImage = LabelImageType::New();
+  labelImage->SetRegions( region );
+  labelImage->Allocate();
+  labelImage->FillBuffer( 0 );
+
+  LabelImageType::IndexType index1 = {{ 5, 8, 8 }};
+  LabelImageType::IndexType index2 = {{ 21, 8, 8 }};
+
+  labelImage->SetPixel( index1, 1 );
+  labelImage->SetPixel( index2, 2 );
+
+  const unsigned int numberOfWorkUnits[] = { 1, 2, 5 };
+
+  FilterType::Pointer filters[3];
+
+  for( unsigned int k = 0; k < 3; k++ )
+    {
+    filters[k] = FilterType::New();
+    filters[k]->SetInput( inputImage );
+    filters[k]->SetInputLabels( labelImage );
+    filters[k]->SetMaximumNumberOfIterations( 100 );
+    filters[k]->SetNumberOfWorkUnits( numberOfWorkUnits[k] );
+
+    try
+      {
+      filters[k]->Update();
+      }
+    catch( itk::ExceptionObject & excp )
+      {
+      std::cerr << excp << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    std::cout << numberOfWorkUnits[k] << " work units: "
+              << filters[k]->GetCurrentIterationNumber() << " iterations, "
+              << filters[k]->GetTotalNumberOfPixelsChanged() << " pixels changed" << std::endl;
+    }
+
+  if( filters[0]->GetNumberOfLabels() != 2 )
+    {
+    std::cerr << "Found " << filters[0]->GetNumberOfLabels() << " labels instead of 2" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  //
+  // Every pixel inside the boundary is labeled, with the label of the
+  // nearest seed, in the chessboard distance that a front with a radius of
+  // one follows. Pixels at the same distance of both seeds go to label 1.
+  //
+  using IteratorType = itk::ImageRegionConstIteratorWithIndex< LabelImageType >;
+
+  const LabelImageType * output = filters[0]->GetOutput();
+
+  IteratorType itr( output, region );
+
+  for( itr.GoToBegin(); !itr.IsAtEnd(); ++itr )
+    {
+    const LabelImageType::IndexType & index = itr.GetIndex();
+
+    bool isBoundary = false;
+    itk::IndexValueType distance1 = 0;
+    itk::IndexValueType distance2 = 0;
+    for( unsigned int d = 0; d < Dimension; d++ )
+      {
+      isBoundary = isBoundary || index[d] == 0 ||
+        index[d] == static_cast< itk::IndexValueType >( size[d] ) - 1;
+      distance1 = std::max( distance1, std::abs( index[d] - index1[d] ) );
+      distance2 = std::max( distance2, std::abs( index[d] - index2[d] ) );
+      }
+
+    const LabelPixelType expectedLabel = isBoundary ? 0 : ( distance1 <= distance2 ) ? 1 : 2;
+
+    if( itr.Get() != expectedLabel )
+      {
+      std::cerr << "Pixel " << index << " has label " << itr.Get()
+                << " instead of " << expectedLabel << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  for( unsigned int k = 1; k < 3; k++ )
+    {
+    if( filters[k]->GetCurrentIterationNumber() != filters[0]->GetCurrentIterationNumber() ||
+        filters[k]->GetTotalNumberOfPixelsChanged() != filters[0]->GetTotalNumberOfPixelsChanged() )
+      {
+      std::cerr << "The propagation with " << numberOfWorkUnits[k]
+                << " work units differs from the one with a single work unit" << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    IteratorType sitr( output, region );
+    IteratorType pitr( filters[k]->GetOutput(), region );
+
+    for( sitr.GoToBegin(), pitr.GoToBegin(); !sitr.IsAtEnd(); ++sitr, ++pitr )
+      {
+      if( sitr.Get() != pitr.Get() )
+        {
+        std::cerr << "Output with " << numberOfWorkUnits[k] << " work units differs at "
+                  << sitr.GetIndex() << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  //
+  // Abort from the first iteration event.
+  //
+  FilterType::Pointer abortedFilter = FilterType::New();
+  abortedFilter->SetInput( inputImage );
+  abortedFilter->SetInputLabels( labelImage );
+  abortedFilter->SetMaximumNumberOfIterations( 100 );
+
+  using CommandType = itk::SimpleMemberCommand< FilterType >;
+  CommandType::Pointer abortCommand = CommandType::New();
+  abortCommand->SetCallbackFunction( abortedFilter, &FilterType::AbortGenerateDataOn );
+  abortedFilter->AddObserver( itk::IterationEvent(), abortCommand );
+
+  bool aborted = false;
+  try
+    {
+    abortedFilter->Update();
+    }
+  catch( itk::ProcessAborted & )
+    {
+    aborted = true;
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if( !aborted || abortedFilter->GetCurrentIterationNumber() != 1 )
+    {
+    std::cerr << "The aborted filter ran " << abortedFilter->GetCurrentIterationNumber()
+              << " iterations and " << ( aborted ? "threw" : "did not throw" )
+              << " ProcessAborted instead of a single aborted iteration" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
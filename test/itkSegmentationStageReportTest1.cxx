@@ -0,0 +1,189 @@
+/*=========================================================================
+
+  Program:   Lesion Sizing Toolkit
+  Module:    itkSegmentationStageReportTest1.cxx
+
+  Copyright (c) Kitware Inc.
+  All rights reserved.
+  See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+// The test attaches a stage report to the segmentation filter, checks that
+// every stage of the pipeline is measured, that re-running after new seeds
+// only reports the segmentation stages, and writes the report as JSON.
+
+#include "itkLesionSegmentationImageFilter8.h"
+#include "itkSegmentationStageReport.h"
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkLandmarksReader.h"
+
+#include <fstream>
+#include <sstream>
+
+int itkSegmentationStageReportTest1( int argc, char * argv [] )
+{
+
+  if( argc < 4 )
+    {
+    std::cerr << "Missing Arguments" << std::endl;
+    std::cerr << argv[0] << " landmarksFile inputImage outputReport" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  constexpr unsigned int Dimension = 3;
+
+  using InputImageType = itk::Image< signed short, Dimension >;
+  using OutputImageType = itk::Image< float, Dimension >;
+
+  using SegmentationMethodType = itk::LesionSegmentationImageFilter8< InputImageType, OutputImageType >;
+  using StageReportType = SegmentationMethodType::StageReportType;
+
+  using InputImageReaderType = itk::ImageFileReader< InputImageType >;
+  using LandmarksReaderType = itk::LandmarksReader< Dimension >;
+
+  InputImageReaderType::Pointer inputImageReader = InputImageReaderType::New();
+  inputImageReader->SetFileName( argv[2] );
+
+  try
+    {
+    inputImageReader->Update();
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  const InputImageType * inputImage = inputImageReader->GetOutput();
+
+  LandmarksReaderType::Pointer landmarksReader = LandmarksReaderType::New();
+  landmarksReader->SetFileName( argv[1] );
+  landmarksReader->Update();
+
+  StageReportType::Pointer report = StageReportType::New();
+
+  SegmentationMethodType::Pointer segmentationMethod = SegmentationMethodType::New();
+  segmentationMethod->SetInput( inputImage );
+  segmentationMethod->SetSeeds( landmarksReader->GetOutput()->GetPoints() );
+  segmentationMethod->SetRegionOfInterest( inputImage->GetBufferedRegion() );
+  segmentationMethod->SetSigmoidBeta( -500.0 );
+  segmentationMethod->SetStageReport( report );
+
+  try
+    {
+    segmentationMethod->Update();
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  report->Print( std::cout );
+
+#ifdef LSTK_DISABLE_INSTRUMENTATION
+  if( report->GetNumberOfStages() != 0 )
+    {
+    std::cerr << "Stages were measured with the instrumentation disabled" << std::endl;
+    return EXIT_FAILURE;
+    }
+#else
+  const char * stageNames[] = { "Crop", "Resample", "LungWallFeature", "VesselnessFeature",
+    "IntensityFeature", "EdgeFeature", "Aggregation", "FastMarching", "GeodesicActiveContour" };
+
+  for( const char * name : stageNames )
+    {
+    const StageReportType::StageType stage = report->GetStage( name );
+    if( stage.NumberOfExecutions != 1 )
+      {
+      std::cerr << "Stage " << name << " executed " << stage.NumberOfExecutions << " times" << std::endl;
+      return EXIT_FAILURE;
+      }
+    if( stage.WallTime < 0.0 || stage.ExclusiveWallTime < 0.0 || stage.ExclusiveWallTime > stage.WallTime )
+      {
+      std::cerr << "Inconsistent times for stage " << name << std::endl;
+      return EXIT_FAILURE;
+      }
+    if( stage.NumberOfVoxels == 0 )
+      {
+      std::cerr << "No voxels reported for stage " << name << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  const StageReportType::StageType aggregation = report->GetStage( "Aggregation" );
+  const StageReportType::StageType lungWall = report->GetStage( "LungWallFeature" );
+
+  if( lungWall.ParentName != "Aggregation" || aggregation.ExclusiveWallTime > aggregation.WallTime - lungWall.WallTime + 1e-6 )
+    {
+    std::cerr << "The feature generators were not accounted as children of the aggregation" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  //
+  // New seeds only re-execute the segmentation stages.
+  //
+  segmentationMethod->SetSeeds( landmarksReader->GetOutput()->GetPoints() );
+  segmentationMethod->SetPropagationScaling( 400.0 );
+
+  try
+    {
+    segmentationMethod->Update();
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if( report->GetNumberOfStages() != 2 ||
+      report->GetStage( "FastMarching" ).NumberOfExecutions != 1 ||
+      report->GetStage( "GeodesicActiveContour" ).NumberOfExecutions != 1 )
+    {
+    std::cerr << "Expected only the segmentation stages after new seeds" << std::endl;
+    report->Print( std::cerr );
+    return EXIT_FAILURE;
+    }
+#endif
+
+  std::ostringstream json;
+  report->WriteJSON( json );
+
+  if( json.str().find( "\"Stages\"" ) == std::string::npos )
+    {
+    std::cerr << "Unexpected JSON report" << std::endl << json.str() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  std::ofstream reportFile( argv[3] );
+  reportFile << json.str();
+
+  // Detaching the report stops the measurements.
+  segmentationMethod->SetStageReport( nullptr );
+  report->Clear();
+  segmentationMethod->SetPropagationScaling( 500.0 );
+
+  try
+    {
+    segmentationMethod->Update();
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if( report->GetNumberOfStages() != 0 )
+    {
+    std::cerr << "A detached report still measures the stages" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,269 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkSymmetricEigenSystem3x3Test1.cxx
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+// Compares the closed form eigen-decomposition of symmetric 3x3 matrices
+// with vnl_symmetric_eigensystem, on random matrices and on matrices with
+// repeated eigenvalues. Then checks that the vessel enhancing diffusion and
+// the Hessian image provider give the same results with either solver.
+
+#include "itkSymmetricEigenSystem3x3.h"
+#include "itkVesselEnhancingDiffusion3DImageFilter.h"
+#include "itkHessianImageProvider.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkTimeProbe.h"
+
+#include <vnl/vnl_matrix.h>
+#include <vnl/algo/vnl_symmetric_eigensystem.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+int itkSymmetricEigenSystem3x3Test1( int itkNotUsed(argc), char * itkNotUsed(argv) [] )
+{
+  using EigenSystemType = itk::SymmetricEigenSystem3x3< double >;
+  using GeneratorType = itk::Statistics::MersenneTwisterRandomVariateGenerator;
+
+  GeneratorType::Pointer generator = GeneratorType::New();
+  generator->Initialize( 1234 );
+
+  //
+  // Random matrices, one in three with a double eigenvalue and one in three
+  // with nearly vanishing off-diagonal elements.
+  //
+  constexpr unsigned int NumberOfMatrices = 10000;
+
+  std::vector< double > xx( NumberOfMatrices );
+  std::vector< double > xy( NumberOfMatrices );
+  std::vector< double > xz( NumberOfMatrices );
+  std::vector< double > yy( NumberOfMatrices );
+  std::vector< double > yz( NumberOfMatrices );
+  std::vector< double > zz( NumberOfMatrices );
+
+  for( unsigned int i = 0; i < NumberOfMatrices; i++ )
+    {
+    xx[i] = generator->GetUniformVariate( -100.0, 100.0 );
+    xy[i] = generator->GetUniformVariate( -100.0, 100.0 );
+    xz[i] = generator->GetUniformVariate( -100.0, 100.0 );
+    yy[i] = generator->GetUniformVariate( -100.0, 100.0 );
+    yz[i] = generator->GetUniformVariate( -100.0, 100.0 );
+    zz[i] = generator->GetUniformVariate( -100.0, 100.0 );
+    if( i % 3 == 1 )
+      {
+      xy[i] = 0.0;
+      xz[i] = 0.0;
+      yz[i] = 0.0;
+      yy[i] = xx[i];
+      }
+    else if( i % 3 == 2 )
+      {
+      xy[i] *= 1e-6;
+      xz[i] *= 1e-6;
+      yz[i] *= 1e-6;
+      }
+    }
+
+  std::vector< double > l0( NumberOfMatrices );
+  std::vector< double > l1( NumberOfMatrices );
+  std::vector< double > l2( NumberOfMatrices );
+
+  EigenSystemType::ComputeEigenValues( NumberOfMatrices, xx.data(), xy.data(), xz.data(),
+    yy.data(), yz.data(), zz.data(), l0.data(), l1.data(), l2.data() );
+
+  double maximumEigenValueError = 0.0;
+  double maximumResidual = 0.0;
+
+  for( unsigned int i = 0; i < NumberOfMatrices; i++ )
+    {
+    vnl_matrix< double > H( 3, 3 );
+    H( 0, 0 ) = xx[i];
+    H( 0, 1 ) = H( 1, 0 ) = xy[i];
+    H( 0, 2 ) = H( 2, 0 ) = xz[i];
+    H( 1, 1 ) = yy[i];
+    H( 1, 2 ) = H( 2, 1 ) = yz[i];
+    H( 2, 2 ) = zz[i];
+
+    vnl_symmetric_eigensystem< double > ES( H );
+
+    const double eigenValues[3] = { l0[i], l1[i], l2[i] };
+    const double scale = std::max( std::abs( ES.get_eigenvalue( 0 ) ), std::abs( ES.get_eigenvalue( 2 ) ) );
+
+    for( unsigned int k = 0; k < 3; k++ )
+      {
+      maximumEigenValueError = std::max( maximumEigenValueError,
+        std::abs( eigenValues[k] - ES.get_eigenvalue( k ) ) / scale );
+
+      // The scalar and the batched solvers agree, up to the floating
+      // point contractions the compiler may apply to the inlined loop.
+      double scalarEigenValues[3];
+      EigenSystemType::ComputeEigenValues( xx[i], xy[i], xz[i], yy[i], yz[i], zz[i], scalarEigenValues );
+      if( std::abs( scalarEigenValues[k] - eigenValues[k] ) > 1e-12 * scale )
+        {
+        std::cerr << "The batched eigenvalues of matrix " << i << " differ from the scalar ones" << std::endl;
+        return EXIT_FAILURE;
+        }
+
+      // The eigenvector is a unit vector, and H v = lambda v.
+      double v[3];
+      EigenSystemType::ComputeEigenVector( xx[i], xy[i], xz[i], yy[i], yz[i], zz[i], eigenValues[k], v );
+
+      const double norm = std::sqrt( v[0] * v[0] + v[1] * v[1] + v[2] * v[2] );
+      if( std::abs( norm - 1.0 ) > 1e-12 )
+        {
+        std::cerr << "The eigenvector " << k << " of matrix " << i << " has norm " << norm << std::endl;
+        return EXIT_FAILURE;
+        }
+
+      double residual = 0.0;
+      for( unsigned int r = 0; r < 3; r++ )
+        {
+        const double hv = H( r, 0 ) * v[0] + H( r, 1 ) * v[1] + H( r, 2 ) * v[2] - eigenValues[k] * v[r];
+        residual += hv * hv;
+        }
+      maximumResidual = std::max( maximumResidual, std::sqrt( residual ) / scale );
+      }
+    }
+
+  std::cout << "Largest relative eigenvalue error " << maximumEigenValueError << std::endl;
+  std::cout << "Largest relative eigenvector residual " << maximumResidual << std::endl;
+
+  if( maximumEigenValueError > 1e-7 || maximumResidual > 1e-6 )
+    {
+    std::cerr << "The closed form eigen-decomposition is not accurate enough" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // A multiple of the identity.
+  double identityEigenValues[3];
+  EigenSystemType::ComputeEigenValues( 2.0, 0.0, 0.0, 2.0, 0.0, 2.0, identityEigenValues );
+  if( identityEigenValues[0] != 2.0 || identityEigenValues[1] != 2.0 || identityEigenValues[2] != 2.0 )
+    {
+    std::cerr << "The eigenvalues of 2 I are " << identityEigenValues[0] << " "
+              << identityEigenValues[1] << " " << identityEigenValues[2] << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  //
+  // The vessel enhancing diffusion of a synthetic vessel with either solver.
+  //
+  constexpr unsigned int Dimension = 3;
+
+  using DiffusionFilterType = itk::VesselEnhancingDiffusion3DImageFilter< short, Dimension >;
+  using ImageType = DiffusionFilterType::ImageType;
+
+  ImageType::SizeType size;
+  size[0] = 40;
+  size[1] = 32;
+  size[2] = 24;
+
+  ImageType::RegionType region;
+  region.SetSize( size );
+
+  ImageType::Pointer input = ImageType::New();
+  input->SetRegions( region );
+  input->Allocate();
+
+  itk::ImageRegionIteratorWithIndex< ImageType > iitr( input, region );
+  for( iitr.GoToBegin(); !iitr.IsAtEnd(); ++iitr )
+    {
+    const ImageType::IndexType & index = iitr.GetIndex();
+    const double dy = index[1] - 16.0;
+    const double dz = index[2] - 12.0 - ( index[0] - 20.0 ) * 0.3;
+    iitr.Set( ( dy * dy + dz * dz < 9.0 ) ? 400 : -600 );
+    }
+
+  DiffusionFilterType::Pointer diffusions[2];
+  for( unsigned int k = 0; k < 2; k++ )
+    {
+    diffusions[k] = DiffusionFilterType::New();
+    diffusions[k]->SetInput( input );
+    diffusions[k]->SetDefaultPars();
+    diffusions[k]->SetVerbose( false );
+    diffusions[k]->SetIterations( 3 );
+    diffusions[k]->SetRecalculateVesselness( 1 );
+    diffusions[k]->SetUseClosedFormEigenSystem( k == 0 );
+
+    itk::TimeProbe probe;
+    try
+      {
+      probe.Start();
+      diffusions[k]->Update();
+      probe.Stop();
+      }
+    catch( itk::ExceptionObject & excp )
+      {
+      std::cerr << excp << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    std::cout << ( k == 0 ? "Closed form" : "vnl" ) << " diffusion: " << probe.GetTotal() << " s" << std::endl;
+    }
+
+  // Both work in single precision, the outputs may differ by the rounding
+  // to the pixel type.
+  itk::ImageRegionConstIterator< ImageType > citr( diffusions[0]->GetOutput(), region );
+  itk::ImageRegionConstIterator< ImageType > vitr( diffusions[1]->GetOutput(), region );
+  for( citr.GoToBegin(), vitr.GoToBegin(); !citr.IsAtEnd(); ++citr, ++vitr )
+    {
+    if( std::abs( citr.Get() - vitr.Get() ) > 1 )
+      {
+      std::cerr << "The diffusion with the closed form solver gives " << citr.Get()
+                << " instead of " << vitr.Get() << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  //
+  // The Hessian eigenvalues of the provider with either solver.
+  //
+  using ProviderType = itk::HessianImageProvider< Dimension >;
+  using ProviderInputImageType = ProviderType::InputImageType;
+  using EigenValueImageType = ProviderType::EigenValueImageType;
+
+  ProviderType::Pointer provider = ProviderType::New();
+
+  const ProviderInputImageType * providerInput = input.GetPointer();
+
+  EigenValueImageType::ConstPointer analysisEigenValues = provider->GetEigenValues( providerInput, 1.5 );
+
+  provider->ReleaseCachedImages();
+  provider->UseClosedFormEigenAnalysisOn();
+  provider->Print( std::cout );
+
+  EigenValueImageType::ConstPointer closedFormEigenValues = provider->GetEigenValues( providerInput, 1.5 );
+
+  itk::ImageRegionConstIterator< EigenValueImageType > aitr( analysisEigenValues, region );
+  itk::ImageRegionConstIterator< EigenValueImageType > fitr( closedFormEigenValues, region );
+  for( aitr.GoToBegin(), fitr.GoToBegin(); !aitr.IsAtEnd(); ++aitr, ++fitr )
+    {
+    const double scale = std::max( 1.0, std::max( std::abs( aitr.Get()[0] ), std::abs( aitr.Get()[2] ) ) );
+    for( unsigned int k = 0; k < Dimension; k++ )
+      {
+      if( std::abs( aitr.Get()[k] - fitr.Get()[k] ) > 1e-6 * scale )
+        {
+        std::cerr << "The closed form eigenvalues " << fitr.Get() << " differ from "
+                  << aitr.Get() << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
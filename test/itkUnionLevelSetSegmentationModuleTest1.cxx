@@ -0,0 +1,263 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkUnionLevelSetSegmentationModuleTest1.cxx
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+// Segments two touching spherical lesions, symmetric around the plane
+// x = 19, in a single evolution, and checks that the labels split them at
+// that plane and that the level set of every lesion is the one of the
+// union inside of the lesion only. A lesion added without seeds gets an
+// empty level set.
+
+#include "itkImage.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkUnionLevelSetSegmentationModule.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+int itkUnionLevelSetSegmentationModuleTest1( int itkNotUsed(argc), char * itkNotUsed(argv) [] )
+{
+  constexpr unsigned int Dimension = 3;
+  using SegmentationModuleType = itk::UnionLevelSetSegmentationModule< Dimension >;
+
+  using FeatureImageType = SegmentationModuleType::FeatureImageType;
+  using OutputImageType = SegmentationModuleType::OutputImageType;
+  using LabelImageType = SegmentationModuleType::LabelImageType;
+  using FeatureSpatialObjectType = SegmentationModuleType::FeatureSpatialObjectType;
+  using OutputSpatialObjectType = SegmentationModuleType::OutputSpatialObjectType;
+  using InputSpatialObjectType = SegmentationModuleType::InputSpatialObjectType;
+  using PointListType = SegmentationModuleType::PointListType;
+
+  FeatureImageType::SizeType size;
+  size[0] = 38;
+  size[1] = 24;
+  size[2] = 24;
+
+  FeatureImageType::RegionType region;
+  region.SetSize( size );
+
+  //
+  // The feature is high inside of two balls of radius 7, centered 14 pixels
+  // apart, and drops at their boundaries and in the valley between them.
+  //
+  const double radius = 7.0;
+  const double centers[2][Dimension] = { { 12.0, 12.0, 12.0 }, { 26.0, 12.0, 12.0 } };
+
+  FeatureImageType::Pointer featureImage = FeatureImageType::New();
+  featureImage->SetRegions( region );
+  featureImage->Allocate();
+
+  itk::ImageRegionIteratorWithIndex< FeatureImageType > fitr( featureImage, region );
+  for( fitr.GoToBegin(); !fitr.IsAtEnd(); ++fitr )
+    {
+    double feature = 0.0;
+    for( unsigned int k = 0; k < 2; k++ )
+      {
+      double distance2 = 0.0;
+      for( unsigned int d = 0; d < Dimension; d++ )
+        {
+        const double delta = fitr.GetIndex()[d] - centers[k][d];
+        distance2 += delta * delta;
+        }
+      const double ratio2 = distance2 / ( radius * radius );
+      feature = std::max( feature, 1.0 / ( 1.0 + ratio2 * ratio2 * ratio2 * ratio2 ) );
+      }
+    fitr.Set( static_cast< FeatureImageType::PixelType >( feature ) );
+    }
+
+  FeatureSpatialObjectType::Pointer featureObject = FeatureSpatialObjectType::New();
+  featureObject->SetImage( featureImage );
+
+  FeatureImageType::IndexType seedIndex[2];
+  PointListType lesionSeeds[2];
+  PointListType allSeeds;
+
+  for( unsigned int k = 0; k < 2; k++ )
+    {
+    InputSpatialObjectType::PointType position;
+    for( unsigned int d = 0; d < Dimension; d++ )
+      {
+      position[d] = centers[k][d];
+      seedIndex[k][d] = static_cast< itk::IndexValueType >( centers[k][d] );
+      }
+    InputSpatialObjectType::LandmarkPointType seed;
+    seed.SetPosition( position );
+    lesionSeeds[k].push_back( seed );
+    allSeeds.push_back( seed );
+    }
+
+  SegmentationModuleType::Pointer segmentationModule = SegmentationModuleType::New();
+  segmentationModule->SetFeature( featureObject );
+  segmentationModule->AddLesion( lesionSeeds[0] );
+  segmentationModule->AddLesion( lesionSeeds[1] );
+  segmentationModule->SetStoppingValue( 100.0 );
+  segmentationModule->SetDistanceFromSeeds( 2.0 );
+  segmentationModule->SetMaximumNumberOfIterations( 50 );
+
+  // The same lesions, given as the points of the input landmarks.
+  InputSpatialObjectType::Pointer inputObject = InputSpatialObjectType::New();
+  inputObject->SetPoints( allSeeds );
+
+  SegmentationModuleType::Pointer pointModule = SegmentationModuleType::New();
+  pointModule->SetFeature( featureObject );
+  pointModule->SetInput( inputObject );
+  pointModule->SetStoppingValue( 100.0 );
+  pointModule->SetDistanceFromSeeds( 2.0 );
+  pointModule->SetMaximumNumberOfIterations( 50 );
+
+  try
+    {
+    segmentationModule->Update();
+    pointModule->Update();
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  segmentationModule->Print( std::cout );
+
+  if( segmentationModule->GetNumberOfLesions() != 2 || pointModule->GetNumberOfLesions() != 2 )
+    {
+    std::cerr << "Segmented " << segmentationModule->GetNumberOfLesions() << " and "
+              << pointModule->GetNumberOfLesions() << " lesions instead of 2" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  const LabelImageType * labelMap = segmentationModule->GetLabelMap()->GetImage();
+  const LabelImageType * pointLabelMap = pointModule->GetLabelMap()->GetImage();
+
+  for( unsigned int k = 0; k < 2; k++ )
+    {
+    if( labelMap->GetPixel( seedIndex[k] ) != k + 1 )
+      {
+      std::cerr << "Seed " << seedIndex[k] << " has label " << labelMap->GetPixel( seedIndex[k] )
+                << " instead of " << k + 1 << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  //
+  // The labels split the union at the plane of symmetry, up to the rounding
+  // of the arrival times, and match the labels of the input points.
+  //
+  const OutputImageType * unionLevelSet =
+    dynamic_cast< const OutputSpatialObjectType * >( segmentationModule->GetOutput() )->GetImage();
+  const OutputImageType * lesionLevelSets[2] = {
+    segmentationModule->GetLesionSegmentation( 0 )->GetImage(),
+    segmentationModule->GetLesionSegmentation( 1 )->GetImage() };
+
+  itk::ImageRegionConstIteratorWithIndex< LabelImageType > litr( labelMap, region );
+  for( litr.GoToBegin(); !litr.IsAtEnd(); ++litr )
+    {
+    const LabelImageType::IndexType & index = litr.GetIndex();
+    const SegmentationModuleType::LabelPixelType label = litr.Get();
+
+    if( ( label == 1 && index[0] > 20 ) || ( label == 2 && index[0] < 18 ) )
+      {
+      std::cerr << "Pixel " << index << " has label " << label << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    if( label != pointLabelMap->GetPixel( index ) )
+      {
+      std::cerr << "Pixel " << index << " has label " << label << " when the lesions are added, and "
+                << pointLabelMap->GetPixel( index ) << " when they are the input points" << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    // Encoded with positive values inside, the level set of a lesion equals
+    // the one of the union in the lesion and is lower elsewhere.
+    const OutputImageType::PixelType unionValue = unionLevelSet->GetPixel( index );
+    for( unsigned int k = 0; k < 2; k++ )
+      {
+      const OutputImageType::PixelType lesionValue = lesionLevelSets[k]->GetPixel( index );
+      if( lesionValue > unionValue + 1e-5 || ( label == k + 1 && std::abs( lesionValue - unionValue ) > 1e-5 ) )
+        {
+        std::cerr << "Level set of lesion " << k << " is " << lesionValue << " at " << index
+                  << " where the one of the union is " << unionValue << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  // Each seed is outside of the other lesion.
+  if( !( lesionLevelSets[1]->GetPixel( seedIndex[0] ) < lesionLevelSets[0]->GetPixel( seedIndex[0] ) ) ||
+      !( lesionLevelSets[0]->GetPixel( seedIndex[1] ) < lesionLevelSets[1]->GetPixel( seedIndex[1] ) ) )
+    {
+    std::cerr << "A seed is not more inside of its lesion than of the other one" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  //
+  // A trailing lesion without seeds is segmented as well, with an empty
+  // level set: outside of every lesion, it is the lowest of their level sets.
+  //
+  segmentationModule->AddLesion( PointListType() );
+
+  try
+    {
+    segmentationModule->Update();
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if( segmentationModule->GetNumberOfLesions() != 3 )
+    {
+    std::cerr << "Segmented " << segmentationModule->GetNumberOfLesions()
+              << " lesions instead of 3 with a lesion without seeds" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  const OutputImageType * seededLevelSets[2] = {
+    segmentationModule->GetLesionSegmentation( 0 )->GetImage(),
+    segmentationModule->GetLesionSegmentation( 1 )->GetImage() };
+  const OutputImageType * emptyLevelSet = segmentationModule->GetLesionSegmentation( 2 )->GetImage();
+
+  itk::ImageRegionConstIteratorWithIndex< OutputImageType > eitr( emptyLevelSet, region );
+  for( eitr.GoToBegin(); !eitr.IsAtEnd(); ++eitr )
+    {
+    const OutputImageType::IndexType & index = eitr.GetIndex();
+    const OutputImageType::PixelType lowestValue =
+      std::min( seededLevelSets[0]->GetPixel( index ), seededLevelSets[1]->GetPixel( index ) );
+    if( std::abs( eitr.Get() - lowestValue ) > 1e-5 )
+      {
+      std::cerr << "Level set of the lesion without seeds is " << eitr.Get() << " at " << index
+                << " instead of " << lowestValue << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  segmentationModule->ClearLesions();
+
+  try
+    {
+    segmentationModule->GetLesionSegmentation( 2 );
+    std::cerr << "Failed to throw for a lesion that was not segmented" << std::endl;
+    return EXIT_FAILURE;
+    }
+  catch( itk::ExceptionObject & )
+    {
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,222 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkVesselEnhancingDiffusion3DImageFilterTest1.cxx
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+
+// Runs the vessel enhancing diffusion of a synthetic vessel with several
+// numbers of work units, and checks that the outputs are identical and that
+// the diffusion changed the image. Then checks that the strided stencil of
+// the inner region agrees with the neighborhood iterators, and that the
+// interleaved storage of the tensor gives the same diffusion.
+
+#include "itkVesselEnhancingDiffusion3DImageFilter.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkTimeProbe.h"
+
+#include <cmath>
+#include <cstdlib>
+
+int itkVesselEnhancingDiffusion3DImageFilterTest1( int itkNotUsed(argc), char * itkNotUsed(argv) [] )
+{
+  constexpr unsigned int Dimension = 3;
+
+  using FilterType = itk::VesselEnhancingDiffusion3DImageFilter< short, Dimension >;
+  using ImageType = FilterType::ImageType;
+
+  //
+  // A tube running diagonally across the slices, on a noisy background,
+  // with a thick slice spacing so that all the offsets of the stencil
+  // matter.
+  //
+  ImageType::SizeType size;
+  size[0] = 40;
+  size[1] = 32;
+  size[2] = 24;
+
+  ImageType::RegionType region;
+  region.SetSize( size );
+
+  ImageType::SpacingType spacing;
+  spacing[0] = 0.7;
+  spacing[1] = 0.7;
+  spacing[2] = 1.25;
+
+  ImageType::Pointer input = ImageType::New();
+  input->SetRegions( region );
+  input->SetSpacing( spacing );
+  input->Allocate();
+
+  itk::ImageRegionIteratorWithIndex< ImageType > iitr( input, region );
+  for( iitr.GoToBegin(); !iitr.IsAtEnd(); ++iitr )
+    {
+    const ImageType::IndexType & index = iitr.GetIndex();
+    const double dy = ( index[1] - 16.0 ) * spacing[1];
+    const double dz = ( index[2] - 12.0 ) * spacing[2] - ( index[0] - 20.0 ) * spacing[0] * 0.5;
+    const short noise = static_cast< short >( ( index[0] * 7 + index[1] * 13 + index[2] * 29 ) % 41 ) - 20;
+    iitr.Set( ( ( dy * dy + dz * dz < 4.0 ) ? 400 : -600 ) + noise );
+    }
+
+  const unsigned int numberOfWorkUnits[] = { 1, 2, 5 };
+  constexpr unsigned int numberOfRuns = sizeof( numberOfWorkUnits ) / sizeof( numberOfWorkUnits[0] );
+
+  FilterType::Pointer filters[numberOfRuns];
+
+  for( unsigned int k = 0; k < numberOfRuns; k++ )
+    {
+    filters[k] = FilterType::New();
+    filters[k]->SetInput( input );
+    filters[k]->SetDefaultPars();
+    filters[k]->SetVerbose( false );
+    filters[k]->SetIterations( 4 );
+    // Recomputes the tensor at the first and the second iteration, and
+    // reuses it for the others.
+    filters[k]->SetRecalculateVesselness( 2 );
+    filters[k]->SetNumberOfWorkUnits( numberOfWorkUnits[k] );
+
+    itk::TimeProbe probe;
+    try
+      {
+      probe.Start();
+      filters[k]->Update();
+      probe.Stop();
+      }
+    catch( itk::ExceptionObject & excp )
+      {
+      std::cerr << excp << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    std::cout << numberOfWorkUnits[k] << " work units: " << probe.GetTotal() << " s" << std::endl;
+    }
+
+  filters[0]->Print( std::cout );
+
+  using IteratorType = itk::ImageRegionConstIterator< ImageType >;
+
+  itk::SizeValueType numberOfChangedPixels = 0;
+
+  IteratorType sitr( input, region );
+  IteratorType ritr( filters[0]->GetOutput(), region );
+  for( sitr.GoToBegin(), ritr.GoToBegin(); !sitr.IsAtEnd(); ++sitr, ++ritr )
+    {
+    if( sitr.Get() != ritr.Get() )
+      {
+      numberOfChangedPixels++;
+      }
+    }
+
+  if( numberOfChangedPixels == 0 )
+    {
+    std::cerr << "The diffusion did not change the image" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  for( unsigned int k = 1; k < numberOfRuns; k++ )
+    {
+    itk::ImageRegionConstIteratorWithIndex< ImageType > kitr( filters[k]->GetOutput(), region );
+    for( ritr.GoToBegin(), kitr.GoToBegin(); !ritr.IsAtEnd(); ++ritr, ++kitr )
+      {
+      if( ritr.Get() != kitr.Get() )
+        {
+        std::cerr << "Output with " << numberOfWorkUnits[k] << " work units differs at "
+                  << kitr.GetIndex() << ": " << kitr.Get() << " instead of " << ritr.Get() << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  //
+  // The same diffusion with the neighborhood iterators over the whole
+  // image. The order of the operations is the same, only the contraction
+  // of multiply-adds by the compiler may differ.
+  //
+  FilterType::Pointer iteratorFilter = FilterType::New();
+  iteratorFilter->SetInput( input );
+  iteratorFilter->SetDefaultPars();
+  iteratorFilter->SetVerbose( false );
+  iteratorFilter->SetIterations( 4 );
+  iteratorFilter->SetRecalculateVesselness( 2 );
+  iteratorFilter->UseStridedStencilOff();
+
+  itk::TimeProbe iteratorProbe;
+  try
+    {
+    iteratorProbe.Start();
+    iteratorFilter->Update();
+    iteratorProbe.Stop();
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  std::cout << "Neighborhood iterators: " << iteratorProbe.GetTotal() << " s" << std::endl;
+
+  itk::ImageRegionConstIteratorWithIndex< ImageType > nitr( iteratorFilter->GetOutput(), region );
+  for( ritr.GoToBegin(), nitr.GoToBegin(); !ritr.IsAtEnd(); ++ritr, ++nitr )
+    {
+    if( std::abs( ritr.Get() - nitr.Get() ) > 1 )
+      {
+      std::cerr << "The strided stencil gives " << ritr.Get() << " at " << nitr.GetIndex()
+                << " instead of " << nitr.Get() << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  //
+  // The same diffusion with the tensor interleaved in a single buffer. The
+  // boundary faces are diffused by the strided kernel, with the same order
+  // of the operations as the neighborhood iterators.
+  //
+  FilterType::Pointer interleavedFilter = FilterType::New();
+  interleavedFilter->SetInput( input );
+  interleavedFilter->SetDefaultPars();
+  interleavedFilter->SetVerbose( false );
+  interleavedFilter->SetIterations( 4 );
+  interleavedFilter->SetRecalculateVesselness( 2 );
+  interleavedFilter->SetNumberOfWorkUnits( 2 );
+  interleavedFilter->UseInterleavedTensorOn();
+
+  itk::TimeProbe interleavedProbe;
+  try
+    {
+    interleavedProbe.Start();
+    interleavedFilter->Update();
+    interleavedProbe.Stop();
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  std::cout << "Interleaved tensor: " << interleavedProbe.GetTotal() << " s" << std::endl;
+
+  itk::ImageRegionConstIteratorWithIndex< ImageType > litr( interleavedFilter->GetOutput(), region );
+  for( ritr.GoToBegin(), litr.GoToBegin(); !ritr.IsAtEnd(); ++ritr, ++litr )
+    {
+    if( std::abs( ritr.Get() - litr.Get() ) > 1 )
+      {
+      std::cerr << "The interleaved tensor gives " << litr.Get() << " at " << litr.GetIndex()
+                << " instead of " << ritr.Get() << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,148 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkVotingBinaryHoleFillFloodingImageFilterTest2.cxx
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even 
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR 
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#if defined(_MSC_VER)
+#pragma warning ( disable : 4786 )
+#endif
+
+// Checks that filling the holes on several threads gives exactly the result
+// of a single thread.
+
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkBinaryThresholdImageFilter.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkVotingBinaryHoleFillFloodingImageFilter.h"
+
+int itkVotingBinaryHoleFillFloodingImageFilterTest2( int argc, char * argv[] )
+{
+  if( argc < 6 )
+    {
+    std::cerr << "Usage: " << std::endl;
+    std::cerr << argv[0] << " inputImageFile inputThreshold radius majority maxNumberOfIterations" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+
+  using InputPixelType = signed short;
+  using OutputPixelType = unsigned char;
+
+  constexpr unsigned int Dimension = 3;
+
+  using InputImageType = itk::Image< InputPixelType,  Dimension >;
+  using OutputImageType = itk::Image< OutputPixelType, Dimension >;
+
+  using ReaderType = itk::ImageFileReader< InputImageType >;
+
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( argv[1] );
+
+  using ThresholderType = itk::BinaryThresholdImageFilter< 
+    InputImageType, OutputImageType >;
+
+  ThresholderType::Pointer thresholder = ThresholderType::New();
+
+  thresholder->SetLowerThreshold( atoi( argv[2] ) );
+  thresholder->SetUpperThreshold( itk::NumericTraits< InputPixelType >::max() );
+
+  thresholder->SetOutsideValue(  0 );
+  thresholder->SetInsideValue( 255 );
+
+  thresholder->SetInput( reader->GetOutput() );
+
+  try
+    {
+    thresholder->Update();
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  using FilterType = itk::VotingBinaryHoleFillFloodingImageFilter< 
+    OutputImageType, OutputImageType >;
+
+  OutputImageType::SizeType indexRadius;
+  indexRadius.Fill( atoi( argv[3] ) );
+
+  const unsigned int numberOfWorkUnits[] = { 1, 3, 8 };
+
+  FilterType::Pointer filters[3];
+
+  for( unsigned int k = 0; k < 3; k++ )
+    {
+    filters[k] = FilterType::New();
+    filters[k]->SetInput( thresholder->GetOutput() );
+    filters[k]->SetRadius( indexRadius );
+    filters[k]->SetBackgroundValue(   0 );
+    filters[k]->SetForegroundValue( 255 );
+    filters[k]->SetMajorityThreshold( atoi( argv[4] ) );
+    filters[k]->SetMaximumNumberOfIterations( atoi( argv[5] ) );
+    filters[k]->SetNumberOfWorkUnits( numberOfWorkUnits[k] );
+
+    try
+      {
+      filters[k]->Update();
+      }
+    catch( itk::ExceptionObject & excp )
+      {
+      std::cerr << excp << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    std::cout << numberOfWorkUnits[k] << " work units: "
+              << filters[k]->GetCurrentIterationNumber() << " iterations, "
+              << filters[k]->GetTotalNumberOfPixelsChanged() << " pixels changed" << std::endl;
+    }
+
+  if( filters[0]->GetTotalNumberOfPixelsChanged() == 0 )
+    {
+    std::cerr << "No hole was filled, the test is not significant" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  using IteratorType = itk::ImageRegionConstIteratorWithIndex< OutputImageType >;
+
+  for( unsigned int k = 1; k < 3; k++ )
+    {
+    if( filters[k]->GetCurrentIterationNumber() != filters[0]->GetCurrentIterationNumber() ||
+        filters[k]->GetTotalNumberOfPixelsChanged() != filters[0]->GetTotalNumberOfPixelsChanged() )
+      {
+      std::cerr << "The front propagation with " << numberOfWorkUnits[k]
+                << " work units differs from the one with a single work unit" << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    const OutputImageType * serialOutput = filters[0]->GetOutput();
+    const OutputImageType * parallelOutput = filters[k]->GetOutput();
+
+    IteratorType sitr( serialOutput, serialOutput->GetBufferedRegion() );
+    IteratorType pitr( parallelOutput, parallelOutput->GetBufferedRegion() );
+
+    for( sitr.GoToBegin(), pitr.GoToBegin(); !sitr.IsAtEnd(); ++sitr, ++pitr )
+      {
+      if( sitr.Get() != pitr.Get() )
+        {
+        std::cerr << "Output with " << numberOfWorkUnits[k] << " work units differs at "
+                  << sitr.GetIndex() << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,144 @@
+/*=========================================================================
+
+  Program:   Insight Segmentation & Registration Toolkit
+  Module:    itkVotingBinaryHoleFillFloodingImageFilterTest3.cxx
+  Language:  C++
+  Date:      $Date$
+  Version:   $Revision$
+
+  Copyright (c) Insight Software Consortium. All rights reserved.
+  See ITKCopyright.txt or http://www.itk.org/HTML/Copyright.htm for details.
+
+     This software is distributed WITHOUT ANY WARRANTY; without even 
+     the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR 
+     PURPOSE.  See the above copyright notices for more information.
+
+=========================================================================*/
+#if defined(_MSC_VER)
+#pragma warning ( disable : 4786 )
+#endif
+
+// Checks that filling the holes on bit planes gives exactly the result of
+// filling them on the output image, for several neighborhood radii.
+
+#include "itkImage.h"
+#include "itkImageFileReader.h"
+#include "itkBinaryThresholdImageFilter.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkVotingBinaryHoleFillFloodingImageFilter.h"
+
+int itkVotingBinaryHoleFillFloodingImageFilterTest3( int argc, char * argv[] )
+{
+  if( argc < 6 )
+    {
+    std::cerr << "Usage: " << std::endl;
+    std::cerr << argv[0] << " inputImageFile inputThreshold radius majority maxNumberOfIterations" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+
+  using InputPixelType = signed short;
+  using OutputPixelType = unsigned char;
+
+  constexpr unsigned int Dimension = 3;
+
+  using InputImageType = itk::Image< InputPixelType,  Dimension >;
+  using OutputImageType = itk::Image< OutputPixelType, Dimension >;
+
+  using ReaderType = itk::ImageFileReader< InputImageType >;
+
+  ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( argv[1] );
+
+  using ThresholderType = itk::BinaryThresholdImageFilter< 
+    InputImageType, OutputImageType >;
+
+  ThresholderType::Pointer thresholder = ThresholderType::New();
+
+  thresholder->SetLowerThreshold( atoi( argv[2] ) );
+  thresholder->SetUpperThreshold( itk::NumericTraits< InputPixelType >::max() );
+
+  thresholder->SetOutsideValue(  0 );
+  thresholder->SetInsideValue( 255 );
+
+  thresholder->SetInput( reader->GetOutput() );
+
+  try
+    {
+    thresholder->Update();
+    }
+  catch( itk::ExceptionObject & excp )
+    {
+    std::cerr << excp << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  using FilterType = itk::VotingBinaryHoleFillFloodingImageFilter< 
+    OutputImageType, OutputImageType >;
+
+  using IteratorType = itk::ImageRegionConstIteratorWithIndex< OutputImageType >;
+
+  // The radius along the first dimension covers windows within a word,
+  // across two words, and as wide as a word. The first two neighborhoods
+  // are isotropic, the last one is not.
+  const unsigned int radii[] = { 1, static_cast< unsigned int >( atoi( argv[3] ) ), 31 };
+
+  for( unsigned int r = 0; r < 3; r++ )
+    {
+    OutputImageType::SizeType indexRadius;
+    indexRadius.Fill( ( r < 2 ) ? radii[r] : 1 );
+    indexRadius[0] = radii[r];
+
+    FilterType::Pointer filters[2];
+
+    for( unsigned int k = 0; k < 2; k++ )
+      {
+      filters[k] = FilterType::New();
+      filters[k]->SetInput( thresholder->GetOutput() );
+      filters[k]->SetRadius( indexRadius );
+      filters[k]->SetBackgroundValue(   0 );
+      filters[k]->SetForegroundValue( 255 );
+      filters[k]->SetMajorityThreshold( atoi( argv[4] ) );
+      filters[k]->SetMaximumNumberOfIterations( atoi( argv[5] ) );
+      filters[k]->SetUseBitPackedImages( k == 1 );
+
+      try
+        {
+        filters[k]->Update();
+        }
+      catch( itk::ExceptionObject & excp )
+        {
+        std::cerr << excp << std::endl;
+        return EXIT_FAILURE;
+        }
+
+      std::cout << "Radius " << indexRadius << ( k == 1 ? " bit planes: " : " images: " )
+                << filters[k]->GetCurrentIterationNumber() << " iterations, "
+                << filters[k]->GetTotalNumberOfPixelsChanged() << " pixels changed" << std::endl;
+      }
+
+    if( filters[1]->GetCurrentIterationNumber() != filters[0]->GetCurrentIterationNumber() ||
+        filters[1]->GetTotalNumberOfPixelsChanged() != filters[0]->GetTotalNumberOfPixelsChanged() )
+      {
+      std::cerr << "The front propagation on bit planes differs from the one on images" << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    const OutputImageType * imageOutput = filters[0]->GetOutput();
+    const OutputImageType * bitPlaneOutput = filters[1]->GetOutput();
+
+    IteratorType iitr( imageOutput, imageOutput->GetBufferedRegion() );
+    IteratorType bitr( bitPlaneOutput, bitPlaneOutput->GetBufferedRegion() );
+
+    for( iitr.GoToBegin(), bitr.GoToBegin(); !iitr.IsAtEnd(); ++iitr, ++bitr )
+      {
+      if( iitr.Get() != bitr.Get() )
+        {
+        std::cerr << "Output on bit planes differs at " << iitr.GetIndex() << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  return EXIT_SUCCESS;
+}